@@ -1,8 +1,31 @@
 /**********************************************************************************************************************
-File: template.c                                                                
+File: accelerometer_lis2dh.c
 
 Description:
-This is a template .c file new source code
+LIS2DH accelerometer driver on the I2C master.
+
+The sensor starts at 400 Hz and raises INT1 when a new sample is ready.  AccelUpdate() watches the pin from the
+main loop, reads the status and all three axes in one auto increment burst and passes the X axis to the motion
+detector in pov.c.  Block data update keeps the high and low bytes of each axis from the same sample.
+
+Sample times are taken when the main loop sees data ready, so they lag the sensor by up to one main loop pass
+(1 ms).  Periods measured between crossings see only the difference of two lags.
+
+Stillness: AccelGetStillMs() is the time since a sample last moved ACCEL_STILL_THRESHOLD away from the one before
+it that moved.  AccelSleep() sets the sensor up to wake the processor out of System OFF through INT1.
+
+Taps: the sensor's click engine finds single and double taps itself and raises INT2, which is a GPIOTE IN event.
+The interrupt only sets a flag; AccelUpdate() then reads CLICK_SRC once, so nothing looks at samples for taps.  A
+double tap is reported at once, a single tap ACCEL_TAP_SINGLE_MS later if no second one came.  AccelGetTap()
+returns them.  Each profile has its own click timing, since it counts samples; at 10 Hz taps are seldom seen.
+
+Profiles: AccelSetProfile() changes rate and resolution (pov.c picks one from the motion state).  The change is
+one burst to CTRL_REG1..CTRL_REG4 and one to the click timing, then any sample already waiting is read out and
+the next u8SettleSamples are dropped while the sensor settles, so every sample kept belongs to the new profile.
+Samples are left justified at every resolution and carry their own times, so the still reference and the zero
+crossing interpolation go on across a change; a dropped sample only makes one interval longer.  The time from
+the change to the first kept sample and the time spent in each profile (hence the average sensor current) are in
+AccelGetStats().
 **********************************************************************************************************************/
 
 #include "configuration.h"
@@ -12,7 +35,7 @@ Global variable definitions with scope across entire project.
 All Global variable names shall start with "G_"
 ***********************************************************************************************************************/
 /* New variables */
-volatile u32 G_u32TemplateFlags;                       /* Global state flags */
+volatile u32 G_u32AccelFlags;                          /* Global state flags */
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -25,9 +48,54 @@ extern volatile u32 G_u32SystemTime1s;                 /* From board-specific so
 
 /***********************************************************************************************************************
 Global variable definitions with scope limited to this local application.
-Variable names shall start with "Template_" and be declared as static.
+Variable names shall start with "Accel_" and be declared as static.
 ***********************************************************************************************************************/
-static u32 Template_u32Timeout;                      /* Timeout counter used across states */
+static AccelSampleType Accel_sSample;                  /* Latest sample */
+static AccelStatsType Accel_sStats;                    /* Read counts */
+static AccelSampleType Accel_sStillReference;          /* Last sample that counted as motion */
+static u32 Accel_u32LastMotionMs;                      /* SysTimeGetMs() of that sample */
+static volatile bool Accel_bTapInterrupt;              /* INT2 rose: CLICK_SRC has news (set by GPIOTE ISR) */
+static bool Accel_bSingleTapPending;                   /* A single tap that may still become a double */
+static u32 Accel_u32TapMs;                             /* SysTimeGetMs() of that tap */
+static u8 Accel_u8TapEvent;                            /* Taps waiting for AccelGetTap(), 0 = none */
+static u8 Accel_u8SettleSamples;                       /* Samples still to drop after a profile change */
+static bool Accel_bChangeTiming;                       /* A profile change waits for its first kept sample */
+static u32 Accel_u32ChangeUs;                          /* SysTimeGetUs() of that change */
+static u32 Accel_u32ProfileStartMs;                    /* SysTimeGetMs() when the profile time was last counted */
+
+/* Indexed by AccelProfileType */
+static const AccelProfileSettingsType Accel_asProfiles[ACCEL_PROFILES] =
+{
+  {ACCEL_IDLE_CTRL_REG1, ACCEL_IDLE_CTRL_REG4,
+   {ACCEL_IDLE_TIME_LIMIT, ACCEL_IDLE_TIME_LATENCY, ACCEL_IDLE_TIME_WINDOW},
+   ACCEL_IDLE_SETTLE_SAMPLES, ACCEL_IDLE_SINGLE_TAP_MS, ACCEL_IDLE_CURRENT_UA},
+  {ACCEL_SWING_CTRL_REG1, ACCEL_SWING_CTRL_REG4,
+   {TIME_LIMIT_INIT, TIME_LATENCY_INIT, TIME_WINDOW_INIT},
+   ACCEL_SWING_SETTLE_SAMPLES, ACCEL_TAP_SINGLE_MS, ACCEL_SWING_CURRENT_UA},
+  {ACCEL_SPIN_CTRL_REG1, ACCEL_SPIN_CTRL_REG4,
+   {TIME_LIMIT_INIT, TIME_LATENCY_INIT, TIME_WINDOW_INIT},
+   ACCEL_SPIN_SETTLE_SAMPLES, ACCEL_TAP_SINGLE_MS, ACCEL_SPIN_CURRENT_UA}
+};
+
+/* Control registers written at start up, CTRL_REG1 first */
+static const u8 Accel_au8CtrlInit[ACCEL_CTRL_SIZE] =
+{
+  CTRL_REG1_INIT, CTRL_REG2_INIT, CTRL_REG3_INIT, CTRL_REG4_INIT, CTRL_REG5_INIT, CTRL_REG6_INIT
+};
+
+/* Click threshold and timing, then sleep-to-wake threshold and duration, CLICK_THS first */
+static const u8 Accel_au8ClickInit[ACCEL_CLICK_SIZE] =
+{
+  CLICK_THS_INIT, TIME_LIMIT_INIT, TIME_LATENCY_INIT, TIME_WINDOW_INIT, ACT_THS_INIT, ACT_DUR_INIT
+};
+
+/* System OFF wake: control registers from CTRL_REG1, and INT1 threshold and duration from INT1_THS */
+static const u8 Accel_au8CtrlWake[ACCEL_CTRL_SIZE] =
+{
+  ACCEL_WAKE_CTRL_REG1, ACCEL_WAKE_CTRL_REG2, ACCEL_WAKE_CTRL_REG3, ACCEL_WAKE_CTRL_REG4, ACCEL_WAKE_CTRL_REG5,
+  ACCEL_WAKE_CTRL_REG6
+};
+static const u8 Accel_au8Int1Wake[] = {ACCEL_WAKE_INT1_THS, ACCEL_WAKE_INT1_DURATION};
 
 
 /**********************************************************************************************************************
@@ -38,27 +106,385 @@ Function Definitions
 /* Public functions                                                                                                   */
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AccelGetSample
+
+Description:
+Returns the latest acceleration sample.
+
+Requires:
+  - psSample_ points to space for the sample
+
+Promises:
+  - *psSample_ is the latest sample
+  - Returns false if the accelerometer is not working (the sample is not meaningful)
+*/
+bool AccelGetSample(AccelSampleType* psSample_)
+{
+  *psSample_ = Accel_sSample;
+
+  return( (G_u32AccelFlags & _ACCEL_FLAGS_PRESENT) != 0 );
+
+} /* end AccelGetSample() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AccelGetStats
+
+Description:
+Reports sample and error counts, profile changes and the average sensor current.
+
+Requires:
+  - psStats_ points to space for the statistics
+
+Promises:
+  - *psStats_ is a copy of the counts since start up, with the time in the present profile counted up to now
+  - u32AverageUa is the typical current of each profile weighted by the time spent in it
+*/
+void AccelGetStats(AccelStatsType* psStats_)
+{
+  u64 u64ChargeUaMs = 0;
+  u32 u32TotalMs = 0;
+
+  *psStats_ = Accel_sStats;
+  psStats_->au32ProfileMs[Accel_sStats.eProfile] += SysTimeElapsed(Accel_u32ProfileStartMs);
+
+  for(u8 i = 0; i < ACCEL_PROFILES; i++)
+  {
+    u64ChargeUaMs += (u64)psStats_->au32ProfileMs[i] * Accel_asProfiles[i].u16CurrentUa;
+    u32TotalMs += psStats_->au32ProfileMs[i];
+  }
+
+  psStats_->u32AverageUa = 0;
+  if(u32TotalMs != 0)
+  {
+    psStats_->u32AverageUa = (u32)(u64ChargeUaMs / u32TotalMs);
+  }
+
+} /* end AccelGetStats() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AccelGetStillMs
+
+Description:
+Reports how long the sensor has seen no motion.
+
+Requires:
+  -
+
+Promises:
+  - Returns the ms since the last sample that moved more than ACCEL_STILL_THRESHOLD on any axis
+  - Returns 0 if the accelerometer is not working (it could not wake the system)
+*/
+u32 AccelGetStillMs(void)
+{
+  if( !(G_u32AccelFlags & _ACCEL_FLAGS_PRESENT) )
+  {
+    return(0);
+  }
+
+  return(SysTimeElapsed(Accel_u32LastMotionMs));
+
+} /* end AccelGetStillMs() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AccelGetTap
+
+Description:
+Reads the oldest tap gesture.
+
+Requires:
+  - pu8Taps_ points to space for the tap count
+
+Promises:
+  - Returns false if there is no gesture
+  - Otherwise *pu8Taps_ is 1 (single tap) or 2 (double tap), returns true and the gesture is consumed
+*/
+bool AccelGetTap(u8* pu8Taps_)
+{
+  if(Accel_u8TapEvent == 0)
+  {
+    return(false);
+  }
+
+  *pu8Taps_ = Accel_u8TapEvent;
+  Accel_u8TapEvent = 0;
+  return(true);
+
+} /* end AccelGetTap() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AccelSetProfile
+
+Description:
+Changes the sample rate and resolution.  Cheap to call every pass: nothing is written unless the profile changes.
+
+Requires:
+  -
+
+Promises:
+  - If eProfile_ differs from the present profile, the sensor is switched to it and the samples that follow are
+    dropped until it has settled; the change is timed to the first sample kept
+  - If the sensor did not take the change, the profile is unchanged and the next call tries again
+*/
+void AccelSetProfile(AccelProfileType eProfile_)
+{
+  u32 u32StartUs;
+
+  if( !(G_u32AccelFlags & _ACCEL_FLAGS_PRESENT) || (eProfile_ == Accel_sStats.eProfile) )
+  {
+    return;
+  }
+
+  u32StartUs = SysTimeGetUs();
+  if( !AccelLoadProfile(eProfile_) )
+  {
+    return;
+  }
+
+  Accel_u32ChangeUs = u32StartUs;
+  Accel_bChangeTiming = true;
+  Accel_sStats.u32ProfileChanges++;
+
+} /* end AccelSetProfile() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AccelSleep
+
+Description:
+Switches the sensor to 10 Hz low power with INT1 latched high on motion, ready for System OFF.
+
+Requires:
+  - The system is about to enter System OFF with INT1 as the wake source
+
+Promises:
+  - Returns true if the sensor took the wake configuration and INT1 is low
+  - Otherwise the normal configuration is loaded again (as far as the bus allows) and returns false
+*/
+bool AccelSleep(void)
+{
+  u8 u8Data;
+  bool bOk;
+
+  if( !(G_u32AccelFlags & _ACCEL_FLAGS_PRESENT) )
+  {
+    return(false);
+  }
+
+  bOk  = AccelWriteRegisters(INT1_THS, Accel_au8Int1Wake, sizeof(Accel_au8Int1Wake));
+  bOk &= AccelWriteRegisters(CTRL_REG1, Accel_au8CtrlWake, ACCEL_CTRL_SIZE);
+
+  /* Reading REFERENCE sets the high pass filter to the present acceleration, so gravity is not an event */
+  bOk &= I2cMasterWriteRead(LIS2DH_ADDRESS, REFERENCE, &u8Data, 1);
+  u8Data = ACCEL_WAKE_INT1_CFG;
+  bOk &= AccelWriteRegisters(INT1_CFG, &u8Data, 1);
+
+  /* Release anything latched while the configuration changed */
+  bOk &= I2cMasterWriteRead(LIS2DH_ADDRESS, INT1_SOURCE, &u8Data, 1);
+
+  if( !bOk || (NRF_GPIO->IN & P0_23_ACCEL_INT1) )
+  {
+    (void)AccelConfigure();
+    return(false);
+  }
+
+  return(true);
+
+} /* end AccelSleep() */
+
+
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* Protected functions                                                                                                */
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 /*--------------------------------------------------------------------------------------------------------------------
-Function: TemplateInitialize
+Function: AccelInitialize
 
 Description:
-Initializes the State Machine and its variables.
+Checks the sensor is there and starts it sampling.
 
 Requires:
-  -
+  - I2cMasterInitialize() has run
 
 Promises:
-  - 
+  - If WHO_AM_I answers I_AM, the sensor is configured (AccelConfigure()), INT2 rising raises GPIOTE IN event
+    ACCEL_TAP_GPIOTE_CHANNEL and _ACCEL_FLAGS_PRESENT is set
+  - Otherwise the driver stays idle
 */
-void TemplateInitialize(void)
+void AccelInitialize(void)
 {
+  u8 au8Data[ACCEL_BURST_SIZE];
+
+  G_u32AccelFlags = 0;
+  memset(&Accel_sSample, 0, sizeof(Accel_sSample));
+  memset(&Accel_sStats, 0, sizeof(Accel_sStats));
+  memset(&Accel_sStillReference, 0, sizeof(Accel_sStillReference));
+  Accel_u32LastMotionMs = SysTimeGetMs();
+  Accel_bTapInterrupt = false;
+  Accel_bSingleTapPending = false;
+  Accel_u8TapEvent = 0;
+  Accel_u8SettleSamples = 0;
+  Accel_bChangeTiming = false;
+  Accel_sStats.eProfile = ACCEL_PROFILE_SWING;
+  Accel_u32ProfileStartMs = SysTimeGetMs();
+
+  /* The sensor needs ACCEL_STARTUP_MS after power up before it answers */
+  nrf_delay_ms(ACCEL_STARTUP_MS);
+
+  if( !I2cMasterWriteRead(LIS2DH_ADDRESS, WHO_AM_I, au8Data, 1) || (au8Data[0] != I_AM) )
+  {
+    return;
+  }
+
+  /* After a wake from System OFF the sensor still has its wake configuration: all of it is loaded again */
+  if( !AccelConfigure() )
+  {
+    return;
+  }
+
+  /* Taps: INT2 rising edges as an event on the shared GPIOTE interrupt, which passes it to AccelTapInterrupt() */
+  NRF_GPIOTE->CONFIG[ACCEL_TAP_GPIOTE_CHANNEL] = (GPIOTE_CONFIG_MODE_Event << GPIOTE_CONFIG_MODE_Pos) |
+                                                 (ACCEL_INT2_PIN_NUMBER << GPIOTE_CONFIG_PSEL_Pos)   |
+                                                 (GPIOTE_CONFIG_POLARITY_LoToHi << GPIOTE_CONFIG_POLARITY_Pos);
+  NRF_GPIOTE->EVENTS_IN[ACCEL_TAP_GPIOTE_CHANNEL] = 0;
+  NRF_GPIOTE->INTENSET = GPIOTE_INTENSET_IN0_Msk << ACCEL_TAP_GPIOTE_CHANNEL;
+  NVIC_SetPriority(GPIOTE_IRQn, INTERRUPTS_GPIOTE_PRIORITY);
+  NVIC_EnableIRQ(GPIOTE_IRQn);
 
-} /* end TemplateInitialize() */
+  G_u32AccelFlags |= _ACCEL_FLAGS_PRESENT;
+
+} /* end AccelInitialize() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AccelUpdate
+
+Description:
+Reads a new sample when the sensor signals data ready.  Call every pass of the main loop.
+
+Requires:
+  - AccelInitialize() has run
+
+Promises:
+  - After a tap interrupt CLICK_SRC is read; a double tap is ready for AccelGetTap() at once, a single tap once
+    the profile's u16SingleTapMs has passed without a second
+  - If INT1 is high and the sensor has settled since the last profile change, Accel_sSample holds the new sample
+    and PovMotionSample() has been given its X axis; the first such sample after a change ends its timing
+  - A sample more than ACCEL_STILL_THRESHOLD from the last moving one restarts the still time
+  - Overruns and failed reads are counted in Accel_sStats
+  - SYSTIME_SLOT_ACCEL is armed for the next tick unless the profile is ACCEL_PROFILE_IDLE
+*/
+void AccelUpdate(void)
+{
+  u8 au8Data[ACCEL_BURST_SIZE];
+  u32 u32TimeUs;
+
+  if( !(G_u32AccelFlags & _ACCEL_FLAGS_PRESENT) )
+  {
+    return;
+  }
+
+  /* Data ready is polled: the fast profiles need a pass per ms, 10 Hz idle is fine with the longest sleep */
+  if(Accel_sStats.eProfile == ACCEL_PROFILE_IDLE)
+  {
+    SysTimeSlotDisarm(SYSTIME_SLOT_ACCEL);
+  }
+  else
+  {
+    SysTimeSlotArm(SYSTIME_SLOT_ACCEL, 1);
+  }
+
+  if(Accel_bTapInterrupt)
+  {
+    Accel_bTapInterrupt = false;
+    AccelReadTap();
+  }
+
+  if( Accel_bSingleTapPending &&
+      (SysTimeElapsed(Accel_u32TapMs) >= Accel_asProfiles[Accel_sStats.eProfile].u16SingleTapMs) )
+  {
+    Accel_bSingleTapPending = false;
+    Accel_u8TapEvent = 1;
+  }
+
+  if( !(NRF_GPIO->IN & P0_23_ACCEL_INT1) )
+  {
+    return;
+  }
+
+  u32TimeUs = SysTimeGetUs();
+  if( !I2cMasterWriteRead(LIS2DH_ADDRESS, STATUS_REG2 | AUTO_INCREMENT, au8Data, ACCEL_BURST_SIZE) )
+  {
+    Accel_sStats.u32ReadErrors++;
+    return;
+  }
+
+  if(au8Data[0] & _STATUS_REG2_ZYXOR)
+  {
+    Accel_sStats.u32Overruns++;
+  }
+
+  if(Accel_u8SettleSamples != 0)
+  {
+    Accel_u8SettleSamples--;
+    Accel_sStats.u32Discarded++;
+    return;
+  }
+
+  if(Accel_bChangeTiming)
+  {
+    Accel_bChangeTiming = false;
+    Accel_sStats.u32ChangeUs = u32TimeUs - Accel_u32ChangeUs;
+    if(Accel_sStats.u32ChangeUs > Accel_sStats.u32MaxChangeUs)
+    {
+      Accel_sStats.u32MaxChangeUs = Accel_sStats.u32ChangeUs;
+    }
+  }
+
+  Accel_sSample.s16X = (s16)( ((u16)au8Data[2] << 8) | au8Data[1] );
+  Accel_sSample.s16Y = (s16)( ((u16)au8Data[4] << 8) | au8Data[3] );
+  Accel_sSample.s16Z = (s16)( ((u16)au8Data[6] << 8) | au8Data[5] );
+  Accel_sSample.u32TimeUs = u32TimeUs;
+  Accel_sStats.u32Samples++;
+
+  if( AccelAxisMoved(Accel_sSample.s16X, Accel_sStillReference.s16X) ||
+      AccelAxisMoved(Accel_sSample.s16Y, Accel_sStillReference.s16Y) ||
+      AccelAxisMoved(Accel_sSample.s16Z, Accel_sStillReference.s16Z) )
+  {
+    Accel_sStillReference = Accel_sSample;
+    Accel_u32LastMotionMs = SysTimeGetMs();
+  }
+
+  PovMotionSample(Accel_sSample.s16X, u32TimeUs);
+
+} /* end AccelUpdate() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AccelTapInterrupt
+
+Description:
+Notes a tap interrupt.  Called from GPIOTE_IRQHandler() on the ACCEL_TAP_GPIOTE_CHANNEL event (INT2 rising).
+
+Requires:
+  - Interrupt context; keep it short
+
+Promises:
+  - EVENTS_IN[ACCEL_TAP_GPIOTE_CHANNEL] is cleared
+  - AccelUpdate() reads CLICK_SRC on its next pass; the main loop is woken
+*/
+void AccelTapInterrupt(void)
+{
+  NRF_GPIOTE->EVENTS_IN[ACCEL_TAP_GPIOTE_CHANNEL] = 0;
+  Accel_bTapInterrupt = true;
+  SystemWakeRequest();
+
+} /* end AccelTapInterrupt() */
 
 
 
@@ -66,6 +492,189 @@ void TemplateInitialize(void)
 /* Private functions                                                                                                  */
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AccelConfigure
+
+Description:
+Loads the awake configuration: data ready on INT1, no INT1 events, taps on INT2, ACCEL_PROFILE_SWING.
+
+Requires:
+  - WHO_AM_I has answered
+
+Promises:
+  - Returns true if every register was written; anything latched and any stale sample are read out
+  - The profile is ACCEL_PROFILE_SWING from now (time in the one before is counted)
+*/
+bool AccelConfigure(void)
+{
+  u8 au8Data[ACCEL_BURST_SIZE];
+  u8 u8Int1Cfg = INT1_CFG_INIT;
+  u8 u8ClickCfg = CLICK_CFG_INIT;
+
+  if( !AccelWriteRegisters(INT1_CFG, &u8Int1Cfg, 1) ||
+      !AccelWriteRegisters(CTRL_REG1, Accel_au8CtrlInit, ACCEL_CTRL_SIZE) ||
+      !AccelWriteRegisters(CLICK_CFG, &u8ClickCfg, 1) ||
+      !AccelWriteRegisters(CLICK_THS, Accel_au8ClickInit, ACCEL_CLICK_SIZE) )
+  {
+    return(false);
+  }
+
+  /* Read out anything left from before a reset so INT1, INT2 and data ready start clear */
+  (void)I2cMasterWriteRead(LIS2DH_ADDRESS, INT1_SOURCE, au8Data, 1);
+  (void)I2cMasterWriteRead(LIS2DH_ADDRESS, CLICK_SRC, au8Data, 1);
+  (void)I2cMasterWriteRead(LIS2DH_ADDRESS, STATUS_REG2 | AUTO_INCREMENT, au8Data, ACCEL_BURST_SIZE);
+
+  AccelCountProfileTime();
+  Accel_sStats.eProfile = ACCEL_PROFILE_SWING;
+  Accel_u8SettleSamples = ACCEL_SWING_SETTLE_SAMPLES;
+  return(true);
+
+} /* end AccelConfigure() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AccelLoadProfile
+
+Description:
+Writes the rate, resolution and click timing of a profile.
+
+Requires:
+  - WHO_AM_I has answered
+
+Promises:
+  - Returns false if a write failed (the sensor may be part way between profiles; the old one is still recorded)
+  - Otherwise the sample waiting from the old profile is read out, the next u8SettleSamples will be dropped, the
+    time in the old profile is counted and eProfile_ is recorded
+*/
+bool AccelLoadProfile(AccelProfileType eProfile_)
+{
+  const AccelProfileSettingsType* psProfile = &Accel_asProfiles[eProfile_];
+  u8 au8Data[ACCEL_BURST_SIZE];
+
+  au8Data[0] = psProfile->u8CtrlReg1;
+  au8Data[1] = CTRL_REG2_INIT;
+  au8Data[2] = CTRL_REG3_INIT;
+  au8Data[3] = psProfile->u8CtrlReg4;
+
+  if( !AccelWriteRegisters(CTRL_REG1, au8Data, ACCEL_PROFILE_CTRL_SIZE) ||
+      !AccelWriteRegisters(TIME_LIMIT, psProfile->au8ClickTime, sizeof(psProfile->au8ClickTime)) )
+  {
+    return(false);
+  }
+
+  /* Clear data ready so it next rises for a sample taken under the new settings */
+  (void)I2cMasterWriteRead(LIS2DH_ADDRESS, STATUS_REG2 | AUTO_INCREMENT, au8Data, ACCEL_BURST_SIZE);
+
+  Accel_u8SettleSamples = psProfile->u8SettleSamples;
+  AccelCountProfileTime();
+  Accel_sStats.eProfile = eProfile_;
+  return(true);
+
+} /* end AccelLoadProfile() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AccelCountProfileTime
+
+Description:
+Adds the time since it was last counted to the present profile.
+
+Requires:
+  - Called before every change of Accel_sStats.eProfile
+
+Promises:
+  - Accel_sStats.au32ProfileMs is up to date and counting starts again from now
+*/
+void AccelCountProfileTime(void)
+{
+  Accel_sStats.au32ProfileMs[Accel_sStats.eProfile] += SysTimeElapsed(Accel_u32ProfileStartMs);
+  Accel_u32ProfileStartMs = SysTimeGetMs();
+
+} /* end AccelCountProfileTime() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AccelReadTap
+
+Description:
+Reads what the click engine found.
+
+Requires:
+  - INT2 has risen since the last read
+
+Promises:
+  - A double tap becomes the pending gesture (replacing a single tap that was waiting)
+  - A single tap starts the wait for a second
+  - A failed read is counted in Accel_sStats
+*/
+void AccelReadTap(void)
+{
+  u8 u8Source;
+
+  if( !I2cMasterWriteRead(LIS2DH_ADDRESS, CLICK_SRC, &u8Source, 1) )
+  {
+    Accel_sStats.u32ReadErrors++;
+    return;
+  }
+
+  if(u8Source & _CLICK_SRC_DCLICK)
+  {
+    Accel_bSingleTapPending = false;
+    Accel_u8TapEvent = 2;
+  }
+  else if(u8Source & _CLICK_SRC_SCLICK)
+  {
+    Accel_bSingleTapPending = true;
+    Accel_u32TapMs = SysTimeGetMs();
+  }
+
+} /* end AccelReadTap() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AccelAxisMoved
+
+Description:
+Compares one axis with the still reference.
+
+Requires:
+  -
+
+Promises:
+  - Returns true if s16Now_ is more than ACCEL_STILL_THRESHOLD from s16Reference_
+*/
+bool AccelAxisMoved(s16 s16Now_, s16 s16Reference_)
+{
+  s32 s32Delta = (s32)s16Now_ - s16Reference_;
+
+  return( (s32Delta > ACCEL_STILL_THRESHOLD) || (s32Delta < -ACCEL_STILL_THRESHOLD) );
+
+} /* end AccelAxisMoved() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AccelWriteRegisters
+
+Description:
+Writes consecutive sensor registers in one transfer.
+
+Requires:
+  - pu8Data_ points to u8Length_ bytes, u8Length_ < ACCEL_BURST_SIZE
+
+Promises:
+  - Returns true if the sensor acknowledged every byte
+*/
+bool AccelWriteRegisters(u8 u8Register_, const u8* pu8Data_, u8 u8Length_)
+{
+  u8 au8Transfer[ACCEL_BURST_SIZE];
+
+  au8Transfer[0] = u8Register_ | AUTO_INCREMENT;
+  memcpy(&au8Transfer[1], pu8Data_, u8Length_);
+
+  return( I2cMasterWrite(LIS2DH_ADDRESS, au8Transfer, u8Length_ + 1) );
+
+} /* end AccelWriteRegisters() */
+
 
 
 
@@ -1,127 +1,74 @@
 /**********************************************************************************************************************
-File: accelerometer_lis2di.h                                                                
+File: accelerometer_lis2dh.h
 
 Description:
-Header file for accelerometer_lis2di.c source.
+Header file for accelerometer_lis2dh.c source.
 
-The default values in this file configure the accelerometer to operate in "Low power" mode (8 bit resolution) at 
-a read frequency of 100Hz which should result in operating current consumption of 10uA.
+The default values in this file configure the accelerometer for "Normal" mode (10 bit resolution) at 400 Hz with
+block data update, +/-2 g full scale and the data ready signal on INT1.  The click engine detects single and double
+taps on Z and signals them on INT2.
+
+The ACCEL_PROFILE_ values change rate and resolution while running (AccelSetProfile()): 10 Hz low power while the
+wand lies still, 400 Hz normal for swinging and finding the spin, 400 Hz high resolution once the spin is locked.
+
+The ACCEL_WAKE_ values are loaded before the processor enters System OFF: 10 Hz low power, and INT1 latched high
+by any axis moving past INT1_THS_WAKE (high pass filtered, so gravity does not count).
 
 Notes:
-Allow 5ms device startup
+Allow 5ms device startup (ACCEL_STARTUP_MS)
 **********************************************************************************************************************/
 
-#ifndef __TEMPLATE_H
-#define __TEMPLATE_H
+#ifndef __ACCELEROMETER_LIS2DH_H
+#define __ACCELEROMETER_LIS2DH_H
 
 /**********************************************************************************************************************
 Type Definitions
 **********************************************************************************************************************/
+/* One acceleration sample.  Values are left justified 16-bit: +/-32768 is +/-2 g whatever the resolution. */
+typedef struct
+{
+  s16 s16X;
+  s16 s16Y;
+  s16 s16Z;
+  u32 u32TimeUs;                              /* SysTimeGetUs() when data ready was seen */
+} AccelSampleType;
+
+typedef enum {ACCEL_PROFILE_IDLE = 0, ACCEL_PROFILE_SWING, ACCEL_PROFILE_SPIN} AccelProfileType;
+#define ACCEL_PROFILES              (u8)3
+
+/* Register values and costs of one profile */
+typedef struct
+{
+  u8 u8CtrlReg1;                              /* ODR and LPEN */
+  u8 u8CtrlReg4;                              /* BDU and HR */
+  u8 au8ClickTime[3];                         /* TIME_LIMIT, TIME_LATENCY, TIME_WINDOW in samples of this ODR */
+  u8 u8SettleSamples;                         /* Samples dropped after changing to this profile */
+  u16 u16SingleTapMs;                         /* TIME_LATENCY + TIME_WINDOW and a margin */
+  u16 u16CurrentUa;                           /* Typical sensor supply current */
+} AccelProfileSettingsType;
+
+typedef struct
+{
+  u32 u32Samples;                             /* Samples read */
+  u32 u32Overruns;                            /* Samples the sensor overwrote before they were read (ZYXOR) */
+  u32 u32ReadErrors;                          /* Failed I2C reads */
+  u32 u32Discarded;                           /* Samples dropped while the sensor settled after a profile change */
+  u32 u32ProfileChanges;                      /* AccelSetProfile() calls that changed the profile */
+  u32 u32ChangeUs;                            /* Last profile change to its first kept sample */
+  u32 u32MaxChangeUs;                         /* Longest of those */
+  u32 au32ProfileMs[ACCEL_PROFILES];          /* Time spent in each profile */
+  u32 u32AverageUa;                           /* Sensor current averaged over those times (AccelGetStats() only) */
+  AccelProfileType eProfile;                  /* Profile now */
+} AccelStatsType;
 
 
 /**********************************************************************************************************************
 Constants / Definitions
 **********************************************************************************************************************/
-
-#define CTRL_REG1_INIT (u8)0x
-/*
-    07 [0] 
-    06 [0] 
-    05 [0] 
-    04 [0] 
-
-    03 [0] LPen Normal mode (10 bit output)
-    02 [0] 
-    01 [0] 
-    00 [0] 
-*/
-
-#define CTRL_REG4_INIT (u8)0x
-/*
-    07 [0] 
-    06 [0] 
-    05 [0] 
-    04 [0] 
-
-    03 [0] HR Normal mode (10 bit output)
-    02 [0] 
-    01 [0] 
-    00 [0] 
-*/
-
-/* Sleep to wake / Return to sleep mode register settings (if used) */
-#define ACT_THS_INIT (u8)0x
-/*
-    07 [0] Threshold accleration value
-    06 [0] 
-    05 [0] 
-    04 [0] 
-
-    03 [0] 
-    02 [0] 
-    01 [0] 
-    00 [0] 
-*/
-
-#define ACT_DUR_INIT (u8)0x
-/*
-    07 [0] Threshold accleration value duration
-    06 [0] 
-    05 [0] 
-    04 [0] 
-
-    03 [0] 
-    02 [0] 
-    01 [0] 
-    00 [0] 
-*/
-
-#define TEMPLATE_INIT (u32)0x
-/*
-    31 [0] 
-    30 [0] 
-    29 [0] 
-    28 [0] 
-
-    27 [0] 
-    26 [0] 
-    25 [0] 
-    24 [0] 
-
-    23 [0] 
-    22 [0] 
-    21 [0] 
-    20 [0] 
-
-    19 [0] 
-    18 [0] 
-    17 [0] 
-    16 [0] 
-
-    15 [0] 
-    14 [0] 
-    13 [0] 
-    12 [0] 
-
-    11 [0] 
-    10 [0] 
-    09 [0] 
-    08 [0] 
-
-    07 [0] 
-    06 [0] 
-    05 [0] 
-    04 [0] 
-
-    03 [0] 
-    02 [0] 
-    01 [0] 
-    00 [0] 
-*/
-
-/* IC Addresses */
+/* I2C Addresses */
 #define LIS2DH_READ     (u8)0x33      /* Read address (assumes SDO tied high) */
 #define LIS2DH_WRITE    (u8)0x32      /* Write address (assumes SDO tied high) */
+#define LIS2DH_ADDRESS  (u8)(LIS2DH_WRITE >> 1)   /* 7-bit address for i2c_master.c */
 
 #define AUTO_INCREMENT  (u8)0x80      /* OR this into a sub address to auto increment the sub address after an access */
 
@@ -155,11 +102,11 @@ Constants / Definitions
 #define _CTRL_REG1_ODR9  (u8)0x09          /* HR / normal (1344 Hz); Low power mode (5376 Hz) */
 
 
-#define CTRL_REG1_INIT  (u8)0x57
+#define CTRL_REG1_INIT  (u8)0x77
 /*
-    07 [0] ODR HR / normal / Low power mode (100 Hz)
+    07 [0] ODR HR / normal / Low power mode (400 Hz)
     06 [1] "
-    05 [0] "
+    05 [1] "
     04 [1] "
 
     03 [0] LPEN Normal mode
@@ -167,29 +114,83 @@ Constants / Definitions
     01 [1] YEN Y-axis enabled
     00 [1] ZEN X-axis enabled
 */
-  
+
 
 
 #define CTRL_REG2       (u8)0x21
+#define CTRL_REG2_INIT  (u8)0x04
 /*
-    07 [0] 
-    06 [0] 
-    05 [0] 
-    04 [0] 
-
-    03 [0] 
-    02 [0] 
-    01 [0] 
-    00 [0] 
+    07 [0] HPM High pass filter normal mode
+    06 [0] "
+    05 [0] HPCF
+    04 [0] "
+
+    03 [0] FDS Output data not filtered
+    02 [1] HPCLICK High pass filter on the click function (gravity and spin do not count)
+    01 [0] HPIS2
+    00 [0] HPIS1
 */
 
 #define CTRL_REG3       (u8)0x22
+#define CTRL_REG3_INIT  (u8)0x10
+/*
+    07 [0] I1_CLICK
+    06 [0] I1_AOI1
+    05 [0] I1_AOI2
+    04 [1] I1_DRDY1 Data ready on INT1
+
+    03 [0] I1_DRDY2
+    02 [0] I1_WTM
+    01 [0] I1_OVERRUN
+    00 [0]
+*/
+
 #define CTRL_REG4       (u8)0x23
+#define CTRL_REG4_INIT  (u8)0x80
+/*
+    07 [1] BDU Output registers not updated until both bytes are read
+    06 [0] BLE Little endian
+    05 [0] FS +/-2 g
+    04 [0] "
+
+    03 [0] HR Normal mode (10 bit output)
+    02 [0] ST Self test off
+    01 [0] "
+    00 [0] SIM
+*/
+
 #define CTRL_REG5       (u8)0x24
+#define CTRL_REG5_INIT  (u8)0x00
+/*
+    07 [0] BOOT Normal mode
+    06 [0] FIFO_EN FIFO disabled
+    05 [0]
+    04 [0]
+
+    03 [0] LIR_INT1 INT1 not latched
+    02 [0] D4D_INT1
+    01 [0] LIR_INT2
+    00 [0] D4D_INT2
+*/
+
 #define CTRL_REG6       (u8)0x25
+#define CTRL_REG6_INIT  (u8)0x80
+/*
+    07 [1] I2_CLICKen Click interrupt on INT2
+    06 [0] I2_INT1
+    05 [0]
+    04 [0] BOOT_I2
+
+    03 [0] P2_ACT
+    02 [0]
+    01 [0] H_LACTIVE Interrupts active high
+    00 [0]
+*/
 
 #define REFERENCE       (u8)0x26
 #define STATUS_REG2     (u8)0x27
+#define _STATUS_REG2_ZYXOR (u8)0x80        /* New X, Y, Z data overwrote data that was not read */
+#define _STATUS_REG2_ZYXDA (u8)0x08        /* New X, Y, Z data available */
 
 #define OUT_X_L         (u8)0x28
 #define OUT_X_H         (u8)0x29
@@ -202,7 +203,9 @@ Constants / Definitions
 #define FIFO_SRC_REG    (u8)0x2F
 
 #define INT1_CFG        (u8)0x30
+#define INT1_CFG_INIT   (u8)0x00          /* No interrupt events while awake (INT1 is data ready) */
 #define INT1_SOURCE     (u8)0x31
+#define _INT1_SOURCE_IA (u8)0x40          /* One or more interrupt events have been generated */
 #define INT1_THS        (u8)0x32
 #define INT1_DURATION   (u8)0x33
 
@@ -212,16 +215,89 @@ Constants / Definitions
 #define INT2_DURATION   (u8)0x37
 
 #define CLICK_CFG       (u8)0x38
+#define CLICK_CFG_INIT  (u8)0x30          /* ZD | ZS: single and double click on Z */
 #define CLICK_SRC       (u8)0x39
+#define _CLICK_SRC_IA      (u8)0x40       /* A click was detected */
+#define _CLICK_SRC_DCLICK  (u8)0x20       /* Double click */
+#define _CLICK_SRC_SCLICK  (u8)0x10       /* Single click */
 #define CLICK_THS       (u8)0x3A
+#define CLICK_THS_INIT  (u8)0x30          /* 768 mg (16 mg per LSB at +/-2 g) */
 
+/* Click timing in samples: 2.5 ms each at 400 Hz */
 #define TIME_LIMIT      (u8)0x3B
+#define TIME_LIMIT_INIT     (u8)0x08      /* 20 ms: a tap must drop back under the threshold within this */
 #define TIME_LATENCY    (u8)0x3C
+#define TIME_LATENCY_INIT   (u8)0x14      /* 50 ms dead time after a tap (ringing) */
 #define TIME_WINDOW     (u8)0x3D
+#define TIME_WINDOW_INIT    (u8)0x50      /* 200 ms after the dead time for the second tap of a double */
 
 #define ACT_THS         (u8)0x3E
+#define ACT_THS_INIT    (u8)0x00          /* Sleep-to-wake off: ACCEL_PROFILE_IDLE takes the sensor to 10 Hz */
 #define ACT_DUR         (u8)0x3F
+#define ACT_DUR_INIT    (u8)0x00
+
+/* System OFF wake configuration: CTRL_REG1 to CTRL_REG5, then INT1 */
+#define ACCEL_WAKE_CTRL_REG1        (u8)0x2F
+/*
+    07 [0] ODR HR / normal / Low power mode (10 Hz)
+    06 [0] "
+    05 [1] "
+    04 [0] "
+
+    03 [1] LPEN Low power mode
+    02 [1] ZEN Z-axis enabled
+    01 [1] YEN Y-axis enabled
+    00 [1] XEN X-axis enabled
+*/
 
+#define ACCEL_WAKE_CTRL_REG2        (u8)0x01  /* HPIS1: high pass filter on the INT1 events, normal mode */
+#define ACCEL_WAKE_CTRL_REG3        (u8)0x40  /* I1_AOI1: INT1 events on the INT1 pin (no data ready) */
+#define ACCEL_WAKE_CTRL_REG4        CTRL_REG4_INIT
+#define ACCEL_WAKE_CTRL_REG5        (u8)0x08  /* LIR_INT1: INT1 stays high until INT1_SOURCE is read */
+#define ACCEL_WAKE_CTRL_REG6        (u8)0x00  /* No taps on INT2 */
+#define ACCEL_WAKE_INT1_THS         (u8)0x08  /* 128 mg (16 mg per LSB at +/-2 g) */
+#define ACCEL_WAKE_INT1_DURATION    (u8)0x00  /* One sample past the threshold is enough */
+#define ACCEL_WAKE_INT1_CFG         (u8)0x2A  /* ZHIE | YHIE | XHIE, OR combination */
+
+/* Profiles.  Each keeps BDU so the bytes of an axis stay from one sample whatever the resolution.  The samples
+after a change are dropped until the sensor has settled: turn-on takes one sample in low power and normal mode,
+seven into high resolution.  Currents are the datasheet typicals. */
+#define ACCEL_IDLE_CTRL_REG1        ACCEL_WAKE_CTRL_REG1    /* 10 Hz low power (8 bit) */
+#define ACCEL_IDLE_CTRL_REG4        CTRL_REG4_INIT
+#define ACCEL_IDLE_TIME_LIMIT       (u8)0x01                /* 100 ms samples: taps are seldom seen */
+#define ACCEL_IDLE_TIME_LATENCY     (u8)0x01
+#define ACCEL_IDLE_TIME_WINDOW      (u8)0x02
+#define ACCEL_IDLE_SETTLE_SAMPLES   (u8)1
+#define ACCEL_IDLE_SINGLE_TAP_MS    (u16)360
+#define ACCEL_IDLE_CURRENT_UA       (u16)3
+
+#define ACCEL_SWING_CTRL_REG1       CTRL_REG1_INIT          /* 400 Hz normal (10 bit) */
+#define ACCEL_SWING_CTRL_REG4       CTRL_REG4_INIT
+#define ACCEL_SWING_SETTLE_SAMPLES  (u8)1
+#define ACCEL_SWING_CURRENT_UA      (u16)73
+
+#define ACCEL_SPIN_CTRL_REG1        CTRL_REG1_INIT          /* 400 Hz high resolution (12 bit) */
+#define ACCEL_SPIN_CTRL_REG4        (u8)0x88                /* BDU | HR */
+#define ACCEL_SPIN_SETTLE_SAMPLES   (u8)7
+#define ACCEL_SPIN_CURRENT_UA       (u16)73
+
+#define ACCEL_STARTUP_MS            (u32)5
+
+/* Sample read: STATUS_REG2 and the six output registers in one auto increment burst */
+#define ACCEL_BURST_SIZE            (u8)7
+#define ACCEL_CTRL_SIZE             (u8)6     /* CTRL_REG1 to CTRL_REG6 written in one burst */
+#define ACCEL_CLICK_SIZE            (u8)6     /* CLICK_THS to ACT_DUR written in one burst */
+#define ACCEL_PROFILE_CTRL_SIZE     (u8)4     /* CTRL_REG1 to CTRL_REG4 written in one burst */
+
+/* Taps: INT2 rising raises a GPIOTE IN event.  A single tap is reported once no second tap can follow. */
+#define ACCEL_TAP_GPIOTE_CHANNEL    (u8)0
+#define ACCEL_TAP_SINGLE_MS         (u16)260  /* TIME_LATENCY + TIME_WINDOW and a margin */
+
+/* Stillness: a sample more than this from the last moving sample on any axis is motion (+/-32768 = +/-2 g) */
+#define ACCEL_STILL_THRESHOLD       (s32)2048               /* 0.125 g */
+
+/* G_u32AccelFlags */
+#define _ACCEL_FLAGS_PRESENT        (u32)0x00000001     /* WHO_AM_I answered and the sensor is configured */
 
 
 /**********************************************************************************************************************
@@ -231,21 +307,35 @@ Function Declarations
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* Public functions                                                                                                   */
 /*--------------------------------------------------------------------------------------------------------------------*/
+bool AccelGetSample(AccelSampleType* psSample_);
+void AccelGetStats(AccelStatsType* psStats_);
+u32 AccelGetStillMs(void);
+bool AccelSleep(void);
+bool AccelGetTap(u8* pu8Taps_);
+void AccelSetProfile(AccelProfileType eProfile_);
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* Protected functions                                                                                                */
 /*--------------------------------------------------------------------------------------------------------------------*/
-void TemplateInitialize(void);
+void AccelInitialize(void);
+void AccelUpdate(void);
+void AccelTapInterrupt(void);
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* Private functions                                                                                                  */
 /*--------------------------------------------------------------------------------------------------------------------*/
+bool AccelConfigure(void);
+bool AccelLoadProfile(AccelProfileType eProfile_);
+void AccelCountProfileTime(void);
+bool AccelAxisMoved(s16 s16Now_, s16 s16Reference_);
+void AccelReadTap(void);
+bool AccelWriteRegisters(u8 u8Register_, const u8* pu8Data_, u8 u8Length_);
 
 
 
-#endif /* __TEMPLATE_H */
+#endif /* __ACCELEROMETER_LIS2DH_H */
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
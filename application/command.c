@@ -0,0 +1,526 @@
+/**********************************************************************************************************************
+File: command.c
+
+Description:
+Text command dispatcher.  Incoming lines are matched against the constant command table Command_asCommandTable.
+
+Lines arrive as IMAGE_UPLOAD_PAGE_COMMAND pages on the ANT upload channel (image_upload.c).
+
+At initialization, a hash index of the command names is built in RAM.  Dispatching a line hashes the first
+word of the line in a single pass and looks it up in the index, so the cost depends only on the length of the
+input and not on the number of commands.  Each hit is confirmed with a name compare so hash collisions can
+never run the wrong command.
+
+To add a command, add its handler to the table below.  Names follow the same rules as SearchString(): they are
+case sensitive and must be followed by a space, <CR>, <LF>, ':' or NULL in the input line.
+**********************************************************************************************************************/
+
+#include "configuration.h"
+
+/***********************************************************************************************************************
+Global variable definitions with scope across entire project.
+All Global variable names shall start with "G_"
+***********************************************************************************************************************/
+/* New variables */
+volatile u32 G_u32CommandFlags;                        /* Global state flags */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Existing variables (defined in other files -- should all contain the "extern" keyword) */
+extern volatile u32 G_u32SystemFlags;                  /* From main.c */
+
+extern volatile u32 G_u32SystemTime1ms;                /* From board-specific source file */
+extern volatile u32 G_u32SystemTime1s;                 /* From board-specific source file */
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "Command_" and be declared as static.
+***********************************************************************************************************************/
+/* Command table: order does not matter */
+static const CommandEntryType Command_asCommandTable[] =
+{
+  {(const u8*)"LEDON",     CommandLedOn},                    /* LEDON <led> */
+  {(const u8*)"LEDOFF",    CommandLedOff},                   /* LEDOFF <led> */
+  {(const u8*)"LEDTOGGLE", CommandLedToggle},                /* LEDTOGGLE <led> */
+  {(const u8*)"LEDPWM",    CommandLedPwm},                   /* LEDPWM <led> <0-20> */
+  {(const u8*)"LEDBLINK",  CommandLedBlink},                 /* LEDBLINK <led> <period ms> */
+  {(const u8*)"SYNC",      CommandSync},                     /* SYNC <0=off|1=master|2=slave> */
+  {(const u8*)"RFSCHED",   CommandRfSchedule},               /* RFSCHED <0|1> */
+  {(const u8*)"ANTPOWER",  CommandAntPower},                 /* ANTPOWER <0|1> */
+  {(const u8*)"REMOTE",    CommandRemote},                   /* REMOTE <0|1> */
+  {(const u8*)"PAIR",      CommandPair},                     /* PAIR <device number>, PAIR 0 unpairs all */
+  {(const u8*)"KEY",       CommandKey},                      /* KEY <w0> <w1> <w2> <w3> (image key, big endian) */
+  {(const u8*)"MOTION",    CommandMotion},                   /* MOTION <0=spin|1=swing> */
+  {(const u8*)"WIDTH",     CommandWidth},                    /* WIDTH <image angle in 1/65536 revolution> */
+  {(const u8*)"BUDGET",    CommandBudget},                   /* BUDGET <LED current mA>, BUDGET 0 for no limit */
+};
+
+#define COMMAND_TABLE_SIZE    (u8)(sizeof(Command_asCommandTable) / sizeof(CommandEntryType))
+
+static const CommandEntryType* Command_pasTable;      /* Table the index was built for */
+static u8 Command_au8HashIndex[COMMAND_HASH_SIZE];    /* Command table index for each hash slot */
+static u32 Command_au32NameHash[COMMAND_HASH_SIZE];   /* Full hash of the command in each slot */
+
+
+/**********************************************************************************************************************
+Function Definitions
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: CommandDispatch
+
+Description:
+Looks up the command at the start of a line and runs its handler.
+
+Requires:
+  - CommandInitialize() has run
+  - pu8Line_ points to a NULL, <CR> or <LF> terminated string; leading spaces are skipped
+
+Promises:
+  - If the first word of the line is a command, its handler is called with a pointer to the rest of the line
+    and true is returned
+  - Otherwise returns false
+*/
+bool CommandDispatch(u8* pu8Line_)
+{
+  u32 u32Hash = COMMAND_HASH_SEED;
+  u8* pu8Name;
+  u8 u8Length = 0;
+  u16 u16Slot;
+  const CommandEntryType* psEntry;
+
+  while(*pu8Line_ == ' ')
+  {
+    pu8Line_++;
+  }
+
+  /* Hash the command word in one pass */
+  pu8Name = pu8Line_;
+  while( !CommandIsTerminator(*pu8Line_) )
+  {
+    u32Hash = ((u32Hash << 5) + u32Hash) ^ *pu8Line_;
+    pu8Line_++;
+    u8Length++;
+
+    if(u8Length > COMMAND_MAX_NAME_LENGTH)
+    {
+      return(false);
+    }
+  }
+
+  /* Probe the index until an empty slot is found */
+  for(u16Slot = u32Hash & COMMAND_HASH_MASK;
+      Command_au8HashIndex[u16Slot] != COMMAND_HASH_EMPTY;
+      u16Slot = (u16Slot + 1) & COMMAND_HASH_MASK)
+  {
+    if(Command_au32NameHash[u16Slot] == u32Hash)
+    {
+      psEntry = &Command_pasTable[Command_au8HashIndex[u16Slot]];
+      if( (strncmp((const char*)psEntry->pu8Name, (const char*)pu8Name, u8Length) == 0) &&
+          (psEntry->pu8Name[u8Length] == NULL) )
+      {
+        psEntry->pfnHandler(pu8Line_);
+        return(true);
+      }
+    }
+  }
+
+  return(false);
+
+} /* end CommandDispatch() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: CommandInitialize
+
+Description:
+Builds the hash index of the command table.
+
+Requires:
+  - COMMAND_HASH_SIZE is at least twice COMMAND_TABLE_SIZE
+  - Command names are unique and no longer than COMMAND_MAX_NAME_LENGTH
+
+Promises:
+  - Every command in Command_asCommandTable can be found by CommandDispatch()
+*/
+void CommandInitialize(void)
+{
+  CommandBuildIndex(Command_asCommandTable, COMMAND_TABLE_SIZE);
+
+} /* end CommandInitialize() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: CommandBuildIndex
+
+Description:
+Builds the hash index for a command table and makes it the table CommandDispatch() searches.
+
+Requires:
+  - u8Entries_ <= COMMAND_HASH_SIZE / 2 and less than COMMAND_HASH_EMPTY
+  - Command names are unique and no longer than COMMAND_MAX_NAME_LENGTH
+
+Promises:
+  - Every command in pasTable_ can be found by CommandDispatch()
+*/
+void CommandBuildIndex(const CommandEntryType* pasTable_, u8 u8Entries_)
+{
+  u32 u32Hash;
+  u16 u16Slot;
+  const u8* pu8Char;
+
+  Command_pasTable = pasTable_;
+  memset(Command_au8HashIndex, COMMAND_HASH_EMPTY, sizeof(Command_au8HashIndex));
+
+  for(u8 i = 0; i < u8Entries_; i++)
+  {
+    /* Same hash as CommandDispatch() */
+    u32Hash = COMMAND_HASH_SEED;
+    for(pu8Char = pasTable_[i].pu8Name; *pu8Char != NULL; pu8Char++)
+    {
+      u32Hash = ((u32Hash << 5) + u32Hash) ^ *pu8Char;
+    }
+
+    /* Linear probe for a free slot */
+    u16Slot = u32Hash & COMMAND_HASH_MASK;
+    while(Command_au8HashIndex[u16Slot] != COMMAND_HASH_EMPTY)
+    {
+      u16Slot = (u16Slot + 1) & COMMAND_HASH_MASK;
+    }
+
+    Command_au8HashIndex[u16Slot] = i;
+    Command_au32NameHash[u16Slot] = u32Hash;
+  }
+
+} /* end CommandBuildIndex() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: CommandIsTerminator
+
+Description:
+Checks for a character that ends a command name.
+
+Requires:
+  -
+
+Promises:
+  - Returns true for NULL, space, <CR>, <LF> and ':'
+*/
+bool CommandIsTerminator(u8 u8Char_)
+{
+  return( (u8Char_ == NULL) || (u8Char_ == ' ') || (u8Char_ == ':') ||
+          (u8Char_ == ASCII_CARRIAGE_RETURN) || (u8Char_ == ASCII_LINEFEED) );
+
+} /* end CommandIsTerminator() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: CommandParseNumber
+
+Description:
+Reads a decimal argument.
+
+Requires:
+  - *ppu8Text_ points into a NULL, <CR> or <LF> terminated string
+
+Promises:
+  - Leading spaces and ':' are skipped, then decimal digits are converted and returned
+  - *ppu8Text_ is left pointing to the first character after the number
+  - Returns 0 if no digits are found
+*/
+u32 CommandParseNumber(u8** ppu8Text_)
+{
+  u32 u32Value = 0;
+  u8* pu8Char = *ppu8Text_;
+
+  while( (*pu8Char == ' ') || (*pu8Char == ':') )
+  {
+    pu8Char++;
+  }
+
+  while( (*pu8Char >= '0') && (*pu8Char <= '9') )
+  {
+    u32Value = (u32Value * 10) + (*pu8Char - NUMBER_ASCII_TO_DEC);
+    pu8Char++;
+  }
+
+  *ppu8Text_ = pu8Char;
+  return(u32Value);
+
+} /* end CommandParseNumber() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: CommandParseWord
+
+Description:
+Reads a decimal argument that must be present and fit 32 bits, for arguments where a wrong value must not be used.
+
+Requires:
+  - *ppu8Text_ points into a NULL, <CR> or <LF> terminated string
+
+Promises:
+  - Leading spaces and ':' are skipped, then the digits up to a terminator (CommandIsTerminator()) are converted
+  - Returns true with the value in *pu32Value_ and *ppu8Text_ after the number
+  - Returns false if there are no digits, a character that is not a digit, or the value is over 0xFFFFFFFF
+*/
+bool CommandParseWord(u8** ppu8Text_, u32* pu32Value_)
+{
+  u32 u32Value = 0;
+  u32 u32Digit;
+  u8* pu8Char = *ppu8Text_;
+
+  while( (*pu8Char == ' ') || (*pu8Char == ':') )
+  {
+    pu8Char++;
+  }
+
+  if(CommandIsTerminator(*pu8Char))
+  {
+    return(false);
+  }
+
+  for( ; !CommandIsTerminator(*pu8Char); pu8Char++)
+  {
+    if( (*pu8Char < '0') || (*pu8Char > '9') )
+    {
+      return(false);
+    }
+
+    u32Digit = *pu8Char - NUMBER_ASCII_TO_DEC;
+    if( u32Value > ((0xFFFFFFFF - u32Digit) / 10) )
+    {
+      return(false);
+    }
+    u32Value = (u32Value * 10) + u32Digit;
+  }
+
+  *pu32Value_ = u32Value;
+  *ppu8Text_ = pu8Char;
+  return(true);
+
+} /* end CommandParseWord() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Command handlers                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/* LEDON <led> */
+void CommandLedOn(u8* pu8Arguments_)
+{
+  u32 u32Led = CommandParseNumber(&pu8Arguments_);
+
+  if(u32Led <= MBLU)
+  {
+    LedOn( (LedNumberType)u32Led );
+  }
+
+} /* end CommandLedOn() */
+
+
+/* LEDOFF <led> */
+void CommandLedOff(u8* pu8Arguments_)
+{
+  u32 u32Led = CommandParseNumber(&pu8Arguments_);
+
+  if(u32Led <= MBLU)
+  {
+    LedOff( (LedNumberType)u32Led );
+  }
+
+} /* end CommandLedOff() */
+
+
+/* LEDTOGGLE <led> */
+void CommandLedToggle(u8* pu8Arguments_)
+{
+  u32 u32Led = CommandParseNumber(&pu8Arguments_);
+
+  if(u32Led <= MBLU)
+  {
+    LedToggle( (LedNumberType)u32Led );
+  }
+
+} /* end CommandLedToggle() */
+
+
+/* LEDPWM <led> <0-20> */
+void CommandLedPwm(u8* pu8Arguments_)
+{
+  u32 u32Led  = CommandParseNumber(&pu8Arguments_);
+  u32 u32Duty = CommandParseNumber(&pu8Arguments_);
+
+  if( (u32Led <= MBLU) && (u32Duty <= LED_PWM_100) )
+  {
+    LedPWM( (LedNumberType)u32Led, (LedRateType)u32Duty );
+  }
+
+} /* end CommandLedPwm() */
+
+
+/* LEDBLINK <led> <period ms> */
+void CommandLedBlink(u8* pu8Arguments_)
+{
+  u32 u32Led    = CommandParseNumber(&pu8Arguments_);
+  u32 u32Period = CommandParseNumber(&pu8Arguments_);
+
+  if( (u32Led <= MBLU) && (u32Period != 0) && (u32Period <= LED_0_5HZ) )
+  {
+    LedBlink( (LedNumberType)u32Led, (LedRateType)u32Period );
+  }
+
+} /* end CommandLedBlink() */
+
+
+/* SYNC <0=off|1=master|2=slave> */
+void CommandSync(u8* pu8Arguments_)
+{
+  u32 u32Role = CommandParseNumber(&pu8Arguments_);
+
+  if(u32Role <= POV_SYNC_SLAVE)
+  {
+    PovSyncSetRole( (PovSyncRoleType)u32Role );
+  }
+
+} /* end CommandSync() */
+
+
+/* RFSCHED <0|1>: also restarts the column timing histogram so the two settings can be compared */
+void CommandRfSchedule(u8* pu8Arguments_)
+{
+  u32 u32Enable = CommandParseNumber(&pu8Arguments_);
+
+  if(u32Enable <= 1)
+  {
+    AntSetRfScheduling( (bool)u32Enable );
+    PovClearColumnStats();
+  }
+
+} /* end CommandRfSchedule() */
+
+
+/* ANTPOWER <0|1> */
+void CommandAntPower(u8* pu8Arguments_)
+{
+  u32 u32Enable = CommandParseNumber(&pu8Arguments_);
+
+  if(u32Enable <= 1)
+  {
+    AntSetPowerMode( (bool)u32Enable );
+  }
+
+} /* end CommandAntPower() */
+
+
+/* REMOTE <0|1> */
+void CommandRemote(u8* pu8Arguments_)
+{
+  u32 u32Enable = CommandParseNumber(&pu8Arguments_);
+
+  if(u32Enable <= 1)
+  {
+    RemoteSetEnabled( (bool)u32Enable );
+  }
+
+} /* end CommandRemote() */
+
+
+/* PAIR <device number>, PAIR 0 unpairs all */
+void CommandPair(u8* pu8Arguments_)
+{
+  u32 u32DeviceNumber = CommandParseNumber(&pu8Arguments_);
+
+  if(u32DeviceNumber == 0)
+  {
+    RemoteUnpairAll();
+  }
+  else if(u32DeviceNumber <= 0xFFFF)
+  {
+    RemotePair( (u16)u32DeviceNumber );
+  }
+
+} /* end CommandPair() */
+
+
+/* KEY <w0> <w1> <w2> <w3>: the 128 bit image key as four 32 bit words, most significant first.  A missing or
+out of range word, or anything after the last one, leaves the key unchanged. */
+void CommandKey(u8* pu8Arguments_)
+{
+  u8 au8Key[AES_CTR_KEY_SIZE];
+  u32 u32Word;
+
+  for(u8 i = 0; i < AES_CTR_KEY_SIZE; i += 4)
+  {
+    if( !CommandParseWord(&pu8Arguments_, &u32Word) )
+    {
+      return;
+    }
+    au8Key[i]     = (u8)(u32Word >> 24);
+    au8Key[i + 1] = (u8)(u32Word >> 16);
+    au8Key[i + 2] = (u8)(u32Word >> 8);
+    au8Key[i + 3] = (u8)u32Word;
+  }
+
+  while(*pu8Arguments_ == ' ')
+  {
+    pu8Arguments_++;
+  }
+  if( (*pu8Arguments_ != NULL) && (*pu8Arguments_ != ASCII_CARRIAGE_RETURN) && (*pu8Arguments_ != ASCII_LINEFEED) )
+  {
+    return;
+  }
+
+  ImageUploadSetKey(au8Key);
+
+} /* end CommandKey() */
+
+
+/* MOTION <0=spin|1=swing> */
+void CommandMotion(u8* pu8Arguments_)
+{
+  u32 u32Mode = CommandParseNumber(&pu8Arguments_);
+
+  if(u32Mode <= POV_MOTION_SWING)
+  {
+    PovSetMotionMode( (PovMotionType)u32Mode );
+  }
+
+} /* end CommandMotion() */
+
+
+/* WIDTH <angle>: image width while spinning in 1/65536 revolution (65536 = all the way round) */
+void CommandWidth(u8* pu8Arguments_)
+{
+  PovSetImageWidth( CommandParseNumber(&pu8Arguments_) );
+
+} /* end CommandWidth() */
+
+
+/* BUDGET <mA>: most current the LEDs may draw at once (in one bit plane), 0 for no limit */
+void CommandBudget(u8* pu8Arguments_)
+{
+  PovSetCurrentBudget( CommandParseNumber(&pu8Arguments_) );
+
+} /* end CommandBudget() */
+
+
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,80 @@
+/**********************************************************************************************************************
+File: command.h
+
+Description:
+Header file for command.c source.
+**********************************************************************************************************************/
+
+#ifndef __COMMAND_H
+#define __COMMAND_H
+
+/**********************************************************************************************************************
+Type Definitions
+**********************************************************************************************************************/
+/* Command handlers receive a pointer to the first character after the command name */
+typedef void(*fnCommandHandlerType)(u8* pu8Arguments_);
+
+typedef struct
+{
+  const u8* pu8Name;                          /* Command name (NULL terminated, case sensitive) */
+  fnCommandHandlerType pfnHandler;            /* Function to call when the command is received */
+} CommandEntryType;
+
+
+/**********************************************************************************************************************
+Constants / Definitions
+**********************************************************************************************************************/
+#define COMMAND_HASH_SIZE         (u16)128        /* Hash index slots (power of 2, at least 2x the number of commands) */
+#define COMMAND_HASH_MASK         (u16)(COMMAND_HASH_SIZE - 1)
+#define COMMAND_HASH_EMPTY        (u8)0xFF        /* Unused hash index slot */
+#define COMMAND_HASH_SEED         (u32)5381       /* djb2 starting value */
+
+#define COMMAND_MAX_NAME_LENGTH   (u8)16          /* Longest command name accepted */
+
+
+/**********************************************************************************************************************
+Function Declarations
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+bool CommandDispatch(u8* pu8Line_);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void CommandInitialize(void);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void CommandBuildIndex(const CommandEntryType* pasTable_, u8 u8Entries_);
+bool CommandIsTerminator(u8 u8Char_);
+u32 CommandParseNumber(u8** ppu8Text_);
+bool CommandParseWord(u8** ppu8Text_, u32* pu32Value_);
+
+void CommandLedOn(u8* pu8Arguments_);
+void CommandLedOff(u8* pu8Arguments_);
+void CommandLedToggle(u8* pu8Arguments_);
+void CommandLedPwm(u8* pu8Arguments_);
+void CommandLedBlink(u8* pu8Arguments_);
+void CommandSync(u8* pu8Arguments_);
+void CommandRfSchedule(u8* pu8Arguments_);
+void CommandAntPower(u8* pu8Arguments_);
+void CommandRemote(u8* pu8Arguments_);
+void CommandPair(u8* pu8Arguments_);
+void CommandKey(u8* pu8Arguments_);
+void CommandMotion(u8* pu8Arguments_);
+void CommandWidth(u8* pu8Arguments_);
+void CommandBudget(u8* pu8Arguments_);
+
+
+#endif /* __COMMAND_H */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,631 @@
+/**********************************************************************************************************************
+File: image_upload.c
+
+Description:
+Receives POV images over the ANT upload channel and streams them into flash through image_writer.c.
+
+Protocol (all messages on ANT_CHANNEL_UPLOAD, see image_upload.h for the page layouts):
+  1. Host sends IMAGE_UPLOAD_PAGE_BEGIN with the image size and CRC16 as a broadcast or acknowledged message.
+  2. Host sends the image as bursts (standard or advanced).  The first 8 bytes of every burst are an
+     IMAGE_UPLOAD_PAGE_DATA header giving the stream offset of the data that follows.  Packets are written to
+     flash as they arrive; nothing is buffered here beyond the packet itself.
+  3. The board's status broadcast reports the number of bytes received.  This is the acknowledgement: the host
+     keeps at most IMAGE_UPLOAD_WINDOW_BYTES in flight beyond it.
+  4. When the last byte arrives, the writer finishes and verifies the image.  The status page shows
+     IMAGE_WRITER_COMPLETE or IMAGE_WRITER_ERROR.
+
+Commands: IMAGE_UPLOAD_PAGE_COMMAND pages carry text command lines for CommandDispatch(), six characters at a time.
+This is how settings such as the image key, sync role and remote pairing are given to the board.
+
+Command security: until a key is set, command pages are plain text, so the first KEY command is trust on first
+use and should be sent where nobody else is listening.  Once a key is set, plain command pages are ignored, which
+also refuses a KEY sent in the clear.  The host opens a session with IMAGE_UPLOAD_PAGE_SESSION and a nonce greater
+than any accepted before (a counter, kept in settings so a recorded session cannot be replayed after a reset), then
+sends the text encrypted under the key.  Page sequence numbers must rise within a session, so no keystream block is
+used twice; after sequence 255, or a KEY command, the host opens a new session.  Counter mode does not
+authenticate, but without the keystream of a fresh nonce a forged page decrypts to noise.  Image and command nonces
+share the key, so the host must never give an image the nonce of a session or the other way round.
+
+Encryption: if the host sends IMAGE_UPLOAD_PAGE_NONCE after BEGIN, the image data is AES-128 counter mode
+ciphertext under the key stored with ImageUploadSetKey().  The keystream position is the stream offset, so it
+follows the acknowledged offset through resends.  The CRC in BEGIN is over the plaintext.
+
+Loss recovery: ANT delivers burst packets in order, so everything up to a failed packet is good.  After a failed
+burst the host resends from the acknowledged offset.  A burst also ends early when the writer has no erased flash
+left (ImageWriterGetRoom()), e.g. while a spinning image keeps the next page erase waiting.  Bytes the board
+already has are dropped, so resends may overlap.  A burst that starts past the acknowledged offset is ignored.
+**********************************************************************************************************************/
+
+#include "configuration.h"
+
+/***********************************************************************************************************************
+Global variable definitions with scope across entire project.
+All Global variable names shall start with "G_"
+***********************************************************************************************************************/
+/* New variables */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Existing variables (defined in other files -- should all contain the "extern" keyword) */
+extern volatile u32 G_u32SystemFlags;                  /* From main.c */
+extern volatile u32 G_u32AesCtrFlags;                  /* From aes_ctr.c */
+
+extern volatile u32 G_u32SystemTime1ms;                /* From board-specific source file */
+extern volatile u32 G_u32SystemTime1s;                 /* From board-specific source file */
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "ImageUpload_" and be declared as static.
+***********************************************************************************************************************/
+static u32 ImageUpload_u32ImageSize;                   /* Size given in IMAGE_UPLOAD_PAGE_BEGIN */
+static u16 ImageUpload_u16ImageCrc;                    /* CRC16 given in IMAGE_UPLOAD_PAGE_BEGIN */
+static u32 ImageUpload_u32Received;                    /* Bytes passed to the writer (acknowledged offset) */
+
+static bool ImageUpload_bBurstActive;                  /* Current burst is being accepted */
+static u32 ImageUpload_u32BurstOffset;                 /* Stream offset of the next byte in the current burst */
+static u8 ImageUpload_u8NextSequence;                  /* Expected sequence number of the next burst packet */
+static u8 ImageUpload_u8FailedBursts;                  /* Bursts that ended early (wraps) */
+
+static bool ImageUpload_bEncrypted;                    /* Current image is AES-CTR encrypted */
+static u8 ImageUpload_au8Nonce[AES_CTR_NONCE_SIZE];    /* Nonce from IMAGE_UPLOAD_PAGE_NONCE */
+
+static u8 ImageUpload_au8Status[IMAGE_UPLOAD_PAGE_SIZE];  /* Status broadcast buffer */
+
+static u8 ImageUpload_au8CommandLine[IMAGE_UPLOAD_COMMAND_SIZE]; /* Command line being received */
+static u8 ImageUpload_u8CommandLength;                 /* Characters in ImageUpload_au8CommandLine */
+static bool ImageUpload_bCommandOverflow;              /* Line too long: dropped up to its end */
+static u16 ImageUpload_u16CommandSequence;             /* Sequence of the last command page taken */
+static bool ImageUpload_bCommandSession;               /* Encrypted command pages are taken */
+static u8 ImageUpload_au8CommandNonce[AES_CTR_NONCE_SIZE];  /* Nonce of the last session opened */
+
+
+/**********************************************************************************************************************
+Function Definitions
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageUploadAntHandler
+
+Description:
+Channel handler for ANT_CHANNEL_UPLOAD (registered with AntRegisterChannelHandler()).
+
+Requires:
+  - psEvents_ points to u8Count_ consecutive events for the upload channel
+
+Promises:
+  - Broadcast and acknowledged data are handled as commands
+  - Burst and advanced burst packets are handled as image data
+  - EVENT_TX loads the next status broadcast
+  - Received messages and transfers in progress keep the ANT power mode on the fast period
+  - EVENT_TRANSFER_RX_FAILED ends the current burst
+*/
+void ImageUploadAntHandler(AntEventType* psEvents_, u8 u8Count_)
+{
+  for( ; u8Count_ != 0; u8Count_--, psEvents_++)
+  {
+    switch(psEvents_->u8Event)
+    {
+      case EVENT_RX:
+      {
+        AntNoteActivity();
+        switch(psEvents_->u8MessageId)
+        {
+          case MESG_BROADCAST_DATA_ID:
+          case MESG_ACKNOWLEDGED_DATA_ID:
+          {
+            ImageUploadCommand(psEvents_->au8Payload);
+            break;
+          }
+
+          case MESG_BURST_DATA_ID:
+          case MESG_ADV_BURST_DATA_ID:
+          {
+            ImageUploadBurstPacket(psEvents_->u8ChannelByte, psEvents_->au8Payload, psEvents_->u8Length);
+            break;
+          }
+
+          default:
+            break;
+        }
+        break;
+      }
+
+      case EVENT_TX:
+      {
+        /* Keep the link fast until the host has seen the end of a transfer */
+        if( (ImageWriterGetStatus() == IMAGE_WRITER_WRITING) || (ImageWriterGetStatus() == IMAGE_WRITER_VERIFYING) )
+        {
+          AntNoteActivity();
+        }
+        ImageUploadSendStatus();
+        break;
+      }
+
+      case EVENT_TRANSFER_RX_FAILED:
+      {
+        ImageUploadBurstFailed();
+        break;
+      }
+
+      default:
+        break;
+    }
+  }
+
+} /* end ImageUploadAntHandler() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageUploadSetKey
+
+Description:
+Stores the AES-128 key for encrypted uploads and loads it.
+
+Requires:
+  - pu8Key_ points to AES_CTR_KEY_SIZE bytes
+  - No upload in progress (a running encrypted upload loses its keystream)
+
+Promises:
+  - Returns true if the key was saved to settings; the key is loaded either way
+  - The command session ends: later command pages need a session under the new key
+*/
+bool ImageUploadSetKey(const u8* pu8Key_)
+{
+  ImageUpload_bEncrypted = false;
+  ImageUpload_bCommandSession = false;
+  AesCtrSetKey(pu8Key_);
+
+  return( SettingsWrite(SETTINGS_KEY_IMAGE_KEY, pu8Key_, AES_CTR_KEY_SIZE) );
+
+} /* end ImageUploadSetKey() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageUploadInitialize
+
+Description:
+Initializes the upload service, registers it for the upload channel and loads the first status broadcast.
+
+Requires:
+  - AntInitialize(), ImageWriterInitialize(), AesCtrInitialize() and SettingsInitialize() have run
+
+Promises:
+  - No upload in progress and no command session open
+  - The stored image key, if any, is loaded, and the nonce of the last command session
+  - ImageUploadAntHandler() receives ANT_CHANNEL_UPLOAD events
+  - Status broadcast loaded
+*/
+void ImageUploadInitialize(void)
+{
+  u8 au8Key[AES_CTR_KEY_SIZE];
+
+  ImageUpload_u32ImageSize = 0;
+  ImageUpload_u32Received = 0;
+  ImageUpload_bBurstActive = false;
+  ImageUpload_u8FailedBursts = 0;
+  ImageUpload_bEncrypted = false;
+  ImageUpload_u8CommandLength = 0;
+  ImageUpload_bCommandOverflow = false;
+  ImageUpload_u16CommandSequence = IMAGE_UPLOAD_NO_SEQUENCE;
+  ImageUpload_bCommandSession = false;
+
+  if(SettingsRead(SETTINGS_KEY_IMAGE_KEY, au8Key, AES_CTR_KEY_SIZE) == AES_CTR_KEY_SIZE)
+  {
+    AesCtrSetKey(au8Key);
+  }
+  if(SettingsRead(SETTINGS_KEY_COMMAND_NONCE, ImageUpload_au8CommandNonce, AES_CTR_NONCE_SIZE) != AES_CTR_NONCE_SIZE)
+  {
+    memset(ImageUpload_au8CommandNonce, 0, AES_CTR_NONCE_SIZE);
+  }
+
+  AntRegisterChannelHandler(ANT_CHANNEL_UPLOAD, ImageUploadAntHandler);
+  ImageUploadSendStatus();
+
+} /* end ImageUploadInitialize() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageUploadCommand
+
+Description:
+Handles a command page from the host.
+
+Requires:
+  - pu8Page_ points to IMAGE_UPLOAD_PAGE_SIZE bytes
+
+Promises:
+  - IMAGE_UPLOAD_PAGE_BEGIN starts a new upload (any upload in progress is abandoned)
+  - IMAGE_UPLOAD_PAGE_NONCE marks the upload encrypted; with no key loaded the upload is abandoned
+  - IMAGE_UPLOAD_PAGE_ABORT abandons the upload
+  - IMAGE_UPLOAD_PAGE_COMMAND text is added to the command line
+  - The status broadcast is refreshed
+*/
+void ImageUploadCommand(u8* pu8Page_)
+{
+  switch(pu8Page_[0])
+  {
+    case IMAGE_UPLOAD_PAGE_BEGIN:
+    {
+      ImageWriterAbort();
+      ImageUpload_bBurstActive = false;
+      ImageUpload_bEncrypted = false;
+      ImageUpload_u32Received = 0;
+      ImageUpload_u32ImageSize = ImageUploadReadU24(&pu8Page_[1]);
+      ImageUpload_u16ImageCrc = (u16)pu8Page_[4] | ((u16)pu8Page_[5] << 8);
+      ImageWriterStart(IMAGE_FLASH_START, ImageUpload_u32ImageSize);
+      break;
+    }
+
+    case IMAGE_UPLOAD_PAGE_NONCE:
+    {
+      /* Only valid before any data has arrived */
+      if(ImageUpload_u32Received != 0)
+      {
+        return;
+      }
+
+      memcpy(ImageUpload_au8Nonce, &pu8Page_[1], AES_CTR_NONCE_SIZE);
+      ImageUpload_bEncrypted = AesCtrStart(ImageUpload_au8Nonce, 0);
+      if(!ImageUpload_bEncrypted)
+      {
+        ImageWriterAbort();
+        ImageUpload_bBurstActive = false;
+      }
+      break;
+    }
+
+    case IMAGE_UPLOAD_PAGE_ABORT:
+    {
+      ImageWriterAbort();
+      ImageUpload_bBurstActive = false;
+      break;
+    }
+
+    case IMAGE_UPLOAD_PAGE_COMMAND:
+    {
+      ImageUploadCommandText(pu8Page_);
+      break;
+    }
+
+    case IMAGE_UPLOAD_PAGE_SESSION:
+    {
+      /* Sessions need a key, and a nonce never used before */
+      if( !(G_u32AesCtrFlags & _AES_CTR_FLAGS_KEY_SET) ||
+          (memcmp(&pu8Page_[1], ImageUpload_au8CommandNonce, AES_CTR_NONCE_SIZE) <= 0) )
+      {
+        return;
+      }
+
+      memcpy(ImageUpload_au8CommandNonce, &pu8Page_[1], AES_CTR_NONCE_SIZE);
+      (void)SettingsWrite(SETTINGS_KEY_COMMAND_NONCE, ImageUpload_au8CommandNonce, AES_CTR_NONCE_SIZE);
+      ImageUpload_bCommandSession = true;
+      ImageUpload_u16CommandSequence = IMAGE_UPLOAD_NO_SEQUENCE;
+      ImageUpload_u8CommandLength = 0;
+      ImageUpload_bCommandOverflow = false;
+      break;
+    }
+
+    default:
+      return;
+  }
+
+  ImageUploadSendStatus();
+
+} /* end ImageUploadCommand() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageUploadCommandText
+
+Description:
+Adds the text of a command page to the command line and runs the line when it ends.
+
+Requires:
+  - pu8Page_ is an IMAGE_UPLOAD_PAGE_COMMAND page
+  - Main loop context (the text is decrypted with the AES-CTR stream)
+
+Promises:
+  - Without a key: a page with the same sequence number as the last one is ignored
+  - With a key: the page is ignored unless a session is open and its sequence number is above the last one taken;
+    the text is decrypted with the session keystream, and an encrypted upload's stream is put back where its next
+    burst resumes
+  - Text up to <CR>, <LF> or NULL is added to the line; at the end of the line it is passed to CommandDispatch()
+    and a new line starts
+  - A line longer than IMAGE_UPLOAD_COMMAND_SIZE - 1 characters is dropped
+*/
+void ImageUploadCommandText(u8* pu8Page_)
+{
+  u8 au8Text[IMAGE_UPLOAD_PAGE_SIZE - IMAGE_UPLOAD_COMMAND_TEXT];
+  u8 u8Char;
+
+  if(pu8Page_[1] == ImageUpload_u16CommandSequence)
+  {
+    return;
+  }
+  memcpy(au8Text, &pu8Page_[IMAGE_UPLOAD_COMMAND_TEXT], sizeof(au8Text));
+
+  if(G_u32AesCtrFlags & _AES_CTR_FLAGS_KEY_SET)
+  {
+    /* A rising sequence keeps every page on its own keystream block */
+    if( !ImageUpload_bCommandSession ||
+        ((ImageUpload_u16CommandSequence != IMAGE_UPLOAD_NO_SEQUENCE) &&
+         (pu8Page_[1] < ImageUpload_u16CommandSequence)) )
+    {
+      return;
+    }
+
+    (void)AesCtrStart(ImageUpload_au8CommandNonce, (u32)pu8Page_[1] * AES_CTR_BLOCK_SIZE);
+    (void)AesCtrXor(au8Text, sizeof(au8Text));
+    AesCtrStop();
+    if( ImageUpload_bEncrypted && (ImageUpload_u32Received < ImageUpload_u32ImageSize) )
+    {
+      (void)AesCtrStart(ImageUpload_au8Nonce, ImageUpload_u32Received);
+    }
+  }
+  ImageUpload_u16CommandSequence = pu8Page_[1];
+
+  for(u8 i = 0; i < sizeof(au8Text); i++)
+  {
+    u8Char = au8Text[i];
+
+    if( (u8Char == NULL) || (u8Char == ASCII_CARRIAGE_RETURN) || (u8Char == ASCII_LINEFEED) )
+    {
+      /* An empty line (padding after a terminator) does nothing */
+      if( !ImageUpload_bCommandOverflow && (ImageUpload_u8CommandLength != 0) )
+      {
+        ImageUpload_au8CommandLine[ImageUpload_u8CommandLength] = NULL;
+        (void)CommandDispatch(ImageUpload_au8CommandLine);
+      }
+      ImageUpload_u8CommandLength = 0;
+      ImageUpload_bCommandOverflow = false;
+    }
+    else if(ImageUpload_u8CommandLength < (IMAGE_UPLOAD_COMMAND_SIZE - 1))
+    {
+      ImageUpload_au8CommandLine[ImageUpload_u8CommandLength++] = u8Char;
+    }
+    else
+    {
+      ImageUpload_bCommandOverflow = true;
+    }
+  }
+
+} /* end ImageUploadCommandText() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageUploadBurstPacket
+
+Description:
+Handles one burst packet.  The first packet of a burst carries the burst header; data in every accepted packet
+goes straight to the image writer.
+
+Requires:
+  - u8ChannelByte_ is the channel byte of the burst message (sequence number and last-packet flag in the top bits)
+  - pu8Data_ points to u8Length_ bytes (8, 16 or 24 depending on the burst packet size)
+
+Promises:
+  - Data that continues the stream at the acknowledged offset is written to flash
+  - A packet out of sequence ends the burst and is counted as a failed burst
+*/
+void ImageUploadBurstPacket(u8 u8ChannelByte_, u8* pu8Data_, u8 u8Length_)
+{
+  u8 u8Sequence = (u8ChannelByte_ & ANT_BURST_SEQUENCE_MASK) >> ANT_BURST_SEQUENCE_POS;
+  u32 u32Offset;
+
+  if(u8Sequence == 0)
+  {
+    /* First packet: check the header */
+    ImageUpload_bBurstActive = false;
+    if( (ImageWriterGetStatus() != IMAGE_WRITER_WRITING) ||
+        (u8Length_ < IMAGE_UPLOAD_HEADER_SIZE) ||
+        (pu8Data_[0] != IMAGE_UPLOAD_PAGE_DATA) )
+    {
+      return;
+    }
+
+    /* A burst past the acknowledged offset would leave a gap: ignore it and let the status page tell the host
+    where to resume */
+    u32Offset = ImageUploadReadU24(&pu8Data_[1]);
+    if(u32Offset > ImageUpload_u32Received)
+    {
+      return;
+    }
+
+    ImageUpload_bBurstActive = true;
+    ImageUpload_u32BurstOffset = u32Offset;
+    ImageUpload_u8NextSequence = 1;
+    pu8Data_  += IMAGE_UPLOAD_HEADER_SIZE;
+    u8Length_ -= IMAGE_UPLOAD_HEADER_SIZE;
+  }
+  else
+  {
+    if(!ImageUpload_bBurstActive)
+    {
+      return;
+    }
+
+    if(u8Sequence != ImageUpload_u8NextSequence)
+    {
+      ImageUpload_bBurstActive = false;
+      ImageUpload_u8FailedBursts++;
+      return;
+    }
+
+    /* Sequence runs 1, 2, 3, 1, 2, 3... after the first packet */
+    ImageUpload_u8NextSequence = (u8Sequence == 3) ? 1 : (u8Sequence + 1);
+  }
+
+  ImageUploadWriteData(pu8Data_, u8Length_);
+
+  if(u8ChannelByte_ & ANT_BURST_LAST_PACKET)
+  {
+    ImageUpload_bBurstActive = false;
+  }
+
+} /* end ImageUploadBurstPacket() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageUploadBurstFailed
+
+Description:
+Called when the stack reports that a burst did not complete.
+
+Requires:
+  -
+
+Promises:
+  - Current burst ends; data already written is kept and remains acknowledged
+  - Failed burst count is incremented
+*/
+void ImageUploadBurstFailed(void)
+{
+  ImageUpload_bBurstActive = false;
+  ImageUpload_u8FailedBursts++;
+
+} /* end ImageUploadBurstFailed() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageUploadSendStatus
+
+Description:
+Loads the status page into the upload channel broadcast.  Called on every EVENT_TX so each broadcast carries
+the latest acknowledged offset.
+
+Requires:
+  -
+
+Promises:
+  - Status broadcast reflects the current writer state and bytes received
+*/
+void ImageUploadSendStatus(void)
+{
+  ImageUpload_au8Status[0] = IMAGE_UPLOAD_PAGE_STATUS;
+  ImageUpload_au8Status[1] = (u8)ImageWriterGetStatus();
+  ImageUpload_au8Status[2] = (u8)(ImageUpload_u32Received & 0xFF);
+  ImageUpload_au8Status[3] = (u8)((ImageUpload_u32Received >> 8) & 0xFF);
+  ImageUpload_au8Status[4] = (u8)((ImageUpload_u32Received >> 16) & 0xFF);
+  ImageUpload_au8Status[5] = (u8)(IMAGE_UPLOAD_WINDOW_BYTES / IMAGE_UPLOAD_WINDOW_UNIT);
+  ImageUpload_au8Status[6] = ImageUpload_u8FailedBursts;
+  ImageUpload_au8Status[7] = 0xFF;
+
+  AntBroadcast(ANT_CHANNEL_UPLOAD, ImageUpload_au8Status);
+
+} /* end ImageUploadSendStatus() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageUploadReadU24
+
+Description:
+Reads a 24 bit little endian value.
+
+Requires:
+  - pu8Data_ points to 3 bytes
+
+Promises:
+  - Returns the value
+*/
+u32 ImageUploadReadU24(u8* pu8Data_)
+{
+  return( (u32)pu8Data_[0] | ((u32)pu8Data_[1] << 8) | ((u32)pu8Data_[2] << 16) );
+
+} /* end ImageUploadReadU24() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageUploadWriteData
+
+Description:
+Passes burst data to the image writer, dropping bytes that were already received and any padding after the end
+of the image.
+
+Requires:
+  - ImageUpload_bBurstActive is true and ImageUpload_u32BurstOffset <= ImageUpload_u32Received
+
+Promises:
+  - New bytes are decrypted in place if the upload is encrypted
+  - New bytes are written and ImageUpload_u32Received advances, as far as the writer has room
+  - The writer is finished when the last image byte arrives
+  - The burst ends if the writer is out of room or reports an error
+*/
+void ImageUploadWriteData(u8* pu8Data_, u8 u8Length_)
+{
+  u32 u32Skip;
+  u32 u32Remaining;
+  u32 u32Room;
+
+  /* Skip the part of a resent burst that is already in flash */
+  u32Skip = ImageUpload_u32Received - ImageUpload_u32BurstOffset;
+  ImageUpload_u32BurstOffset += u8Length_;
+  if(u32Skip >= u8Length_)
+  {
+    return;
+  }
+
+  pu8Data_  += u32Skip;
+  u8Length_ -= (u8)u32Skip;
+
+  /* The last burst is padded to a whole packet */
+  u32Remaining = ImageUpload_u32ImageSize - ImageUpload_u32Received;
+  if(u8Length_ > u32Remaining)
+  {
+    u8Length_ = (u8)u32Remaining;
+  }
+
+  /* The rest waits for the next page erase: the host resends it from the acknowledged offset */
+  u32Room = ImageWriterGetRoom();
+  if(u8Length_ > u32Room)
+  {
+    u8Length_ = (u8)u32Room;
+    ImageUpload_bBurstActive = false;
+  }
+
+  /* Only new bytes are decrypted, so the keystream stays at ImageUpload_u32Received */
+  if(ImageUpload_bEncrypted)
+  {
+    AesCtrXor(pu8Data_, u8Length_);
+  }
+
+  if( !ImageWriterWrite(pu8Data_, u8Length_) )
+  {
+    /* Put the keystream back where the host will resume */
+    if(ImageUpload_bEncrypted)
+    {
+      AesCtrStart(ImageUpload_au8Nonce, ImageUpload_u32Received);
+    }
+    ImageUpload_bBurstActive = false;
+    return;
+  }
+
+  ImageUpload_u32Received += u8Length_;
+  if(ImageUpload_u32Received == ImageUpload_u32ImageSize)
+  {
+    ImageWriterFinish(ImageUpload_u16ImageCrc);
+    ImageUpload_bBurstActive = false;
+    if(ImageUpload_bEncrypted)
+    {
+      AesCtrStop();
+    }
+  }
+
+} /* end ImageUploadWriteData() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
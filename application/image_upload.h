@@ -0,0 +1,80 @@
+/**********************************************************************************************************************
+File: image_upload.h
+
+Description:
+Header file for image_upload.c source.
+**********************************************************************************************************************/
+
+#ifndef __IMAGE_UPLOAD_H
+#define __IMAGE_UPLOAD_H
+
+/**********************************************************************************************************************
+Type Definitions
+**********************************************************************************************************************/
+
+
+/**********************************************************************************************************************
+Constants / Definitions
+**********************************************************************************************************************/
+/* Pages: byte 0 of every 8 byte message.  Multi-byte fields are little endian. */
+#define IMAGE_UPLOAD_PAGE_BEGIN     (u8)0x20    /* Host: [1..3] image size, [4..5] image CRC16 */
+#define IMAGE_UPLOAD_PAGE_DATA      (u8)0x21    /* Host: first 8 bytes of every burst, [1..3] stream offset of the data */
+#define IMAGE_UPLOAD_PAGE_NONCE     (u8)0x22    /* Host: [1..7] AES-CTR nonce; after BEGIN, marks the image encrypted */
+#define IMAGE_UPLOAD_PAGE_ABORT     (u8)0x23    /* Host: abandon the upload */
+#define IMAGE_UPLOAD_PAGE_COMMAND   (u8)0x24    /* Host: [1] sequence, [2..7] command text (see command.c) */
+#define IMAGE_UPLOAD_PAGE_SESSION   (u8)0x25    /* Host: [1..7] command nonce, most significant byte first */
+#define IMAGE_UPLOAD_PAGE_STATUS    (u8)0x30    /* Board: [1] ImageWriterStatusType, [2..4] bytes received,
+                                                   [5] window in 256 byte units, [6] failed bursts, [7] 0xFF */
+
+#define IMAGE_UPLOAD_PAGE_SIZE      (u8)8
+#define IMAGE_UPLOAD_HEADER_SIZE    (u8)8       /* Burst header at the start of each burst */
+
+/* Command pages carry 6 characters of a text line.  The line runs until <CR>, <LF> or NULL; a page repeated with
+the same sequence number (a broadcast sent again) is dropped.  Once a key is set the text is AES-CTR ciphertext:
+page sequence n of a session uses the keystream block at n * AES_CTR_BLOCK_SIZE. */
+#define IMAGE_UPLOAD_COMMAND_TEXT   (u8)2       /* First text byte in the page */
+#define IMAGE_UPLOAD_COMMAND_SIZE   (u8)48      /* Longest command line, including the NULL */
+#define IMAGE_UPLOAD_NO_SEQUENCE    (u16)0x100  /* No command page seen yet */
+
+/* The host may send up to this many bytes past the last acknowledged offset before it waits for a status
+broadcast.  Sized to cover more than one channel period of advanced burst so the link never idles waiting for an
+acknowledgement. */
+#define IMAGE_UPLOAD_WINDOW_BYTES   (u32)4096
+#define IMAGE_UPLOAD_WINDOW_UNIT    (u32)256
+
+
+/**********************************************************************************************************************
+Function Declarations
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void ImageUploadAntHandler(AntEventType* psEvents_, u8 u8Count_);
+bool ImageUploadSetKey(const u8* pu8Key_);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void ImageUploadInitialize(void);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void ImageUploadCommand(u8* pu8Page_);
+void ImageUploadCommandText(u8* pu8Page_);
+void ImageUploadBurstPacket(u8 u8ChannelByte_, u8* pu8Data_, u8 u8Length_);
+void ImageUploadBurstFailed(void);
+void ImageUploadSendStatus(void);
+u32 ImageUploadReadU24(u8* pu8Data_);
+void ImageUploadWriteData(u8* pu8Data_, u8 u8Length_);
+
+
+#endif /* __IMAGE_UPLOAD_H */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -47,6 +47,7 @@ void main(void)
   /* Low level initialization */
   G_u32SystemFlags |= _SYSTEM_INITIALIZING;  
 
+  ResetSourceCheck();
   InterruptSetup();
   ClockSetup();
   GpioSetup();
@@ -56,11 +57,20 @@ void main(void)
   SysTickSetup();
 
   /* Driver initialization */
+  SettingsInitialize();
+  ImageWriterInitialize();
+  AesCtrInitialize();
   LedInitialize();
-  //AntInitialize();
+  ButtonInitialize();
+  AccelInitialize();
+  AntInitialize();
 
   /* Application initialization */
+  CommandInitialize();
+  ImageUploadInitialize();
   PovInitialize();
+  PovSyncInitialize();
+  RemoteInitialize();
   
   /* Exit initialization */
   G_u32SystemFlags &= ~_SYSTEM_INITIALIZING;
@@ -69,11 +79,17 @@ void main(void)
   /* Main loop */  
   while(1)
   {
-    /* If no acceleration is detected, turn off all LEDs, LP the accelerometer, and sleep the processor */
-    
-    /**/
-    
+    /* If no acceleration is detected, PovUpdate() turns off all LEDs, LPs the accelerometer, and powers off the
+    processor (PovSM_Idle()); motion wakes it through a reset */
     LedUpdate();
+    ButtonUpdate();
+    AccelUpdate();
+    ImageWriterUpdate();
+    SettingsUpdate();
+    AntUpdate();
+    PovUpdate();
+    PovSyncUpdate();
+    RemoteUpdate();
     
         
     /* System sleep */
@@ -22,6 +22,7 @@ Header file for main.c.
 ***********************************************************************************************************************/
 /* G_u32SystemFlags */
 #define _SYSTEM_HFCLK_NO_START          0x00000001        /* Set if the main oscilator does not start as expected */
+#define _SYSTEM_WOKE_FROM_OFF           0x00000002        /* Set if this start up is a wake from System OFF */
 
 #define _SYSTEM_ANT_EVENT               0x00010000        /* Set when at least one Soft Device event needs to be processed */
 
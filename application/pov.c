@@ -4,7 +4,76 @@ File: pov.c
 Description:
 - Maintains communications to accelerometer to update rotational speed
 - Runs color cycle when not spinning or off (depends on button press)
-- 
+- Shows the image one column at a time while spinning
+
+Rotation estimate: the motion source calls PovRevolutionMark() once per revolution with the microsecond time of
+the zero angle.  Periods inside POV_MIN_PERIOD_US..POV_MAX_PERIOD_US are filtered into Pov_u32CyclePeriod and
+POV_LOCK_MARKS good marks in a row lock the estimate.  PovUpdate() drops the lock if marks stop.
+
+Columns: while locked the column schedule runs from the microsecond alarm (TIMER2 interrupt) so LED timing does
+not depend on the main loop.  Each mark builds a new PovScheduleType in a mailbox; the interrupt only adopts it
+when it wraps back to column 0, so a revolution is never drawn with two different timings.
+
+Column timing: every column records how late its interrupt ran in Pov_sColumnStats.  Soft device radio events
+and blocking flash work show up here as late columns; PovGetColumnStats() returns the histogram so it can be
+compared with RF scheduling on and off (command RFSCHED).
+
+Image: pixels are 8-bit levels per LED channel, stored raw or compressed in a pov_image.c container and decoded
+in column order as they are rendered.  PovRenderFrame() turns them into POV_PWM_BITS GPIO bit planes per column
+through Pov_au8DutyLut, which holds gamma and white balance for each color, so every level is one table load.  The
+column interrupt shows the planes in binary weighted slots (8, 4, 2, 1 of POV_PWM_SLOTS).  The image flash area is
+shown if it holds a valid image, otherwise the built in test image.  PovWatchUpload() changes to the test image
+when an upload starts writing over the flash image and opens the new one when the upload completes.
+
+Current: the LEDs draw their peak current while a bit plane is shown, the sum of POV_LED_xxx_MA over the channels
+on in that plane; the duty-weighted sum is only the average.  When an image is selected or the budget changes
+(PovSetCurrentBudget()), PovApplyCurrentBudget() finds the largest duty scale whose highest plane, with any dither
+error, stays within the budget, and folds it into Pov_au8ScaledLut with gamma and white balance.  The whole image
+dims evenly, so color balance and the dither are kept, and rendering is still one table load per channel.
+PovGetCurrentStats() reports the peak, the demand without the governor, the average and the scale.
+
+Dither: the duties have POV_DITHER_BITS more resolution than the PWM.  Each channel of each column keeps the
+part that was not shown in Pov_au8DitherError and adds it to the next revolution, so a column alternates between
+adjacent PWM levels and averages to the full 8-bit duty.  PovUpdate() re-renders the columns the interrupt has
+just passed, so each revolution costs POV_COLUMNS column renders and nothing is written while it is displayed.
+
+Frames: the rendered planes are double buffered.  A new image is rendered whole into the back frame by the main
+loop; the interrupt swaps it to the front only as it wraps to column 0, so no revolution shows parts of two
+images.  Only the main loop writes Pov_bSwapPending true and only the interrupt clears it, so no lock is needed.
+Dither re-rendering works on the front frame (same image) and waits while a swap is pending.
+
+Speed: each mark recomputes the column pitch from Pov_u32CyclePeriod and the image width (PovSetImageWidth()),
+so the image covers the same angle at any speed.  The schedule carries a reciprocal of the pitch so the interrupt
+finds columns with a multiply instead of a divide.  When the PWM slots would get shorter than POV_MIN_SLOT_US the
+schedule skips every other column: half the resolution, but every column stays in its place and the image never
+runs into the next revolution.
+
+Phase: PovGetPhase() gives the angle being shown at any time.  PovSetPhaseOffset() shifts the whole image around
+the revolution; wand phase sync (pov_sync.c) uses it to line up several wands.
+
+Motion: PovMotionSample() gets the accelerometer X axis and finds its zero crossings.  Spinning, each rising
+crossing is a revolution mark.  Swinging (PovSetMotionMode()), every crossing is the middle of a stroke and the
+direction of the crossing gives the direction of the stroke.  Each crossing schedules the next stroke: its middle
+is predicted one stroke after this one, using the stroke before (alternate strokes differ in length when X has
+an offset, e.g. from gravity), and the image is drawn across the middle of it, last column first on the return
+stroke.  The LEDs are dark between strokes and a new dither frame is rendered whole for each stroke.  The
+difference between each crossing and its prediction is kept in the column statistics as a measure of how still
+the image stands.  Phase offset and sync apply to spinning only.
+
+Power: PovSM_Active() watches for the wand lying still (AccelGetStillMs()) while nothing is shown or uploaded.
+After POV_SLEEP_STILL_MS PovSM_Idle() turns the LEDs off, sets the accelerometer to wake on motion and enters
+System OFF.  Motion resets the processor; PovGetWakeTimeUs() then gives the time from start up to the first column.
+Before that the accelerometer is slowed (AccelSetProfile()): idle after POV_ACCEL_IDLE_STILL_MS still, high
+resolution while a spin is locked, and normal 400 Hz otherwise, which is what finding a spin or a swing needs.
+
+Taps: while nothing is shown, a single tap on the wand (AccelGetTap()) changes the image (PovNextImage()) and a
+double tap changes between spin and swing.  Taps are ignored while locked, where the motion itself could look like
+one.
+
+Buttons: POV_BUTTON does the same as a tap at any time, a click for the next image and a double click for spin or
+swing.  A long press on POV_REMOTE_BUTTON turns remote mode (remote.c) on or off and a click pairs the next
+remote heard.  PovSM_Active() is the only reader of ButtonGetEvent().  Any button event, or POV_BUTTON held down,
+keeps the wand awake for another POV_SLEEP_STILL_MS.
 
 
 
@@ -27,14 +96,110 @@ extern volatile u32 G_u32SystemFlags;                  /* From main.c */
 extern volatile u32 G_u32SystemTime1ms;                /* From board-specific source file */
 extern volatile u32 G_u32SystemTime1s;                 /* From board-specific source file */
 
+extern const LedAnimationType G_sLedIdleAnimation;     /* From leds_abbcn.c */
+
 
 /***********************************************************************************************************************
 Global variable definitions with scope limited to this local application.
 Variable names shall start with "Pov_" and be declared as static.
 ***********************************************************************************************************************/
+static fnCode_type Pov_pfnStateMachine;                /* The state machine function pointer */
 static u32 Pov_u32Timeout;                             /* Timeout counter used across states */
+static u32 Pov_u32WakeToColumnUs;                      /* Start up to first column after a wake, 0 = not yet */
+static u32 Pov_u32LastButtonMs;                        /* Time of the last button event or held button */
 
 static u32 Pov_u32CyclePeriod;                         /* Current base time for Pov modulation */
+static u32 Pov_u32LastMark;                            /* SysTimeGetUs() of the last revolution mark */
+static u8 Pov_u8GoodMarks;                             /* In-range marks in a row */
+static s16 Pov_s16PhaseOffset;                         /* Image rotation in 1/65536 revolution */
+static u32 Pov_u32ImageWidth;                          /* Image angle in 1/65536 revolution while spinning */
+
+/* Motion detector */
+static PovMotionType Pov_eMotionMode;                  /* Spinning or swinging */
+static s16 Pov_s16LastX;                               /* Previous X sample */
+static u32 Pov_u32LastSampleUs;                        /* Time of the previous X sample */
+static s8 Pov_s8Side;                                  /* Side of zero X was last seen past the hysteresis, 0 = not yet */
+static u32 Pov_u32ZeroUs;                              /* Interpolated time of the last X sign change */
+static u32 Pov_u32StrokeUs;                            /* Duration of the previous stroke */
+static u32 Pov_u32NextCenterUs;                        /* Predicted middle of the next stroke */
+static bool Pov_bNextReverse;                          /* The next stroke is a return stroke */
+
+/* Column interrupt state */
+static PovScheduleType Pov_sActive;                    /* Timing in use (interrupt only) */
+static volatile u16 Pov_u16Column;                     /* Next column to show (written by the interrupt only) */
+static u8 Pov_u8Plane;                                 /* Next bit plane of the column to show (interrupt only) */
+static PovScheduleType Pov_sMailbox;                   /* Next timing, adopted at column 0 */
+static volatile bool Pov_bMailboxValid;                /* Set by the main loop when Pov_sMailbox is complete */
+static PovImageDecoderType Pov_sImage;                 /* Image being shown (pov_image.c container) */
+static ImageWriterStatusType Pov_eWriterStatus;        /* Image writer state at the last PovWatchUpload() */
+static u32 Pov_au32Planes[2][POV_COLUMNS][POV_PWM_BITS];  /* Front and back frames of GPIO words, most
+                                                          significant plane first */
+static volatile u8 Pov_u8Front;                        /* Frame the interrupt shows; the other is the back frame */
+static volatile bool Pov_bSwapPending;                 /* Back frame complete: swap at the next column 0 */
+static u16 Pov_u16RenderColumn;                        /* Next column to re-render behind the interrupt */
+static u32 Pov_u32FrameRenderUs;                       /* Render time so far this revolution */
+
+/* Dither error per channel, struct-of-arrays by color: [color][column][pixel], POV_DITHER_BITS used */
+static u8 Pov_au8DitherError[POV_COLORS][POV_COLUMNS][POV_PIXELS];
+static PovColumnStatsType Pov_sColumnStats;            /* Column lateness (written by the interrupt) */
+static volatile bool Pov_bBlank;                       /* Show dark columns (timing keeps running) */
+
+/* LED output for each channel, in LedNumberType order */
+static const u32 Pov_au32ChannelPins[POV_CHANNELS] =
+{
+  P0_19_ARED, P0_17_AGRN, P0_18_ABLU, P0_13_DRED, P0_11_DGRN, P0_12_DBLU,
+  P0_10_YRED, P0_08_YGRN, P0_09_YBLU, P0_15_MRED, P0_14_MGRN, P0_16_MBLU
+};
+
+/* Level to duty (0 to POV_DUTY_FULL) for each color, generated at compile time from POV_GAMMA() and the white
+balance */
+#define POV_DUTY(x, white)    (u8)( (POV_GAMMA(x) * (white) * POV_DUTY_FULL + 32512UL) / 65025UL )
+#define POV_DUTY4(x, white)   POV_DUTY((x), white), POV_DUTY((x) + 1, white), POV_DUTY((x) + 2, white),    \
+                              POV_DUTY((x) + 3, white)
+#define POV_DUTY16(x, white)  POV_DUTY4((x), white), POV_DUTY4((x) + 4, white), POV_DUTY4((x) + 8, white), \
+                              POV_DUTY4((x) + 12, white)
+#define POV_DUTY_LUT(white)   POV_DUTY16(0, white),   POV_DUTY16(16, white),  POV_DUTY16(32, white),       \
+                              POV_DUTY16(48, white),  POV_DUTY16(64, white),  POV_DUTY16(80, white),       \
+                              POV_DUTY16(96, white),  POV_DUTY16(112, white), POV_DUTY16(128, white),      \
+                              POV_DUTY16(144, white), POV_DUTY16(160, white), POV_DUTY16(176, white),      \
+                              POV_DUTY16(192, white), POV_DUTY16(208, white), POV_DUTY16(224, white),      \
+                              POV_DUTY16(240, white)
+
+static const u8 Pov_au8DutyLut[POV_COLORS][POV_LEVELS] =
+{
+  {POV_DUTY_LUT(POV_WHITE_RED)},
+  {POV_DUTY_LUT(POV_WHITE_GRN)},
+  {POV_DUTY_LUT(POV_WHITE_BLU)}
+};
+
+/* Current governor */
+static const u32 Pov_au32LedCurrentMa[POV_COLORS] = {POV_LED_RED_MA, POV_LED_GRN_MA, POV_LED_BLU_MA};
+static u8 Pov_au8ScaledLut[POV_COLORS][POV_LEVELS];    /* Pov_au8DutyLut scaled by Pov_u16CurrentScale */
+static u16 Pov_u16CurrentScale;                        /* Duty scale in 1/256 */
+static u32 Pov_u32CurrentBudgetMa;                     /* Bit plane current limit, 0 = none */
+static u32 Pov_u32CurrentDemandMa;                     /* Highest plane of the image unscaled, with dither error */
+static PovColumnCurrentType Pov_sFrameCurrent;         /* Last frame rendered whole: peak and slot sum */
+
+/* Default image (raw container): color bars, 8 columns each, ramping up in brightness across the bar */
+#define POV_COLUMN(r, g, b)   r, g, b, r, g, b, r, g, b, r, g, b
+#define POV_RAMP(r, g, b, n)  POV_COLUMN((r) * (n) / 8, (g) * (n) / 8, (b) * (n) / 8)
+#define POV_BAR(r, g, b)      POV_RAMP(r, g, b, 1), POV_RAMP(r, g, b, 2), POV_RAMP(r, g, b, 3),          \
+                              POV_RAMP(r, g, b, 4), POV_RAMP(r, g, b, 5), POV_RAMP(r, g, b, 6),          \
+                              POV_RAMP(r, g, b, 7), POV_RAMP(r, g, b, 8)
+#define POV_TEST_IMAGE_SIZE   (u16)(POV_COLUMNS * POV_CHANNELS)
+static const u8 Pov_au8TestImage[POV_IMAGE_HEADER_SIZE + POV_TEST_IMAGE_SIZE] =
+{
+  POV_IMAGE_MAGIC0, POV_IMAGE_MAGIC1, POV_IMAGE_FORMAT_RAW, POV_COLUMNS,
+  (u8)POV_TEST_IMAGE_SIZE, (u8)(POV_TEST_IMAGE_SIZE >> 8), 0, 0,
+  POV_BAR(255, 0, 0),
+  POV_BAR(255, 255, 0),
+  POV_BAR(0, 255, 0),
+  POV_BAR(0, 255, 255),
+  POV_BAR(0, 0, 255),
+  POV_BAR(255, 0, 255),
+  POV_BAR(255, 255, 255),
+  POV_BAR(0, 0, 0)
+};
 
 /**********************************************************************************************************************
 Function Definitions
@@ -44,6 +209,495 @@ Function Definitions
 /* Public functions                                                                                                   */
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovRevolutionMark
+
+Description:
+Feeds the rotation estimator with the time the wand passed the zero angle.
+
+Requires:
+  - Called from the main loop (not an interrupt), once per revolution
+  - u32TimeUs_ is a SysTimeGetUs() time
+
+Promises:
+  - An in-range period is filtered into Pov_u32CyclePeriod; an out-of-range one restarts the lock count
+  - _POV_FLAGS_LOCKED is set and the columns start after POV_LOCK_MARKS good marks
+  - While locked a new schedule is posted for the column interrupt
+*/
+void PovRevolutionMark(u32 u32TimeUs_)
+{
+  u32 u32Period = u32TimeUs_ - Pov_u32LastMark;
+
+  Pov_u32LastMark = u32TimeUs_;
+
+  if( (u32Period < POV_MIN_PERIOD_US) || (u32Period > POV_MAX_PERIOD_US) )
+  {
+    Pov_u8GoodMarks = 0;
+    return;
+  }
+
+  /* The first good period seeds the filter */
+  if(Pov_u8GoodMarks == 0)
+  {
+    Pov_u32CyclePeriod = u32Period;
+  }
+  else
+  {
+    Pov_u32CyclePeriod = (u32)( (s32)Pov_u32CyclePeriod +
+                                (((s32)u32Period - (s32)Pov_u32CyclePeriod) >> POV_PERIOD_FILTER_SHIFT) );
+  }
+
+  if(Pov_u8GoodMarks < POV_LOCK_MARKS)
+  {
+    Pov_u8GoodMarks++;
+  }
+
+  if(G_u32PovFlags & _POV_FLAGS_LOCKED)
+  {
+    PovPublishSchedule();
+  }
+  else if(Pov_u8GoodMarks >= POV_LOCK_MARKS)
+  {
+    PovStart();
+  }
+
+} /* end PovRevolutionMark() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovMotionSample
+
+Description:
+Feeds one accelerometer X sample to the zero crossing detector.
+
+Requires:
+  - Called from the main loop for every sample, in order
+  - s16X_ is left justified (+/-32768 = full scale); u32TimeUs_ is the SysTimeGetUs() time of the sample
+
+Promises:
+  - Pov_u32ZeroUs is updated at each sign change, interpolated between this sample and the last
+  - When X passes POV_CROSSING_HYSTERESIS on the other side of zero, the crossing is reported: rising ones to
+    PovRevolutionMark() when spinning, both directions to PovStrokeMark() when swinging
+*/
+void PovMotionSample(s16 s16X_, u32 u32TimeUs_)
+{
+  u32 u32Below;
+  u32 u32Span;
+  s8 s8Side = 0;
+
+  /* Latest sign change: zero lies |last| / |x - last| of the way from the last sample to this one */
+  if( (s16X_ < 0) != (Pov_s16LastX < 0) )
+  {
+    u32Below = (u32)( (Pov_s16LastX < 0) ? -(s32)Pov_s16LastX : (s32)Pov_s16LastX );
+    u32Span  = (u32)( (Pov_s16LastX < 0) ? ((s32)s16X_ - Pov_s16LastX) : ((s32)Pov_s16LastX - s16X_) );
+    Pov_u32ZeroUs = Pov_u32LastSampleUs +
+                    (u32)( ((u64)(u32TimeUs_ - Pov_u32LastSampleUs) * u32Below) / u32Span );
+  }
+
+  Pov_s16LastX = s16X_;
+  Pov_u32LastSampleUs = u32TimeUs_;
+
+  if(s16X_ >= POV_CROSSING_HYSTERESIS)
+  {
+    s8Side = 1;
+  }
+  else if(s16X_ <= -POV_CROSSING_HYSTERESIS)
+  {
+    s8Side = -1;
+  }
+
+  if( (s8Side == 0) || (s8Side == Pov_s8Side) )
+  {
+    return;
+  }
+
+  /* The first side seen only arms the detector.  The crossing into it starts the timing, so the first mark is not
+  measured from one made before a mode change (a rising one when spinning, as marks are) */
+  if(Pov_s8Side != 0)
+  {
+    if(Pov_eMotionMode == POV_MOTION_SWING)
+    {
+      PovStrokeMark(Pov_u32ZeroUs, (bool)(s8Side > 0));
+    }
+    else if(s8Side > 0)
+    {
+      PovRevolutionMark(Pov_u32ZeroUs);
+    }
+  }
+  else if( (Pov_eMotionMode == POV_MOTION_SWING) || (s8Side > 0) )
+  {
+    Pov_u32LastMark = Pov_u32ZeroUs;
+  }
+  Pov_s8Side = s8Side;
+
+} /* end PovMotionSample() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovSetMotionMode
+
+Description:
+Selects how the marks are interpreted: one per revolution (spinning) or one per stroke (swinging).
+
+Requires:
+  - Main loop context
+
+Promises:
+  - If the mode changes, the columns stop and the estimate has to lock again in the new mode
+*/
+void PovSetMotionMode(PovMotionType eMode_)
+{
+  if(eMode_ == Pov_eMotionMode)
+  {
+    return;
+  }
+
+  if(G_u32PovFlags & _POV_FLAGS_LOCKED)
+  {
+    PovStop();
+  }
+  Pov_u8GoodMarks = 0;
+  Pov_s8Side = 0;
+  Pov_eMotionMode = eMode_;
+
+} /* end PovSetMotionMode() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovGetMotionMode
+
+Description:
+Returns the mode set by PovSetMotionMode().
+
+Requires:
+  -
+
+Promises:
+  - Returns POV_MOTION_SPIN or POV_MOTION_SWING
+*/
+PovMotionType PovGetMotionMode(void)
+{
+  return(Pov_eMotionMode);
+
+} /* end PovGetMotionMode() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovGetRotation
+
+Description:
+Reports the rotation estimate.
+
+Requires:
+  - Pointers to space for the results
+
+Promises:
+  - *pu32PeriodUs_ and *pu32MarkUs_ hold the filtered period and the time of the last mark
+  - Returns true if the estimate is locked
+*/
+bool PovGetRotation(u32* pu32PeriodUs_, u32* pu32MarkUs_)
+{
+  *pu32PeriodUs_ = Pov_u32CyclePeriod;
+  *pu32MarkUs_   = Pov_u32LastMark;
+
+  return( (G_u32PovFlags & _POV_FLAGS_LOCKED) != 0 );
+
+} /* end PovGetRotation() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovGetPhase
+
+Description:
+Returns the image angle shown at a time, extrapolated from the last mark.
+
+Requires:
+  - u32TimeUs_ is a SysTimeGetUs() time within a few revolutions of the last mark
+
+Promises:
+  - Returns the angle in 1/65536 revolution (0 = image column 0), or 0 if not locked
+*/
+u16 PovGetPhase(u32 u32TimeUs_)
+{
+  s32 s32Elapsed;
+  u32 u32Elapsed;
+
+  if( !(G_u32PovFlags & _POV_FLAGS_LOCKED) )
+  {
+    return(0);
+  }
+
+  /* Times before the mark are fine too: fold the signed difference into one revolution */
+  s32Elapsed = (s32)(u32TimeUs_ - Pov_u32LastMark) % (s32)Pov_u32CyclePeriod;
+  if(s32Elapsed < 0)
+  {
+    s32Elapsed += (s32)Pov_u32CyclePeriod;
+  }
+  u32Elapsed = (u32)s32Elapsed;
+  return( (u16)( (((u64)u32Elapsed << 16) / Pov_u32CyclePeriod) - (u16)Pov_s16PhaseOffset ) );
+
+} /* end PovGetPhase() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovSetPhaseOffset
+
+Description:
+Rotates the image.  Positive offsets show the image later in the revolution.
+
+Requires:
+  - s16Offset_ in 1/65536 revolution
+
+Promises:
+  - The new offset is used from the next revolution
+*/
+void PovSetPhaseOffset(s16 s16Offset_)
+{
+  Pov_s16PhaseOffset = s16Offset_;
+
+  if(G_u32PovFlags & _POV_FLAGS_LOCKED)
+  {
+    PovPublishSchedule();
+  }
+
+} /* end PovSetPhaseOffset() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovGetPhaseOffset
+
+Description:
+Returns the image rotation set by PovSetPhaseOffset().
+
+Requires:
+  -
+
+Promises:
+  - Returns the offset in 1/65536 revolution
+*/
+s16 PovGetPhaseOffset(void)
+{
+  return(Pov_s16PhaseOffset);
+
+} /* end PovGetPhaseOffset() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovGetColumnStats
+
+Description:
+Reports how late the column interrupts have run.
+
+Requires:
+  - psStats_ points to space for the statistics
+
+Promises:
+  - *psStats_ is a copy of the column statistics (a column may be counted during the copy)
+*/
+void PovGetColumnStats(PovColumnStatsType* psStats_)
+{
+  *psStats_ = Pov_sColumnStats;
+
+} /* end PovGetColumnStats() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovClearColumnStats
+
+Description:
+Starts a new column timing measurement.
+
+Requires:
+  -
+
+Promises:
+  - Histogram, maximum and column count are 0
+*/
+void PovClearColumnStats(void)
+{
+  memset(&Pov_sColumnStats, 0, sizeof(Pov_sColumnStats));
+
+} /* end PovClearColumnStats() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovSetBlank
+
+Description:
+Blanks or restores the image.  Column timing keeps running so the image comes back in phase.
+
+Requires:
+  -
+
+Promises:
+  - From the next column, all LEDs are off while bBlank_ is true
+*/
+void PovSetBlank(bool bBlank_)
+{
+  Pov_bBlank = bBlank_;
+
+} /* end PovSetBlank() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovGetWakeTimeUs
+
+Description:
+Reports how long the system took from waking out of System OFF to showing its first column.
+
+Requires:
+  -
+
+Promises:
+  - Returns the us from the microsecond timer starting (SysTickSetup()) to the first column, to within one main
+    loop pass; the clock start before that is not included
+  - Returns 0 if this start was not a wake from System OFF or no column has been shown yet
+*/
+u32 PovGetWakeTimeUs(void)
+{
+  return(Pov_u32WakeToColumnUs);
+
+} /* end PovGetWakeTimeUs() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovSetCurrentBudget
+
+Description:
+Sets the most current the LEDs may draw in any bit plane of a column.
+
+Requires:
+  - u32BudgetMa_ in mA, 0 for no limit
+  - Main loop context
+
+Promises:
+  - The duty scale is worked out again for the image shown; if it changed the frame is rendered again with it
+*/
+void PovSetCurrentBudget(u32 u32BudgetMa_)
+{
+  Pov_u32CurrentBudgetMa = u32BudgetMa_;
+  if( PovApplyCurrentBudget() )
+  {
+    PovRenderFrame();
+  }
+
+} /* end PovSetCurrentBudget() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovGetCurrentStats
+
+Description:
+Reports the LED current estimate for the last frame rendered whole.
+
+Requires:
+  - psStats_ points to space for the statistics
+
+Promises:
+  - *psStats_ holds the peak plane current with the governor and without it, the average, and the scale
+*/
+void PovGetCurrentStats(PovCurrentStatsType* psStats_)
+{
+  psStats_->u32PeakMa    = Pov_sFrameCurrent.u32PeakMa;
+  psStats_->u32AverageMa = Pov_sFrameCurrent.u32SlotMa / ((u32)POV_COLUMNS * POV_PWM_SLOTS);
+  psStats_->u32DemandMa  = Pov_u32CurrentDemandMa;
+  psStats_->u32BudgetMa  = Pov_u32CurrentBudgetMa;
+  psStats_->u16ScaleQ8   = Pov_u16CurrentScale;
+
+} /* end PovGetCurrentStats() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovSetImageWidth
+
+Description:
+Sets the angle the image covers while spinning.
+
+Requires:
+  - u32Width_ in 1/65536 revolution
+
+Promises:
+  - The width is clamped to POV_IMAGE_WIDTH_MIN..POV_PHASE_FULL and used from the next revolution
+*/
+void PovSetImageWidth(u32 u32Width_)
+{
+  if(u32Width_ < POV_IMAGE_WIDTH_MIN)
+  {
+    u32Width_ = POV_IMAGE_WIDTH_MIN;
+  }
+  if(u32Width_ > POV_PHASE_FULL)
+  {
+    u32Width_ = POV_PHASE_FULL;
+  }
+  Pov_u32ImageWidth = u32Width_;
+
+  if(G_u32PovFlags & _POV_FLAGS_LOCKED)
+  {
+    PovPublishSchedule();
+  }
+
+} /* end PovSetImageWidth() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovSetImage
+
+Description:
+Selects the image to show.
+
+Requires:
+  - pu8Image_ points to u32MaxSize_ readable bytes holding a pov_image.c container; it stays valid while shown
+
+Promises:
+  - Returns false and keeps the current image if the container is not valid
+  - Otherwise the duty scale is worked out for the new image, which is rendered into the back frame and shown from
+    the next revolution
+*/
+bool PovSetImage(const u8* pu8Image_, u32 u32MaxSize_)
+{
+  PovImageDecoderType sImage;
+
+  if( !PovImageOpen(&sImage, pu8Image_, u32MaxSize_) )
+  {
+    return(false);
+  }
+
+  Pov_sImage = sImage;
+  (void)PovApplyCurrentBudget();
+  PovRenderFrame();
+  return(true);
+
+} /* end PovSetImage() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovNextImage
+
+Description:
+Changes between the image in the image flash area and the test image.
+
+Requires:
+  -
+
+Promises:
+  - The test image is selected if the flash image was shown or is not valid, otherwise the flash image
+*/
+void PovNextImage(void)
+{
+  if( (Pov_sImage.pu8Data >= Pov_au8TestImage) &&
+      (Pov_sImage.pu8Data < (Pov_au8TestImage + sizeof(Pov_au8TestImage))) )
+  {
+    if( PovSetImage((const u8*)IMAGE_FLASH_START, IMAGE_FLASH_END - IMAGE_FLASH_START) )
+    {
+      return;
+    }
+  }
+
+  PovSetImage(Pov_au8TestImage, sizeof(Pov_au8TestImage));
+
+} /* end PovNextImage() */
+
+
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* Protected functions                                                                                                */
@@ -56,25 +710,784 @@ Description:
 Initializes the State Machine and its variables.
 
 Requires:
-  -
+  - LED pins configured as outputs
 
 Promises:
-  - 
+  - Rotation estimate cleared and not locked
+  - The image in the image flash area is selected if it is valid, otherwise the test image
+  - The LEDs are left to the LED animation until the columns start
 */
 void PovInitialize(void)
 {
-  
-  /* Fire up the LEDs */
-  
+  G_u32PovFlags = 0;
+  Pov_u32CyclePeriod = 0;
+  Pov_u8GoodMarks = 0;
+  Pov_s16PhaseOffset = 0;
+  Pov_u32ImageWidth = POV_IMAGE_WIDTH_DEFAULT;
+  Pov_eMotionMode = POV_MOTION_SPIN;
+  Pov_s8Side = 0;
+  Pov_bMailboxValid = false;
+  Pov_bBlank = false;
+  memset(Pov_au8DitherError, 0, sizeof(Pov_au8DitherError));
+  PovClearColumnStats();
+  Pov_u32CurrentBudgetMa = POV_CURRENT_BUDGET_MA;
+  Pov_u16CurrentScale = POV_CURRENT_SCALE_FULL;
+  memcpy(Pov_au8ScaledLut, Pov_au8DutyLut, sizeof(Pov_au8ScaledLut));
+  memset(&Pov_sFrameCurrent, 0, sizeof(Pov_sFrameCurrent));
+
+  if( !PovSetImage((const u8*)IMAGE_FLASH_START, IMAGE_FLASH_END - IMAGE_FLASH_START) )
+  {
+    PovSetImage(Pov_au8TestImage, sizeof(Pov_au8TestImage));
+  }
+  Pov_eWriterStatus = ImageWriterGetStatus();
+
+  Pov_u32LastMark = SysTimeGetUs();
+  Pov_u32WakeToColumnUs = 0;
+  Pov_u32Timeout = SysTimeGetMs();
+  Pov_u32LastButtonMs = SysTimeGetMs();
+  Pov_pfnStateMachine = PovSM_Active;
 
 } /* end PovInitialize() */
 
 
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovUpdate
+
+Description:
+Watches for the motion stopping and renders the next dither step.  Call every pass of the main loop.
+
+Requires:
+  - PovInitialize() has run
+
+Promises:
+  - The power state machine runs
+  - SYSTIME_SLOT_POV is armed for the next tick while locked
+  - If locked and no mark has arrived for POV_UNLOCK_PERIODS periods, the columns stop and the lock is dropped
+  - While spinning, every column the interrupt has finished is rendered again with the next dither step
+  - While swinging, the next dither step is rendered whole into the back frame once the last one was swapped in
+  - Render time is recorded in Pov_sColumnStats
+*/
+void PovUpdate(void)
+{
+  u32 u32StartUs;
+  u32 u32RenderUs;
+  u16 u16Shown = Pov_u16Column;
+
+  Pov_pfnStateMachine();
+  PovWatchUpload();
+
+  /* Rendering keeps up with the column interrupt only if it runs every tick */
+  if(G_u32PovFlags & _POV_FLAGS_LOCKED)
+  {
+    SysTimeSlotArm(SYSTIME_SLOT_POV, 1);
+  }
+  else
+  {
+    SysTimeSlotDisarm(SYSTIME_SLOT_POV);
+  }
+
+  /* Past the last column (dark to the end of the revolution) every column has been shown */
+  if(u16Shown >= POV_COLUMNS)
+  {
+    u16Shown = 0;
+  }
+
+  if( (G_u32PovFlags & _POV_FLAGS_LOCKED) &&
+      ((SysTimeGetUs() - Pov_u32LastMark) > (POV_UNLOCK_PERIODS * Pov_u32CyclePeriod)) )
+  {
+    Pov_u8GoodMarks = 0;
+    PovStop();
+  }
+
+  if( !(G_u32PovFlags & _POV_FLAGS_LOCKED) || Pov_bSwapPending ||
+      ((Pov_eMotionMode == POV_MOTION_SPIN) && (Pov_u16RenderColumn == u16Shown)) )
+  {
+    return;
+  }
+
+  u32StartUs = SysTimeGetUs();
+  if(Pov_eMotionMode == POV_MOTION_SWING)
+  {
+    /* Columns run in either order, so there is no "behind the interrupt": the frame goes in between strokes */
+    PovRenderFrame();
+  }
+  else
+  {
+    /* Catch up to the column on display; at most one revolution of work */
+    while(Pov_u16RenderColumn != u16Shown)
+    {
+      PovRenderColumn(Pov_u8Front, Pov_u16RenderColumn, NULL);
+      Pov_u16RenderColumn++;
+      if(Pov_u16RenderColumn >= POV_COLUMNS)
+      {
+        Pov_u16RenderColumn = 0;
+        if(Pov_u32FrameRenderUs > Pov_sColumnStats.u32MaxFrameRenderUs)
+        {
+          Pov_sColumnStats.u32MaxFrameRenderUs = Pov_u32FrameRenderUs;
+        }
+        Pov_u32FrameRenderUs = 0;
+      }
+    }
+  }
+
+  u32RenderUs = SysTimeGetUs() - u32StartUs;
+  Pov_u32FrameRenderUs += u32RenderUs;
+  if(u32RenderUs > Pov_sColumnStats.u32MaxRenderUs)
+  {
+    Pov_sColumnStats.u32MaxRenderUs = u32RenderUs;
+  }
+
+  /* A swing render is a whole frame */
+  if(Pov_eMotionMode == POV_MOTION_SWING)
+  {
+    if(Pov_u32FrameRenderUs > Pov_sColumnStats.u32MaxFrameRenderUs)
+    {
+      Pov_sColumnStats.u32MaxFrameRenderUs = Pov_u32FrameRenderUs;
+    }
+    Pov_u32FrameRenderUs = 0;
+  }
+
+} /* end PovUpdate() */
+
+
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* Private functions                                                                                                  */
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovStrokeMark
+
+Description:
+Feeds the swing estimator with the time the wand passed the middle of a stroke.
+
+Requires:
+  - Called from the main loop (not an interrupt), once per stroke
+  - u32TimeUs_ is a SysTimeGetUs() time; bRising_ is true if the X acceleration was rising through zero (the wand
+    is moving towards -X, so the next stroke is towards +X)
+
+Promises:
+  - Strokes outside POV_SWING_MIN_STROKE_US..POV_SWING_MAX_STROKE_US restart the lock count
+  - While locked, the error between this crossing and its prediction is recorded
+  - The middle and direction of the next stroke are predicted; Pov_u32CyclePeriod is the filtered swing cycle
+  - _POV_FLAGS_LOCKED is set and the columns start after POV_LOCK_MARKS good strokes; while locked a new schedule
+    is posted for the column interrupt
+*/
+void PovStrokeMark(u32 u32TimeUs_, bool bRising_)
+{
+  u32 u32Stroke = u32TimeUs_ - Pov_u32LastMark;
+  u32 u32Cycle;
+  s32 s32ErrorUs;
+
+  Pov_u32LastMark = u32TimeUs_;
+
+  if( (u32Stroke < POV_SWING_MIN_STROKE_US) || (u32Stroke > POV_SWING_MAX_STROKE_US) )
+  {
+    Pov_u8GoodMarks = 0;
+    return;
+  }
+
+  if(G_u32PovFlags & _POV_FLAGS_LOCKED)
+  {
+    s32ErrorUs = (s32)(u32TimeUs_ - Pov_u32NextCenterUs);
+    Pov_sColumnStats.s32CenterErrorUs = s32ErrorUs;
+    if(s32ErrorUs < 0)
+    {
+      s32ErrorUs = -s32ErrorUs;
+    }
+    if((u32)s32ErrorUs > Pov_sColumnStats.u32MaxCenterErrorUs)
+    {
+      Pov_sColumnStats.u32MaxCenterErrorUs = (u32)s32ErrorUs;
+    }
+    Pov_sColumnStats.u32Strokes++;
+  }
+
+  /* A prediction needs the stroke before this one too */
+  if(Pov_u8GoodMarks == 0)
+  {
+    Pov_u32StrokeUs = u32Stroke;
+    Pov_u8GoodMarks = 1;
+    return;
+  }
+
+  /* The next stroke runs the same way as the previous one, so it lasts about as long */
+  u32Cycle = Pov_u32StrokeUs + u32Stroke;
+  Pov_u32NextCenterUs = u32TimeUs_ + Pov_u32StrokeUs;
+  Pov_u32StrokeUs = u32Stroke;
+  Pov_bNextReverse = !bRising_;
+
+  if(Pov_u8GoodMarks == 1)
+  {
+    Pov_u32CyclePeriod = u32Cycle;
+  }
+  else
+  {
+    Pov_u32CyclePeriod = (u32)( (s32)Pov_u32CyclePeriod +
+                                (((s32)u32Cycle - (s32)Pov_u32CyclePeriod) >> POV_PERIOD_FILTER_SHIFT) );
+  }
+
+  if(Pov_u8GoodMarks < POV_LOCK_MARKS)
+  {
+    Pov_u8GoodMarks++;
+  }
+
+  if(G_u32PovFlags & _POV_FLAGS_LOCKED)
+  {
+    PovPublishSchedule();
+  }
+  else if(Pov_u8GoodMarks >= POV_LOCK_MARKS)
+  {
+    PovStart();
+  }
+
+} /* end PovStrokeMark() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovPublishSchedule
+
+Description:
+Builds the column timing from the rotation or swing estimate and posts it to the column interrupt.
+
+Requires:
+  - Pov_u32CyclePeriod is in range
+  - Main loop context (the column interrupt is the only reader)
+
+Promises:
+  - Spinning: Pov_sMailbox holds the timing for the revolution starting at the last mark, with the image across
+    Pov_u32ImageWidth of it
+  - Swinging: Pov_sMailbox holds the timing for the next stroke, centered on Pov_u32NextCenterUs
+  - Every other column is skipped if the PWM slots would be shorter than POV_MIN_SLOT_US
+  - Pov_bMailboxValid is set
+*/
+void PovPublishSchedule(void)
+{
+  s32 s32OffsetUs;
+  u32 u32SpanUs;
+
+  s32OffsetUs = (s32)( ((s64)Pov_s16PhaseOffset * (s64)Pov_u32CyclePeriod) >> 16 );
+
+  /* Invalidate first so the interrupt never adopts a half-written schedule */
+  Pov_bMailboxValid = false;
+  if(Pov_eMotionMode == POV_MOTION_SWING)
+  {
+    u32SpanUs = ((Pov_u32CyclePeriod >> 1) * POV_SWING_SPAN_Q8) >> 8;
+    Pov_sMailbox.u32StartUs  = Pov_u32NextCenterUs - (u32SpanUs >> 1);
+    Pov_sMailbox.u32PeriodUs = Pov_u32CyclePeriod >> 1;
+    Pov_sMailbox.u32StepQ8   = (u32SpanUs << 8) / POV_COLUMNS;
+    Pov_sMailbox.bGap        = true;
+    Pov_sMailbox.bSwing      = true;
+    Pov_sMailbox.bReverse    = Pov_bNextReverse;
+  }
+  else
+  {
+    Pov_sMailbox.u32StartUs  = Pov_u32LastMark + (u32)s32OffsetUs;
+    Pov_sMailbox.u32PeriodUs = Pov_u32CyclePeriod;
+    Pov_sMailbox.u32StepQ8   = (u32)( (((u64)Pov_u32CyclePeriod * Pov_u32ImageWidth) >> 8) / POV_COLUMNS );
+    Pov_sMailbox.bGap        = (bool)(Pov_u32ImageWidth < POV_PHASE_FULL);
+    Pov_sMailbox.bSwing      = false;
+    Pov_sMailbox.bReverse    = false;
+  }
+
+  /* Too fast for full resolution: show every other column for twice as long */
+  Pov_sMailbox.u8ColumnStride = 1;
+  while( ((Pov_sMailbox.u32StepQ8 * Pov_sMailbox.u8ColumnStride) < (POV_MIN_SLOT_US * POV_PWM_SLOTS << 8)) &&
+         (Pov_sMailbox.u8ColumnStride < POV_MAX_COLUMN_STRIDE) )
+  {
+    Pov_sMailbox.u8ColumnStride <<= 1;
+  }
+  Pov_sMailbox.u32SlotQ8 = (Pov_sMailbox.u32StepQ8 * Pov_sMailbox.u8ColumnStride) / POV_PWM_SLOTS;
+  Pov_sMailbox.u32ColumnRecipQ32 = (u32)( ((u64)1 << 40) / Pov_sMailbox.u32StepQ8 );
+  Pov_bMailboxValid = true;
+
+} /* end PovPublishSchedule() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovStart
+
+Description:
+Locks the estimate and starts the column interrupt.
+
+Requires:
+  - Columns are not running
+
+Promises:
+  - The LED animation is stopped so the columns own the LEDs
+  - _POV_FLAGS_LOCKED set and the first column alarm set
+*/
+void PovStart(void)
+{
+  LedStopAnimation();
+  G_u32PovFlags |= _POV_FLAGS_LOCKED;
+  PovPublishSchedule();
+  PovAdoptSchedule(SysTimeGetUs());
+
+} /* end PovStart() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovStop
+
+Description:
+Stops the column interrupt and hands the LEDs back to the idle animation.
+
+Requires:
+  -
+
+Promises:
+  - No column alarm pending, _POV_FLAGS_LOCKED clear
+  - A pending back frame is made the front frame
+  - G_sLedIdleAnimation playing
+*/
+void PovStop(void)
+{
+  SysTimeAlarmCancel();
+  if(Pov_bSwapPending)
+  {
+    Pov_u8Front ^= 1;
+    Pov_bSwapPending = false;
+  }
+  NRF_GPIO->OUTCLR = POV_LED_MASK;
+  Pov_bMailboxValid = false;
+  G_u32PovFlags &= ~_POV_FLAGS_LOCKED;
+  LedPlayAnimation(&G_sLedIdleAnimation);
+
+} /* end PovStop() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovWrapSchedule
+
+Description:
+Ends a revolution or stroke: swaps in a pending frame and moves on to the next schedule.
+
+Requires:
+  - Column interrupt context, after the last column
+
+Promises:
+  - A pending back frame becomes the front frame
+  - The current schedule repeats one period later (the other way round when swinging) unless a new one was posted
+*/
+void PovWrapSchedule(u32 u32NowUs_)
+{
+  if(Pov_bSwapPending)
+  {
+    Pov_u8Front ^= 1;
+    Pov_bSwapPending = false;
+  }
+
+  Pov_sActive.u32StartUs += Pov_sActive.u32PeriodUs;
+  Pov_sActive.bReverse ^= Pov_sActive.bSwing;
+  PovAdoptSchedule(u32NowUs_);
+
+} /* end PovWrapSchedule() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovAdoptSchedule
+
+Description:
+Takes the posted schedule (if any) and finds the next column due after now.
+
+Requires:
+  - Column interrupt context, or the interrupt is not running
+
+Promises:
+  - Pov_sActive starts at the latest revolution (or stroke) start not after u32NowUs_; each stroke skipped
+    reverses the direction
+  - Pov_u16Column is the next column due and the alarm for its first plane is set
+*/
+void PovAdoptSchedule(u32 u32NowUs_)
+{
+  u32 u32Elapsed;
+
+  if(Pov_bMailboxValid)
+  {
+    Pov_sActive = Pov_sMailbox;
+    Pov_bMailboxValid = false;
+  }
+
+  /* Bring the start within one revolution before now; a start in the future is simply waited for */
+  while( (s32)(u32NowUs_ - Pov_sActive.u32StartUs) >= (s32)Pov_sActive.u32PeriodUs )
+  {
+    Pov_sActive.u32StartUs += Pov_sActive.u32PeriodUs;
+    Pov_sActive.bReverse ^= Pov_sActive.bSwing;
+  }
+
+  Pov_u16Column = 0;
+  Pov_u8Plane = 0;
+  if( (s32)(u32NowUs_ - Pov_sActive.u32StartUs) > 0 )
+  {
+    /* Joining part way round: skip to the next column instead of rushing through the ones already passed (or
+    past the end of a stroke to the next one) */
+    u32Elapsed = u32NowUs_ - Pov_sActive.u32StartUs;
+    Pov_u16Column = (u16)( (((u64)u32Elapsed * Pov_sActive.u32ColumnRecipQ32) >> 32) + Pov_sActive.u8ColumnStride );
+    Pov_u16Column &= ~(u16)(Pov_sActive.u8ColumnStride - 1);
+    if(Pov_u16Column >= POV_COLUMNS)
+    {
+      Pov_u16Column = 0;
+      Pov_sActive.u32StartUs += Pov_sActive.u32PeriodUs;
+      Pov_sActive.bReverse ^= Pov_sActive.bSwing;
+    }
+  }
+
+  SysTimeAlarmSet(Pov_sActive.u32StartUs + ((Pov_u16Column * Pov_sActive.u32StepQ8) >> 8), PovColumnAlarm);
+
+} /* end PovAdoptSchedule() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovColumnAlarm
+
+Description:
+Column interrupt: shows the due bit plane of the column and sets the alarm for the next plane or column.
+
+Requires:
+  - Runs from TIMER2_IRQHandler via SysTimeAlarmSet()
+
+Promises:
+  - LED outputs show plane Pov_u8Plane of column Pov_u16Column (counted from the last column on a return stroke)
+  - The lateness of each column's first plane is added to Pov_sColumnStats
+  - Columns advance by u8ColumnStride; with bGap the LEDs go dark at the end of the last column
+  - At the end of a revolution or stroke PovWrapSchedule() runs
+*/
+void PovColumnAlarm(u32 u32AlarmTime_)
+{
+  u32 u32Leds;
+  u32 u32Late;
+  u32 u32Limit = POV_LATE_FIRST_BUCKET_US;
+  u8 u8Bucket = 0;
+  u16 u16Column;
+
+  /* End of the last column: dark until the next revolution or stroke */
+  if(Pov_u16Column >= POV_COLUMNS)
+  {
+    NRF_GPIO->OUTCLR = POV_LED_MASK;
+    PovWrapSchedule(u32AlarmTime_);
+    return;
+  }
+
+  u16Column = Pov_sActive.bReverse ? (POV_COLUMNS - 1 - Pov_u16Column) : Pov_u16Column;
+  u32Leds = Pov_bBlank ? 0 : Pov_au32Planes[Pov_u8Front][u16Column][Pov_u8Plane];
+
+  /* All the LEDs of a plane switch together; the planes are not staggered per LED the way LedPWM() staggers its
+  periods.  Staggered planes would switch at the union of every LED's plane boundaries, about twice the alarms per
+  column and twice the plane RAM to hold the segments between them.  The peak is bounded instead by the governor,
+  which scales the duties so the highest plane fits the current budget (PovApplyCurrentBudget()). */
+  NRF_GPIO->OUTCLR = POV_LED_MASK & ~u32Leds;
+  NRF_GPIO->OUTSET = u32Leds;
+
+  /* The first plane is the one on the column grid: time it */
+  if(Pov_u8Plane == 0)
+  {
+    u32Late = SysTimeGetUs() - u32AlarmTime_;
+    while( (u32Late >= u32Limit) && (u8Bucket < (POV_LATE_BUCKETS - 1)) )
+    {
+      u32Limit <<= 1;
+      u8Bucket++;
+    }
+    Pov_sColumnStats.au32LateHistogram[u8Bucket]++;
+    Pov_sColumnStats.u32Columns++;
+    if(u32Late > Pov_sColumnStats.u32MaxLateUs)
+    {
+      Pov_sColumnStats.u32MaxLateUs = u32Late;
+    }
+  }
+
+  /* Plane n (0 = most significant) is shown for 2^(POV_PWM_BITS - 1 - n) slots; the last one runs to the next column */
+  Pov_u8Plane++;
+  if(Pov_u8Plane < POV_PWM_BITS)
+  {
+    SysTimeAlarmSet(u32AlarmTime_ + ((Pov_sActive.u32SlotQ8 << (POV_PWM_BITS - Pov_u8Plane)) >> 8), PovColumnAlarm);
+    return;
+  }
+
+  /* Without a gap the last column runs on to column 0; with one, one more alarm ends it (column POV_COLUMNS) */
+  Pov_u8Plane = 0;
+  Pov_u16Column += Pov_sActive.u8ColumnStride;
+  if( (Pov_u16Column >= POV_COLUMNS) && !Pov_sActive.bGap )
+  {
+    PovWrapSchedule(u32AlarmTime_);
+    return;
+  }
+
+  SysTimeAlarmSet(Pov_sActive.u32StartUs + ((Pov_u16Column * Pov_sActive.u32StepQ8) >> 8), PovColumnAlarm);
+
+} /* end PovColumnAlarm() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovRenderFrame
+
+Description:
+Renders every column into the back frame and queues it for display, e.g. for a new image.
+
+Requires:
+  - Pov_sImage is open
+  - Main loop context
+
+Promises:
+  - If a swap is still pending its back frame is replaced (it has not been shown)
+  - Pov_sFrameCurrent holds the frame's LED current: highest plane and the slot sum
+  - If the columns are running the frame is swapped in by the interrupt at the next column 0; otherwise now
+*/
+void PovRenderFrame(void)
+{
+  u8 u8Back = Pov_u8Front ^ 1;
+
+  /* While a swap is pending the interrupt reads Pov_bSwapPending at every wrap: withdraw the frame first */
+  Pov_bSwapPending = false;
+  if(Pov_u8Front == u8Back)
+  {
+    /* The interrupt swapped just before the withdrawal: the other frame is the back one now */
+    u8Back ^= 1;
+  }
+
+  memset(&Pov_sFrameCurrent, 0, sizeof(Pov_sFrameCurrent));
+  for(u16 u16Column = 0; u16Column < POV_COLUMNS; u16Column++)
+  {
+    PovRenderColumn(u8Back, u16Column, &Pov_sFrameCurrent);
+  }
+  Pov_u16RenderColumn = 0;
+
+  if(G_u32PovFlags & _POV_FLAGS_LOCKED)
+  {
+    Pov_bSwapPending = true;
+  }
+  else
+  {
+    Pov_u8Front = u8Back;
+  }
+
+} /* end PovRenderFrame() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovRenderColumn
+
+Description:
+Decodes one column of image levels and converts it to bit planes through the scaled duty lookup tables, with
+temporal dither.
+
+Requires:
+  - u8Frame_ is 0 or 1; u16Column_ < POV_COLUMNS and is not the column on display in that frame
+  - Pov_sImage is open; columns are cheapest in order (the decoder is sequential)
+  - psCurrent_ is NULL, or the totals to add the column's current to
+
+Promises:
+  - Pov_au32Planes[u8Frame_][u16Column_] holds the POV_PWM_BITS most significant bits of each corrected and scaled
+    duty plus error
+  - The bits that were not shown are kept in Pov_au8DitherError for the next revolution
+  - If psCurrent_ is not NULL: its peak is raised to this column's highest plane and the column's current times the
+    slots of each plane is added to u32SlotMa
+*/
+void PovRenderColumn(u8 u8Frame_, u16 u16Column_, PovColumnCurrentType* psCurrent_)
+{
+  u32 au32Planes[POV_PWM_BITS];
+  u32 au32PlaneMa[POV_PWM_BITS];
+  const u8* pu8Levels;
+  u8* pu8Error;
+  u32 u32Duty;
+  u8 u8Channel;
+
+  /* Out of order (new image or joining part way round): decode forward to the column */
+  while(Pov_sImage.u8Column != u16Column_)
+  {
+    PovImageNextColumn(&Pov_sImage);
+  }
+  pu8Levels = PovImageNextColumn(&Pov_sImage);
+
+  memset(au32Planes, 0, sizeof(au32Planes));
+  memset(au32PlaneMa, 0, sizeof(au32PlaneMa));
+
+  for(u8 u8Color = 0; u8Color < POV_COLORS; u8Color++)
+  {
+    pu8Error = Pov_au8DitherError[u8Color][u16Column_];
+    u8Channel = u8Color;
+    for(u8 u8Pixel = 0; u8Pixel < POV_PIXELS; u8Pixel++, u8Channel += POV_COLORS)
+    {
+      /* One table load per channel; duty + error is at most POV_DUTY_FULL + POV_DITHER_MASK, within 8 bits */
+      u32Duty = Pov_au8ScaledLut[u8Color][pu8Levels[u8Channel]] + pu8Error[u8Pixel];
+      pu8Error[u8Pixel] = (u8)(u32Duty & POV_DITHER_MASK);
+
+      /* Spread the PWM bits to the planes, and the channel's current to the planes it is on in, without branching */
+      for(u8 u8Plane = 0; u8Plane < POV_PWM_BITS; u8Plane++)
+      {
+        au32Planes[u8Plane] |= Pov_au32ChannelPins[u8Channel] & (0 - ((u32Duty >> (7 - u8Plane)) & 1));
+        au32PlaneMa[u8Plane] += Pov_au32LedCurrentMa[u8Color] & (0 - ((u32Duty >> (7 - u8Plane)) & 1));
+      }
+    }
+  }
+
+  for(u8 u8Plane = 0; (psCurrent_ != NULL) && (u8Plane < POV_PWM_BITS); u8Plane++)
+  {
+    if(au32PlaneMa[u8Plane] > psCurrent_->u32PeakMa)
+    {
+      psCurrent_->u32PeakMa = au32PlaneMa[u8Plane];
+    }
+    psCurrent_->u32SlotMa += au32PlaneMa[u8Plane] << (POV_PWM_BITS - 1 - u8Plane);
+  }
+
+  memcpy(Pov_au32Planes[u8Frame_][u16Column_], au32Planes, sizeof(au32Planes));
+
+} /* end PovRenderColumn() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovPlanePeakMa
+
+Description:
+Works out the highest bit plane current of the image shown if its duties were scaled by u16Scale_.  The dither
+error can add up to POV_DITHER_MASK to a duty, so a channel counts in a plane if its bit is set at either end of
+that range: the bits above the dither cannot change more than once over it.
+
+Requires:
+  - Pov_sImage is open
+  - u16Scale_ in 1/256, at most POV_CURRENT_SCALE_FULL
+
+Promises:
+  - Returns the most current any plane of any column can draw, whatever the dither error, in mA
+  - Pov_sImage is not moved (a copy is decoded)
+*/
+u32 PovPlanePeakMa(u16 u16Scale_)
+{
+  PovImageDecoderType sImage = Pov_sImage;
+  u32 au32PlaneMa[POV_PWM_BITS];
+  const u8* pu8Levels;
+  u32 u32Duty;
+  u32 u32PeakMa = 0;
+
+  PovImageRewind(&sImage);
+  for(u16 u16Column = 0; u16Column < POV_COLUMNS; u16Column++)
+  {
+    pu8Levels = PovImageNextColumn(&sImage);
+    memset(au32PlaneMa, 0, sizeof(au32PlaneMa));
+
+    for(u8 u8Channel = 0; u8Channel < POV_CHANNELS; u8Channel++)
+    {
+      u32Duty = (Pov_au8DutyLut[u8Channel % POV_COLORS][pu8Levels[u8Channel]] * u16Scale_) >> 8;
+      u32Duty |= u32Duty + POV_DITHER_MASK;
+      for(u8 u8Plane = 0; u8Plane < POV_PWM_BITS; u8Plane++)
+      {
+        au32PlaneMa[u8Plane] += Pov_au32LedCurrentMa[u8Channel % POV_COLORS] & (0 - ((u32Duty >> (7 - u8Plane)) & 1));
+      }
+    }
+
+    for(u8 u8Plane = 0; u8Plane < POV_PWM_BITS; u8Plane++)
+    {
+      if(au32PlaneMa[u8Plane] > u32PeakMa)
+      {
+        u32PeakMa = au32PlaneMa[u8Plane];
+      }
+    }
+  }
+
+  return(u32PeakMa);
+
+} /* end PovPlanePeakMa() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovApplyCurrentBudget
+
+Description:
+Works out the duty scale that keeps every bit plane of the image shown within the budget and rebuilds the scaled
+duty tables if it changed.  A plane is not a smooth function of the scale (a duty dropping below 128 leaves plane 0
+but can join the lower ones), so the scale is found by bisection that keeps a scale known to fit: scale 0 always
+fits, since no dither error reaches the PWM bits on its own.
+
+Requires:
+  - Pov_sImage is open
+  - Main loop context (the tables are only read by the renderer)
+
+Promises:
+  - Pov_u32CurrentDemandMa is the image's highest plane unscaled
+  - Pov_u16CurrentScale is POV_CURRENT_SCALE_FULL, or the largest scale found whose planes fit Pov_u32CurrentBudgetMa
+  - Pov_au8ScaledLut is Pov_au8DutyLut times the scale
+  - Returns true if the scale changed (frames rendered before now use the old one)
+*/
+bool PovApplyCurrentBudget(void)
+{
+  u16 u16Scale = POV_CURRENT_SCALE_FULL;
+  u16 u16Over = POV_CURRENT_SCALE_FULL;
+  u16 u16Try;
+
+  Pov_u32CurrentDemandMa = PovPlanePeakMa(POV_CURRENT_SCALE_FULL);
+  if( (Pov_u32CurrentBudgetMa != 0) && (Pov_u32CurrentDemandMa > Pov_u32CurrentBudgetMa) )
+  {
+    /* u16Scale fits and u16Over does not */
+    u16Scale = 0;
+    while( (u16Over - u16Scale) > 1 )
+    {
+      u16Try = (u16Scale + u16Over) >> 1;
+      if(PovPlanePeakMa(u16Try) <= Pov_u32CurrentBudgetMa)
+      {
+        u16Scale = u16Try;
+      }
+      else
+      {
+        u16Over = u16Try;
+      }
+    }
+  }
+
+  if(u16Scale == Pov_u16CurrentScale)
+  {
+    return(false);
+  }
+
+  Pov_u16CurrentScale = u16Scale;
+  for(u8 u8Color = 0; u8Color < POV_COLORS; u8Color++)
+  {
+    for(u16 u16Level = 0; u16Level < POV_LEVELS; u16Level++)
+    {
+      Pov_au8ScaledLut[u8Color][u16Level] = (u8)( (Pov_au8DutyLut[u8Color][u16Level] * u16Scale) >> 8 );
+    }
+  }
+
+  return(true);
+
+} /* end PovApplyCurrentBudget() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovWatchUpload
+
+Description:
+Keeps the image shown in step with uploads into the image flash area.
+
+Requires:
+  - Runs after AntUpdate(), where uploads start, and before the next ImageWriterUpdate(), which erases
+
+Promises:
+  - When the writer starts (IMAGE_WRITER_WRITING) and the image shown is in the image flash area, the test image is
+    shown instead, so nothing is decoded from pages being erased and written
+  - When the writer reaches IMAGE_WRITER_COMPLETE the new flash image is opened; if it is not valid the current
+    image stays
+*/
+void PovWatchUpload(void)
+{
+  ImageWriterStatusType eStatus = ImageWriterGetStatus();
+
+  if(eStatus == Pov_eWriterStatus)
+  {
+    return;
+  }
+  Pov_eWriterStatus = eStatus;
+
+  if( (eStatus == IMAGE_WRITER_WRITING) && ((u32)(uintptr_t)Pov_sImage.pu8Data >= IMAGE_FLASH_START) &&
+      ((u32)(uintptr_t)Pov_sImage.pu8Data < IMAGE_FLASH_END) )
+  {
+    PovSetImage(Pov_au8TestImage, sizeof(Pov_au8TestImage));
+  }
+  else if(eStatus == IMAGE_WRITER_COMPLETE)
+  {
+    PovSetImage((const u8*)IMAGE_FLASH_START, IMAGE_FLASH_END - IMAGE_FLASH_START);
+  }
+
+} /* end PovWatchUpload() */
+
 
 
 
@@ -82,14 +1495,118 @@ void PovInitialize(void)
 /* State Machine definitions                                                                                          */
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovSM_Active
+Awake: the image is shown while there is motion.  Waits for the wand to lie still long enough to power off.
+*/
+void PovSM_Active(void)
+{
+  u8 u8Taps;
+  ButtonEventType sButton;
+
+  /* Measure how long a wake from System OFF took to show something */
+  if( (G_u32SystemFlags & _SYSTEM_WOKE_FROM_OFF) && (Pov_u32WakeToColumnUs == 0) &&
+      (Pov_sColumnStats.u32Columns != 0) )
+  {
+    Pov_u32WakeToColumnUs = SysTimeGetUs();
+  }
+
+  if(AccelGetStillMs() >= POV_ACCEL_IDLE_STILL_MS)
+  {
+    AccelSetProfile(ACCEL_PROFILE_IDLE);
+  }
+  else if( (G_u32PovFlags & _POV_FLAGS_LOCKED) && (Pov_eMotionMode == POV_MOTION_SPIN) )
+  {
+    AccelSetProfile(ACCEL_PROFILE_SPIN);
+  }
+  else
+  {
+    AccelSetProfile(ACCEL_PROFILE_SWING);
+  }
+
+  /* Taps are read even while locked so old ones do not pile up, but only acted on when not */
+  if( AccelGetTap(&u8Taps) && !(G_u32PovFlags & _POV_FLAGS_LOCKED) )
+  {
+    if(u8Taps == 1)
+    {
+      PovNextImage();
+    }
+    else
+    {
+      PovSetMotionMode(Pov_eMotionMode == POV_MOTION_SPIN ? POV_MOTION_SWING : POV_MOTION_SPIN);
+    }
+  }
+
+  /* Buttons cannot be mistaken for motion, so they work while locked too */
+  while( ButtonGetEvent(&sButton) )
+  {
+    Pov_u32LastButtonMs = SysTimeGetMs();
+    if( (sButton.eButton == POV_BUTTON) && (sButton.eEvent == BUTTON_EVENT_CLICK) )
+    {
+      if(sButton.u8Clicks == 1)
+      {
+        PovNextImage();
+      }
+      else
+      {
+        PovSetMotionMode(Pov_eMotionMode == POV_MOTION_SPIN ? POV_MOTION_SWING : POV_MOTION_SPIN);
+      }
+    }
+    else if(sButton.eButton == POV_REMOTE_BUTTON)
+    {
+      if(sButton.eEvent == BUTTON_EVENT_LONG_PRESS)
+      {
+        RemoteSetEnabled( !RemoteIsEnabled() );
+      }
+      else
+      {
+        RemoteStartPairing();
+      }
+    }
+  }
+
+  if( IsButtonPressed(POV_BUTTON) )
+  {
+    Pov_u32LastButtonMs = SysTimeGetMs();
+  }
+
+  if( (G_u32PovFlags & _POV_FLAGS_LOCKED) ||
+      (AccelGetStillMs() < POV_SLEEP_STILL_MS) ||
+      (SysTimeElapsed(Pov_u32LastButtonMs) < POV_SLEEP_STILL_MS) ||
+      (SysTimeElapsed(Pov_u32Timeout) < POV_SLEEP_RETRY_MS) ||
+      (ImageWriterGetStatus() == IMAGE_WRITER_WRITING) ||
+      (ImageWriterGetStatus() == IMAGE_WRITER_VERIFYING) )
+  {
+    return;
+  }
+
+  Pov_pfnStateMachine = PovSM_Idle;
+
+} /* end PovSM_Active() */
+
+
 /*--------------------------------------------------------------------------------------------------------------------
 Function: PovSM_Idle
 No motion detected, system powered off.
 */
 void PovSM_Idle(void)
 {
+  /* LEDs off: System OFF keeps the outputs as they are */
+  LedStopAnimation();
+  NRF_GPIO->OUTCLR = POV_LED_MASK;
 
-} /* end PovInitialize() */
+  if( AccelSleep() )
+  {
+    /* Does not return: motion on INT1 restarts the system */
+    SystemOff();
+  }
+
+  /* The accelerometer could not be set to wake the system: stay on and try again later */
+  LedPlayAnimation(&G_sLedIdleAnimation);
+  Pov_u32Timeout = SysTimeGetMs();
+  Pov_pfnStateMachine = PovSM_Active;
+
+} /* end PovSM_Idle() */
 
 
 
@@ -11,11 +11,147 @@ This is a pov .h file new source code header file.
 /**********************************************************************************************************************
 Type Definitions
 **********************************************************************************************************************/
+/* Motion source: rotation (one mark per revolution) or a handheld swing (two strokes per cycle) */
+typedef enum {POV_MOTION_SPIN = 0, POV_MOTION_SWING} PovMotionType;
+
+/* Column timing for one revolution or stroke.  Built by the main loop and handed to the column interrupt as a
+whole. */
+typedef struct
+{
+  u32 u32StartUs;                             /* Time column 0 is shown (revolution mark + phase offset) */
+  u32 u32PeriodUs;                            /* Revolution period, or stroke period when swinging */
+  u32 u32StepQ8;                              /* Image column pitch in 1/256 us */
+  u32 u32ColumnRecipQ32;                      /* 2^40 / u32StepQ8: image columns per us in 1/2^32 (no ISR divide) */
+  u32 u32SlotQ8;                              /* PWM slot (shown column period / POV_PWM_SLOTS) in 1/256 us */
+  u8 u8ColumnStride;                          /* Image columns per shown column: 1, or 2 to skip every other */
+  bool bGap;                                  /* Columns cover part of the period, then the LEDs go dark */
+  bool bSwing;                                /* Strokes alternate direction */
+  bool bReverse;                              /* Show the columns last to first (return stroke) */
+} PovScheduleType;
+
+/* Column timing measurements: how late each column was shown, in power of 2 buckets */
+typedef struct
+{
+  u32 au32LateHistogram[8];                   /* [0] < 4 us, [1] < 8 us ... [6] < 256 us, [7] >= 256 us */
+  u32 u32MaxLateUs;                           /* Latest column */
+  u32 u32Columns;                             /* Columns shown */
+  u32 u32MaxRenderUs;                         /* Longest PovUpdate() render pass */
+  u32 u32MaxFrameRenderUs;                    /* Most render time spent in one revolution */
+  u32 u32Strokes;                             /* Swing strokes measured while locked */
+  s32 s32CenterErrorUs;                       /* Last stroke center minus where it was predicted */
+  u32 u32MaxCenterErrorUs;                    /* Largest center error magnitude */
+} PovColumnStatsType;
+
+/* LED current estimate of the frame being shown */
+typedef struct
+{
+  u32 u32PeakMa;                              /* Highest bit plane of any column after the governor */
+  u32 u32AverageMa;                           /* Duty-weighted mean over the columns after the governor */
+  u32 u32DemandMa;                            /* Highest bit plane the image can ask for, with dither error */
+  u32 u32BudgetMa;                            /* Limit in force, 0 = none */
+  u16 u16ScaleQ8;                             /* Duty scale applied, POV_CURRENT_SCALE_FULL = none */
+} PovCurrentStatsType;
+
+/* LED current of rendered columns, added up by PovRenderColumn() */
+typedef struct
+{
+  u32 u32PeakMa;                              /* Highest bit plane */
+  u32 u32SlotMa;                              /* Plane current times its slots, summed (average * POV_PWM_SLOTS) */
+} PovColumnCurrentType;
 
 
 /**********************************************************************************************************************
 Constants / Definitions
 **********************************************************************************************************************/
+#define POV_COLUMNS                 (u16)64                 /* Image columns per revolution */
+
+/* Image pixels: one 8-bit level per LED channel, channels in LedNumberType order (ARED, AGRN, ABLU, DRED...) */
+#define POV_PIXELS                  (u8)4                   /* LED groups A, D, Y, M */
+#define POV_COLORS                  (u8)3                   /* Red, green, blue */
+#define POV_CHANNELS                (u8)(POV_PIXELS * POV_COLORS)
+#define POV_LEVELS                  (u16)256
+
+/* Column PWM: binary weighted slots, POV_PWM_BITS bit planes per column.  The most significant plane is shown
+for 2^(POV_PWM_BITS - 1) slots, the least significant for one. */
+#define POV_PWM_BITS                (u8)4
+#define POV_PWM_SLOTS               (u8)((1 << POV_PWM_BITS) - 1)
+
+/* Temporal dither: duties carry POV_DITHER_BITS below the PWM bits.  Full scale is POV_PWM_SLOTS whole steps so
+duty + error never overflows the PWM. */
+#define POV_DITHER_BITS             (u8)(8 - POV_PWM_BITS)
+#define POV_DITHER_MASK             (u8)((1 << POV_DITHER_BITS) - 1)
+#define POV_DUTY_FULL               (u32)(POV_PWM_SLOTS << POV_DITHER_BITS)
+
+/* Color correction: duty = POV_DUTY_FULL * white balance * gamma(level).  The gamma curve approximates 2.2 as
+x^2 * (x + 3 * 255) / (4 * 255^2), which is within 0.5% of full scale everywhere.  The white balance scales
+(out of 255) dim the stronger dies so full red + green + blue is neutral; trim them against a reference white. */
+#define POV_GAMMA(x)                (u32)( ((u32)(x) * (u32)(x) * ((u32)(x) + 765UL)) / 260100UL )
+#define POV_WHITE_RED               (u32)255
+#define POV_WHITE_GRN               (u32)190
+#define POV_WHITE_BLU               (u32)215
+
+/* Current governor: each LED die draws about its POV_LED_xxx_MA through its resistor while it is on, so the peak
+is a bit plane's on-count times the current (plane 0, duty >= 128, included); duty * current is only the average.
+An image whose planes would draw more than the budget is dimmed as a whole by a duty scale.  The default budget is
+every LED on at once, so artwork is only dimmed if a lower budget is set (command BUDGET). */
+#define POV_LED_RED_MA              (u32)20
+#define POV_LED_GRN_MA              (u32)20
+#define POV_LED_BLU_MA              (u32)20
+#define POV_CURRENT_BUDGET_MA       (u32)(POV_PIXELS * (POV_LED_RED_MA + POV_LED_GRN_MA + POV_LED_BLU_MA))
+#define POV_CURRENT_SCALE_FULL      (u16)256                /* Duty scale of 1 in 1/256 */
+
+/* Rotation estimator */
+#define POV_MIN_PERIOD_US           (u32)20000              /* 50 rev/s: faster marks are treated as noise */
+#define POV_MAX_PERIOD_US           (u32)1000000            /* 1 rev/s: slower than this is not spinning */
+#define POV_PERIOD_FILTER_SHIFT     (u8)3                   /* Period IIR weight 1/8 */
+#define POV_LOCK_MARKS              (u8)3                   /* Good marks in a row before the display starts */
+#define POV_UNLOCK_PERIODS          (u32)2                  /* Missing marks for this many periods stops it */
+
+/* Motion detector: zero crossings of the accelerometer X axis (+/-32768 = +/-2 g).  A crossing counts once the
+signal has gone POV_CROSSING_HYSTERESIS past zero; its time is interpolated between the samples either side. */
+#define POV_CROSSING_HYSTERESIS     (s16)1638               /* 0.1 g */
+
+/* Swing: the tangential acceleration crosses zero at the middle of each stroke, where the wand moves fastest.
+The image is drawn across the middle POV_SWING_SPAN_Q8 / 256 of each stroke, centered on the predicted crossing. */
+#define POV_SWING_MIN_STROKE_US     (u32)50000              /* 10 Hz swing cycle: faster is noise */
+#define POV_SWING_MAX_STROKE_US     (u32)1000000            /* Slower than this is not swinging */
+#define POV_SWING_SPAN_Q8           (u32)128                /* Image across half of the stroke time */
+
+/* LED outputs by color: one pixel (red, green, blue) per group A, D, Y, M */
+#define POV_RED_LEDS                (P0_19_ARED | P0_13_DRED | P0_10_YRED | P0_15_MRED)
+#define POV_GRN_LEDS                (P0_17_AGRN | P0_11_DGRN | P0_08_YGRN | P0_14_MGRN)
+#define POV_BLU_LEDS                (P0_18_ABLU | P0_12_DBLU | P0_09_YBLU | P0_16_MBLU)
+#define POV_LED_MASK                (POV_RED_LEDS | POV_GRN_LEDS | POV_BLU_LEDS)
+
+#define POV_LATE_BUCKETS            (u8)8                   /* Entries in au32LateHistogram */
+#define POV_LATE_FIRST_BUCKET_US    (u32)4                  /* Upper limit of bucket 0 */
+
+/* Phase is a 16-bit angle: 0x10000 = one revolution */
+#define POV_PHASE_FULL              (u32)0x10000
+
+/* Image width while spinning: the image covers this angle from column 0 and the LEDs are dark for the rest of
+the revolution, so the image keeps its size at any speed */
+#define POV_IMAGE_WIDTH_DEFAULT     POV_PHASE_FULL
+#define POV_IMAGE_WIDTH_MIN         (u32)(POV_PHASE_FULL / 16)
+
+/* Shortest PWM slot the column interrupt can keep up with.  Faster than this, every other column is skipped so
+the shown columns (and their slots) are twice as long. */
+#define POV_MIN_SLOT_US             (u32)10
+#define POV_MAX_COLUMN_STRIDE       (u8)2
+
+/* Power: still this long with nothing shown and the system enters System OFF until the accelerometer sees motion */
+#define POV_ACCEL_IDLE_STILL_MS     (u32)2000               /* Still this long: accelerometer to 10 Hz */
+#define POV_SLEEP_STILL_MS          (u32)60000
+#define POV_SLEEP_RETRY_MS          (u32)5000               /* Retry after the accelerometer refused the wake set up */
+
+/* Click: next image, double click: spin or swing */
+#define POV_BUTTON                  BUTTON0
+
+/* Long press: remote mode on or off, click: pair the next remote heard */
+#define POV_REMOTE_BUTTON           BUTTON1
+
+/* G_u32PovFlags */
+#define _POV_FLAGS_LOCKED           (u32)0x00000001         /* Rotation estimate is good and columns are running */
 
 
 /**********************************************************************************************************************
@@ -25,17 +161,54 @@ Function Declarations
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* Public functions                                                                                                   */
 /*--------------------------------------------------------------------------------------------------------------------*/
+void PovRevolutionMark(u32 u32TimeUs_);
+void PovMotionSample(s16 s16X_, u32 u32TimeUs_);
+void PovSetMotionMode(PovMotionType eMode_);
+PovMotionType PovGetMotionMode(void);
+bool PovGetRotation(u32* pu32PeriodUs_, u32* pu32MarkUs_);
+u16 PovGetPhase(u32 u32TimeUs_);
+void PovSetPhaseOffset(s16 s16Offset_);
+s16 PovGetPhaseOffset(void);
+void PovGetColumnStats(PovColumnStatsType* psStats_);
+void PovClearColumnStats(void);
+void PovSetBlank(bool bBlank_);
+void PovSetImageWidth(u32 u32Width_);
+bool PovSetImage(const u8* pu8Image_, u32 u32MaxSize_);
+void PovNextImage(void);
+void PovSetCurrentBudget(u32 u32BudgetMa_);
+void PovGetCurrentStats(PovCurrentStatsType* psStats_);
+u32 PovGetWakeTimeUs(void);
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* Protected functions                                                                                                */
 /*--------------------------------------------------------------------------------------------------------------------*/
 void PovInitialize(void);
+void PovUpdate(void);
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* Private functions                                                                                                  */
 /*--------------------------------------------------------------------------------------------------------------------*/
+void PovStrokeMark(u32 u32TimeUs_, bool bRising_);
+void PovPublishSchedule(void);
+void PovStart(void);
+void PovStop(void);
+void PovWrapSchedule(u32 u32NowUs_);
+void PovAdoptSchedule(u32 u32NowUs_);
+void PovColumnAlarm(u32 u32AlarmTime_);
+void PovRenderFrame(void);
+void PovRenderColumn(u8 u8Frame_, u16 u16Column_, PovColumnCurrentType* psCurrent_);
+u32 PovPlanePeakMa(u16 u16Scale_);
+bool PovApplyCurrentBudget(void);
+void PovWatchUpload(void);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* State Machine declarations                                                                                         */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void PovSM_Active(void);
+void PovSM_Idle(void);
 
 
 
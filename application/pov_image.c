@@ -0,0 +1,341 @@
+/**********************************************************************************************************************
+File: pov_image.c
+
+Description:
+POV image container and column decoder.
+
+An image in flash is a PovImageHeaderType followed by column data in one of the POV_IMAGE_FORMAT_... formats.
+Raw images cost POV_CHANNELS bytes per column.  RLE_DELTA images code each column against the one before it: a
+run of identical columns is one byte and a column that changes a few channels costs two mask bytes plus the new
+levels, so typical artwork (bars, text, sparse patterns) shrinks several times.  Palette images store a few colors once
+and then 1, 2 or 4 bits per pixel; a column expands with one palette lookup per pixel.
+
+Decoding is one column per PovImageNextColumn() call, always in column order, wrapping to column 0 after the
+last column.  Each call reads at most one code, its mask and POV_CHANNELS levels, so its time is bounded
+whatever the data holds.  Malformed data never reads outside the image: the decoder marks an error and returns
+dark columns.  Nothing outside the decoder structure is touched, so the column interrupt may call it too.
+
+Usage:
+  PovImageOpen(&sDecoder, pu8Image, u32MaxSize);
+  pu8Levels = PovImageNextColumn(&sDecoder);       (POV_CHANNELS levels for the next column)
+**********************************************************************************************************************/
+
+#include "configuration.h"
+
+/***********************************************************************************************************************
+Global variable definitions with scope across entire project.
+All Global variable names shall start with "G_"
+***********************************************************************************************************************/
+/* New variables */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Existing variables (defined in other files -- should all contain the "extern" keyword) */
+extern volatile u32 G_u32SystemFlags;                  /* From main.c */
+
+extern volatile u32 G_u32SystemTime1ms;                /* From board-specific source file */
+extern volatile u32 G_u32SystemTime1s;                 /* From board-specific source file */
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "PovImage_" and be declared as static.
+***********************************************************************************************************************/
+
+
+/**********************************************************************************************************************
+Function Definitions
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovImageOpen
+
+Description:
+Checks an image header and sets up a decoder for it.
+
+Requires:
+  - pu8Image_ points to u32MaxSize_ readable bytes (e.g. the image flash area)
+
+Promises:
+  - Returns false if the header is not a POV image of POV_COLUMNS columns in a known format, or the data does not
+    fit in u32MaxSize_
+  - Otherwise *psDecoder_ is ready to return column 0
+*/
+bool PovImageOpen(PovImageDecoderType* psDecoder_, const u8* pu8Image_, u32 u32MaxSize_)
+{
+  u16 u16DataSize;
+
+  if( (u32MaxSize_ < POV_IMAGE_HEADER_SIZE) ||
+      (pu8Image_[0] != POV_IMAGE_MAGIC0) || (pu8Image_[1] != POV_IMAGE_MAGIC1) ||
+      (pu8Image_[3] != POV_COLUMNS) )
+  {
+    return(false);
+  }
+
+  u16DataSize = (u16)pu8Image_[4] | ((u16)pu8Image_[5] << 8);
+  if(u16DataSize > (u32MaxSize_ - POV_IMAGE_HEADER_SIZE))
+  {
+    return(false);
+  }
+
+  switch(pu8Image_[2])
+  {
+    case POV_IMAGE_FORMAT_RAW:
+    {
+      if(u16DataSize != (POV_COLUMNS * POV_CHANNELS))
+      {
+        return(false);
+      }
+      break;
+    }
+
+    case POV_IMAGE_FORMAT_RLE_DELTA:
+      break;
+
+    case POV_IMAGE_FORMAT_PALETTE1:
+    case POV_IMAGE_FORMAT_PALETTE2:
+    case POV_IMAGE_FORMAT_PALETTE4:
+    {
+      /* 1, 2 or 4 bits */
+      psDecoder_->u8IndexBits = (u8)(1 << (pu8Image_[2] - POV_IMAGE_FORMAT_PALETTE1));
+      if(u16DataSize != (POV_IMAGE_PALETTE_SIZE(psDecoder_->u8IndexBits) +
+                         POV_IMAGE_INDEX_SIZE(psDecoder_->u8IndexBits)) )
+      {
+        return(false);
+      }
+      break;
+    }
+
+    default:
+      return(false);
+  }
+
+  psDecoder_->u8Format = pu8Image_[2];
+  psDecoder_->pu8Data  = &pu8Image_[POV_IMAGE_HEADER_SIZE];
+  psDecoder_->pu8End   = psDecoder_->pu8Data + u16DataSize;
+  if(psDecoder_->u8Format >= POV_IMAGE_FORMAT_PALETTE1)
+  {
+    psDecoder_->pu8Palette = psDecoder_->pu8Data;
+    psDecoder_->pu8Data   += POV_IMAGE_PALETTE_SIZE(psDecoder_->u8IndexBits);
+  }
+  PovImageRewind(psDecoder_);
+
+  return(true);
+
+} /* end PovImageOpen() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovImageRewind
+
+Description:
+Goes back to column 0.
+
+Requires:
+  - PovImageOpen() succeeded on psDecoder_
+
+Promises:
+  - The next PovImageNextColumn() returns column 0
+*/
+void PovImageRewind(PovImageDecoderType* psDecoder_)
+{
+  psDecoder_->pu8Next  = psDecoder_->pu8Data;
+  psDecoder_->u8Column = 0;
+  psDecoder_->u8Repeat = 0;
+  psDecoder_->bError   = false;
+  memset(psDecoder_->au8Levels, 0, POV_CHANNELS);
+
+} /* end PovImageRewind() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovImageNextColumn
+
+Description:
+Expands the next column.
+
+Requires:
+  - PovImageOpen() succeeded on psDecoder_
+
+Promises:
+  - Returns POV_CHANNELS levels for the column psDecoder_->u8Column had on entry (valid until the next call)
+  - psDecoder_->u8Column advances, wrapping to 0 (and the decoder rewinds) after the last column
+*/
+const u8* PovImageNextColumn(PovImageDecoderType* psDecoder_)
+{
+  if(psDecoder_->u8Column == 0)
+  {
+    PovImageRewind(psDecoder_);
+  }
+
+  if(psDecoder_->u8Format == POV_IMAGE_FORMAT_RAW)
+  {
+    /* Raw data is the levels themselves */
+    psDecoder_->u8Column++;
+    if(psDecoder_->u8Column >= POV_COLUMNS)
+    {
+      psDecoder_->u8Column = 0;
+    }
+    psDecoder_->pu8Next += POV_CHANNELS;
+    return(psDecoder_->pu8Next - POV_CHANNELS);
+  }
+
+  if(psDecoder_->u8Format >= POV_IMAGE_FORMAT_PALETTE1)
+  {
+    PovImageDecodePalette(psDecoder_);
+  }
+  else if(!psDecoder_->bError)
+  {
+    PovImageDecodeRleDelta(psDecoder_);
+  }
+
+  psDecoder_->u8Column++;
+  if(psDecoder_->u8Column >= POV_COLUMNS)
+  {
+    psDecoder_->u8Column = 0;
+  }
+
+  return(psDecoder_->au8Levels);
+
+} /* end PovImageNextColumn() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovImageDecodeRleDelta
+
+Description:
+Applies the next RLE_DELTA code to au8Levels, or uses up one column of a repeat.
+
+Requires:
+  - psDecoder_->bError is false
+
+Promises:
+  - au8Levels holds the next column
+  - On a truncated or unknown code bError is set and au8Levels is all 0
+*/
+void PovImageDecodeRleDelta(PovImageDecoderType* psDecoder_)
+{
+  const u8* pu8Next = psDecoder_->pu8Next;
+  u8 u8Code;
+  u16 u16Mask;
+
+  if(psDecoder_->u8Repeat != 0)
+  {
+    psDecoder_->u8Repeat--;
+    return;
+  }
+
+  if(pu8Next >= psDecoder_->pu8End)
+  {
+    psDecoder_->bError = true;
+    memset(psDecoder_->au8Levels, 0, POV_CHANNELS);
+    return;
+  }
+
+  u8Code = *pu8Next++;
+  if(u8Code <= POV_IMAGE_CODE_REPEAT_MAX)
+  {
+    /* This column is the first of the run */
+    psDecoder_->u8Repeat = u8Code;
+  }
+  else if( (u8Code & POV_IMAGE_CODE_TYPE_MASK) == POV_IMAGE_CODE_DELTA )
+  {
+    if(pu8Next >= psDecoder_->pu8End)
+    {
+      psDecoder_->bError = true;
+    }
+    else
+    {
+      u16Mask = ((u16)(u8Code & POV_IMAGE_CODE_DELTA_MASK) << 8) | *pu8Next++;
+      for(u8 i = 0; (i < POV_CHANNELS) && !psDecoder_->bError; i++, u16Mask >>= 1)
+      {
+        if(u16Mask & 0x0001)
+        {
+          if(pu8Next >= psDecoder_->pu8End)
+          {
+            psDecoder_->bError = true;
+          }
+          else
+          {
+            psDecoder_->au8Levels[i] = *pu8Next++;
+          }
+        }
+      }
+    }
+  }
+  else if( (u8Code == POV_IMAGE_CODE_LITERAL) && ((psDecoder_->pu8End - pu8Next) >= POV_CHANNELS) )
+  {
+    memcpy(psDecoder_->au8Levels, pu8Next, POV_CHANNELS);
+    pu8Next += POV_CHANNELS;
+  }
+  else
+  {
+    psDecoder_->bError = true;
+  }
+
+  if(psDecoder_->bError)
+  {
+    memset(psDecoder_->au8Levels, 0, POV_CHANNELS);
+  }
+  psDecoder_->pu8Next = pu8Next;
+
+} /* end PovImageDecodeRleDelta() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovImageDecodePalette
+
+Description:
+Expands column u8Column of a palette image.
+
+Requires:
+  - psDecoder_ is open on a palette format (the size was checked by PovImageOpen())
+
+Promises:
+  - au8Levels holds the palette color of each pixel of the column
+*/
+void PovImageDecodePalette(PovImageDecoderType* psDecoder_)
+{
+  u8 u8Bits = psDecoder_->u8IndexBits;
+  u16 u16BitOffset = (u16)psDecoder_->u8Column * POV_PIXELS * u8Bits;
+  const u8* pu8Indices = psDecoder_->pu8Data + (u16BitOffset >> 3);
+  u8 u8Mask = (u8)((1 << u8Bits) - 1);
+  u32 u32Indices;
+  const u8* pu8Color;
+  u8* pu8Levels = psDecoder_->au8Levels;
+
+  /* A column is at most 16 bits and starts on a byte or nibble boundary */
+  u32Indices = pu8Indices[0];
+  if( ((u16BitOffset & 0x7) + (POV_PIXELS * u8Bits)) > 8 )
+  {
+    u32Indices |= (u32)pu8Indices[1] << 8;
+  }
+  u32Indices >>= (u16BitOffset & 0x7);
+
+  for(u8 i = 0; i < POV_PIXELS; i++, u32Indices >>= u8Bits)
+  {
+    pu8Color = psDecoder_->pu8Palette + ((u32Indices & u8Mask) * POV_COLORS);
+    *pu8Levels++ = pu8Color[0];
+    *pu8Levels++ = pu8Color[1];
+    *pu8Levels++ = pu8Color[2];
+  }
+
+} /* end PovImageDecodePalette() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
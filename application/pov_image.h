@@ -0,0 +1,104 @@
+/**********************************************************************************************************************
+File: pov_image.h
+
+Description:
+Header file for pov_image.c source.
+**********************************************************************************************************************/
+
+#ifndef __POV_IMAGE_H
+#define __POV_IMAGE_H
+
+/**********************************************************************************************************************
+Type Definitions
+**********************************************************************************************************************/
+/* Image container header, at the start of every image in flash.  Multi-byte fields are little endian. */
+typedef struct
+{
+  u8 au8Magic[2];                             /* POV_IMAGE_MAGIC0, POV_IMAGE_MAGIC1 */
+  u8 u8Format;                                /* POV_IMAGE_FORMAT_... */
+  u8 u8Columns;                               /* Must be POV_COLUMNS */
+  u16 u16DataSize;                            /* Bytes of column data after the header */
+  u16 u16Reserved;
+} PovImageHeaderType;
+
+/* Column decoder.  Holds everything needed to expand the next column, so it can run from any one context
+(main loop or column interrupt) without other state. */
+typedef struct
+{
+  const u8* pu8Data;                          /* First byte of column data */
+  const u8* pu8Next;                          /* Next byte to decode */
+  const u8* pu8End;                           /* One past the last byte of column data */
+  const u8* pu8Palette;                       /* Palette formats: POV_COLORS levels per entry */
+  u8 u8Format;
+  u8 u8IndexBits;                             /* Palette formats: bits per pixel */
+  u8 u8Column;                                /* Column the next call returns */
+  u8 u8Repeat;                                /* Further columns still to come from the last repeat code */
+  bool bError;                                /* Data ran out or held an unknown code; columns are dark */
+  u8 au8Levels[POV_CHANNELS];                 /* Last column decoded */
+} PovImageDecoderType;
+
+
+/**********************************************************************************************************************
+Constants / Definitions
+**********************************************************************************************************************/
+#define POV_IMAGE_MAGIC0            (u8)'P'
+#define POV_IMAGE_MAGIC1            (u8)'V'
+#define POV_IMAGE_HEADER_SIZE       (u8)8
+
+/* Formats */
+#define POV_IMAGE_FORMAT_RAW        (u8)0x00    /* POV_CHANNELS levels per column */
+#define POV_IMAGE_FORMAT_RLE_DELTA  (u8)0x01    /* Codes below, each column coded against the one before */
+#define POV_IMAGE_FORMAT_PALETTE1   (u8)0x02    /* 2 color palette, 1 bit per pixel */
+#define POV_IMAGE_FORMAT_PALETTE2   (u8)0x03    /* 4 color palette, 2 bits per pixel */
+#define POV_IMAGE_FORMAT_PALETTE4   (u8)0x04    /* 16 color palette, 4 bits per pixel */
+
+/* Palette formats: the data starts with the palette, 2^bits entries of POV_COLORS levels (red, green, blue).
+The column indices follow as one bit stream, POV_PIXELS indices per column, pixel 0 in the lowest bits of the
+first byte.  A column is 4, 8 or 16 bits against 96 for raw, and any column can be found directly. */
+#define POV_IMAGE_PALETTE_SIZE(bits)  (u16)((1 << (bits)) * POV_COLORS)
+#define POV_IMAGE_INDEX_SIZE(bits)    (u16)(((u16)POV_COLUMNS * POV_PIXELS * (bits) + 7) / 8)
+
+/* RLE_DELTA codes.  The column before column 0 is all 0.  Every code produces at least one column.
+     0x00 - 0x3F  REPEAT:  the previous column again, (code + 1) times
+     0x40 - 0x4F  DELTA:   12-bit channel mask (code & 0x0F = bits 11..8, next byte = bits 7..0), then one level
+                           for each set bit, lowest channel first; other channels keep the previous level
+     0x80         LITERAL: POV_CHANNELS levels follow
+Worst case per column is a LITERAL or a full DELTA: one code, two mask bytes and POV_CHANNELS levels. */
+#define POV_IMAGE_CODE_REPEAT       (u8)0x00
+#define POV_IMAGE_CODE_REPEAT_MAX   (u8)0x3F
+#define POV_IMAGE_CODE_DELTA        (u8)0x40
+#define POV_IMAGE_CODE_DELTA_MASK   (u8)0x0F
+#define POV_IMAGE_CODE_LITERAL      (u8)0x80
+#define POV_IMAGE_CODE_TYPE_MASK    (u8)0xF0
+
+
+/**********************************************************************************************************************
+Function Declarations
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+bool PovImageOpen(PovImageDecoderType* psDecoder_, const u8* pu8Image_, u32 u32MaxSize_);
+void PovImageRewind(PovImageDecoderType* psDecoder_);
+const u8* PovImageNextColumn(PovImageDecoderType* psDecoder_);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void PovImageDecodeRleDelta(PovImageDecoderType* psDecoder_);
+void PovImageDecodePalette(PovImageDecoderType* psDecoder_);
+
+
+#endif /* __POV_IMAGE_H */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
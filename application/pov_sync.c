@@ -0,0 +1,385 @@
+/**********************************************************************************************************************
+File: pov_sync.c
+
+Description:
+Lines up the images of several wands over ANT.
+
+One wand is the master: it broadcasts its rotation phase on ANT_CHANNEL_SYNC.  The page loaded on each EVENT_TX
+is sent at the next channel period, so it carries the phase predicted for that time.  Slaves receive the page,
+compare it with their own phase at the receive time and move their image with PovSetPhaseOffset().  Large errors
+are corrected in one step; after that the offset follows 1/2^POV_SYNC_GAIN_SHIFT of each error, which smooths
+out the jitter of the individual revolution marks.
+
+Both sides use the microsecond time stamps that ant.c puts on every event, so main loop delays do not add error.
+POV_SYNC_LATENCY_US covers the fixed difference between the RX and TX event interrupts.
+
+PovSyncGetStatus() reports the last and filtered error and the time from the first page to lock so convergence
+can be measured on the wands.  The filtered error starts again from the first page after a one-step correction, so
+the error that was just removed does not hold the lock back while the filter decays.  The role is set with
+PovSyncSetRole() (command SYNC <0=off|1=master|2=slave>).
+**********************************************************************************************************************/
+
+#include "configuration.h"
+
+/***********************************************************************************************************************
+Global variable definitions with scope across entire project.
+All Global variable names shall start with "G_"
+***********************************************************************************************************************/
+/* New variables */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Existing variables (defined in other files -- should all contain the "extern" keyword) */
+extern volatile u32 G_u32SystemFlags;                  /* From main.c */
+
+extern volatile u32 G_u32SystemTime1ms;                /* From board-specific source file */
+extern volatile u32 G_u32SystemTime1s;                 /* From board-specific source file */
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "PovSync_" and be declared as static.
+***********************************************************************************************************************/
+static PovSyncRoleType PovSync_eRole;                  /* Role requested */
+static PovSyncRoleType PovSync_eChannelRole;           /* Role the channel was opened with */
+static u32 PovSync_u32OpenTime;                        /* SysTimeGetMs() of the last open attempt */
+
+static u8 PovSync_u8Sequence;                          /* Master: page sequence number */
+static u8 PovSync_au8Page[ANT_STANDARD_DATA_PAYLOAD_SIZE];  /* Master: broadcast buffer */
+
+static PovSyncStatusType PovSync_sStatus;              /* Measurements */
+static u32 PovSync_u32FirstPageTime;                   /* Slave: SysTimeGetMs() of the first page used */
+static bool PovSync_bSeedResidual;                     /* Slave: the next error seeds the residual filter */
+
+
+/**********************************************************************************************************************
+Function Definitions
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovSyncAntHandler
+
+Description:
+Channel handler for ANT_CHANNEL_SYNC (registered with AntRegisterChannelHandler()).
+
+Requires:
+  - psEvents_ points to u8Count_ consecutive events for the sync channel
+
+Promises:
+  - Master: EVENT_TX loads the next sync page
+  - Slave: received sync pages adjust the image phase
+*/
+void PovSyncAntHandler(AntEventType* psEvents_, u8 u8Count_)
+{
+  for( ; u8Count_ != 0; u8Count_--, psEvents_++)
+  {
+    if( (PovSync_eChannelRole == POV_SYNC_MASTER) && (psEvents_->u8Event == EVENT_TX) )
+    {
+      PovSyncMasterSend(psEvents_->u32TimeUs);
+    }
+
+    if( (PovSync_eChannelRole == POV_SYNC_SLAVE) && (psEvents_->u8Event == EVENT_RX) &&
+        (psEvents_->u8MessageId == MESG_BROADCAST_DATA_ID) && (psEvents_->au8Payload[0] == POV_SYNC_PAGE) )
+    {
+      PovSyncSlaveReceive(psEvents_->au8Payload, psEvents_->u32TimeUs);
+    }
+  }
+
+} /* end PovSyncAntHandler() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovSyncSetRole
+
+Description:
+Selects master, slave or no sync.
+
+Requires:
+  -
+
+Promises:
+  - The sync channel is closed and reopened in the new role by PovSyncUpdate()
+  - Measurements restart; the phase offset returns to 0 when sync is turned off
+*/
+void PovSyncSetRole(PovSyncRoleType eRole_)
+{
+  if(eRole_ == PovSync_eRole)
+  {
+    return;
+  }
+
+  PovSync_eRole = eRole_;
+  AntRequireTxEvents(ANT_CHANNEL_SYNC, false);
+  AntCloseChannel(ANT_CHANNEL_SYNC);
+
+  PovSync_sStatus.bSynced = false;
+  PovSync_sStatus.s16LastError = 0;
+  PovSync_sStatus.u16Residual = 0;
+  PovSync_sStatus.u32Messages = 0;
+  PovSync_sStatus.u32TimeToLockMs = 0;
+  PovSync_bSeedResidual = true;
+
+  if(eRole_ == POV_SYNC_OFF)
+  {
+    PovSetPhaseOffset(0);
+  }
+
+} /* end PovSyncSetRole() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovSyncGetStatus
+
+Description:
+Reports the sync role and measurements.
+
+Requires:
+  - psStatus_ points to space for the status
+
+Promises:
+  - *psStatus_ is a copy of the current status
+*/
+void PovSyncGetStatus(PovSyncStatusType* psStatus_)
+{
+  *psStatus_ = PovSync_sStatus;
+  psStatus_->eRole = PovSync_eRole;
+
+} /* end PovSyncGetStatus() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovSyncInitialize
+
+Description:
+Registers the sync channel handler.  Sync starts off.
+
+Requires:
+  - AntInitialize() has run
+
+Promises:
+  - PovSyncAntHandler() receives ANT_CHANNEL_SYNC events
+*/
+void PovSyncInitialize(void)
+{
+  PovSync_eRole = POV_SYNC_OFF;
+  PovSync_eChannelRole = POV_SYNC_OFF;
+  PovSync_u8Sequence = 0;
+
+  AntRegisterChannelHandler(ANT_CHANNEL_SYNC, PovSyncAntHandler);
+
+} /* end PovSyncInitialize() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovSyncUpdate
+
+Description:
+Keeps the sync channel open in the requested role.  Call every pass of the main loop.
+
+Requires:
+  - PovSyncInitialize() has run
+
+Promises:
+  - If a role is set and the channel is closed (role change, slave search timeout), it is opened again, at most
+    once per POV_SYNC_REOPEN_MS
+*/
+void PovSyncUpdate(void)
+{
+  if( (PovSync_eRole == POV_SYNC_OFF) || AntIsChannelOpen(ANT_CHANNEL_SYNC) )
+  {
+    return;
+  }
+
+  if( SysTimeElapsed(PovSync_u32OpenTime) >= POV_SYNC_REOPEN_MS )
+  {
+    PovSync_u32OpenTime = SysTimeGetMs();
+    PovSyncOpenChannel();
+  }
+
+} /* end PovSyncUpdate() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovSyncOpenChannel
+
+Description:
+Opens the sync channel as a transmit-only master or a receive-only slave.
+
+Requires:
+  - PovSync_eRole is POV_SYNC_MASTER or POV_SYNC_SLAVE
+
+Promises:
+  - Returns true if the channel is open; PovSync_eChannelRole is the role it was opened with
+  - Master: EVENT_TX is kept out of the ANT power mode filter and the first sync page is loaded
+*/
+bool PovSyncOpenChannel(void)
+{
+  AntChannelConfigType sConfig;
+
+  sConfig.u8Channel          = ANT_CHANNEL_SYNC;
+  sConfig.u8DeviceType       = POV_SYNC_DEVICE_TYPE;
+  sConfig.u8TransmissionType = POV_SYNC_TRANSMISSION_TYPE;
+  sConfig.u16Period          = POV_SYNC_CHANNEL_PERIOD;
+  sConfig.u8RfFrequency      = POV_SYNC_RF_FREQUENCY;
+
+  if(PovSync_eRole == POV_SYNC_MASTER)
+  {
+    sConfig.u8ChannelType   = CHANNEL_TYPE_MASTER_TX_ONLY;
+    sConfig.u16DeviceNumber = (u16)(NRF_FICR->DEVICEID[0] & 0xFFFF);
+    if(sConfig.u16DeviceNumber == 0)
+    {
+      sConfig.u16DeviceNumber = 1;
+    }
+  }
+  else
+  {
+    sConfig.u8ChannelType   = CHANNEL_TYPE_SLAVE_RX_ONLY;
+    sConfig.u16DeviceNumber = 0;
+  }
+
+  if( !AntOpenChannel(&sConfig) )
+  {
+    PovSync_eChannelRole = POV_SYNC_OFF;
+    return(false);
+  }
+
+  PovSync_eChannelRole = PovSync_eRole;
+  if(PovSync_eRole == POV_SYNC_MASTER)
+  {
+    AntRequireTxEvents(ANT_CHANNEL_SYNC, true);
+    PovSyncMasterSend(SysTimeGetUs());
+  }
+
+  return(true);
+
+} /* end PovSyncOpenChannel() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovSyncMasterSend
+
+Description:
+Loads the sync page for the next transmission.
+
+Requires:
+  - u32TxTimeUs_ is the time of the EVENT_TX that just happened
+
+Promises:
+  - The broadcast holds the phase predicted one channel period after u32TxTimeUs_, the period and the lock flag
+*/
+void PovSyncMasterSend(u32 u32TxTimeUs_)
+{
+  u32 u32Period;
+  u32 u32Mark;
+  u16 u16Phase;
+  bool bLocked;
+
+  bLocked  = PovGetRotation(&u32Period, &u32Mark);
+  u16Phase = PovGetPhase(u32TxTimeUs_ + ANT_PERIOD_TO_US(POV_SYNC_CHANNEL_PERIOD));
+
+  PovSync_au8Page[0] = POV_SYNC_PAGE;
+  PovSync_au8Page[1] = PovSync_u8Sequence++;
+  PovSync_au8Page[2] = (u8)(u16Phase & 0xFF);
+  PovSync_au8Page[3] = (u8)(u16Phase >> 8);
+  PovSync_au8Page[4] = (u8)(u32Period & 0xFF);
+  PovSync_au8Page[5] = (u8)((u32Period >> 8) & 0xFF);
+  PovSync_au8Page[6] = (u8)((u32Period >> 16) & 0xFF);
+  PovSync_au8Page[7] = bLocked ? POV_SYNC_PAGE_LOCKED : 0;
+
+  if( AntBroadcast(ANT_CHANNEL_SYNC, PovSync_au8Page) )
+  {
+    PovSync_sStatus.u32Messages++;
+  }
+
+} /* end PovSyncMasterSend() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: PovSyncSlaveReceive
+
+Description:
+Moves the image phase toward the master's.
+
+Requires:
+  - pu8Page_ is a POV_SYNC_PAGE received at u32RxTimeUs_
+
+Promises:
+  - If both wands are locked, the phase offset is corrected and the status measurements are updated
+*/
+void PovSyncSlaveReceive(u8* pu8Page_, u32 u32RxTimeUs_)
+{
+  u32 u32Period;
+  u32 u32Mark;
+  u16 u16MasterPhase;
+  s16 s16Error;
+  s16 s16Step;
+  u16 u16Magnitude;
+
+  if( !(pu8Page_[7] & POV_SYNC_PAGE_LOCKED) || !PovGetRotation(&u32Period, &u32Mark) )
+  {
+    return;
+  }
+
+  if(PovSync_sStatus.u32Messages == 0)
+  {
+    PovSync_u32FirstPageTime = SysTimeGetMs();
+  }
+  PovSync_sStatus.u32Messages++;
+
+  /* Positive error: this wand is behind the master.  Phase = angle - offset, so the offset goes down. */
+  u16MasterPhase = (u16)pu8Page_[2] | ((u16)pu8Page_[3] << 8);
+  s16Error = (s16)(u16MasterPhase - PovGetPhase(u32RxTimeUs_ - POV_SYNC_LATENCY_US));
+  PovSync_sStatus.s16LastError = s16Error;
+  u16Magnitude = (u16)((s16Error < 0) ? -s16Error : s16Error);
+
+  if( !PovSync_sStatus.bSynced && ((s16Error > POV_SYNC_ACQUIRE_ERROR) || (s16Error < -POV_SYNC_ACQUIRE_ERROR)) )
+  {
+    /* The error is gone after this step: filtering starts again from the next one */
+    PovSetPhaseOffset( (s16)(PovGetPhaseOffset() - s16Error) );
+    PovSync_sStatus.u16Residual = u16Magnitude;
+    PovSync_bSeedResidual = true;
+    return;
+  }
+
+  /* Divide the magnitude, rounded, then put the sign back: a shift of the signed error would round every
+  negative error down and every small positive one to 0, leaving a bias the offset hunts around */
+  s16Step = (s16)( (u16Magnitude + (1u << (POV_SYNC_GAIN_SHIFT - 1))) >> POV_SYNC_GAIN_SHIFT );
+  if(s16Error < 0)
+  {
+    s16Step = -s16Step;
+  }
+  PovSetPhaseOffset( (s16)(PovGetPhaseOffset() - s16Step) );
+
+  if(PovSync_bSeedResidual)
+  {
+    PovSync_sStatus.u16Residual = u16Magnitude;
+    PovSync_bSeedResidual = false;
+  }
+  PovSync_sStatus.u16Residual = (u16)( (s32)PovSync_sStatus.u16Residual +
+                                (((s32)u16Magnitude - (s32)PovSync_sStatus.u16Residual) >> POV_SYNC_RESIDUAL_SHIFT) );
+
+  if( !PovSync_sStatus.bSynced && (PovSync_sStatus.u16Residual < POV_SYNC_LOCK_ERROR) &&
+      (u16Magnitude < POV_SYNC_LOCK_ERROR) )
+  {
+    PovSync_sStatus.bSynced = true;
+    PovSync_sStatus.u32TimeToLockMs = SysTimeElapsed(PovSync_u32FirstPageTime);
+  }
+
+} /* end PovSyncSlaveReceive() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,84 @@
+/**********************************************************************************************************************
+File: pov_sync.h
+
+Description:
+Header file for pov_sync.c source.
+**********************************************************************************************************************/
+
+#ifndef __POV_SYNC_H
+#define __POV_SYNC_H
+
+/**********************************************************************************************************************
+Type Definitions
+**********************************************************************************************************************/
+typedef enum {POV_SYNC_OFF = 0, POV_SYNC_MASTER, POV_SYNC_SLAVE} PovSyncRoleType;
+
+typedef struct
+{
+  PovSyncRoleType eRole;
+  bool bSynced;                               /* Slave: filtered error is inside POV_SYNC_LOCK_ERROR */
+  s16 s16LastError;                           /* Slave: last master phase - own phase (1/65536 revolution) */
+  u16 u16Residual;                            /* Slave: filtered magnitude of the phase error */
+  u32 u32Messages;                            /* Sync pages sent (master) or used (slave) */
+  u32 u32TimeToLockMs;                        /* Slave: first sync page to bSynced, 0 until synced */
+} PovSyncStatusType;
+
+
+/**********************************************************************************************************************
+Constants / Definitions
+**********************************************************************************************************************/
+/* Sync channel: same ID fields on every wand, slaves search with device number 0 so any master is accepted */
+#define POV_SYNC_DEVICE_TYPE        (u8)0x7D
+#define POV_SYNC_TRANSMISSION_TYPE  (u8)0x01
+#define POV_SYNC_CHANNEL_PERIOD     (u16)4096               /* 32768 / 4096 = 8 Hz */
+#define POV_SYNC_RF_FREQUENCY       (u8)57                  /* 2457 MHz, away from the upload channel */
+#define POV_SYNC_REOPEN_MS          (u32)1000               /* Retry time for a channel that closed */
+
+/* Sync page: [0] page, [1] sequence, [2..3] master phase at the transmission that carries the page,
+[4..6] master period in us, [7] flags.  Multi-byte fields are little endian. */
+#define POV_SYNC_PAGE               (u8)0x40
+#define POV_SYNC_PAGE_LOCKED        (u8)0x01                /* Master rotation estimate is locked */
+
+/* Radio event latency: slave EVENT_RX interrupt delay minus master EVENT_TX interrupt delay */
+#define POV_SYNC_LATENCY_US         (u32)0
+
+/* Offset filter: large errors are taken in one step, small ones are filtered */
+#define POV_SYNC_ACQUIRE_ERROR      (s16)0x1000             /* 1/16 revolution */
+#define POV_SYNC_GAIN_SHIFT         (u8)2                   /* Offset moves by 1/4 of the error per page */
+#define POV_SYNC_RESIDUAL_SHIFT     (u8)3                   /* Residual IIR weight 1/8 */
+#define POV_SYNC_LOCK_ERROR         (u16)0x0100             /* 1/256 revolution */
+
+
+/**********************************************************************************************************************
+Function Declarations
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void PovSyncAntHandler(AntEventType* psEvents_, u8 u8Count_);
+void PovSyncSetRole(PovSyncRoleType eRole_);
+void PovSyncGetStatus(PovSyncStatusType* psStatus_);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void PovSyncInitialize(void);
+void PovSyncUpdate(void);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+bool PovSyncOpenChannel(void);
+void PovSyncMasterSend(u32 u32TxTimeUs_);
+void PovSyncSlaveReceive(u8* pu8Page_, u32 u32RxTimeUs_);
+
+
+#endif /* __POV_SYNC_H */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
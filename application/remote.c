@@ -0,0 +1,570 @@
+/**********************************************************************************************************************
+File: remote.c
+
+Description:
+Show remote receiver.  One or more paired remotes broadcast command pages; every wand in remote mode hears them
+with ANT continuous scan mode on channel 0, so a command is applied as soon as the page arrives instead of at the
+next slot of a slave channel synchronized to one remote.  The scan ID list holds the paired remotes
+(REMOTE_MAX_PAIRS, saved in settings); with no remotes paired any remote with REMOTE_DEVICE_TYPE is accepted.
+
+Scan mode needs channel 0 and starts only with every channel closed, so remote mode closes the upload channel
+and gives it back when remote mode ends.  Turn wand sync off first, or enable it again once scanning: a sync
+master may open alongside the scan, a sync slave may not.
+
+Each page carries a sequence number so the repeats a remote sends for reliability are applied once.  The time
+from the radio interrupt to the command taking effect is kept in RemoteGetStats().
+
+Remote mode is saved in settings, so a wand left in remote mode comes back in it after a reset.  Pairing: while
+RemoteStartPairing() is pending the scan accepts any remote, and the first one heard with its device number is
+paired and the scan goes back to the paired list.  On the wand, POV_REMOTE_BUTTON starts both (pov.c).
+
+Threat model: command pages are not authenticated.  Anyone with a transmitter can send pages with a paired
+device number (or any device number while nothing is paired or pairing is pending), so a remote page can only
+do what someone standing near the show could see and undo: blank the image, move its phase, or change the sync
+role.  Nothing that persists or weakens the wand is reachable from here.  Configuration that does (PAIR, ANTPOWER,
+RFSCHED, KEY and the rest of command.c) only arrives as text on the upload channel, which is closed while remote
+mode runs and whose command pages are encrypted once an image key is set (image_upload.c).  Pairing a remote on
+the upload channel (PAIR) is the way to avoid the race of RemoteStartPairing() taking the first remote heard.
+**********************************************************************************************************************/
+
+#include "configuration.h"
+
+/***********************************************************************************************************************
+Global variable definitions with scope across entire project.
+All Global variable names shall start with "G_"
+***********************************************************************************************************************/
+/* New variables */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Existing variables (defined in other files -- should all contain the "extern" keyword) */
+extern volatile u32 G_u32SystemFlags;                  /* From main.c */
+
+extern volatile u32 G_u32SystemTime1ms;                /* From board-specific source file */
+extern volatile u32 G_u32SystemTime1s;                 /* From board-specific source file */
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "Remote_" and be declared as static.
+***********************************************************************************************************************/
+static fnCode_type Remote_pfnStateMachine;             /* The state machine function pointer */
+static bool Remote_bEnabled;                           /* Remote mode requested */
+static bool Remote_bPairing;                           /* Pair the next remote heard */
+static u32 Remote_u32Timer;                            /* SysTimeGetMs() of the last scan attempt */
+static u32 Remote_u32PairingStart;                     /* SysTimeGetMs() when pairing started */
+
+static u16 Remote_au16Pairs[REMOTE_MAX_PAIRS];         /* Paired remote device numbers */
+static u8 Remote_u8PairCount;                          /* Entries used in Remote_au16Pairs */
+static u16 Remote_au16SequenceIds[REMOTE_SEQUENCE_SLOTS];  /* Device number each sequence slot belongs to */
+static u8 Remote_au8LastSequence[REMOTE_SEQUENCE_SLOTS];   /* Last sequence number heard from that remote */
+static u8 Remote_u8SequenceSlots;                      /* Slots in use since the scan started */
+static u8 Remote_u8NextSlot;                           /* Slot reused next once all are in use */
+
+static RemoteStatsType Remote_sStats;                  /* Command counts and latency */
+
+
+/**********************************************************************************************************************
+Function Definitions
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: RemoteAntHandler
+
+Description:
+Channel handler for ANT_CHANNEL_SCAN while remote mode is scanning.
+
+Requires:
+  - psEvents_ points to u8Count_ consecutive events for channel 0
+
+Promises:
+  - Received command pages are applied
+*/
+void RemoteAntHandler(AntEventType* psEvents_, u8 u8Count_)
+{
+  for( ; u8Count_ != 0; u8Count_--, psEvents_++)
+  {
+    if( (psEvents_->u8Event == EVENT_RX) && (psEvents_->au8Payload[0] == REMOTE_PAGE) &&
+        ((psEvents_->u8MessageId == MESG_BROADCAST_DATA_ID) || (psEvents_->u8MessageId == MESG_ACKNOWLEDGED_DATA_ID)) )
+    {
+      RemoteReceive(psEvents_);
+    }
+  }
+
+} /* end RemoteAntHandler() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: RemoteSetEnabled
+
+Description:
+Starts or ends remote mode.
+
+Requires:
+  -
+
+Promises:
+  - RemoteUpdate() moves channel 0 between the upload channel and the scan
+  - The mode is saved for the next start up; ending remote mode ends pairing
+*/
+void RemoteSetEnabled(bool bEnable_)
+{
+  u8 u8Enabled = (u8)bEnable_;
+
+  Remote_bEnabled = bEnable_;
+  if(!bEnable_)
+  {
+    Remote_bPairing = false;
+  }
+  SettingsWrite(SETTINGS_KEY_REMOTE_ENABLED, &u8Enabled, sizeof(u8Enabled));
+
+} /* end RemoteSetEnabled() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: RemoteIsEnabled
+
+Description:
+Reports whether remote mode is on.
+
+Requires:
+  -
+
+Promises:
+  - Returns the last RemoteSetEnabled() (or the saved mode)
+*/
+bool RemoteIsEnabled(void)
+{
+  return(Remote_bEnabled);
+
+} /* end RemoteIsEnabled() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: RemotePair
+
+Description:
+Adds a remote to the paired list and saves it.
+
+Requires:
+  - u16DeviceNumber_ is the remote's ANT device number (not 0)
+
+Promises:
+  - Returns true if the remote is paired (already or now) and the list was saved
+  - A running scan restarts with the new ID list
+*/
+bool RemotePair(u16 u16DeviceNumber_)
+{
+  u8 i;
+
+  if(u16DeviceNumber_ == 0)
+  {
+    return(false);
+  }
+
+  for(i = 0; i < Remote_u8PairCount; i++)
+  {
+    if(Remote_au16Pairs[i] == u16DeviceNumber_)
+    {
+      return(true);
+    }
+  }
+
+  if(Remote_u8PairCount >= REMOTE_MAX_PAIRS)
+  {
+    return(false);
+  }
+
+  Remote_au16Pairs[Remote_u8PairCount++] = u16DeviceNumber_;
+  RemoteRestart();
+
+  return( SettingsWrite(SETTINGS_KEY_REMOTE_PAIRS, (const u8*)Remote_au16Pairs,
+                        (u8)(Remote_u8PairCount * sizeof(u16))) );
+
+} /* end RemotePair() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: RemoteUnpairAll
+
+Description:
+Forgets every paired remote.
+
+Requires:
+  -
+
+Promises:
+  - The paired list is empty and saved; a running scan restarts accepting any remote
+*/
+void RemoteUnpairAll(void)
+{
+  Remote_u8PairCount = 0;
+  SettingsWrite(SETTINGS_KEY_REMOTE_PAIRS, (const u8*)Remote_au16Pairs, 0);
+  RemoteRestart();
+
+} /* end RemoteUnpairAll() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: RemoteStartPairing
+
+Description:
+Pairs the next remote heard.  Starts remote mode if it is off.
+
+Requires:
+  -
+
+Promises:
+  - The scan restarts accepting any remote; the first command page that carries a device number pairs that
+    remote (RemotePair()) and the scan restarts with the paired list
+  - Pairing ends unpaired after REMOTE_PAIRING_MS
+*/
+void RemoteStartPairing(void)
+{
+  if(!Remote_bEnabled)
+  {
+    RemoteSetEnabled(true);
+  }
+
+  Remote_bPairing = true;
+  Remote_u32PairingStart = SysTimeGetMs();
+  RemoteRestart();
+
+} /* end RemoteStartPairing() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: RemoteGetStats
+
+Description:
+Reports command counts and latency.
+
+Requires:
+  - psStats_ points to space for the statistics
+
+Promises:
+  - *psStats_ is a copy of the statistics
+*/
+void RemoteGetStats(RemoteStatsType* psStats_)
+{
+  *psStats_ = Remote_sStats;
+
+} /* end RemoteGetStats() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: RemoteInitialize
+
+Description:
+Loads the paired remotes and the saved remote mode.
+
+Requires:
+  - SettingsInitialize() has run
+
+Promises:
+  - Remote_au16Pairs holds the saved pairs
+  - Remote mode is on if it was on when last set
+*/
+void RemoteInitialize(void)
+{
+  u8 u8Enabled = 0;
+
+  Remote_u8PairCount = (u8)(SettingsRead(SETTINGS_KEY_REMOTE_PAIRS, (u8*)Remote_au16Pairs,
+                                         (u8)sizeof(Remote_au16Pairs)) / sizeof(u16));
+  SettingsRead(SETTINGS_KEY_REMOTE_ENABLED, &u8Enabled, sizeof(u8Enabled));
+  Remote_bEnabled = (u8Enabled != 0);
+  Remote_bPairing = false;
+  Remote_pfnStateMachine = RemoteSM_Idle;
+
+} /* end RemoteInitialize() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: RemoteUpdate
+
+Description:
+Runs the remote mode state machine.  Call every pass of the main loop.
+
+Requires:
+  - RemoteInitialize() has run
+
+Promises:
+  - Channel 0 follows RemoteSetEnabled()
+*/
+void RemoteUpdate(void)
+{
+  Remote_pfnStateMachine();
+
+} /* end RemoteUpdate() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: RemoteReceive
+
+Description:
+Applies a command page unless it repeats the last one from the same remote.
+
+Requires:
+  - psEvent_ holds a REMOTE_PAGE received while scanning
+
+Promises:
+  - While pairing, the sender is paired
+  - New commands are applied and counted with their latency; repeats are counted as duplicates
+  - Each remote has its own sequence, so remotes heard in turn never repeat each other's last command.  Past
+    REMOTE_SEQUENCE_SLOTS remotes the one heard longest ago is forgotten, and its page applies again when next heard.
+*/
+void RemoteReceive(AntEventType* psEvent_)
+{
+  u8* pu8Page = psEvent_->au8Payload;
+  u16 u16DeviceNumber = 0;
+  u8 u8Slot;
+  u32 u32Latency;
+
+  /* Find the sender so each remote has its own sequence */
+  if( (psEvent_->u8Length >= (REMOTE_EXT_ID_INDEX + 2)) &&
+      (pu8Page[REMOTE_EXT_FLAG_INDEX] & ANT_EXT_MESG_BITFIELD_DEVICE_ID) )
+  {
+    u16DeviceNumber = (u16)pu8Page[REMOTE_EXT_ID_INDEX] | ((u16)pu8Page[REMOTE_EXT_ID_INDEX + 1] << 8);
+    if(Remote_bPairing)
+    {
+      Remote_bPairing = false;
+      RemotePair(u16DeviceNumber);
+      RemoteRestart();
+    }
+  }
+
+  for(u8Slot = 0; u8Slot < Remote_u8SequenceSlots; u8Slot++)
+  {
+    if(Remote_au16SequenceIds[u8Slot] == u16DeviceNumber)
+    {
+      break;
+    }
+  }
+
+  if(u8Slot < Remote_u8SequenceSlots)
+  {
+    if(Remote_au8LastSequence[u8Slot] == pu8Page[1])
+    {
+      Remote_sStats.u32Duplicates++;
+      return;
+    }
+  }
+  else
+  {
+    /* A remote not heard since the scan started: a free slot, or the oldest one */
+    if(Remote_u8SequenceSlots < REMOTE_SEQUENCE_SLOTS)
+    {
+      Remote_u8SequenceSlots++;
+    }
+    else
+    {
+      u8Slot = Remote_u8NextSlot;
+      Remote_u8NextSlot = (u8)((u8Slot + 1) % REMOTE_SEQUENCE_SLOTS);
+    }
+    Remote_au16SequenceIds[u8Slot] = u16DeviceNumber;
+  }
+  Remote_au8LastSequence[u8Slot] = pu8Page[1];
+
+  RemoteApply(pu8Page[2], (u32)pu8Page[3] | ((u32)pu8Page[4] << 8) | ((u32)pu8Page[5] << 16) |
+                          ((u32)pu8Page[6] << 24));
+
+  u32Latency = SysTimeGetUs() - psEvent_->u32TimeUs;
+  Remote_sStats.u32Commands++;
+  Remote_sStats.u32LastLatencyUs = u32Latency;
+  if(u32Latency > Remote_sStats.u32MaxLatencyUs)
+  {
+    Remote_sStats.u32MaxLatencyUs = u32Latency;
+  }
+
+} /* end RemoteReceive() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: RemoteApply
+
+Description:
+Carries out a remote command.
+
+Requires:
+  -
+
+Promises:
+  - Known commands take effect; unknown ones are ignored
+*/
+void RemoteApply(u8 u8Command_, u32 u32Argument_)
+{
+  switch(u8Command_)
+  {
+    case REMOTE_CMD_BLANK:
+    {
+      PovSetBlank( (bool)(u32Argument_ != 0) );
+      break;
+    }
+
+    case REMOTE_CMD_PHASE:
+    {
+      PovSetPhaseOffset( (s16)u32Argument_ );
+      break;
+    }
+
+    case REMOTE_CMD_SYNC:
+    {
+      if(u32Argument_ <= POV_SYNC_SLAVE)
+      {
+        PovSyncSetRole( (PovSyncRoleType)u32Argument_ );
+      }
+      break;
+    }
+
+    default:
+      break;
+  }
+
+} /* end RemoteApply() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: RemoteRestart
+
+Description:
+Restarts a running scan so a changed ID list is used.
+
+Requires:
+  -
+
+Promises:
+  - If scanning, the scan is closed and RemoteSM_WaitChannelClosed() starts it again
+*/
+void RemoteRestart(void)
+{
+  if(Remote_pfnStateMachine == RemoteSM_Scanning)
+  {
+    AntCloseChannel(ANT_CHANNEL_SCAN);
+    Remote_pfnStateMachine = RemoteSM_WaitChannelClosed;
+  }
+
+} /* end RemoteRestart() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* State Machine definitions                                                                                          */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: RemoteSM_Idle
+Remote mode off; channel 0 belongs to the upload channel.
+*/
+void RemoteSM_Idle(void)
+{
+  if(Remote_bEnabled)
+  {
+    AntCloseChannel(ANT_CHANNEL_UPLOAD);
+    Remote_u32Timer = SysTimeGetMs() - REMOTE_RETRY_MS;
+    Remote_pfnStateMachine = RemoteSM_WaitChannelClosed;
+  }
+
+} /* end RemoteSM_Idle() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: RemoteSM_WaitChannelClosed
+Waiting for channel 0 to close, then starting the scan.
+*/
+void RemoteSM_WaitChannelClosed(void)
+{
+  AntChannelConfigType sConfig;
+
+  if( !Remote_bEnabled )
+  {
+    Remote_pfnStateMachine = RemoteSM_WaitScanClosed;
+    return;
+  }
+
+  if( AntIsChannelOpen(ANT_CHANNEL_SCAN) || (SysTimeElapsed(Remote_u32Timer) < REMOTE_RETRY_MS) )
+  {
+    return;
+  }
+
+  Remote_u32Timer = SysTimeGetMs();
+
+  sConfig.u8Channel          = ANT_CHANNEL_SCAN;
+  sConfig.u8ChannelType      = CHANNEL_TYPE_SLAVE;
+  sConfig.u16DeviceNumber    = 0;
+  sConfig.u8DeviceType       = REMOTE_DEVICE_TYPE;
+  sConfig.u8TransmissionType = REMOTE_TRANSMISSION_TYPE;
+  sConfig.u16Period          = 0;
+  sConfig.u8RfFrequency      = REMOTE_RF_FREQUENCY;
+
+  AntRegisterChannelHandler(ANT_CHANNEL_SCAN, RemoteAntHandler);
+  if( AntOpenScanChannel(&sConfig, Remote_au16Pairs, Remote_bPairing ? 0 : Remote_u8PairCount) )
+  {
+    Remote_u8SequenceSlots = 0;
+    Remote_u8NextSlot = 0;
+    Remote_pfnStateMachine = RemoteSM_Scanning;
+  }
+
+} /* end RemoteSM_WaitChannelClosed() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: RemoteSM_Scanning
+Scanning for remotes.
+*/
+void RemoteSM_Scanning(void)
+{
+  if( !Remote_bEnabled )
+  {
+    AntCloseChannel(ANT_CHANNEL_SCAN);
+    Remote_pfnStateMachine = RemoteSM_WaitScanClosed;
+    return;
+  }
+
+  if( Remote_bPairing && (SysTimeElapsed(Remote_u32PairingStart) >= REMOTE_PAIRING_MS) )
+  {
+    Remote_bPairing = false;
+    RemoteRestart();
+    return;
+  }
+
+  /* The stack closed the scan (e.g. another channel interfered): start it again */
+  if( !AntIsChannelOpen(ANT_CHANNEL_SCAN) )
+  {
+    Remote_pfnStateMachine = RemoteSM_WaitChannelClosed;
+  }
+
+} /* end RemoteSM_Scanning() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: RemoteSM_WaitScanClosed
+Remote mode ending: waiting for channel 0 to close, then giving it back to the upload channel.
+*/
+void RemoteSM_WaitScanClosed(void)
+{
+  if( AntIsChannelOpen(ANT_CHANNEL_SCAN) )
+  {
+    return;
+  }
+
+  AntRegisterChannelHandler(ANT_CHANNEL_UPLOAD, ImageUploadAntHandler);
+  AntOpenUploadChannel();
+  Remote_pfnStateMachine = RemoteSM_Idle;
+
+} /* end RemoteSM_WaitScanClosed() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,94 @@
+/**********************************************************************************************************************
+File: remote.h
+
+Description:
+Header file for remote.c source.
+**********************************************************************************************************************/
+
+#ifndef __REMOTE_H
+#define __REMOTE_H
+
+/**********************************************************************************************************************
+Type Definitions
+**********************************************************************************************************************/
+typedef struct
+{
+  u32 u32Commands;                            /* Commands applied */
+  u32 u32Duplicates;                          /* Repeats of a command already applied */
+  u32 u32LastLatencyUs;                       /* Radio interrupt to command applied, last command */
+  u32 u32MaxLatencyUs;                        /* Radio interrupt to command applied, worst case */
+} RemoteStatsType;
+
+
+/**********************************************************************************************************************
+Constants / Definitions
+**********************************************************************************************************************/
+/* Remote channel ID: remotes transmit as masters with their own device number */
+#define REMOTE_DEVICE_TYPE          (u8)0x7E
+#define REMOTE_TRANSMISSION_TYPE    (u8)0x01
+#define REMOTE_RF_FREQUENCY         (u8)60                  /* 2460 MHz */
+#define REMOTE_MAX_PAIRS            ANT_ID_LIST_SIZE        /* Remotes held in the scan ID list */
+#define REMOTE_RETRY_MS             (u32)1000               /* Retry time for a scan that would not start */
+#define REMOTE_PAIRING_MS           (u32)30000              /* RemoteStartPairing() gives up after this */
+#define REMOTE_SEQUENCE_SLOTS       (u8)8                   /* Remotes whose last sequence number is kept */
+
+/* Command page: [0] page, [1] sequence (changes for each new command, repeats are ignored), [2] command,
+[3..6] argument (little endian), [7] reserved.  Remotes repeat each page a few times for reliability. */
+#define REMOTE_PAGE                 (u8)0x50
+#define REMOTE_PAGE_SIZE            (u8)8
+
+#define REMOTE_CMD_BLANK            (u8)0x01                /* Argument: 1 = blank the image, 0 = show it */
+#define REMOTE_CMD_PHASE            (u8)0x02                /* Argument: image phase offset (s16) */
+#define REMOTE_CMD_SYNC             (u8)0x03                /* Argument: PovSyncRoleType */
+
+/* Extended data after the 8 byte page while scanning: flag byte, then device number LSB, MSB, type, trans type */
+#define REMOTE_EXT_FLAG_INDEX       (u8)8
+#define REMOTE_EXT_ID_INDEX         (u8)9
+
+
+/**********************************************************************************************************************
+Function Declarations
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void RemoteAntHandler(AntEventType* psEvents_, u8 u8Count_);
+void RemoteSetEnabled(bool bEnable_);
+bool RemoteIsEnabled(void);
+bool RemotePair(u16 u16DeviceNumber_);
+void RemoteStartPairing(void);
+void RemoteUnpairAll(void);
+void RemoteGetStats(RemoteStatsType* psStats_);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void RemoteInitialize(void);
+void RemoteUpdate(void);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void RemoteReceive(AntEventType* psEvent_);
+void RemoteApply(u8 u8Command_, u32 u32Argument_);
+void RemoteRestart(void);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* State Machine declarations                                                                                         */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void RemoteSM_Idle(void);
+void RemoteSM_WaitChannelClosed(void);
+void RemoteSM_Scanning(void);
+void RemoteSM_WaitScanClosed(void);
+
+
+#endif /* __REMOTE_H */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
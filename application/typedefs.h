@@ -21,6 +21,7 @@ typedef unsigned char BOOL;     /* Boolean */
 
 
 /* Standard Peripheral Library old types (maintained for legacy purpose) */
+typedef long long s64;
 typedef long s32;
 typedef short s16;
 typedef signed char  s8;
@@ -29,6 +30,7 @@ typedef const long sc32;  /*!< Read Only */
 typedef const short sc16;  /*!< Read Only */
 typedef const char sc8;   /*!< Read Only */
 
+typedef unsigned long long u64;
 typedef ULONG  u32;
 typedef USHORT u16;
 typedef UCHAR  u8;
@@ -24,6 +24,9 @@ extern volatile u32 G_u32SystemFlags;                 /* From main.c */
 Global variable definitions with scope limited to this local application.
 Variable names shall start with "Bsp_" and be declared as static.
 ***********************************************************************************************************************/
+static u16 Bsp_u16NextTick;                            /* TIMER1 count at which the next 1ms tick is due */
+static volatile u32 Bsp_u32WakeRequests;               /* Changed by SystemWakeRequest() */
+static u32 Bsp_u32WakeRequestsSeen;                    /* Bsp_u32WakeRequests when the last sleep ended */
 
 
 /***********************************************************************************************************************
@@ -34,6 +37,26 @@ Function Definitions
 /* Public Functions */
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+/*----------------------------------------------------------------------------------------------------------------------
+Function: SystemWakeRequest
+
+Description:
+Asks for the main loop to run now instead of sleeping to the next deadline.  For interrupt handlers that queue
+work for an update function.
+
+Requires:
+  - 
+
+Promises:
+  - A SystemSleep() in progress ends at once if a tick has passed since it started, otherwise at the next tick
+*/
+void SystemWakeRequest(void)
+{
+  /* Only a change is looked for, so an increment lost to a higher priority caller does not matter */
+  Bsp_u32WakeRequests++;
+
+} /* end SystemWakeRequest() */
+
 
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* Protected Functions */
@@ -82,10 +105,10 @@ void GpioSetup(void)
   NRF_GPIO->PIN_CNF[P0_27_INDEX] = P0_27_CNF;
   NRF_GPIO->PIN_CNF[P0_26_INDEX] = P0_26_CNF;
   NRF_GPIO->PIN_CNF[P0_25_INDEX] = P0_25_CNF;
-  NRF_GPIO->PIN_CNF[P0_24_INDEX] = P0_24_CNF;
-  NRF_GPIO->PIN_CNF[P0_23_INDEX] = P0_23_CNF;
-  NRF_GPIO->PIN_CNF[P0_22_INDEX] = P0_22_CNF;
-  NRF_GPIO->PIN_CNF[P0_21_INDEX] = P0_21_CNF;
+  NRF_GPIO->PIN_CNF[P0_24_INDEX] = P0_24_ACCEL_INT2_CNF;
+  NRF_GPIO->PIN_CNF[P0_23_INDEX] = P0_23_ACCEL_INT1_CNF;
+  NRF_GPIO->PIN_CNF[P0_22_INDEX] = P0_22_ACCEL_SDA_CNF;
+  NRF_GPIO->PIN_CNF[P0_21_INDEX] = P0_21_ACCEL_SCL_CNF;
   NRF_GPIO->PIN_CNF[P0_20_INDEX] = P0_20_CNF;
   NRF_GPIO->PIN_CNF[P0_19_INDEX] = P0_19_ARED_CNF;
   NRF_GPIO->PIN_CNF[P0_18_INDEX] = P0_18_ABLU_CNF;
@@ -213,33 +236,34 @@ Function: SysTickSetup
 
 Description:
 Initializes the 1ms and 1s System Ticks from the TIMER1 peripheral.
-Since this application is not concerned about power, we can keep the 16MHz clock
-on and power TIMER1 all the time.  
+TIMER1 runs free at 1 MHz; the ticks are counted from its value by SystemCountTicks().  The TIMER1 interrupt is
+never enabled: its compare only pends it, and SEVONPEND turns that into the event that ends a __WFE().
 
 Requires:
   -
 
 Promises:
-  - Both system timers are zeroed and the Timer is configured to produce 1ms interrupts
+  - Both system timers are zeroed and TIMER1 is counting from 0 with the first tick due at TIMER_COUNT_1MS
 */
 void SysTickSetup(void)
 {
-  G_u32SystemTime1ms = 0;      
-  G_u32SystemTime1s  = 0;   
+  SysTimeInitialize();
   
   /* Load the SysTick Timer */
   NRF_TIMER1->MODE      = TIMER_MODE_MODE_Timer << TIMER_MODE_MODE_Pos;
   NRF_TIMER1->BITMODE   = TIMER_BITMODE_BITMODE_16Bit << TIMER_BITMODE_BITMODE_Pos;
-  NRF_TIMER1->PRESCALER = 0;
-  NRF_TIMER1->SHORTS    = TIMER_SHORTS_COMPARE0_CLEAR_Enabled << TIMER_SHORTS_COMPARE0_CLEAR_Pos;
-  NRF_TIMER1->CC[0]     = TIMER_COUNT_1MS;
+  NRF_TIMER1->PRESCALER = TIMER_PRESCALER_1MHZ;
+  NRF_TIMER1->SHORTS    = 0;
   NRF_TIMER1->INTENSET  = TIMER_INTENSET_COMPARE0_Enabled << TIMER_INTENSET_COMPARE0_Pos;
+  Bsp_u16NextTick       = (u16)TIMER_COUNT_1MS;
   
-  /* Enable TIMER1 interrupt */
+  /* TIMER1 interrupt stays disabled: a pended disabled interrupt wakes __WFE() */
   NVIC_SetPriority(TIMER1_IRQn, 0);
-  //NVIC_EnableIRQ(TIMER1_IRQn);
+  NVIC_ClearPendingIRQ(TIMER1_IRQn);
+  SCB->SCR |= SCB_SCR_SEVONPEND_Msk;
   
   /* Start timer */
+  NRF_TIMER1->TASKS_CLEAR = 1;
   NRF_TIMER1->TASKS_START = 1;
 
   
@@ -250,37 +274,202 @@ void SysTickSetup(void)
 Function: SystemSleep
 
 Description:
-Puts the system into sleep mode. 
-
-TBD
+Counts the ticks that went by during the main loop pass, then sleeps (__WFE) until the nearest armed deadline
+slot, the next tick if a wake request came in, or SYSTEM_SLEEP_MAX_MS.  Every tick that passes is counted, so a
+pass that overruns 1ms (e.g. across a flash page erase) does not make the system time drift.
 
 Requires:
-  - TBD
+  - SysTickSetup() has run
+  - Modules that need a pass every 1ms keep a 1ms deadline slot armed
 
 Promises:
-  - Configures processor for maximum sleep while still allowing any required
-    interrupt to wake it up.
+  - Returns at once if the pass took a tick or more; otherwise returns after at least one tick
+  - G_u32SystemTime1ms has counted every tick up to now
 */
 void SystemSleep(void)
-{    
-  /* Set the system control register for Sleep (but not Deep Sleep) */
-   
-   /* Set the sleep flag (cleared only in SysTick ISR */
-   G_u32SystemFlags |= _SYSTEM_SLEEPING;
+{
+  u32 u32SleepMs;
 
-   while(NRF_TIMER1->EVENTS_COMPARE[0] == 0);
-   NRF_TIMER1->EVENTS_COMPARE[0] = 0;
-   
-  /* Now sleep until an event wakes us up */
-   //while(G_u32SystemFlags & _SYSTEM_SLEEPING)
-   {
-   }
+  /* A pass that ran into the next tick is already late for it */
+  if(SystemCountTicks() != 0)
+  {
+    Bsp_u32WakeRequestsSeen = Bsp_u32WakeRequests;
+    return;
+  }
 
-  /* Clear the sleep mode status flags */
+  u32SleepMs = SysTimeNextDeadline();
+  if(u32SleepMs > SYSTEM_SLEEP_MAX_MS)
+  {
+    u32SleepMs = SYSTEM_SLEEP_MAX_MS;
+  }
+  if(u32SleepMs == 0)
+  {
+    u32SleepMs = 1;
+  }
+
+  G_u32SystemFlags |= _SYSTEM_SLEEPING;
+
+  /* Sleep to the last tick needed; anything else that wakes the CPU goes back to sleep unless it asked to run */
+  SystemWaitForCompare( (u16)(Bsp_u16NextTick + (u16)((u32SleepMs - 1) * TIMER_COUNT_1MS)),
+                        (u16)(u32SleepMs * TIMER_COUNT_1MS), true );
+
+  /* Woken by a request before the first tick: the main loop still runs at most once per tick */
+  if(SystemCountTicks() == 0)
+  {
+    SystemWaitForCompare(Bsp_u16NextTick, (u16)TIMER_COUNT_1MS, false);
+    (void)SystemCountTicks();
+  }
+
+  Bsp_u32WakeRequestsSeen = Bsp_u32WakeRequests;
+  G_u32SystemFlags &= ~_SYSTEM_SLEEPING;
     
 } /* end SystemSleep(void) */
 
 
+/*----------------------------------------------------------------------------------------------------------------------
+Function: ResetSourceCheck
+
+Description:
+Finds out why the processor started.  Must run before the soft device is enabled (it owns the POWER registers
+after that).
+
+Requires:
+  - 
+
+Promises:
+  - _SYSTEM_WOKE_FROM_OFF is set in G_u32SystemFlags if this start is a wake from System OFF
+  - RESETREAS is cleared so the next reset reports only its own cause
+*/
+void ResetSourceCheck(void)
+{
+  u32 u32Reason = NRF_POWER->RESETREAS;
+
+  if(u32Reason & POWER_RESETREAS_OFF_Msk)
+  {
+    G_u32SystemFlags |= _SYSTEM_WOKE_FROM_OFF;
+  }
+
+  /* Bits are cleared by writing 1 */
+  NRF_POWER->RESETREAS = u32Reason;
+
+} /* end ResetSourceCheck() */
+
+
+/*----------------------------------------------------------------------------------------------------------------------
+Function: SystemOff
+
+Description:
+Enters System OFF with the accelerometer INT1 line as the only wake source.  Waking is a reset: main() starts over
+with _SYSTEM_WOKE_FROM_OFF set.
+
+Requires:
+  - The LEDs and anything else that draws current are off
+  - The accelerometer holds INT1 low until it sees motion
+
+Promises:
+  - Does not return (in a debug session, where System OFF is only emulated, it waits here)
+*/
+void SystemOff(void)
+{
+  u8 u8SoftDeviceEnabled = 0;
+
+  NRF_GPIO->PIN_CNF[P0_23_INDEX] = P0_23_ACCEL_INT1_WAKE_CNF;
+
+  /* The soft device owns the clock and power registers while it is enabled */
+  (void)sd_softdevice_is_enabled(&u8SoftDeviceEnabled);
+  if(u8SoftDeviceEnabled)
+  {
+    (void)sd_clock_hfclk_release();
+    (void)sd_power_system_off();
+  }
+
+  NRF_CLOCK->TASKS_HFCLKSTOP = 1;
+  NRF_POWER->SYSTEMOFF = 1;
+
+  while(1);
+
+} /* end SystemOff() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private Functions */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------------------------------------------------
+Function: SystemCountTicks
+
+Description:
+Counts the 1ms ticks that have passed since the last count.  TIMER1 is 16-bit, so a gap of more than
+SYSTEM_TICK_MAX_LATE_US (~64ms) between counts loses time.
+
+Requires:
+  - TIMER1 runs free at 1 MHz
+
+Promises:
+  - SysTimeTick() has run once for each tick due since the last count
+  - Bsp_u16NextTick is the TIMER1 count of the next tick (in the future)
+  - Returns the number of ticks counted
+*/
+u32 SystemCountTicks(void)
+{
+  u32 u32Ticks = 0;
+  u16 u16Now;
+
+  NRF_TIMER1->TASKS_CAPTURE[TIMER_CC_CAPTURE] = 1;
+  u16Now = (u16)NRF_TIMER1->CC[TIMER_CC_CAPTURE];
+
+  /* While the next tick is still ahead, (now - next) wraps to more than SYSTEM_TICK_MAX_LATE_US */
+  while( (u16)(u16Now - Bsp_u16NextTick) < SYSTEM_TICK_MAX_LATE_US )
+  {
+    SysTimeTick();
+    Bsp_u16NextTick += (u16)TIMER_COUNT_1MS;
+    u32Ticks++;
+  }
+
+  return(u32Ticks);
+
+} /* end SystemCountTicks() */
+
+
+/*----------------------------------------------------------------------------------------------------------------------
+Function: SystemWaitForCompare
+
+Description:
+Sleeps until TIMER1 reaches u16Compare_.
+
+Requires:
+  - u16Span_ is how far ahead of now u16Compare_ can be; a compare further off than that has already gone by
+  - SEVONPEND is set and the TIMER1 interrupt is disabled, so the pended compare is a wake event
+
+Promises:
+  - Returns once TIMER1 has reached u16Compare_ (at once if it already had)
+  - If bWakeEarly_, also returns once SystemWakeRequest() has been called since the last sleep ended
+*/
+void SystemWaitForCompare(u16 u16Compare_, u16 u16Span_, bool bWakeEarly_)
+{
+  u16 u16Now;
+
+  NRF_TIMER1->CC[TIMER_CC_SLEEP] = u16Compare_;
+  NRF_TIMER1->EVENTS_COMPARE[TIMER_CC_SLEEP] = 0;
+  NVIC_ClearPendingIRQ(TIMER1_IRQn);
+
+  /* A compare that went by while it was being set would not fire for another 65ms */
+  NRF_TIMER1->TASKS_CAPTURE[TIMER_CC_CAPTURE] = 1;
+  u16Now = (u16)NRF_TIMER1->CC[TIMER_CC_CAPTURE];
+  if( (u16)(u16Compare_ - u16Now - 1) >= u16Span_ )
+  {
+    return;
+  }
+
+  while( (NRF_TIMER1->EVENTS_COMPARE[TIMER_CC_SLEEP] == 0) &&
+         !(bWakeEarly_ && (Bsp_u32WakeRequests != Bsp_u32WakeRequestsSeen)) )
+  {
+    __WFE();
+  }
+
+} /* end SystemWaitForCompare() */
+
+
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -29,6 +29,7 @@ Type Definitions
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* Public Functions */
 /*--------------------------------------------------------------------------------------------------------------------*/
+void SystemWakeRequest(void);
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -41,6 +42,14 @@ void ClockSetup(void);
 void InterruptSetup(void);
 void SysTickSetup(void);
 void SystemSleep(void);
+void ResetSourceCheck(void);
+void SystemOff(void);
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private Functions */
+/*--------------------------------------------------------------------------------------------------------------------*/
+u32 SystemCountTicks(void);
+void SystemWaitForCompare(u16 u16Compare_, u16 u16Span_, bool bWakeEarly_);
 
 
 /***********************************************************************************************************************
@@ -73,10 +82,18 @@ Then we can count up to 33 to get a 1.0071ms tick.  That gives 993 for the value
 /* Watch Dog Values */
 
 /* TIMER
-The built-in timer will provide the system tick
-It is clocked from HFCLK.  To get the desired 1ms tick use a compare period of 0.001 / (1/HFCLK) or HFCLK/1000.
+TIMER1 provides the system tick.  It runs free at 1 MHz in 16-bit mode; the 1ms ticks are counted from its value
+and CC[0] is moved to the time the next main loop pass is due.  Ticks the CPU was held through (e.g. a flash page
+erase) are still counted as long as the pass took less than SYSTEM_TICK_MAX_LATE_US.
 */
-#define TIMER_COUNT_1MS        (u32)(HFCLK_FREQ / 1000)
+#define TIMER_PRESCALER_1MHZ   (u32)4                  /* 16 MHz / 2^4 */
+#define TIMER_COUNT_1MS        (u32)1000
+#define TIMER_CC_SLEEP         (u8)0                   /* Wake compare */
+#define TIMER_CC_CAPTURE       (u8)1                   /* Count read */
+#define SYSTEM_TICK_MAX_LATE_US (u16)(0x10000 - TIMER_COUNT_1MS)
+
+/* Longest sleep when no deadline slot is armed nearer.  Modules that need every tick arm a 1ms slot. */
+#define SYSTEM_SLEEP_MAX_MS    (u32)10
 
 
 /***********************************************************************************************************************
@@ -92,10 +109,10 @@ It is clocked from HFCLK.  To get the desired 1ms tick use a compare period of 0
 #define P0_27_               (u32)0x08000000
 #define P0_26_               (u32)0x04000000 
 #define P0_25_               (u32)0x02000000
-#define P0_24_               (u32)0x01000000
-#define P0_23_               (u32)0x00800000
-#define P0_22_               (u32)0x00400000 
-#define P0_21_               (u32)0x00200000
+#define P0_24_ACCEL_INT2     (u32)0x01000000
+#define P0_23_ACCEL_INT1     (u32)0x00800000
+#define P0_22_ACCEL_SDA      (u32)0x00400000
+#define P0_21_ACCEL_SCL      (u32)0x00200000
 #define P0_20_               (u32)0x00100000
 #define P0_19_ARED           (u32)0x00080000
 #define P0_18_ABLU           (u32)0x00040000
@@ -195,28 +212,36 @@ It is clocked from HFCLK.  To get the desired 1ms tick use a compare period of 0
                               (GPIO_PIN_CNF_DRIVE_S0S1       << GPIO_PIN_CNF_DRIVE_Pos) | \
                               (GPIO_PIN_CNF_SENSE_Disabled   << GPIO_PIN_CNF_SENSE_Pos) )
 
-#define P0_24_CNF      ( (GPIO_PIN_CNF_DIR_Input       << GPIO_PIN_CNF_DIR_Pos)   | \
-                              (GPIO_PIN_CNF_INPUT_Disconnect << GPIO_PIN_CNF_INPUT_Pos) | \
-                              (GPIO_PIN_CNF_PULL_Disabled    << GPIO_PIN_CNF_PULL_Pos)  | \
+/* Pulled down so an unfitted INT2 reads as no tap */
+#define P0_24_ACCEL_INT2_CNF ( (GPIO_PIN_CNF_DIR_Input       << GPIO_PIN_CNF_DIR_Pos)   | \
+                              (GPIO_PIN_CNF_INPUT_Connect    << GPIO_PIN_CNF_INPUT_Pos) | \
+                              (GPIO_PIN_CNF_PULL_Pulldown    << GPIO_PIN_CNF_PULL_Pos)  | \
                               (GPIO_PIN_CNF_DRIVE_S0S1       << GPIO_PIN_CNF_DRIVE_Pos) | \
                               (GPIO_PIN_CNF_SENSE_Disabled   << GPIO_PIN_CNF_SENSE_Pos) )
 
-#define P0_23_CNF      ( (GPIO_PIN_CNF_DIR_Input       << GPIO_PIN_CNF_DIR_Pos)   | \
-                              (GPIO_PIN_CNF_INPUT_Disconnect << GPIO_PIN_CNF_INPUT_Pos) | \
+#define P0_23_ACCEL_INT1_CNF ( (GPIO_PIN_CNF_DIR_Input       << GPIO_PIN_CNF_DIR_Pos)   | \
+                              (GPIO_PIN_CNF_INPUT_Connect    << GPIO_PIN_CNF_INPUT_Pos) | \
                               (GPIO_PIN_CNF_PULL_Disabled    << GPIO_PIN_CNF_PULL_Pos)  | \
                               (GPIO_PIN_CNF_DRIVE_S0S1       << GPIO_PIN_CNF_DRIVE_Pos) | \
                               (GPIO_PIN_CNF_SENSE_Disabled   << GPIO_PIN_CNF_SENSE_Pos) )
 
-#define P0_22_CNF      ( (GPIO_PIN_CNF_DIR_Input       << GPIO_PIN_CNF_DIR_Pos)   | \
-                              (GPIO_PIN_CNF_INPUT_Disconnect << GPIO_PIN_CNF_INPUT_Pos) | \
+/* INT1 while in System OFF: a high level wakes the processor (reset with RESETREAS.OFF set) */
+#define P0_23_ACCEL_INT1_WAKE_CNF ( (GPIO_PIN_CNF_DIR_Input       << GPIO_PIN_CNF_DIR_Pos)   | \
+                              (GPIO_PIN_CNF_INPUT_Connect    << GPIO_PIN_CNF_INPUT_Pos) | \
                               (GPIO_PIN_CNF_PULL_Disabled    << GPIO_PIN_CNF_PULL_Pos)  | \
                               (GPIO_PIN_CNF_DRIVE_S0S1       << GPIO_PIN_CNF_DRIVE_Pos) | \
+                              (GPIO_PIN_CNF_SENSE_High       << GPIO_PIN_CNF_SENSE_Pos) )
+
+#define P0_22_ACCEL_SDA_CNF ( (GPIO_PIN_CNF_DIR_Input       << GPIO_PIN_CNF_DIR_Pos)   | \
+                              (GPIO_PIN_CNF_INPUT_Connect    << GPIO_PIN_CNF_INPUT_Pos) | \
+                              (GPIO_PIN_CNF_PULL_Pullup      << GPIO_PIN_CNF_PULL_Pos)  | \
+                              (GPIO_PIN_CNF_DRIVE_S0D1       << GPIO_PIN_CNF_DRIVE_Pos) | \
                               (GPIO_PIN_CNF_SENSE_Disabled   << GPIO_PIN_CNF_SENSE_Pos) )
 
-#define P0_21_CNF      ( (GPIO_PIN_CNF_DIR_Input       << GPIO_PIN_CNF_DIR_Pos)   | \
-                              (GPIO_PIN_CNF_INPUT_Disconnect << GPIO_PIN_CNF_INPUT_Pos) | \
-                              (GPIO_PIN_CNF_PULL_Disabled    << GPIO_PIN_CNF_PULL_Pos)  | \
-                              (GPIO_PIN_CNF_DRIVE_S0S1       << GPIO_PIN_CNF_DRIVE_Pos) | \
+#define P0_21_ACCEL_SCL_CNF ( (GPIO_PIN_CNF_DIR_Input       << GPIO_PIN_CNF_DIR_Pos)   | \
+                              (GPIO_PIN_CNF_INPUT_Connect    << GPIO_PIN_CNF_INPUT_Pos) | \
+                              (GPIO_PIN_CNF_PULL_Pullup      << GPIO_PIN_CNF_PULL_Pos)  | \
+                              (GPIO_PIN_CNF_DRIVE_S0D1       << GPIO_PIN_CNF_DRIVE_Pos) | \
                               (GPIO_PIN_CNF_SENSE_Disabled   << GPIO_PIN_CNF_SENSE_Pos) )
 
 #define P0_20_CNF    ( (GPIO_PIN_CNF_DIR_Input        << GPIO_PIN_CNF_DIR_Pos)   | \
@@ -0,0 +1,367 @@
+/**********************************************************************************************************************
+File: aes_ctr.c
+
+Description:
+AES-128 counter mode stream for encrypted image uploads and command pages, using the ECB peripheral.  The key is
+provisioned with the KEY command (see image_upload.c for when it is accepted) and kept in settings.  Settings are
+not encrypted.
+
+nrf_ecb_crypt() starts the ECB and waits for EVENTS_ENDECB on every 16 byte block.  Counter mode only ever
+encrypts the counter, never the data, so the keystream does not depend on what is received.  This module keeps
+AES_CTR_RING_BLOCKS blocks of keystream ready: ECB_IRQHandler stores each finished block and starts the next one
+until the ring is full, so the ECB works in the background while the radio is still receiving.  AesCtrXor() then
+decrypts (or encrypts) with a word-wise XOR against the ring and only waits if the data has outrun the ECB.
+
+Usage:
+  AesCtrSetKey(au8Key);
+  AesCtrStart(au8Nonce, 0);                  (offset lets a stream resume part way through)
+  AesCtrXor(pu8Data, u16Length);             (repeat for consecutive pieces of the stream)
+  AesCtrStop();
+
+The ECB can be aborted by the radio's own crypto (ERRORECB); the block is simply run again.
+**********************************************************************************************************************/
+
+#include "configuration.h"
+
+/***********************************************************************************************************************
+Global variable definitions with scope across entire project.
+All Global variable names shall start with "G_"
+***********************************************************************************************************************/
+/* New variables */
+volatile u32 G_u32AesCtrFlags;                         /* Global state flags */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Existing variables (defined in other files -- should all contain the "extern" keyword) */
+extern volatile u32 G_u32SystemFlags;                  /* From main.c */
+
+extern volatile u32 G_u32SystemTime1ms;                /* From board-specific source file */
+extern volatile u32 G_u32SystemTime1s;                 /* From board-specific source file */
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "AesCtr_" and be declared as static.
+***********************************************************************************************************************/
+/* ECB data structure read and written by the peripheral: key, counter block (cleartext), keystream (ciphertext) */
+static u32 AesCtr_au32EcbData[3 * AES_CTR_BLOCK_WORDS];
+#define AesCtr_pu8Key         ((u8*)&AesCtr_au32EcbData[0])
+#define AesCtr_pu8Counter     ((u8*)&AesCtr_au32EcbData[AES_CTR_BLOCK_WORDS])
+#define AesCtr_pu32Keystream  (&AesCtr_au32EcbData[2 * AES_CTR_BLOCK_WORDS])
+
+static u32 AesCtr_au32Ring[AES_CTR_RING_BLOCKS][AES_CTR_BLOCK_WORDS];  /* Keystream blocks ready for use */
+/* Free running block counts: each side writes only its own, so no critical sections are needed */
+static volatile u8 AesCtr_u8Produced;                  /* Blocks stored by ECB_IRQHandler() */
+static volatile u8 AesCtr_u8Consumed;                  /* Blocks used up by AesCtrXor() */
+static u8 AesCtr_u8ByteIndex;                          /* Bytes of the tail block already used */
+static volatile bool AesCtr_bBusy;                     /* ECB is running */
+
+static AesCtrStatsType AesCtr_sStats;                  /* Counters */
+
+
+/**********************************************************************************************************************
+Function Definitions
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AesCtrSetKey
+
+Description:
+Loads the AES-128 key.
+
+Requires:
+  - pu8Key_ points to AES_CTR_KEY_SIZE bytes
+
+Promises:
+  - Any stream in progress is stopped; _AES_CTR_FLAGS_KEY_SET is set
+*/
+void AesCtrSetKey(const u8* pu8Key_)
+{
+  AesCtrStop();
+  memcpy(AesCtr_pu8Key, pu8Key_, AES_CTR_KEY_SIZE);
+  G_u32AesCtrFlags |= _AES_CTR_FLAGS_KEY_SET;
+
+} /* end AesCtrSetKey() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AesCtrStart
+
+Description:
+Starts a keystream at a byte offset into the stream for a nonce.
+
+Requires:
+  - pu8Nonce_ points to AES_CTR_NONCE_SIZE bytes; a nonce is never reused with the same key
+  - Main loop context
+
+Promises:
+  - Returns false if no key is loaded
+  - Otherwise the ring is emptied and the ECB starts filling it from the block holding u32Offset_
+*/
+bool AesCtrStart(const u8* pu8Nonce_, u32 u32Offset_)
+{
+  u32 u32Block = u32Offset_ / AES_CTR_BLOCK_SIZE;
+
+  if( !(G_u32AesCtrFlags & _AES_CTR_FLAGS_KEY_SET) )
+  {
+    return(false);
+  }
+
+  AesCtrStop();
+
+  memset(AesCtr_pu8Counter, 0, AES_CTR_BLOCK_SIZE);
+  memcpy(AesCtr_pu8Counter, pu8Nonce_, AES_CTR_NONCE_SIZE);
+  AesCtr_pu8Counter[AES_CTR_COUNTER_INDEX]     = (u8)(u32Block >> 24);
+  AesCtr_pu8Counter[AES_CTR_COUNTER_INDEX + 1] = (u8)(u32Block >> 16);
+  AesCtr_pu8Counter[AES_CTR_COUNTER_INDEX + 2] = (u8)(u32Block >> 8);
+  AesCtr_pu8Counter[AES_CTR_COUNTER_INDEX + 3] = (u8)u32Block;
+
+  AesCtr_u8Produced = 0;
+  AesCtr_u8Consumed = 0;
+  AesCtr_u8ByteIndex = (u8)(u32Offset_ % AES_CTR_BLOCK_SIZE);
+
+  G_u32AesCtrFlags |= _AES_CTR_FLAGS_RUNNING;
+  NRF_ECB->INTENSET = ECB_INTENSET_ENDECB_Msk | ECB_INTENSET_ERRORECB_Msk;
+  AesCtrKick();
+
+  return(true);
+
+} /* end AesCtrStart() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AesCtrStop
+
+Description:
+Ends the current stream.
+
+Requires:
+  - Main loop context
+
+Promises:
+  - ECB stopped and its interrupt disabled; AesCtrXor() fails until AesCtrStart() is called
+*/
+void AesCtrStop(void)
+{
+  NRF_ECB->INTENCLR = ECB_INTENCLR_ENDECB_Msk | ECB_INTENCLR_ERRORECB_Msk;
+  NRF_ECB->TASKS_STOPECB = 1;
+  NRF_ECB->EVENTS_ENDECB = 0;
+  NRF_ECB->EVENTS_ERRORECB = 0;
+  AesCtr_bBusy = false;
+  G_u32AesCtrFlags &= ~_AES_CTR_FLAGS_RUNNING;
+
+} /* end AesCtrStop() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AesCtrXor
+
+Description:
+XORs the next bytes of keystream into data (decrypts or encrypts in place).
+
+Requires:
+  - AesCtrStart() has run
+  - Main loop context (the ECB interrupt must be able to run while this waits)
+
+Promises:
+  - Returns false if no stream is running
+  - Otherwise pu8Data_[0..u16Length_-1] are XORed with the keystream and the stream advances by u16Length_
+*/
+bool AesCtrXor(u8* pu8Data_, u16 u16Length_)
+{
+  u8* pu8Keystream;
+  u32* pu32Data;
+  u32* pu32Keystream;
+
+  if( !(G_u32AesCtrFlags & _AES_CTR_FLAGS_RUNNING) )
+  {
+    return(false);
+  }
+
+  while(u16Length_ != 0)
+  {
+    /* Wait for the ECB only if the data has used up every ready block */
+    if(AesCtr_u8Produced == AesCtr_u8Consumed)
+    {
+      AesCtr_sStats.u32Stalls++;
+      AesCtrKick();
+      while(AesCtr_u8Produced == AesCtr_u8Consumed)
+      {
+      }
+    }
+
+    pu8Keystream = (u8*)AesCtr_au32Ring[AesCtr_u8Consumed & AES_CTR_RING_MASK];
+
+    /* Word-wise while the data and keystream line up on word boundaries */
+    if( (((uintptr_t)pu8Data_ & 0x3) == 0) && ((AesCtr_u8ByteIndex & 0x3) == 0) )
+    {
+      pu32Data = (u32*)pu8Data_;
+      pu32Keystream = (u32*)&pu8Keystream[AesCtr_u8ByteIndex];
+      while( (u16Length_ >= 4) && (AesCtr_u8ByteIndex < AES_CTR_BLOCK_SIZE) )
+      {
+        *pu32Data++ ^= *pu32Keystream++;
+        AesCtr_u8ByteIndex += 4;
+        u16Length_ -= 4;
+      }
+      pu8Data_ = (u8*)pu32Data;
+    }
+
+    while( (u16Length_ != 0) && (AesCtr_u8ByteIndex < AES_CTR_BLOCK_SIZE) )
+    {
+      *pu8Data_++ ^= pu8Keystream[AesCtr_u8ByteIndex++];
+      u16Length_--;
+
+      /* Back to the word loop as soon as both pointers are aligned again */
+      if( (((uintptr_t)pu8Data_ & 0x3) == 0) && ((AesCtr_u8ByteIndex & 0x3) == 0) )
+      {
+        break;
+      }
+    }
+
+    /* Block used up: hand it back to the ECB */
+    if(AesCtr_u8ByteIndex == AES_CTR_BLOCK_SIZE)
+    {
+      AesCtr_u8ByteIndex = 0;
+      AesCtr_u8Consumed++;
+      AesCtrKick();
+    }
+  }
+
+  return(true);
+
+} /* end AesCtrXor() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AesCtrGetStats
+
+Description:
+Reports keystream production and waits.
+
+Requires:
+  - psStats_ points to space for the statistics
+
+Promises:
+  - *psStats_ is a copy of the counters
+*/
+void AesCtrGetStats(AesCtrStatsType* psStats_)
+{
+  *psStats_ = AesCtr_sStats;
+
+} /* end AesCtrGetStats() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AesCtrInitialize
+
+Description:
+Points the ECB at the module's data structure and sets up its interrupt.
+
+Requires:
+  - Called before the soft device is enabled (direct NVIC access)
+
+Promises:
+  - No key loaded, no stream running, ECB interrupt enabled in the NVIC at AES_CTR_PRIORITY
+*/
+void AesCtrInitialize(void)
+{
+  G_u32AesCtrFlags = 0;
+  memset(&AesCtr_sStats, 0, sizeof(AesCtr_sStats));
+
+  NRF_ECB->ECBDATAPTR = (u32)(uintptr_t)AesCtr_au32EcbData;
+  AesCtrStop();
+
+  NVIC_SetPriority(ECB_IRQn, AES_CTR_PRIORITY);
+  NVIC_ClearPendingIRQ(ECB_IRQn);
+  NVIC_EnableIRQ(ECB_IRQn);
+
+} /* end AesCtrInitialize() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Interrupt handler: ECB_IRQHandler
+
+Description:
+Stores a finished keystream block and starts the next.
+
+Requires:
+  - AesCtrStart() enabled the ECB interrupts
+
+Promises:
+  - ENDECB: the keystream block joins the ring, the counter advances and the next block starts if there is room
+  - ERRORECB: the same block is started again
+*/
+void ECB_IRQHandler(void)
+{
+  u8 i;
+
+  if(NRF_ECB->EVENTS_ERRORECB)
+  {
+    NRF_ECB->EVENTS_ERRORECB = 0;
+    AesCtr_sStats.u32Errors++;
+    AesCtr_bBusy = false;
+  }
+
+  if(NRF_ECB->EVENTS_ENDECB)
+  {
+    NRF_ECB->EVENTS_ENDECB = 0;
+    AesCtr_bBusy = false;
+
+    memcpy(AesCtr_au32Ring[AesCtr_u8Produced & AES_CTR_RING_MASK], AesCtr_pu32Keystream, AES_CTR_BLOCK_SIZE);
+    AesCtr_u8Produced++;
+    AesCtr_sStats.u32Blocks++;
+
+    /* Big endian increment of the block number */
+    for(i = AES_CTR_BLOCK_SIZE; i > AES_CTR_COUNTER_INDEX; i--)
+    {
+      if(++AesCtr_pu8Counter[i - 1] != 0)
+      {
+        break;
+      }
+    }
+  }
+
+  AesCtrKick();
+
+} /* end ECB_IRQHandler() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AesCtrKick
+
+Description:
+Starts the ECB on the next counter block if it is idle and the ring has room.
+
+Requires:
+  - Safe from both contexts: the interrupt can only fire while the ECB is busy, and then this does nothing
+
+Promises:
+  - ECB running if a stream is active and fewer than AES_CTR_RING_BLOCKS blocks are ready
+*/
+void AesCtrKick(void)
+{
+  if( (G_u32AesCtrFlags & _AES_CTR_FLAGS_RUNNING) && !AesCtr_bBusy &&
+      ((u8)(AesCtr_u8Produced - AesCtr_u8Consumed) < AES_CTR_RING_BLOCKS) )
+  {
+    AesCtr_bBusy = true;
+    NRF_ECB->TASKS_STARTECB = 1;
+  }
+
+} /* end AesCtrKick() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
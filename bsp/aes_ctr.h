@@ -0,0 +1,76 @@
+/**********************************************************************************************************************
+File: aes_ctr.h
+
+Description:
+Header file for aes_ctr.c source.
+**********************************************************************************************************************/
+
+#ifndef __AES_CTR_H
+#define __AES_CTR_H
+
+/**********************************************************************************************************************
+Type Definitions
+**********************************************************************************************************************/
+typedef struct
+{
+  u32 u32Blocks;                              /* Keystream blocks produced by the ECB */
+  u32 u32Stalls;                              /* AesCtrXor() calls that had to wait for keystream */
+  u32 u32Errors;                              /* ECB runs aborted by the radio and repeated */
+} AesCtrStatsType;
+
+
+/**********************************************************************************************************************
+Constants / Definitions
+**********************************************************************************************************************/
+#define AES_CTR_BLOCK_SIZE          (u8)16
+#define AES_CTR_BLOCK_WORDS         (u8)4
+#define AES_CTR_KEY_SIZE            (u8)16
+#define AES_CTR_NONCE_SIZE          (u8)7                     /* Nonce bytes at the start of each counter block */
+
+/* Counter block: [0..6] nonce, [7..11] zero, [12..15] block number (big endian) */
+#define AES_CTR_COUNTER_INDEX       (u8)12
+
+/* Keystream kept ready ahead of the data: 8 blocks covers five 24 byte burst packets */
+#define AES_CTR_RING_BLOCKS         (u8)8                     /* Power of 2 */
+#define AES_CTR_RING_MASK           (u8)(AES_CTR_RING_BLOCKS - 1)
+
+#define AES_CTR_PRIORITY            (u8)3                     /* Application low */
+
+/* G_u32AesCtrFlags */
+#define _AES_CTR_FLAGS_KEY_SET      (u32)0x00000001           /* A key has been loaded */
+#define _AES_CTR_FLAGS_RUNNING      (u32)0x00000002           /* A stream is started */
+
+
+/**********************************************************************************************************************
+Function Declarations
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void AesCtrSetKey(const u8* pu8Key_);
+bool AesCtrStart(const u8* pu8Nonce_, u32 u32Offset_);
+void AesCtrStop(void);
+bool AesCtrXor(u8* pu8Data_, u16 u16Length_);
+void AesCtrGetStats(AesCtrStatsType* psStats_);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void AesCtrInitialize(void);
+void ECB_IRQHandler(void);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void AesCtrKick(void);
+
+
+#endif /* __AES_CTR_H */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,897 @@
+/**********************************************************************************************************************
+File: ant.c
+
+Description:
+ANT radio driver.  Enables the soft device and runs the image upload channel.
+
+Events: the soft device event interrupt (SD_EVT_IRQHandler in soc_integration.c) calls AntCaptureEvents(), which
+reads every waiting event with sd_ant_event_get() and copies it into a fixed-size queue of AntEventType.  Nothing
+else runs in interrupt context.  AntUpdate() drains up to ANT_EVENT_BATCH_SIZE events per main loop pass.  Runs of
+consecutive events for the same channel go to that channel's handler in a single call, so a busy channel (e.g.
+an incoming burst) costs one handler call per batch instead of one per packet.  Handlers are registered per
+channel with AntRegisterChannelHandler().
+
+If the queue is full the event is dropped and counted.  AntGetEventStats() reports the high-water depth and drop
+count for sizing ANT_EVENT_QUEUE_SIZE.  A dropped burst packet is reported to its channel as
+EVENT_TRANSFER_RX_FAILED ahead of the channel's next event: burst sequence numbers repeat every three packets, so
+the handler could not always see the gap itself.
+
+Each event is stamped with SysTimeGetUs() when the interrupt runs so handlers can relate radio traffic to the
+microsecond time base (e.g. wand phase sync).
+
+Other modules open their own channels with AntOpenChannel().  A channel closed with AntCloseChannel() is
+unassigned when the stack reports EVENT_CHANNEL_CLOSED, after which it can be opened again.
+
+Scan mode: AntOpenScanChannel() runs channel 0 as a continuous receiver limited by an ID list, for remotes that
+must be heard at once rather than at a slave channel's next slot.  It needs channel 0, so the upload channel is
+closed first and reopened afterwards with AntOpenUploadChannel().  Received messages carry the sender's channel ID
+after the payload while scanning.
+
+Radio windows: the soft device preempts the application whenever the radio runs.  With RF scheduling on
+(AntSetRfScheduling()), the stack sends EVENT_RFACTIVE_NOTIFICATION when the next radio activity is at least
+ANT_RFACTIVE_THRESHOLD away.  The interrupt notes the time instead of queueing the event, and AntRadioQuietUs()
+reports how much of that quiet window is left so long blocking work can be moved into it.  RF scheduling starts
+off, as each notification is an extra wakeup; command RFSCHED turns it on.
+
+Power mode: with AntSetPowerMode() on, sd_ant_event_filtering_set() stops the stack raising events that no handler
+uses, and the upload channel period follows the host: ANT_CHANNEL_PERIOD_ACTIVE from the first AntNoteActivity()
+until ANT_IDLE_TIMEOUT_MS of quiet, then ANT_CHANNEL_PERIOD_IDLE.  While idle EVENT_TX is filtered too unless a
+channel has asked for it.  AntGetEventStats() reports SD_EVT interrupts per minute to check the savings; the
+interrupts that only carried RF active notifications are counted on their own, as they come from RF scheduling and
+not from the channels.  The mode is saved in settings and set again by AntInitialize(), so it can be turned on
+once (command ANTPOWER) and stays on.
+
+Advanced burst is requested with 24 byte packets.  If the stack rejects the configuration, standard 8 byte
+bursts still work.
+**********************************************************************************************************************/
+
+#include "configuration.h"
+
+/***********************************************************************************************************************
+Global variable definitions with scope across entire project.
+All Global variable names shall start with "G_"
+***********************************************************************************************************************/
+/* New variables */
+volatile u32 G_u32AntFlags;                            /* Global state flags */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Existing variables (defined in other files -- should all contain the "extern" keyword) */
+extern volatile u32 G_u32SystemFlags;                  /* From main.c */
+
+extern volatile u32 G_u32SystemTime1ms;                /* From board-specific source file */
+extern volatile u32 G_u32SystemTime1s;                 /* From board-specific source file */
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "Ant_" and be declared as static.
+***********************************************************************************************************************/
+static ANT_MESSAGE Ant_sMessage;                       /* Message buffer for sd_ant_event_get() (ISR only) */
+
+static AntEventType Ant_asEventQueue[ANT_EVENT_QUEUE_SIZE];  /* Captured events */
+static volatile u8 Ant_u8EventHead;                    /* Next slot to fill (written by the ISR only) */
+static volatile u8 Ant_u8EventTail;                    /* Next slot to dispatch (written by AntUpdate() only) */
+static volatile u32 Ant_u32EventCount;                 /* Events read from the soft device */
+static volatile u32 Ant_u32DroppedEvents;              /* Events lost to a full queue */
+static volatile u8 Ant_u8MaxDepth;                     /* Queue high-water mark */
+static volatile u8 Ant_u8BurstLostChannels;            /* Bit n set if a burst packet for channel n was dropped */
+
+static fnAntChannelHandlerType Ant_apfnChannelHandlers[ANT_CHANNELS];  /* Dispatch table, NULL = discard */
+static u8 Ant_u8OpenChannels;                          /* Bit n set while channel n is assigned */
+
+static volatile u32 Ant_u32QuietStartUs;               /* SysTimeGetUs() of the last RF active notification */
+static volatile bool Ant_bQuietWindow;                 /* Ant_u32QuietStartUs is valid */
+
+static u8 Ant_u8TxEventChannels;                       /* Bit n set if channel n needs EVENT_TX */
+static u32 Ant_u32LastActivity;                        /* SysTimeGetMs() of the last AntNoteActivity() */
+static volatile u32 Ant_u32Wakeups;                    /* SD_EVT interrupts in the current minute */
+static u32 Ant_u32WakeupsPerMinute;                    /* SD_EVT interrupts in the last full minute */
+static volatile u32 Ant_u32RfActiveWakeups;            /* SD_EVT interrupts with only RF active notifications */
+static u32 Ant_u32RfActiveWakeupsPerMinute;            /* Ant_u32RfActiveWakeups in the last full minute */
+static u32 Ant_u32WakeupWindowStart;                   /* SysTimeGetMs() the current minute started */
+
+
+/**********************************************************************************************************************
+Function Definitions
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AntBroadcast
+
+Description:
+Loads the next broadcast message on a master channel.  The stack repeats it every channel period until it is
+replaced.
+
+Requires:
+  - pu8Data_ points to ANT_STANDARD_DATA_PAYLOAD_SIZE bytes
+
+Promises:
+  - Returns true if the stack accepted the message
+*/
+bool AntBroadcast(u8 u8Channel_, u8* pu8Data_)
+{
+  if( !AntIsChannelOpen(u8Channel_) )
+  {
+    return(false);
+  }
+
+  return( sd_ant_broadcast_message_tx(u8Channel_, ANT_STANDARD_DATA_PAYLOAD_SIZE, pu8Data_) == NRF_SUCCESS );
+
+} /* end AntBroadcast() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AntRegisterChannelHandler
+
+Description:
+Sets the function that receives events for a channel.
+
+Requires:
+  - Called from the main loop or during initialization (the table is read by AntUpdate() without protection)
+
+Promises:
+  - Returns true and installs pfnHandler_ if u8Channel_ is valid; NULL discards the channel's events
+*/
+bool AntRegisterChannelHandler(u8 u8Channel_, fnAntChannelHandlerType pfnHandler_)
+{
+  if(u8Channel_ >= ANT_CHANNELS)
+  {
+    return(false);
+  }
+
+  Ant_apfnChannelHandlers[u8Channel_] = pfnHandler_;
+  return(true);
+
+} /* end AntRegisterChannelHandler() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AntGetEventStats
+
+Description:
+Reports event queue usage.
+
+Requires:
+  - psStats_ points to space for the statistics
+
+Promises:
+  - *psStats_ holds the event count, drop count, current depth, high-water depth and wakeups per minute, with the
+    RF active notification wakeups apart from the others
+*/
+void AntGetEventStats(AntEventStatsType* psStats_)
+{
+  psStats_->u32Events  = Ant_u32EventCount;
+  psStats_->u32Dropped = Ant_u32DroppedEvents;
+  psStats_->u8Depth    = (u8)((Ant_u8EventHead - Ant_u8EventTail) & ANT_EVENT_QUEUE_MASK);
+  psStats_->u8MaxDepth = Ant_u8MaxDepth;
+  psStats_->u32WakeupsPerMinute = Ant_u32WakeupsPerMinute;
+  psStats_->u32RfActiveWakeupsPerMinute = Ant_u32RfActiveWakeupsPerMinute;
+
+} /* end AntGetEventStats() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AntOpenChannel
+
+Description:
+Assigns, configures and opens a channel on the default network.
+
+Requires:
+  - Soft device enabled
+  - psConfig_->u8Channel is not already open
+
+Promises:
+  - Returns true if the channel is open; on failure the channel is left unassigned
+*/
+bool AntOpenChannel(const AntChannelConfigType* psConfig_)
+{
+  u8 u8Channel = psConfig_->u8Channel;
+  u32 u32Result;
+
+  if( (G_u32AntFlags & _ANT_FLAGS_SOFTDEVICE_ERROR) || (u8Channel >= ANT_CHANNELS) ||
+      (Ant_u8OpenChannels & (1 << u8Channel)) )
+  {
+    return(false);
+  }
+
+  /* NRF_SUCCESS is 0, so any failure leaves a non-zero result */
+  u32Result = sd_ant_channel_assign(u8Channel, psConfig_->u8ChannelType, ANT_NETWORK_NUMBER, 0);
+  if(u32Result != NRF_SUCCESS)
+  {
+    return(false);
+  }
+
+  u32Result |= sd_ant_channel_id_set(u8Channel, psConfig_->u16DeviceNumber, psConfig_->u8DeviceType,
+                                     psConfig_->u8TransmissionType);
+  u32Result |= sd_ant_channel_period_set(u8Channel, psConfig_->u16Period);
+  u32Result |= sd_ant_channel_radio_freq_set(u8Channel, psConfig_->u8RfFrequency);
+  u32Result |= sd_ant_channel_radio_tx_power_set(u8Channel, ANT_TX_POWER);
+  u32Result |= sd_ant_channel_open(u8Channel);
+  if(u32Result != NRF_SUCCESS)
+  {
+    sd_ant_channel_unassign(u8Channel);
+    return(false);
+  }
+
+  Ant_u8OpenChannels |= (u8)(1 << u8Channel);
+  return(true);
+
+} /* end AntOpenChannel() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AntCloseChannel
+
+Description:
+Starts closing a channel.  The channel is unassigned by AntUpdate() when the stack reports it closed.
+
+Requires:
+  -
+
+Promises:
+  - Returns true if the close was requested
+*/
+bool AntCloseChannel(u8 u8Channel_)
+{
+  if( !AntIsChannelOpen(u8Channel_) )
+  {
+    return(false);
+  }
+
+  return( sd_ant_channel_close(u8Channel_) == NRF_SUCCESS );
+
+} /* end AntCloseChannel() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AntIsChannelOpen
+
+Description:
+Checks if a channel is assigned.
+
+Requires:
+  -
+
+Promises:
+  - Returns true from a successful open until the stack reports the channel closed
+*/
+bool AntIsChannelOpen(u8 u8Channel_)
+{
+  return( (u8Channel_ < ANT_CHANNELS) && (Ant_u8OpenChannels & (1 << u8Channel_)) );
+
+} /* end AntIsChannelOpen() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AntSetRfScheduling
+
+Description:
+Turns RF active notifications on or off.
+
+Requires:
+  - Soft device enabled
+
+Promises:
+  - Returns true and updates _ANT_FLAGS_RF_SCHEDULING if the stack accepted the setting
+  - Any quiet window in progress is forgotten
+*/
+bool AntSetRfScheduling(bool bEnable_)
+{
+  u8 u8Mode = bEnable_ ? RFACTIVE_NOTIFICATION_CONTINUOUS_MODE : RFACTIVE_NOTIFICATION_DISABLED_MODE;
+
+  Ant_bQuietWindow = false;
+
+  if( (G_u32AntFlags & _ANT_FLAGS_SOFTDEVICE_ERROR) ||
+      (sd_ant_rfactive_notification_config_set(u8Mode, ANT_RFACTIVE_THRESHOLD) != NRF_SUCCESS) )
+  {
+    return(false);
+  }
+
+  if(bEnable_)
+  {
+    G_u32AntFlags |= _ANT_FLAGS_RF_SCHEDULING;
+  }
+  else
+  {
+    G_u32AntFlags &= ~_ANT_FLAGS_RF_SCHEDULING;
+  }
+
+  return(true);
+
+} /* end AntSetRfScheduling() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AntRadioQuietUs
+
+Description:
+Returns how long the radio is certain to stay idle.
+
+Requires:
+  -
+
+Promises:
+  - Returns the microseconds left in the current quiet window less ANT_RFACTIVE_GUARD_US, or 0 if there is no
+    window open (or RF scheduling is off)
+*/
+u32 AntRadioQuietUs(void)
+{
+  u32 u32Elapsed;
+
+  if( !Ant_bQuietWindow )
+  {
+    return(0);
+  }
+
+  u32Elapsed = SysTimeGetUs() - Ant_u32QuietStartUs + ANT_RFACTIVE_GUARD_US;
+  if(u32Elapsed >= ANT_PERIOD_TO_US(ANT_RFACTIVE_THRESHOLD))
+  {
+    Ant_bQuietWindow = false;
+    return(0);
+  }
+
+  return( ANT_PERIOD_TO_US(ANT_RFACTIVE_THRESHOLD) - u32Elapsed );
+
+} /* end AntRadioQuietUs() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AntSetPowerMode
+
+Description:
+Turns event filtering and upload channel period tuning on or off.
+
+Requires:
+  - AntInitialize() has run
+
+Promises:
+  - On: unused events are filtered and the upload channel starts on the idle period
+  - Off: no events are filtered and the upload channel returns to ANT_CHANNEL_PERIOD
+  - The mode is saved for AntInitialize()
+  - Returns false if the soft device is not running
+*/
+bool AntSetPowerMode(bool bEnable_)
+{
+  u16 u16Period = ANT_CHANNEL_PERIOD;
+  u8 u8Enabled = (u8)bEnable_;
+
+  if(G_u32AntFlags & _ANT_FLAGS_SOFTDEVICE_ERROR)
+  {
+    return(false);
+  }
+
+  G_u32AntFlags &= ~(_ANT_FLAGS_POWER_MODE | _ANT_FLAGS_INTERACTIVE);
+  if(bEnable_)
+  {
+    G_u32AntFlags |= _ANT_FLAGS_POWER_MODE;
+    u16Period = ANT_CHANNEL_PERIOD_IDLE;
+  }
+
+  if( AntIsChannelOpen(ANT_CHANNEL_UPLOAD) )
+  {
+    sd_ant_channel_period_set(ANT_CHANNEL_UPLOAD, u16Period);
+  }
+  AntApplyEventFilter();
+  SettingsWrite(SETTINGS_KEY_ANT_POWER_MODE, &u8Enabled, sizeof(u8Enabled));
+
+  return(true);
+
+} /* end AntSetPowerMode() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AntNoteActivity
+
+Description:
+Tells the power mode that the host is interacting (a command or data arrived, or a transfer is in progress).
+
+Requires:
+  - Main loop context
+
+Promises:
+  - In power mode the upload channel is on the fast period and EVENT_TX is delivered for at least another
+    ANT_IDLE_TIMEOUT_MS
+*/
+void AntNoteActivity(void)
+{
+  Ant_u32LastActivity = SysTimeGetMs();
+
+  if( (G_u32AntFlags & _ANT_FLAGS_POWER_MODE) && !(G_u32AntFlags & _ANT_FLAGS_INTERACTIVE) )
+  {
+    G_u32AntFlags |= _ANT_FLAGS_INTERACTIVE;
+    sd_ant_channel_period_set(ANT_CHANNEL_UPLOAD, ANT_CHANNEL_PERIOD_ACTIVE);
+    AntApplyEventFilter();
+  }
+
+} /* end AntNoteActivity() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AntRequireTxEvents
+
+Description:
+Marks a channel as needing EVENT_TX even while idle (e.g. a master that loads new data every period).
+
+Requires:
+  -
+
+Promises:
+  - EVENT_TX is not filtered while any channel requires it
+*/
+void AntRequireTxEvents(u8 u8Channel_, bool bRequired_)
+{
+  if(u8Channel_ >= ANT_CHANNELS)
+  {
+    return;
+  }
+
+  if(bRequired_)
+  {
+    Ant_u8TxEventChannels |= (u8)(1 << u8Channel_);
+  }
+  else
+  {
+    Ant_u8TxEventChannels &= (u8)~(1 << u8Channel_);
+  }
+
+  AntApplyEventFilter();
+
+} /* end AntRequireTxEvents() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AntOpenScanChannel
+
+Description:
+Starts continuous scan mode on channel 0, accepting only the listed device numbers.
+
+Requires:
+  - psConfig_->u8Channel is ANT_CHANNEL_SCAN; the device number in psConfig_ is ignored
+  - No channel is open (the stack only starts scanning with all channels closed)
+  - u8IdCount_ <= ANT_ID_LIST_SIZE; 0 accepts any device with the configured device and transmission types
+
+Promises:
+  - Returns true and sets _ANT_FLAGS_SCAN_MODE if scanning; received messages include the sender's device ID
+  - On failure the channel is left unassigned
+*/
+bool AntOpenScanChannel(const AntChannelConfigType* psConfig_, const u16* pu16IdList_, u8 u8IdCount_)
+{
+  u8 au8DeviceId[ANT_EXT_MESG_DEVICE_ID_FIELD_SIZE];
+  u32 u32Result;
+  u8 i;
+
+  if( (G_u32AntFlags & _ANT_FLAGS_SOFTDEVICE_ERROR) || (psConfig_->u8Channel != ANT_CHANNEL_SCAN) ||
+      (Ant_u8OpenChannels != 0) || (u8IdCount_ > ANT_ID_LIST_SIZE) )
+  {
+    return(false);
+  }
+
+  if(sd_ant_channel_assign(ANT_CHANNEL_SCAN, CHANNEL_TYPE_SLAVE, ANT_NETWORK_NUMBER, 0) != NRF_SUCCESS)
+  {
+    return(false);
+  }
+
+  u32Result  = sd_ant_channel_id_set(ANT_CHANNEL_SCAN, 0, psConfig_->u8DeviceType, psConfig_->u8TransmissionType);
+  u32Result |= sd_ant_channel_radio_freq_set(ANT_CHANNEL_SCAN, psConfig_->u8RfFrequency);
+
+  /* ID list entries: device number LSB, MSB, device type, transmission type */
+  au8DeviceId[2] = psConfig_->u8DeviceType;
+  au8DeviceId[3] = psConfig_->u8TransmissionType;
+  for(i = 0; i < u8IdCount_; i++)
+  {
+    au8DeviceId[0] = (u8)(pu16IdList_[i] & 0xFF);
+    au8DeviceId[1] = (u8)(pu16IdList_[i] >> 8);
+    u32Result |= sd_ant_id_list_add(ANT_CHANNEL_SCAN, au8DeviceId, i);
+  }
+  u32Result |= sd_ant_id_list_config(ANT_CHANNEL_SCAN, u8IdCount_, 0);
+
+  u32Result |= sd_ant_lib_config_set(ANT_LIB_CONFIG_MESG_OUT_INC_DEVICE_ID);
+  u32Result |= sd_ant_rx_scan_mode_start(0);
+  if(u32Result != NRF_SUCCESS)
+  {
+    sd_ant_lib_config_clear(ANT_LIB_CONFIG_MESG_OUT_INC_DEVICE_ID);
+    sd_ant_channel_unassign(ANT_CHANNEL_SCAN);
+    return(false);
+  }
+
+  Ant_u8OpenChannels |= (u8)(1 << ANT_CHANNEL_SCAN);
+  G_u32AntFlags |= _ANT_FLAGS_SCAN_MODE;
+  return(true);
+
+} /* end AntOpenScanChannel() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AntOpenUploadChannel
+
+Description:
+Requests advanced burst and opens the upload channel as a master.  Called by AntInitialize() and to bring the
+channel back after channel 0 has been used for something else (scan mode).
+
+Requires:
+  - Soft device enabled
+  - Channel 0 is closed
+
+Promises:
+  - Returns true and sets _ANT_FLAGS_CHANNEL_OPEN if the channel is open
+  - Sets _ANT_FLAGS_ADV_BURST if advanced burst was accepted
+*/
+bool AntOpenUploadChannel(void)
+{
+  u8 au8AdvBurstConfig[ANT_ADV_BURST_CONFIG_SIZE] =
+  {
+    ADV_BURST_MODE_ENABLE, ANT_ADV_BURST_PACKET_SIZE, 0, 0, 0, 0, 0, 0,
+    (u8)(ANT_ADV_BURST_STALL_COUNT & 0xFF), (u8)(ANT_ADV_BURST_STALL_COUNT >> 8), ANT_ADV_BURST_RETRY_CYCLES
+  };
+  AntChannelConfigType sConfig;
+
+  /* Device number from the chip ID so boards can be told apart; 0 is the search wildcard so avoid it */
+  sConfig.u16DeviceNumber = (u16)(NRF_FICR->DEVICEID[0] & 0xFFFF);
+  if(sConfig.u16DeviceNumber == 0)
+  {
+    sConfig.u16DeviceNumber = 1;
+  }
+
+  sConfig.u8Channel          = ANT_CHANNEL_UPLOAD;
+  sConfig.u8ChannelType      = CHANNEL_TYPE_MASTER;
+  sConfig.u8DeviceType       = ANT_DEVICE_TYPE;
+  sConfig.u8TransmissionType = ANT_TRANSMISSION_TYPE;
+  sConfig.u16Period          = ANT_CHANNEL_PERIOD;
+  if(G_u32AntFlags & _ANT_FLAGS_POWER_MODE)
+  {
+    G_u32AntFlags &= ~_ANT_FLAGS_INTERACTIVE;
+    sConfig.u16Period = ANT_CHANNEL_PERIOD_IDLE;
+  }
+  sConfig.u8RfFrequency      = ANT_RF_FREQUENCY;
+
+  /* Advanced burst is optional: the host falls back to standard burst if it is not available */
+  if(sd_ant_adv_burst_config_set(au8AdvBurstConfig, ANT_ADV_BURST_CONFIG_SIZE) == NRF_SUCCESS)
+  {
+    G_u32AntFlags |= _ANT_FLAGS_ADV_BURST;
+  }
+
+  if( !AntOpenChannel(&sConfig) )
+  {
+    return(false);
+  }
+
+  G_u32AntFlags |= _ANT_FLAGS_CHANNEL_OPEN;
+  return(true);
+
+} /* end AntOpenUploadChannel() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AntInitialize
+
+Description:
+Enables the soft device and opens the upload channel.
+
+Requires:
+  - ClockSetup() has started the clocks
+  - Called once during initialization, before any application uses the radio
+  - SettingsInitialize() has run
+
+Promises:
+  - Soft device enabled and its event interrupt enabled at application low priority
+  - Upload channel open, or _ANT_FLAGS_SOFTDEVICE_ERROR / _ANT_FLAGS_CHANNEL_ERROR set
+  - RF active notifications off (AntSetRfScheduling(), command RFSCHED, turns them on)
+  - Power mode on if it was on when last set
+*/
+void AntInitialize(void)
+{
+  u8 u8PowerMode = 0;
+
+  G_u32AntFlags = 0;
+  Ant_u8OpenChannels = 0;
+  Ant_u8TxEventChannels = 0;
+  Ant_u32WakeupWindowStart = SysTimeGetMs();
+
+  if(sd_softdevice_enable(NRF_CLOCK_LFCLKSRC_SYNTH_250_PPM, softdevice_assert_callback) != NRF_SUCCESS)
+  {
+    G_u32AntFlags |= _ANT_FLAGS_SOFTDEVICE_ERROR;
+    return;
+  }
+
+  /* With the soft device running, NVIC access goes through the soft device */
+  sd_nvic_SetPriority(SD_EVT_IRQn, NRF_APP_PRIORITY_LOW);
+  sd_nvic_EnableIRQ(SD_EVT_IRQn);
+
+  if( !AntOpenUploadChannel() )
+  {
+    G_u32AntFlags |= _ANT_FLAGS_CHANNEL_ERROR;
+  }
+
+  if( (SettingsRead(SETTINGS_KEY_ANT_POWER_MODE, &u8PowerMode, sizeof(u8PowerMode)) == sizeof(u8PowerMode)) &&
+      (u8PowerMode != 0) )
+  {
+    AntSetPowerMode(true);
+  }
+
+} /* end AntInitialize() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AntUpdate
+
+Description:
+Dispatches captured events to the channel handlers.  Call every pass of the main loop.
+
+Requires:
+  - AntInitialize() has run
+
+Promises:
+  - Up to ANT_EVENT_BATCH_SIZE events are removed from the queue
+  - Each run of consecutive events for one channel is passed to that channel's handler in one call
+  - A channel that reports EVENT_CHANNEL_CLOSED is unassigned after its handler has seen the event
+  - Power mode drops to the idle period after ANT_IDLE_TIMEOUT_MS without activity
+  - The wakeup count is latched every ANT_WAKEUP_WINDOW_MS
+  - SYSTIME_SLOT_ANT is armed for the next tick while events are left in the queue
+*/
+void AntUpdate(void)
+{
+  AntEventType* psFirst;
+  fnAntChannelHandlerType pfnHandler;
+  u8 u8Tail = Ant_u8EventTail;
+  u8 u8Available;
+  u8 u8Run;
+  u8 u8Index;
+
+  u8Available = (u8)((Ant_u8EventHead - u8Tail) & ANT_EVENT_QUEUE_MASK);
+  if(u8Available > ANT_EVENT_BATCH_SIZE)
+  {
+    u8Available = ANT_EVENT_BATCH_SIZE;
+  }
+
+  while(u8Available != 0)
+  {
+    /* Extend the run while the channel matches.  Runs stop at the end of the array so the handler always gets
+    contiguous events. */
+    psFirst = &Ant_asEventQueue[u8Tail];
+    u8Run = 1;
+    while( (u8Run < u8Available) && ((u8Tail + u8Run) < ANT_EVENT_QUEUE_SIZE) &&
+           (Ant_asEventQueue[u8Tail + u8Run].u8Channel == psFirst->u8Channel) )
+    {
+      u8Run++;
+    }
+
+    if(psFirst->u8Channel < ANT_CHANNELS)
+    {
+      pfnHandler = Ant_apfnChannelHandlers[psFirst->u8Channel];
+      if(pfnHandler != NULL)
+      {
+        pfnHandler(psFirst, u8Run);
+      }
+
+      for(u8Index = 0; u8Index < u8Run; u8Index++)
+      {
+        if(psFirst[u8Index].u8Event == EVENT_CHANNEL_CLOSED)
+        {
+          sd_ant_channel_unassign(psFirst->u8Channel);
+          Ant_u8OpenChannels &= (u8)~(1 << psFirst->u8Channel);
+          if(psFirst->u8Channel == ANT_CHANNEL_UPLOAD)
+          {
+            G_u32AntFlags &= ~_ANT_FLAGS_CHANNEL_OPEN;
+          }
+          if( (psFirst->u8Channel == ANT_CHANNEL_SCAN) && (G_u32AntFlags & _ANT_FLAGS_SCAN_MODE) )
+          {
+            sd_ant_lib_config_clear(ANT_LIB_CONFIG_MESG_OUT_INC_DEVICE_ID);
+            G_u32AntFlags &= ~_ANT_FLAGS_SCAN_MODE;
+          }
+        }
+      }
+    }
+
+    /* Slots are released only after the handler is done with them */
+    u8Tail = (u8)((u8Tail + u8Run) & ANT_EVENT_QUEUE_MASK);
+    Ant_u8EventTail = u8Tail;
+    u8Available -= u8Run;
+  }
+
+  if( (G_u32AntFlags & _ANT_FLAGS_INTERACTIVE) &&
+      (SysTimeElapsed(Ant_u32LastActivity) > ANT_IDLE_TIMEOUT_MS) )
+  {
+    G_u32AntFlags &= ~_ANT_FLAGS_INTERACTIVE;
+    sd_ant_channel_period_set(ANT_CHANNEL_UPLOAD, ANT_CHANNEL_PERIOD_IDLE);
+    AntApplyEventFilter();
+  }
+
+  if( SysTimeElapsed(Ant_u32WakeupWindowStart) >= ANT_WAKEUP_WINDOW_MS )
+  {
+    Ant_u32WakeupWindowStart += ANT_WAKEUP_WINDOW_MS;
+    Ant_u32WakeupsPerMinute = Ant_u32Wakeups;
+    Ant_u32Wakeups = 0;
+    Ant_u32RfActiveWakeupsPerMinute = Ant_u32RfActiveWakeups;
+    Ant_u32RfActiveWakeups = 0;
+  }
+
+  /* A full queue takes more than one batch */
+  if(Ant_u8EventHead != Ant_u8EventTail)
+  {
+    SysTimeSlotArm(SYSTIME_SLOT_ANT, 1);
+  }
+  else
+  {
+    SysTimeSlotDisarm(SYSTIME_SLOT_ANT);
+  }
+
+} /* end AntUpdate() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AntCaptureEvents
+
+Description:
+Reads all waiting soft device events into the event queue.  Called from SD_EVT_IRQHandler.
+
+Requires:
+  - Only called from the SD_EVT interrupt (single producer)
+
+Promises:
+  - The soft device event queue is empty
+  - Each event is copied into Ant_asEventQueue with the interrupt time, or counted in Ant_u32DroppedEvents if
+    the queue is full
+  - After a burst packet has been dropped, the channel's next queued event is preceded by EVENT_TRANSFER_RX_FAILED
+  - Ant_u8MaxDepth holds the deepest the queue has been
+  - EVENT_RFACTIVE_NOTIFICATION opens a quiet window instead of being queued
+  - The interrupt is counted in Ant_u32RfActiveWakeups if it only read RF active notifications, otherwise in
+    Ant_u32Wakeups
+  - The main loop is woken if anything is queued
+*/
+void AntCaptureEvents(void)
+{
+  AntEventType* psEvent;
+  u8 u8Channel;
+  u8 u8Event;
+  u8 u8NextHead;
+  u8 u8Depth;
+  u8 u8Length;
+  u8 u8ChannelBit;
+  u32 u32TimeUs;
+  bool bRfActive = false;
+  bool bOther = false;
+
+  /* One stamp for everything read in this interrupt: it is the closest to when the radio events happened */
+  u32TimeUs = SysTimeGetUs();
+
+  while(sd_ant_event_get(&u8Channel, &u8Event, Ant_sMessage.ANT_MESSAGE_aucMessage) == NRF_SUCCESS)
+  {
+    Ant_u32EventCount++;
+
+    if(u8Event == EVENT_RFACTIVE_NOTIFICATION)
+    {
+      Ant_u32QuietStartUs = u32TimeUs;
+      Ant_bQuietWindow = true;
+      bRfActive = true;
+      continue;
+    }
+    bOther = true;
+
+    /* A channel that lost a burst packet needs a second slot for the failure report */
+    u8ChannelBit = (u8Channel < ANT_CHANNELS) ? (u8)(1 << u8Channel) : 0;
+    u8NextHead = (u8)((Ant_u8EventHead + 1) & ANT_EVENT_QUEUE_MASK);
+    if( (u8NextHead == Ant_u8EventTail) ||
+        ((Ant_u8BurstLostChannels & u8ChannelBit) &&
+         (((u8NextHead + 1) & ANT_EVENT_QUEUE_MASK) == Ant_u8EventTail)) )
+    {
+      Ant_u32DroppedEvents++;
+      if( (u8Event == EVENT_RX) && ((Ant_sMessage.ANT_MESSAGE_ucMesgID == MESG_BURST_DATA_ID) ||
+                                    (Ant_sMessage.ANT_MESSAGE_ucMesgID == MESG_ADV_BURST_DATA_ID)) )
+      {
+        Ant_u8BurstLostChannels |= u8ChannelBit;
+      }
+      continue;
+    }
+
+    if(Ant_u8BurstLostChannels & u8ChannelBit)
+    {
+      psEvent = &Ant_asEventQueue[Ant_u8EventHead];
+      psEvent->u8Channel     = u8Channel;
+      psEvent->u8Event       = EVENT_TRANSFER_RX_FAILED;
+      psEvent->u8MessageId   = MESG_RESPONSE_EVENT_ID;
+      psEvent->u8ChannelByte = u8Channel;
+      psEvent->u8Length      = 0;
+      psEvent->u32TimeUs     = u32TimeUs;
+      Ant_u8EventHead = u8NextHead;
+      Ant_u8BurstLostChannels &= (u8)~u8ChannelBit;
+      u8NextHead = (u8)((Ant_u8EventHead + 1) & ANT_EVENT_QUEUE_MASK);
+    }
+
+    psEvent = &Ant_asEventQueue[Ant_u8EventHead];
+    psEvent->u8Channel     = u8Channel;
+    psEvent->u8Event       = u8Event;
+    psEvent->u8MessageId   = Ant_sMessage.ANT_MESSAGE_ucMesgID;
+    psEvent->u8ChannelByte = Ant_sMessage.ANT_MESSAGE_ucChannel;
+
+    /* Message size counts the channel byte ahead of the payload */
+    u8Length = 0;
+    if(Ant_sMessage.ANT_MESSAGE_ucSize > MESG_CHANNEL_NUM_SIZE)
+    {
+      u8Length = Ant_sMessage.ANT_MESSAGE_ucSize - MESG_CHANNEL_NUM_SIZE;
+      if(u8Length > ANT_EVENT_PAYLOAD_SIZE)
+      {
+        u8Length = ANT_EVENT_PAYLOAD_SIZE;
+      }
+      memcpy(psEvent->au8Payload, Ant_sMessage.ANT_MESSAGE_aucPayload, u8Length);
+    }
+    psEvent->u8Length = u8Length;
+    psEvent->u32TimeUs = u32TimeUs;
+
+    Ant_u8EventHead = u8NextHead;
+
+    u8Depth = (u8)((u8NextHead - Ant_u8EventTail) & ANT_EVENT_QUEUE_MASK);
+    if(u8Depth > Ant_u8MaxDepth)
+    {
+      Ant_u8MaxDepth = u8Depth;
+    }
+  }
+
+  if(bRfActive && !bOther)
+  {
+    Ant_u32RfActiveWakeups++;
+  }
+  else
+  {
+    Ant_u32Wakeups++;
+  }
+
+  if(Ant_u8EventHead != Ant_u8EventTail)
+  {
+    SystemWakeRequest();
+  }
+
+} /* end AntCaptureEvents() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: AntApplyEventFilter
+
+Description:
+Sets the soft device event filter for the current power mode state.
+
+Requires:
+  - Soft device enabled
+
+Promises:
+  - Power mode off: nothing filtered
+  - Power mode on: ANT_FILTER_UNUSED_EVENTS filtered, plus EVENT_TX while idle if no channel requires it
+*/
+void AntApplyEventFilter(void)
+{
+  u16 u16Filter = 0;
+
+  if(G_u32AntFlags & _ANT_FLAGS_SOFTDEVICE_ERROR)
+  {
+    return;
+  }
+
+  if(G_u32AntFlags & _ANT_FLAGS_POWER_MODE)
+  {
+    u16Filter = ANT_FILTER_UNUSED_EVENTS;
+    if( !(G_u32AntFlags & _ANT_FLAGS_INTERACTIVE) && (Ant_u8TxEventChannels == 0) )
+    {
+      u16Filter |= FILTER_EVENT_TX;
+    }
+  }
+
+  sd_ant_event_filtering_set(u16Filter);
+
+} /* end AntApplyEventFilter() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
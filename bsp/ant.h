@@ -0,0 +1,164 @@
+/**********************************************************************************************************************
+File: ant.h
+
+Description:
+Header file for ant.c source.
+**********************************************************************************************************************/
+
+#ifndef __ANT_H
+#define __ANT_H
+
+/**********************************************************************************************************************
+Type Definitions
+**********************************************************************************************************************/
+#define ANT_EVENT_PAYLOAD_SIZE      (u8)24                    /* Largest payload: advanced burst packet */
+
+/* One soft device event as captured by the SD_EVT interrupt */
+typedef struct
+{
+  u8 au8Payload[ANT_EVENT_PAYLOAD_SIZE];      /* Message payload (first so it is word aligned) */
+  u8 u8Channel;                               /* Channel number from sd_ant_event_get() */
+  u8 u8Event;                                 /* Event code: EVENT_RX, EVENT_TX, EVENT_TRANSFER_RX_FAILED... */
+  u8 u8MessageId;                             /* Message ID: MESG_BROADCAST_DATA_ID, MESG_BURST_DATA_ID... */
+  u8 u8ChannelByte;                           /* Channel byte of the message (burst sequence bits at the top) */
+  u8 u8Length;                                /* Bytes used in au8Payload */
+  u32 u32TimeUs;                              /* SysTimeGetUs() when the event interrupt ran */
+} AntEventType;
+
+/* Settings for AntOpenChannel() */
+typedef struct
+{
+  u8 u8Channel;                               /* Channel number 0 to ANT_CHANNELS - 1 */
+  u8 u8ChannelType;                           /* CHANNEL_TYPE_MASTER, CHANNEL_TYPE_SLAVE_RX_ONLY... */
+  u16 u16DeviceNumber;                        /* 0 = wildcard (slaves only) */
+  u8 u8DeviceType;
+  u8 u8TransmissionType;
+  u16 u16Period;                              /* 32768 / u16Period = message rate in Hz */
+  u8 u8RfFrequency;                           /* 2400 + u8RfFrequency MHz */
+} AntChannelConfigType;
+
+/* Channel handlers receive a run of consecutive events for their channel */
+typedef void(*fnAntChannelHandlerType)(AntEventType* psEvents_, u8 u8Count_);
+
+typedef struct
+{
+  u32 u32Events;                              /* Events read from the soft device */
+  u32 u32Dropped;                             /* Events lost because the queue was full */
+  u8 u8Depth;                                 /* Events waiting now */
+  u8 u8MaxDepth;                              /* Most events ever waiting at once */
+  u32 u32WakeupsPerMinute;                    /* SD_EVT interrupts with other events in the last full minute */
+  u32 u32RfActiveWakeupsPerMinute;            /* SD_EVT interrupts with only RF active notifications, same minute */
+} AntEventStatsType;
+
+
+/**********************************************************************************************************************
+Constants / Definitions
+**********************************************************************************************************************/
+/* Upload channel: the board is the master.  The host opens a slave channel with the same ID, reads the status
+broadcast and sends commands and burst data back on the same channel. */
+#define ANT_CHANNEL_UPLOAD          (u8)0
+#define ANT_CHANNEL_SYNC            (u8)1                     /* Wand phase sync (pov_sync.c) */
+#define ANT_CHANNEL_SCAN            (u8)0                     /* Scan mode always runs on channel 0 (remote.c) */
+#define ANT_ID_LIST_SIZE            (u8)4                     /* Most entries in a channel's ID list */
+#define ANT_NETWORK_NUMBER          (u8)0                     /* Default public network */
+#define ANT_DEVICE_TYPE             (u8)0x7C
+#define ANT_TRANSMISSION_TYPE       (u8)0x01
+#define ANT_CHANNEL_PERIOD          (u16)8192                 /* 32768 / 8192 = 4 Hz status broadcast */
+
+/* Power mode (AntSetPowerMode()): the upload channel runs fast while the host is sending and slow when it is
+quiet.  The slow period is a multiple of the fast one, so a host that stays on ANT_CHANNEL_PERIOD_IDLE keeps
+tracking the board in both modes; it can move to the fast period once it has sent something. */
+#define ANT_CHANNEL_PERIOD_ACTIVE   (u16)4096                 /* 8 Hz while interactive */
+#define ANT_CHANNEL_PERIOD_IDLE     (u16)32768                /* 1 Hz while idle */
+#define ANT_IDLE_TIMEOUT_MS         (u32)5000                 /* Quiet time before dropping to the idle period */
+
+/* Events no handler uses: filtered in power mode so they do not wake the application.  EVENT_TX is also
+filtered while idle unless a channel needs it (AntRequireTxEvents()). */
+#define ANT_FILTER_UNUSED_EVENTS    (u16)(FILTER_EVENT_RX_SEARCH_TIMEOUT | FILTER_EVENT_RX_FAIL |                  \
+                                          FILTER_EVENT_TRANSFER_TX_COMPLETED | FILTER_EVENT_TRANSFER_TX_FAILED |   \
+                                          FILTER_EVENT_RX_FAIL_GO_TO_SEARCH | FILTER_EVENT_CHANNEL_COLLISION |     \
+                                          FILTER_EVENT_TRANSFER_TX_START)
+
+#define ANT_WAKEUP_WINDOW_MS        (u32)60000                /* Wakeup count interval */
+#define ANT_RF_FREQUENCY            (u8)66                    /* 2466 MHz */
+#define ANT_TX_POWER                RADIO_TX_POWER_LVL_3
+
+/* Advanced burst: 24 byte packets for the 60 kbps ceiling.  Frequency hopping is neither required nor requested. */
+#define ANT_ADV_BURST_PACKET_SIZE   ADV_BURST_MODES_SIZE_24_BYTES
+#define ANT_ADV_BURST_STALL_COUNT   (u16)3210                 /* ~10 s of stalling (3 ms per count) */
+#define ANT_ADV_BURST_RETRY_CYCLES  (u8)3                     /* 15 retries (5 per cycle) */
+#define ANT_ADV_BURST_CONFIG_SIZE   (u8)11
+
+/* Burst packets carry a sequence number and a last-packet flag in the top bits of the channel byte */
+#define ANT_BURST_CHANNEL_MASK      (u8)0x1F
+#define ANT_BURST_SEQUENCE_MASK     (u8)0x60
+#define ANT_BURST_SEQUENCE_POS      (u8)5
+#define ANT_BURST_LAST_PACKET       (u8)0x80
+
+/* Event queue: filled by the SD_EVT interrupt, drained by AntUpdate() */
+#define ANT_CHANNELS                (u8)8                     /* Channels supported by the soft device */
+#define ANT_EVENT_QUEUE_SIZE        (u8)16                    /* Power of 2; holds ANT_EVENT_QUEUE_SIZE - 1 events */
+#define ANT_EVENT_QUEUE_MASK        (u8)(ANT_EVENT_QUEUE_SIZE - 1)
+#define ANT_EVENT_BATCH_SIZE        (u8)8                     /* Most events dispatched per AntUpdate() */
+
+/* G_u32AntFlags */
+#define _ANT_FLAGS_SOFTDEVICE_ERROR (u32)0x00000001           /* Set if the soft device could not be enabled */
+#define _ANT_FLAGS_CHANNEL_ERROR    (u32)0x00000002           /* Set if the upload channel could not be opened */
+#define _ANT_FLAGS_ADV_BURST        (u32)0x00000004           /* Set if advanced burst was accepted by the stack */
+#define _ANT_FLAGS_CHANNEL_OPEN     (u32)0x00000008           /* Set while the upload channel is open */
+#define _ANT_FLAGS_RF_SCHEDULING    (u32)0x00000010           /* Set while RF active notifications are enabled */
+#define _ANT_FLAGS_POWER_MODE       (u32)0x00000020           /* Set while event filtering and period tuning are on */
+#define _ANT_FLAGS_INTERACTIVE      (u32)0x00000040           /* Power mode: upload channel is on the fast period */
+#define _ANT_FLAGS_SCAN_MODE        (u32)0x00000080           /* Set while channel 0 is scanning */
+
+/* RF active notification: the stack reports when the next radio activity is at least the threshold away.  The
+threshold covers a flash page erase so the erase never overlaps the radio. */
+#define ANT_RFACTIVE_THRESHOLD      (u16)1024                 /* 32768 counts: 31.25 ms */
+#define ANT_RFACTIVE_GUARD_US       (u32)1000                 /* Event latency and margin taken off each window */
+
+/* Channel period in microseconds: u16Period counts 1/32768 s */
+#define ANT_PERIOD_TO_US(period)    (u32)(((u32)(period) * 15625UL) >> 9)
+
+
+/**********************************************************************************************************************
+Function Declarations
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+bool AntBroadcast(u8 u8Channel_, u8* pu8Data_);
+bool AntRegisterChannelHandler(u8 u8Channel_, fnAntChannelHandlerType pfnHandler_);
+void AntGetEventStats(AntEventStatsType* psStats_);
+bool AntOpenChannel(const AntChannelConfigType* psConfig_);
+bool AntCloseChannel(u8 u8Channel_);
+bool AntIsChannelOpen(u8 u8Channel_);
+bool AntSetRfScheduling(bool bEnable_);
+u32 AntRadioQuietUs(void);
+bool AntSetPowerMode(bool bEnable_);
+void AntNoteActivity(void);
+void AntRequireTxEvents(u8 u8Channel_, bool bRequired_);
+bool AntOpenScanChannel(const AntChannelConfigType* psConfig_, const u16* pu16IdList_, u8 u8IdCount_);
+bool AntOpenUploadChannel(void);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void AntInitialize(void);
+void AntUpdate(void);
+void AntCaptureEvents(void);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void AntApplyEventFilter(void);
+
+
+#endif /* __ANT_H */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
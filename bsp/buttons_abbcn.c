@@ -0,0 +1,402 @@
+/***********************************************************************************************************************
+File: buttons_abbcn.c
+
+Description:
+Button driver that turns raw button edges into click, multi-click and long press events.
+
+Edges are caught with the GPIOTE PORT event: each button pin has its SENSE level set to the opposite of its current
+level, so any change raises DETECT and wakes the processor.  The shared GPIOTE interrupt (interrupts.c) passes the
+PORT event to ButtonPortInterrupt(), which only records the new level and a SysTimeGetUs() time stamp, so an edge is
+placed to the microsecond rather than to the last 1ms tick.  Debouncing is done from the time stamps: a new level
+is accepted once no further edge has been seen for BUTTON_DEBOUNCE_MS.  The SYSTIME_SLOT_BUTTONS deadline is only
+armed while a debounce, long press or multi-click window is pending, so idle buttons never shorten SystemSleep(); an
+edge wakes the main loop at the next tick through SystemWakeRequest().
+
+Buttons are active low (pressed = pin reads 0).
+
+------------------------------------------------------------------------------------------------------------------------
+API:
+ButtonNumberType: BUTTON0, BUTTON1, BUTTON2, BUTTON3
+
+Public:
+bool IsButtonPressed(ButtonNumberType eButton_)
+Returns true if the button is currently pressed (debounced).
+e.g. if(IsButtonPressed(BUTTON0)) ...
+
+bool ButtonGetEvent(ButtonEventType* psEvent_)
+Reads the oldest button event.  Returns false if there are none.
+Events:
+  BUTTON_EVENT_CLICK       Button pressed and released one or more times in quick succession.  u8Clicks is the
+                           number of presses (1 = single click, 2 = double click, ...).  Reported once the
+                           multi-click window closes.
+  BUTTON_EVENT_LONG_PRESS  Button held for BUTTON_LONG_PRESS_MS.  Reported while the button is still held.  The
+                           release that follows does not generate a click.
+e.g.
+  ButtonEventType sEvent;
+  while(ButtonGetEvent(&sEvent)) { ... }
+
+Protected:
+void ButtonInitialize(void)
+Configures the pins for PORT sensing and enables the GPIOTE interrupt.
+
+void ButtonUpdate(void)
+Runs debouncing and event detection.  Call every pass of the main loop.
+
+void ButtonPortInterrupt(void)
+Records button edges.  Called from GPIOTE_IRQHandler() on the PORT event.
+***********************************************************************************************************************/
+
+#include "configuration.h"
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope across entire project.
+All Global variable names shall start with "G_xxButton"
+***********************************************************************************************************************/
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* New variables (all shall start with G_xxButton*/
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* External global variables defined in other files (must indicate which file they are defined in) */
+extern volatile u32 G_u32SystemTime1ms;                /* From board-specific source file */
+extern volatile u32 G_u32SystemTime1s;                 /* From board-specific source file */
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "Button_" and be declared as static.
+***********************************************************************************************************************/
+/* Button locations: order must correspond to the order set in ButtonNumberType in the header file. */
+static const u32 Button_au32BitPositions[TOTAL_BUTTONS] = {P0_07_BUTTON0, P0_06_BUTTON1, P0_05_BUTTON2, P0_04_BUTTON3};
+static const u8 Button_au8PinIndex[TOTAL_BUTTONS] = {P0_07_INDEX, P0_06_INDEX, P0_05_INDEX, P0_04_INDEX};
+
+static volatile ButtonStatusType Button_asStatus[TOTAL_BUTTONS];  /* State of each button */
+
+static ButtonEventType Button_asEventQueue[BUTTON_EVENT_QUEUE_SIZE];  /* Events waiting to be read */
+static u8 Button_u8EventHead;                          /* Next queue slot to write */
+static u8 Button_u8EventTail;                          /* Next queue slot to read */
+
+
+/***********************************************************************************************************************
+* Function Definitions
+***********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------------------------------------------------
+Function: IsButtonPressed
+
+Description:
+Returns the debounced state of a button.
+
+Requires:
+  - eButton_ is a valid button
+
+Promises:
+  - Returns true if the button is pressed
+*/
+bool IsButtonPressed(ButtonNumberType eButton_)
+{
+  return(Button_asStatus[eButton_].bPressed);
+
+} /* end IsButtonPressed() */
+
+
+/*----------------------------------------------------------------------------------------------------------------------
+Function: ButtonGetEvent
+
+Description:
+Reads the oldest event from the button event queue.
+
+Requires:
+  - psEvent_ points to space for one event
+
+Promises:
+  - If an event is waiting, it is copied to *psEvent_, removed from the queue and true is returned
+  - Returns false if the queue is empty
+*/
+bool ButtonGetEvent(ButtonEventType* psEvent_)
+{
+  if(Button_u8EventTail == Button_u8EventHead)
+  {
+    return(false);
+  }
+
+  *psEvent_ = Button_asEventQueue[Button_u8EventTail];
+  Button_u8EventTail = (Button_u8EventTail + 1) & BUTTON_EVENT_QUEUE_MASK;
+
+  return(true);
+
+} /* end ButtonGetEvent() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------------------------------------------------
+Function: ButtonInitialize
+
+Description:
+Sets up the buttons for edge detection through the GPIOTE PORT event.
+
+Requires:
+  - GpioSetup() has configured the button pins as connected inputs
+  - System time is running
+
+Promises:
+  - Each button's SENSE level is set opposite to its current level
+  - GPIOTE PORT interrupt is enabled (the shared GPIOTE_IRQHandler() passes it to ButtonPortInterrupt())
+  - Event queue is empty
+*/
+void ButtonInitialize(void)
+{
+  u32 u32PortLevels = NRF_GPIO->IN;
+  bool bPressed;
+
+  for(u8 i = 0; i < TOTAL_BUTTONS; i++)
+  {
+    bPressed = ((u32PortLevels & Button_au32BitPositions[i]) == 0);
+
+    Button_asStatus[i].bRawPressed   = bPressed;
+    Button_asStatus[i].bPressed      = bPressed;
+    Button_asStatus[i].bLongReported = true;     /* A button held through reset does not count as a long press */
+    Button_asStatus[i].u8Clicks      = 0;
+    Button_asStatus[i].u32EdgeTimeUs = SysTimeGetUs();
+
+    ButtonSetSense((ButtonNumberType)i, bPressed);
+  }
+
+  Button_u8EventHead = 0;
+  Button_u8EventTail = 0;
+
+  /* Enable the PORT event interrupt */
+  NRF_GPIOTE->EVENTS_PORT = 0;
+  NRF_GPIOTE->INTENSET = GPIOTE_INTENSET_PORT_Msk;
+  NVIC_SetPriority(GPIOTE_IRQn, INTERRUPTS_GPIOTE_PRIORITY);
+  NVIC_EnableIRQ(GPIOTE_IRQn);
+
+} /* end ButtonInitialize() */
+
+
+/*----------------------------------------------------------------------------------------------------------------------
+Function: ButtonUpdate
+
+Description:
+Debounces the edges recorded by ButtonPortInterrupt() and generates button events.  The windows are timed in
+microseconds from the edge time stamps.  Only does work while a button
+has something pending; otherwise it returns quickly and leaves SYSTIME_SLOT_BUTTONS disarmed.
+
+Requires:
+  - ButtonInitialize() has run
+
+Promises:
+  - Debounced button states are updated
+  - Click, multi-click and long press events are queued
+  - SYSTIME_SLOT_BUTTONS is armed for the next time this function has work to do, or disarmed if nothing is
+    pending
+*/
+void ButtonUpdate(void)
+{
+  volatile ButtonStatusType* psButton;
+  u32 u32NowUs = SysTimeGetUs();
+  u32 u32NextWakeUs = SYSTIME_NO_DEADLINE;
+  u32 u32ElapsedUs;
+  bool bRawPressed;
+  u32 u32EdgeTimeUs;
+
+  for(u8 i = 0; i < TOTAL_BUTTONS; i++)
+  {
+    psButton = &Button_asStatus[i];
+
+    /* Read the level before the time stamp: if an edge lands in between, the new time stamp just delays
+    acceptance of the stale level until the next pass */
+    bRawPressed = psButton->bRawPressed;
+    u32EdgeTimeUs = psButton->u32EdgeTimeUs;
+
+    /* Debounce: accept a new level once it has been stable for BUTTON_DEBOUNCE_MS */
+    if(bRawPressed != psButton->bPressed)
+    {
+      u32ElapsedUs = u32NowUs - u32EdgeTimeUs;
+      if(u32ElapsedUs >= BUTTON_DEBOUNCE_US)
+      {
+        psButton->bPressed = bRawPressed;
+        if(bRawPressed)
+        {
+          psButton->u32PressTimeUs = u32EdgeTimeUs;
+          psButton->bLongReported  = false;
+        }
+        else
+        {
+          psButton->u32ReleaseTimeUs = u32EdgeTimeUs;
+          if(!psButton->bLongReported)
+          {
+            psButton->u8Clicks++;
+          }
+        }
+      }
+      else if((BUTTON_DEBOUNCE_US - u32ElapsedUs) < u32NextWakeUs)
+      {
+        u32NextWakeUs = BUTTON_DEBOUNCE_US - u32ElapsedUs;
+      }
+    }
+
+    /* Long press is reported as soon as the hold time is reached */
+    if(psButton->bPressed && !psButton->bLongReported)
+    {
+      u32ElapsedUs = u32NowUs - psButton->u32PressTimeUs;
+      if(u32ElapsedUs >= BUTTON_LONG_PRESS_US)
+      {
+        ButtonQueueEvent((ButtonNumberType)i, BUTTON_EVENT_LONG_PRESS, 0);
+        psButton->bLongReported = true;
+        psButton->u8Clicks = 0;
+      }
+      else if((BUTTON_LONG_PRESS_US - u32ElapsedUs) < u32NextWakeUs)
+      {
+        u32NextWakeUs = BUTTON_LONG_PRESS_US - u32ElapsedUs;
+      }
+    }
+
+    /* Clicks are reported when no new press starts within the multi-click window */
+    if(!psButton->bPressed && (psButton->u8Clicks != 0))
+    {
+      u32ElapsedUs = u32NowUs - psButton->u32ReleaseTimeUs;
+      if(u32ElapsedUs >= BUTTON_MULTI_CLICK_US)
+      {
+        ButtonQueueEvent((ButtonNumberType)i, BUTTON_EVENT_CLICK, psButton->u8Clicks);
+        psButton->u8Clicks = 0;
+      }
+      else if((BUTTON_MULTI_CLICK_US - u32ElapsedUs) < u32NextWakeUs)
+      {
+        u32NextWakeUs = BUTTON_MULTI_CLICK_US - u32ElapsedUs;
+      }
+    }
+  }
+
+  /* The deadline slots count whole ticks: round up so the window has closed when ButtonUpdate() runs again */
+  if(u32NextWakeUs == SYSTIME_NO_DEADLINE)
+  {
+    SysTimeSlotDisarm(SYSTIME_SLOT_BUTTONS);
+  }
+  else
+  {
+    SysTimeSlotArm(SYSTIME_SLOT_BUTTONS, (u32NextWakeUs + BUTTON_US_PER_MS - 1) / BUTTON_US_PER_MS);
+  }
+
+} /* end ButtonUpdate() */
+
+
+/*----------------------------------------------------------------------------------------------------------------------
+Function: ButtonPortInterrupt
+
+Description:
+Records button edges.  Called from GPIOTE_IRQHandler() on the PORT event.  Kept short: only the new level and a
+time stamp are saved.
+
+Requires:
+  - Interrupt context
+  - Button pins have SENSE set opposite to their last recorded level
+
+Promises:
+  - EVENTS_PORT is cleared
+  - Any button whose level changed has bRawPressed and u32EdgeTimeUs (SysTimeGetUs()) updated
+  - SENSE of every button is set opposite to its current level so the next edge raises another PORT event
+  - The main loop is woken
+*/
+void ButtonPortInterrupt(void)
+{
+  u32 u32PortLevels;
+  u32 u32NowUs;
+  bool bPressed;
+
+  NRF_GPIOTE->EVENTS_PORT = 0;
+  u32PortLevels = NRF_GPIO->IN;
+  u32NowUs = SysTimeGetUs();
+
+  for(u8 i = 0; i < TOTAL_BUTTONS; i++)
+  {
+    bPressed = ((u32PortLevels & Button_au32BitPositions[i]) == 0);
+    if(bPressed != Button_asStatus[i].bRawPressed)
+    {
+      Button_asStatus[i].u32EdgeTimeUs = u32NowUs;
+      Button_asStatus[i].bRawPressed = bPressed;
+    }
+
+    ButtonSetSense((ButtonNumberType)i, bPressed);
+  }
+
+  /* ButtonUpdate() starts the debounce on the next tick */
+  SystemWakeRequest();
+
+} /* end ButtonPortInterrupt() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*----------------------------------------------------------------------------------------------------------------------
+Function: ButtonSetSense
+
+Description:
+Points a button pin's SENSE level at the next expected edge.
+
+Requires:
+  - eButton_ is a valid button
+
+Promises:
+  - SENSE is High if the button is pressed (waiting for release), Low if released (waiting for press)
+*/
+void ButtonSetSense(ButtonNumberType eButton_, bool bPressed_)
+{
+  u32 u32Config = NRF_GPIO->PIN_CNF[Button_au8PinIndex[eButton_]] & ~GPIO_PIN_CNF_SENSE_Msk;
+
+  if(bPressed_)
+  {
+    u32Config |= (GPIO_PIN_CNF_SENSE_High << GPIO_PIN_CNF_SENSE_Pos);
+  }
+  else
+  {
+    u32Config |= (GPIO_PIN_CNF_SENSE_Low << GPIO_PIN_CNF_SENSE_Pos);
+  }
+
+  NRF_GPIO->PIN_CNF[Button_au8PinIndex[eButton_]] = u32Config;
+
+} /* end ButtonSetSense() */
+
+
+/*----------------------------------------------------------------------------------------------------------------------
+Function: ButtonQueueEvent
+
+Description:
+Adds an event to the button event queue.
+
+Requires:
+  - Called only from ButtonUpdate() (single writer)
+
+Promises:
+  - Event is queued; if the queue is full the event is dropped
+*/
+void ButtonQueueEvent(ButtonNumberType eButton_, ButtonEventKindType eEvent_, u8 u8Clicks_)
+{
+  u8 u8NextHead = (Button_u8EventHead + 1) & BUTTON_EVENT_QUEUE_MASK;
+
+  if(u8NextHead == Button_u8EventTail)
+  {
+    return;
+  }
+
+  Button_asEventQueue[Button_u8EventHead].eButton  = eButton_;
+  Button_asEventQueue[Button_u8EventHead].eEvent   = eEvent_;
+  Button_asEventQueue[Button_u8EventHead].u8Clicks = u8Clicks_;
+  Button_u8EventHead = u8NextHead;
+
+} /* end ButtonQueueEvent() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,78 @@
+/***********************************************************************************************************************
+File: buttons_abbcn.h
+
+Description:
+Header file for buttons_abbcn.c
+***********************************************************************************************************************/
+
+#ifndef __BUTTONS_H
+#define __BUTTONS_H
+
+/***********************************************************************************************************************
+Type Definitions
+***********************************************************************************************************************/
+typedef enum {BUTTON0 = 0, BUTTON1, BUTTON2, BUTTON3} ButtonNumberType;
+
+typedef enum {BUTTON_EVENT_CLICK = 0, BUTTON_EVENT_LONG_PRESS} ButtonEventKindType;
+
+typedef struct
+{
+  ButtonNumberType eButton;                   /* Button that generated the event */
+  ButtonEventKindType eEvent;                 /* What happened */
+  u8 u8Clicks;                                /* BUTTON_EVENT_CLICK: number of clicks in the group (2 = double click) */
+} ButtonEventType;
+
+typedef struct
+{
+  bool bRawPressed;                           /* Pressed state at the last edge (written by the GPIOTE ISR) */
+  u32 u32EdgeTimeUs;                          /* SysTimeGetUs() of the last edge (written by the GPIOTE ISR) */
+  bool bPressed;                              /* Debounced pressed state */
+  bool bLongReported;                         /* Long press already reported for this press */
+  u8 u8Clicks;                                /* Clicks counted in the current multi-click window */
+  u32 u32PressTimeUs;                         /* SysTimeGetUs() of the debounced press */
+  u32 u32ReleaseTimeUs;                       /* SysTimeGetUs() of the debounced release */
+} ButtonStatusType;
+
+
+/***********************************************************************************************************************
+* Constants
+***********************************************************************************************************************/
+#define TOTAL_BUTTONS               (u8)4           /* Total number of buttons in the system */
+
+#define BUTTON_DEBOUNCE_MS          (u32)25         /* Level must be stable this long after an edge */
+#define BUTTON_LONG_PRESS_MS        (u32)800        /* Hold time for BUTTON_EVENT_LONG_PRESS */
+#define BUTTON_MULTI_CLICK_MS       (u32)300        /* Max time from a release to the next press in a multi-click */
+
+/* The same windows against the microsecond edge time stamps */
+#define BUTTON_US_PER_MS            (u32)1000
+#define BUTTON_DEBOUNCE_US          (u32)(BUTTON_DEBOUNCE_MS * BUTTON_US_PER_MS)
+#define BUTTON_LONG_PRESS_US        (u32)(BUTTON_LONG_PRESS_MS * BUTTON_US_PER_MS)
+#define BUTTON_MULTI_CLICK_US       (u32)(BUTTON_MULTI_CLICK_MS * BUTTON_US_PER_MS)
+
+#define BUTTON_EVENT_QUEUE_SIZE     (u8)8           /* Events held until read by ButtonGetEvent() (power of 2) */
+#define BUTTON_EVENT_QUEUE_MASK     (u8)(BUTTON_EVENT_QUEUE_SIZE - 1)
+
+
+/***********************************************************************************************************************
+* Function Declarations
+***********************************************************************************************************************/
+/* Public Functions */
+bool IsButtonPressed(ButtonNumberType eButton_);
+bool ButtonGetEvent(ButtonEventType* psEvent_);
+
+/* Protected Functions */
+void ButtonInitialize(void);
+void ButtonUpdate(void);
+void ButtonPortInterrupt(void);
+
+/* Private Functions */
+void ButtonSetSense(ButtonNumberType eButton_, bool bPressed_);
+void ButtonQueueEvent(ButtonNumberType eButton_, ButtonEventKindType eEvent_, u8 u8Clicks_);
+
+
+#endif /* __BUTTONS_H */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File */
+/*--------------------------------------------------------------------------------------------------------------------*/
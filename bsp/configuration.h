@@ -45,6 +45,7 @@ Includes
 #include "nrf.h"
 #include "nrf_assert.h"
 #include "nrf_delay.h"
+#include "nrf_nvmc.h"
 #include "nrf_error.h"
 #include "nrf_soc.h"
 #include "nrf_sdm.h"
@@ -53,6 +54,7 @@ Includes
 #include "ant_parameters.h"
 #include "ant_error.h"
 #include "app_error.h"
+#include "crc16.h"
 //#include "appconfig.h"
 //#include "boardconfig.h"
 //#include "command.h"
@@ -67,6 +69,12 @@ Includes
 #include "main.h"
 #include "typedefs.h"
 #include "utilities.h"
+#include "system_time.h"
+#include "settings.h"
+#include "image_writer.h"
+#include "aes_ctr.h"
+#include "ant.h"
+#include "soc_integration.h"
 #include "i2c_master.h"
 #include "lcd_bitmaps.h"
 
@@ -74,15 +82,25 @@ Includes
 
 /* Driver header files */
 #include "leds_abbcn.h" 
+#include "buttons_abbcn.h"
+#include "accelerometer_lis2dh.h"
 
 /* Application header files */
+#include "command.h"
+#include "image_upload.h"
+#include "pov.h"
+#include "pov_image.h"
+#include "pov_sync.h"
+#include "remote.h"
 
 
 /**********************************************************************************************************************
 !!!!! External device peripheral assignments
 ***********************************************************************************************************************/
-#define TWI_MASTER_CONFIG_CLOCK_PIN_NUMBER  P0_16_INDEX
-#define TWI_MASTER_CONFIG_DATA_PIN_NUMBER   P0_15_INDEX
+#define TWI_MASTER_CONFIG_CLOCK_PIN_NUMBER  P0_21_INDEX     /* LIS2DH accelerometer I2C */
+#define TWI_MASTER_CONFIG_DATA_PIN_NUMBER   P0_22_INDEX
+#define ACCEL_INT1_PIN_NUMBER               P0_23_INDEX
+#define ACCEL_INT2_PIN_NUMBER               P0_24_INDEX     /* Tap (click) interrupt */
 
 
 #endif /* __CONFIG_H */
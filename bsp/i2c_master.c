@@ -1,9 +1,16 @@
 /**********************************************************************************************************************
-File: i2c_master.c                                                                
+File: i2c_master.c
 
 Description:
-SPI master implementation using SPI master perihperal but not
-Nordic SDK.
+I2C master on the TWI1 peripheral, register level (not the Nordic SDK driver).  Transfers are blocking and meant
+for the main loop: a 7 byte register read takes about 200 us at 400 kHz.
+
+Reads use the TWI shortcuts: BB_SUSPEND holds SCL low after each byte until it has been read, and BB_STOP is set
+for the last byte so the stop condition follows it without software timing.
+
+Every wait for an event is bounded by I2C_MASTER_BYTE_TIMEOUT_US.  On an error or timeout the peripheral is
+powered off and on again (nRF51 PAN 56: the TWI can lock up), the bus is cleared and the transfer fails; the
+caller decides whether to retry.
 **********************************************************************************************************************/
 
 #include "configuration.h"
@@ -28,7 +35,7 @@ extern volatile u32 G_u32SystemTime1s;                 /* From board-specific so
 Global variable definitions with scope limited to this local application.
 Variable names shall start with "I2cMaster_" and be declared as static.
 ***********************************************************************************************************************/
-static u32 I2cMaster_u32Timeout;                      /* Timeout counter used across states */
+static u32 I2cMaster_u32Errors;                        /* Transfers that failed (NACK, bus error or timeout) */
 
 
 /**********************************************************************************************************************
@@ -40,17 +47,152 @@ Function Definitions
 /*--------------------------------------------------------------------------------------------------------------------*/
 
 /*--------------------------------------------------------------------------------------------------------------------
-Function: I2cMasterTxByte
+Function: I2cMasterWrite
+
+Description:
+Writes bytes to a slave: start, address, data, stop.
+
+Requires:
+  - u8Address_ is the 7-bit slave address
+  - pu8Data_ points to u8Length_ > 0 bytes (usually a register address followed by its data)
+  - Main loop context; blocks for the transfer
+
+Promises:
+  - Returns true if every byte was acknowledged and the stop condition was sent
+  - Returns false on a NACK, bus error or timeout; the peripheral is recovered and ready for the next transfer
+*/
+bool I2cMasterWrite(u8 u8Address_, const u8* pu8Data_, u8 u8Length_)
+{
+  if(u8Length_ == 0)
+  {
+    return(false);
+  }
+
+  I2C_MASTER_TWI->ADDRESS = u8Address_;
+  I2C_MASTER_TWI->SHORTS = 0;
+  I2C_MASTER_TWI->EVENTS_TXDSENT = 0;
+  I2C_MASTER_TWI->EVENTS_STOPPED = 0;
+  I2C_MASTER_TWI->EVENTS_ERROR = 0;
+
+  I2C_MASTER_TWI->TXD = *pu8Data_++;
+  I2C_MASTER_TWI->TASKS_STARTTX = 1;
+
+  while(u8Length_ != 0)
+  {
+    if( !I2cMasterWaitEvent(&I2C_MASTER_TWI->EVENTS_TXDSENT) )
+    {
+      I2cMasterRecover();
+      return(false);
+    }
+
+    u8Length_--;
+    if(u8Length_ != 0)
+    {
+      I2C_MASTER_TWI->TXD = *pu8Data_++;
+    }
+  }
+
+  return( I2cMasterStop() );
+
+} /* end I2cMasterWrite() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: I2cMasterWriteRead
+
+Description:
+Reads bytes from a slave register: start, address + write, register, repeated start, address + read, data, stop.
+
+Requires:
+  - u8Address_ is the 7-bit slave address
+  - u8Register_ is the register to start from (including any auto-increment bit the slave needs)
+  - pu8Data_ points to space for u8Length_ > 0 bytes
+  - Main loop context; blocks for the transfer
+
+Promises:
+  - Returns true and fills pu8Data_ if the whole transfer completed
+  - Returns false on a NACK, bus error or timeout; the peripheral is recovered and ready for the next transfer
+*/
+bool I2cMasterWriteRead(u8 u8Address_, u8 u8Register_, u8* pu8Data_, u8 u8Length_)
+{
+  if(u8Length_ == 0)
+  {
+    return(false);
+  }
+
+  I2C_MASTER_TWI->ADDRESS = u8Address_;
+  I2C_MASTER_TWI->SHORTS = 0;
+  I2C_MASTER_TWI->EVENTS_TXDSENT = 0;
+  I2C_MASTER_TWI->EVENTS_RXDREADY = 0;
+  I2C_MASTER_TWI->EVENTS_STOPPED = 0;
+  I2C_MASTER_TWI->EVENTS_ERROR = 0;
+
+  /* Register address, no stop */
+  I2C_MASTER_TWI->TXD = u8Register_;
+  I2C_MASTER_TWI->TASKS_STARTTX = 1;
+  if( !I2cMasterWaitEvent(&I2C_MASTER_TWI->EVENTS_TXDSENT) )
+  {
+    I2cMasterRecover();
+    return(false);
+  }
+
+  /* Repeated start into the read.  The shortcut decides what follows each byte: suspend until it is read, or stop
+  after the last one. */
+  I2C_MASTER_TWI->SHORTS = (u8Length_ == 1) ? TWI_SHORTS_BB_STOP_Msk : TWI_SHORTS_BB_SUSPEND_Msk;
+  I2C_MASTER_TWI->TASKS_STARTRX = 1;
+
+  while(u8Length_ != 0)
+  {
+    if( !I2cMasterWaitEvent(&I2C_MASTER_TWI->EVENTS_RXDREADY) )
+    {
+      I2cMasterRecover();
+      return(false);
+    }
+
+    *pu8Data_++ = (u8)I2C_MASTER_TWI->RXD;
+    u8Length_--;
+
+    if(u8Length_ != 0)
+    {
+      if(u8Length_ == 1)
+      {
+        I2C_MASTER_TWI->SHORTS = TWI_SHORTS_BB_STOP_Msk;
+      }
+      I2C_MASTER_TWI->TASKS_RESUME = 1;
+    }
+  }
+
+  /* BB_STOP has already started the stop condition */
+  if( !I2cMasterWaitEvent(&I2C_MASTER_TWI->EVENTS_STOPPED) )
+  {
+    I2cMasterRecover();
+    return(false);
+  }
+
+  I2C_MASTER_TWI->SHORTS = 0;
+  return(true);
+
+} /* end I2cMasterWriteRead() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: I2cMasterGetErrors
 
 Description:
-Sends one byte of data to the slave.
+Reports how many transfers have failed.
 
 Requires:
-  - 
+  -
 
 Promises:
-  - Returns TRUE if slave ACKs sent byte
+  - Returns the count of failed transfers since start up
 */
+u32 I2cMasterGetErrors(void)
+{
+  return(I2cMaster_u32Errors);
+
+} /* end I2cMasterGetErrors() */
+
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -61,37 +203,22 @@ Promises:
 Function: I2cMasterInitialize
 
 Description:
-Initializes the State Machine and its variables.
+Clears the bus and sets up the TWI peripheral.
 
 Requires:
-  -
+  - GpioSetup() has configured the SCL and SDA pins (input connected, S0D1)
+  - Uses nrf_delay_us() only, so it may run before the system time base
 
 Promises:
-  - 
+  - TWI1 enabled on TWI_MASTER_CONFIG_CLOCK_PIN_NUMBER / TWI_MASTER_CONFIG_DATA_PIN_NUMBER at I2C_MASTER_FREQUENCY
+  - _I2C_MASTER_FLAGS_BUS_STUCK set if a slave still holds SDA low
 */
 void I2cMasterInitialize(void)
 {
-#if 0
-  /* Set up IC-specific GPIO */
-  NRF_GPIO->PIN_CNF[ANT_SPI_MOSI_BIT] = P0_13_ANT_SPI_MOSI_CNF;
-  NRF_GPIO->PIN_CNF[ANT_SPI_MISO_BIT] = P0_12_ANT_SPI_MISO_CNF;
-  NRF_GPIO->PIN_CNF[ANT_SPI_SCK_BIT]  = P0_11_ANT_SPI_SCK_CNF;
-  NRF_GPIO->PIN_CNF[ANT_SEN_BIT]      = P0_10_ANT_SEN_CNF;
-
-  NRF_SPI0->PSELMOSI = P0_13_ANT_SPI_MOSI_INDEX;
-  NRF_SPI0->PSELMISO = P0_12_ANT_SPI_MISO_INDEX;  
-  NRF_SPI0->PSELSCK  = P0_11_ANT_SPI_SCK_INDEX;
-
-  /* Set up SPI Master peripheral */
-  NRF_SPI0->FREQUENCY = SPI_FREQUENCY_FREQUENCY_M1 << SPI_FREQUENCY_FREQUENCY_Pos;
-  NRF_SPI0->CONFIG   = (SPI_CONFIG_ORDER_MsbFirst << SPI_CONFIG_ORDER_Pos | \
-                        SPI_CONFIG_CPHA_Leading   << SPI_CONFIG_CPHA_Pos  | \
-                        SPI_CONFIG_CPOL_ActiveLow << SPI_CONFIG_CPOL_Pos );
-#endif
-  /* Configure SPI driver */
-  
-  
-  /* Activate SPI peripheral */
+  G_u32I2cMasterFlags = 0;
+  I2cMaster_u32Errors = 0;
+
+  I2cMasterEnable();
 
 } /* end I2cMasterInitialize() */
 
@@ -101,6 +228,169 @@ void I2cMasterInitialize(void)
 /* Private functions                                                                                                  */
 /*--------------------------------------------------------------------------------------------------------------------*/
 
+/*--------------------------------------------------------------------------------------------------------------------
+Function: I2cMasterWaitEvent
+
+Description:
+Waits for a TWI event, watching for errors and the byte timeout.
+
+Requires:
+  - pu32Event_ is one of the I2C_MASTER_TWI event registers
+
+Promises:
+  - Returns true with the event cleared if it occurred
+  - Returns false on EVENTS_ERROR or after I2C_MASTER_BYTE_TIMEOUT_US
+*/
+bool I2cMasterWaitEvent(volatile uint32_t* pu32Event_)
+{
+  u32 u32StartUs = SysTimeGetUs();
+
+  while(*pu32Event_ == 0)
+  {
+    if( I2C_MASTER_TWI->EVENTS_ERROR ||
+        ((SysTimeGetUs() - u32StartUs) > I2C_MASTER_BYTE_TIMEOUT_US) )
+    {
+      return(false);
+    }
+  }
+
+  *pu32Event_ = 0;
+  return(true);
+
+} /* end I2cMasterWaitEvent() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: I2cMasterStop
+
+Description:
+Sends the stop condition after a write.
+
+Requires:
+  - The last byte has been sent
+
+Promises:
+  - Returns true once EVENTS_STOPPED arrives; otherwise recovers the peripheral and returns false
+*/
+bool I2cMasterStop(void)
+{
+  I2C_MASTER_TWI->TASKS_STOP = 1;
+  if( !I2cMasterWaitEvent(&I2C_MASTER_TWI->EVENTS_STOPPED) )
+  {
+    I2cMasterRecover();
+    return(false);
+  }
+
+  return(true);
+
+} /* end I2cMasterStop() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: I2cMasterRecover
+
+Description:
+Resets the TWI after a failed transfer (nRF51 PAN 56: power cycling is the only way out of a lock-up).
+
+Requires:
+  - A transfer has failed
+
+Promises:
+  - I2cMaster_u32Errors counted
+  - TWI powered off and on and enabled again
+*/
+void I2cMasterRecover(void)
+{
+  I2cMaster_u32Errors++;
+
+  I2C_MASTER_TWI->EVENTS_ERROR = 0;
+  I2C_MASTER_TWI->ERRORSRC = I2C_MASTER_TWI->ERRORSRC;
+  I2C_MASTER_TWI->ENABLE = TWI_ENABLE_ENABLE_Disabled << TWI_ENABLE_ENABLE_Pos;
+  I2C_MASTER_TWI->POWER = 0;
+  nrf_delay_us(5);
+  I2C_MASTER_TWI->POWER = 1;
+
+  I2cMasterEnable();
+
+} /* end I2cMasterRecover() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: I2cMasterEnable
+
+Description:
+Clears the bus and enables the TWI on the accelerometer pins.
+
+Requires:
+  - TWI disabled
+
+Promises:
+  - TWI1 enabled on TWI_MASTER_CONFIG_CLOCK_PIN_NUMBER / TWI_MASTER_CONFIG_DATA_PIN_NUMBER at I2C_MASTER_FREQUENCY
+*/
+void I2cMasterEnable(void)
+{
+  I2cMasterClearBus();
+
+  I2C_MASTER_TWI->PSELSCL   = TWI_MASTER_CONFIG_CLOCK_PIN_NUMBER;
+  I2C_MASTER_TWI->PSELSDA   = TWI_MASTER_CONFIG_DATA_PIN_NUMBER;
+  I2C_MASTER_TWI->FREQUENCY = I2C_MASTER_FREQUENCY << TWI_FREQUENCY_FREQUENCY_Pos;
+  I2C_MASTER_TWI->SHORTS    = 0;
+  I2C_MASTER_TWI->ENABLE    = TWI_ENABLE_ENABLE_Enabled << TWI_ENABLE_ENABLE_Pos;
+
+} /* end I2cMasterEnable() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: I2cMasterClearBus
+
+Description:
+Frees a slave that was interrupted part way through a byte and is holding SDA low: clocks SCL until SDA is
+released, then sends a stop condition.
+
+Requires:
+  - TWI disabled so the pins are under GPIO control
+  - SCL and SDA pins are open drain (S0D1) with pull-ups
+
+Promises:
+  - Both lines released high if the bus could be cleared; _I2C_MASTER_FLAGS_BUS_STUCK set otherwise
+*/
+void I2cMasterClearBus(void)
+{
+  u32 u32Scl = 1UL << TWI_MASTER_CONFIG_CLOCK_PIN_NUMBER;
+  u32 u32Sda = 1UL << TWI_MASTER_CONFIG_DATA_PIN_NUMBER;
+
+  NRF_GPIO->OUTSET = u32Scl | u32Sda;
+  NRF_GPIO->DIRSET = u32Scl | u32Sda;
+  nrf_delay_us(I2C_MASTER_CLEAR_DELAY_US);
+
+  for(u8 i = 0; (i < I2C_MASTER_CLEAR_PULSES) && !(NRF_GPIO->IN & u32Sda); i++)
+  {
+    NRF_GPIO->OUTCLR = u32Scl;
+    nrf_delay_us(I2C_MASTER_CLEAR_DELAY_US);
+    NRF_GPIO->OUTSET = u32Scl;
+    nrf_delay_us(I2C_MASTER_CLEAR_DELAY_US);
+  }
+
+  /* Stop condition: SDA rises while SCL is high */
+  NRF_GPIO->OUTCLR = u32Sda;
+  nrf_delay_us(I2C_MASTER_CLEAR_DELAY_US);
+  NRF_GPIO->OUTSET = u32Sda;
+  nrf_delay_us(I2C_MASTER_CLEAR_DELAY_US);
+
+  if(NRF_GPIO->IN & u32Sda)
+  {
+    G_u32I2cMasterFlags &= ~_I2C_MASTER_FLAGS_BUS_STUCK;
+  }
+  else
+  {
+    G_u32I2cMasterFlags |= _I2C_MASTER_FLAGS_BUS_STUCK;
+  }
+
+  /* Hand the pins back to the TWI as inputs */
+  NRF_GPIO->DIRCLR = u32Scl | u32Sda;
+
+} /* end I2cMasterClearBus() */
+
 
 
 
@@ -1,5 +1,5 @@
 /**********************************************************************************************************************
-File: i2c_master.h                                                                
+File: i2c_master.h
 
 Description:
 Header file for i2c_master.c source.
@@ -16,48 +16,16 @@ Type Definitions
 /**********************************************************************************************************************
 Constants / Definitions
 **********************************************************************************************************************/
-#define I2C_MASTER_INIT (u32)0x
-/*
-    31 [0] 
-    30 [0] 
-    29 [0] 
-    28 [0] 
-
-    27 [0] 
-    26 [0] 
-    25 [0] 
-    24 [0] 
-
-    23 [0] 
-    22 [0] 
-    21 [0] 
-    20 [0] 
-
-    19 [0] 
-    18 [0] 
-    17 [0] 
-    16 [0] 
-
-    15 [0] 
-    14 [0] 
-    13 [0] 
-    12 [0] 
-
-    11 [0] 
-    10 [0] 
-    09 [0] 
-    08 [0] 
-
-    07 [0] 
-    06 [0] 
-    05 [0] 
-    04 [0] 
-
-    03 [0] 
-    02 [0] 
-    01 [0] 
-    00 [0] 
-*/
+#define I2C_MASTER_TWI              NRF_TWI1                  /* TWI0 shares its registers with SPI0 */
+#define I2C_MASTER_FREQUENCY        TWI_FREQUENCY_FREQUENCY_K400
+
+/* Each byte takes 22.5 us at 400 kHz; a byte that has not moved in this time means a stuck bus or peripheral */
+#define I2C_MASTER_BYTE_TIMEOUT_US  (u32)500
+#define I2C_MASTER_CLEAR_PULSES     (u8)9                     /* SCL pulses to free a slave holding SDA low */
+#define I2C_MASTER_CLEAR_DELAY_US   (u32)4                    /* Half SCL period while clearing the bus */
+
+/* G_u32I2cMasterFlags */
+#define _I2C_MASTER_FLAGS_BUS_STUCK (u32)0x00000001           /* SDA still low after clearing the bus */
 
 
 /**********************************************************************************************************************
@@ -67,6 +35,9 @@ Function Declarations
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* Public functions                                                                                                   */
 /*--------------------------------------------------------------------------------------------------------------------*/
+bool I2cMasterWrite(u8 u8Address_, const u8* pu8Data_, u8 u8Length_);
+bool I2cMasterWriteRead(u8 u8Address_, u8 u8Register_, u8* pu8Data_, u8 u8Length_);
+u32 I2cMasterGetErrors(void);
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -78,7 +49,11 @@ void I2cMasterInitialize(void);
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* Private functions                                                                                                  */
 /*--------------------------------------------------------------------------------------------------------------------*/
-
+bool I2cMasterWaitEvent(volatile uint32_t* pu32Event_);
+bool I2cMasterStop(void);
+void I2cMasterRecover(void);
+void I2cMasterEnable(void);
+void I2cMasterClearBus(void);
 
 
 #endif /* __I2C_MASTER_H */
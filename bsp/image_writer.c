@@ -0,0 +1,527 @@
+/**********************************************************************************************************************
+File: image_writer.c
+
+Description:
+Streams image data (e.g. POV artwork received over the radio) into the image area of flash.
+
+nrf_nvmc_write_bytes() toggles the NVMC CONFIG register and waits for READY around every single byte.  This writer
+instead packs incoming bytes into words and programs them in bursts of up to IMAGE_WRITER_CHUNK_WORDS with one
+CONFIG toggle per burst, so throughput is set by the NVMC word write time.
+
+Page erases are only done from ImageWriterUpdate() in the main loop, ahead of the write pointer, so data
+arriving at the start of a new page usually finds it already erased.  ImageWriterWrite() takes no more than the
+erased space left (ImageWriterGetRoom()); the sender holds the rest until the next page has been erased.  The main
+loop also reads back what has been written a piece at a time and keeps a CRC16 of the flash contents.  When the
+last chunk arrives, most of the image has already been verified.
+
+The CPU stops while the NVMC is busy: a page erase takes IMAGE_PAGE_ERASE_US, longer than a column.  While the
+POV columns are running (_POV_FLAGS_LOCKED) an erase waits until the next column alarm is at least that far away,
+which is the dark part of a revolution or stroke, so no column is frozen or smeared.  An image that fills the whole
+revolution has no such gap and the upload waits for the wand to stop.  A word burst is only as long as fits before
+the next column alarm (SysTimeAlarmSlackUs()).  Words that do not fit wait in ImageWriter_au32Pending, which
+ImageWriterUpdate() programs on later passes; nothing spins waiting for a gap, and ImageWriterGetRoom() counts the
+buffer so the sender holds data while it is full.  With RF scheduling on (_ANT_FLAGS_RF_SCHEDULING) erase-ahead
+also waits for a radio quiet window, unless the write pointer has caught up with it.
+
+Usage:
+  ImageWriterStart(IMAGE_FLASH_START, u32ImageSize);
+  ImageWriterWrite(pu8Chunk, u16ChunkSize);         (repeat as data arrives, up to ImageWriterGetRoom() at a time)
+  ImageWriterFinish(u16SenderCrc);
+  ImageWriterGetStatus() becomes IMAGE_WRITER_COMPLETE or IMAGE_WRITER_ERROR once verification is done.
+**********************************************************************************************************************/
+
+#include "configuration.h"
+
+/***********************************************************************************************************************
+Global variable definitions with scope across entire project.
+All Global variable names shall start with "G_"
+***********************************************************************************************************************/
+/* New variables */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Existing variables (defined in other files -- should all contain the "extern" keyword) */
+extern volatile u32 G_u32SystemFlags;                  /* From main.c */
+
+extern volatile u32 G_u32SystemTime1ms;                /* From board-specific source file */
+extern volatile u32 G_u32SystemTime1s;                 /* From board-specific source file */
+
+extern volatile u32 G_u32AntFlags;                     /* From ant.c */
+extern u32 G_u32PovFlags;                              /* From pov.c */
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "ImageWriter_" and be declared as static.
+***********************************************************************************************************************/
+static ImageWriterStatusType ImageWriter_eStatus;      /* Current writer state */
+
+static u32 ImageWriter_u32StartAddress;                /* First flash address of the image */
+static u32 ImageWriter_u32ImageEnd;                    /* Address after the last image byte */
+static u32 ImageWriter_u32FlashEnd;                    /* ImageWriter_u32ImageEnd rounded up to a whole word */
+static u32 ImageWriter_u32WriteAddress;                /* Next flash word to program */
+static u32 ImageWriter_u32ErasedTo;                    /* Pages below this address are erased and ready */
+static u32 ImageWriter_u32VerifyAddress;               /* Next flash byte to read back for the CRC */
+
+static u32 ImageWriter_au32Pending[IMAGE_WRITER_PENDING_WORDS]; /* Words from ImageWriter_u32WriteAddress on */
+static u8 ImageWriter_u8PendingWords;                  /* Words in ImageWriter_au32Pending */
+static u32 ImageWriter_u32PartialWord;                 /* Bytes waiting to complete a word */
+static u8 ImageWriter_u8PartialBytes;                  /* Number of bytes in ImageWriter_u32PartialWord */
+
+static u16 ImageWriter_u16StreamCrc;                   /* CRC16 of all bytes passed to ImageWriterWrite() */
+static u16 ImageWriter_u16FlashCrc;                    /* CRC16 of the bytes read back from flash */
+static u16 ImageWriter_u16ExpectedCrc;                 /* CRC16 given to ImageWriterFinish() */
+
+
+/**********************************************************************************************************************
+Function Definitions
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageWriterStart
+
+Description:
+Begins a new image write.  ImageWriterUpdate() erases the first page when the columns allow it.
+
+Requires:
+  - u32Address_ is page aligned and the image fits between IMAGE_FLASH_START and IMAGE_FLASH_END
+  - No image is currently being written (call ImageWriterAbort() first if needed)
+
+Promises:
+  - Returns true and enters IMAGE_WRITER_WRITING if the request is valid
+  - Returns false otherwise
+*/
+bool ImageWriterStart(u32 u32Address_, u32 u32Size_)
+{
+  if( (ImageWriter_eStatus == IMAGE_WRITER_WRITING) || (ImageWriter_eStatus == IMAGE_WRITER_VERIFYING) ||
+      (u32Address_ & (IMAGE_PAGE_SIZE - 1)) || (u32Address_ < IMAGE_FLASH_START) ||
+      (u32Size_ == 0) || (u32Size_ > (IMAGE_FLASH_END - u32Address_)) )
+  {
+    return(false);
+  }
+
+  ImageWriter_u32StartAddress  = u32Address_;
+  ImageWriter_u32ImageEnd      = u32Address_ + u32Size_;
+  ImageWriter_u32FlashEnd      = (ImageWriter_u32ImageEnd + 3) & ~(u32)0x03;
+  ImageWriter_u32WriteAddress  = u32Address_;
+  ImageWriter_u32VerifyAddress = u32Address_;
+  ImageWriter_u8PendingWords   = 0;
+  ImageWriter_u32PartialWord   = 0;
+  ImageWriter_u8PartialBytes   = 0;
+  ImageWriter_u16StreamCrc     = 0xFFFF;
+  ImageWriter_u16FlashCrc      = 0xFFFF;
+  ImageWriter_u32ErasedTo      = u32Address_;
+
+  ImageWriter_eStatus = IMAGE_WRITER_WRITING;
+  return(true);
+
+} /* end ImageWriterStart() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageWriterWrite
+
+Description:
+Adds the next piece of the image.  Any length and alignment is accepted; bytes are packed into words and
+programmed in bursts.
+
+Requires:
+  - ImageWriterStart() succeeded
+
+Promises:
+  - Complete words are programmed as far as the time to the next column allows (ImageWriterFlushPending()); the
+    rest wait for ImageWriterUpdate(), and up to 3 trailing bytes are held until the next call
+  - Returns false and writes nothing if u16Length_ is more than ImageWriterGetRoom()
+  - Returns false and enters IMAGE_WRITER_ERROR if the data runs past the size given to ImageWriterStart()
+*/
+bool ImageWriterWrite(const u8* pu8Data_, u16 u16Length_)
+{
+  u32 u32Taken;
+
+  if( (ImageWriter_eStatus != IMAGE_WRITER_WRITING) || (u16Length_ > ImageWriterGetRoom()) )
+  {
+    return(false);
+  }
+
+  u32Taken = ImageWriter_u32WriteAddress + ((u32)ImageWriter_u8PendingWords << 2) + ImageWriter_u8PartialBytes;
+  if( (u32Taken + u16Length_) > ImageWriter_u32ImageEnd )
+  {
+    ImageWriter_eStatus = IMAGE_WRITER_ERROR;
+    return(false);
+  }
+
+  ImageWriter_u16StreamCrc = crc16_compute(pu8Data_, u16Length_, &ImageWriter_u16StreamCrc);
+
+  while(u16Length_--)
+  {
+    /* Little endian: first byte goes in the low bits */
+    ImageWriter_u32PartialWord |= (u32)(*pu8Data_++) << (ImageWriter_u8PartialBytes << 3);
+
+    if(++ImageWriter_u8PartialBytes == 4)
+    {
+      ImageWriter_au32Pending[ImageWriter_u8PendingWords++] = ImageWriter_u32PartialWord;
+      ImageWriter_u32PartialWord = 0;
+      ImageWriter_u8PartialBytes = 0;
+    }
+  }
+
+  ImageWriterFlushPending();
+  return(true);
+
+} /* end ImageWriterWrite() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageWriterFinish
+
+Description:
+Ends the image write.  Any trailing bytes are padded with 0xFF, then the words still waiting for a gap and the
+rest of the read-back verification are done from ImageWriterUpdate().
+
+Requires:
+  - All image bytes have been passed to ImageWriterWrite()
+  - u16ExpectedCrc_ is the CRC16 (crc16_compute, initial value 0xFFFF) of the whole image from the sender
+
+Promises:
+  - Enters IMAGE_WRITER_VERIFYING and returns true if the full image was received
+  - Returns false and enters IMAGE_WRITER_ERROR otherwise
+*/
+bool ImageWriterFinish(u16 u16ExpectedCrc_)
+{
+  u32 u32LastWord;
+
+  if(ImageWriter_eStatus != IMAGE_WRITER_WRITING)
+  {
+    return(false);
+  }
+
+  /* ImageWriterGetRoom() kept a word free for the partial bytes */
+  if(ImageWriter_u8PartialBytes != 0)
+  {
+    u32LastWord = ImageWriter_u32PartialWord | (0xFFFFFFFF << (ImageWriter_u8PartialBytes << 3));
+    ImageWriter_au32Pending[ImageWriter_u8PendingWords++] = u32LastWord;
+    ImageWriter_u8PartialBytes = 0;
+  }
+
+  if( (ImageWriter_u32WriteAddress + ((u32)ImageWriter_u8PendingWords << 2)) != ImageWriter_u32FlashEnd )
+  {
+    ImageWriter_eStatus = IMAGE_WRITER_ERROR;
+    return(false);
+  }
+
+  ImageWriterFlushPending();
+  ImageWriter_u16ExpectedCrc = u16ExpectedCrc_;
+  ImageWriter_eStatus = IMAGE_WRITER_VERIFYING;
+  return(true);
+
+} /* end ImageWriterFinish() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageWriterAbort
+
+Description:
+Abandons the current image write.  Flash contents written so far are left as they are.
+
+Requires:
+  -
+
+Promises:
+  - Writer returns to IMAGE_WRITER_IDLE
+*/
+void ImageWriterAbort(void)
+{
+  ImageWriter_eStatus = IMAGE_WRITER_IDLE;
+
+} /* end ImageWriterAbort() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageWriterGetStatus
+
+Description:
+Returns the writer state.
+
+Requires:
+  -
+
+Promises:
+  - Returns ImageWriter_eStatus
+*/
+ImageWriterStatusType ImageWriterGetStatus(void)
+{
+  return(ImageWriter_eStatus);
+
+} /* end ImageWriterGetStatus() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageWriterGetBytesWritten
+
+Description:
+Returns the number of bytes programmed so far, e.g. to acknowledge progress to the sender.
+
+Requires:
+  -
+
+Promises:
+  - Returns the bytes programmed since ImageWriterStart() (whole words only)
+*/
+u32 ImageWriterGetBytesWritten(void)
+{
+  return(ImageWriter_u32WriteAddress - ImageWriter_u32StartAddress);
+
+} /* end ImageWriterGetBytesWritten() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageWriterGetRoom
+
+Description:
+Returns how many bytes ImageWriterWrite() can take now without a page erase or a column gap.
+
+Requires:
+  -
+
+Promises:
+  - Returns the erased space ahead of the data already given, limited to the space left in
+    ImageWriter_au32Pending, or 0 if no image is being written
+*/
+u32 ImageWriterGetRoom(void)
+{
+  u32 u32Room;
+  u32 u32Buffer;
+
+  if(ImageWriter_eStatus != IMAGE_WRITER_WRITING)
+  {
+    return(0);
+  }
+
+  u32Room = ImageWriter_u32ErasedTo - ImageWriter_u32WriteAddress - ((u32)ImageWriter_u8PendingWords << 2) -
+            ImageWriter_u8PartialBytes;
+  u32Buffer = ((u32)(IMAGE_WRITER_PENDING_WORDS - ImageWriter_u8PendingWords) << 2) - ImageWriter_u8PartialBytes;
+  if(u32Buffer < u32Room)
+  {
+    u32Room = u32Buffer;
+  }
+
+  return(u32Room);
+
+} /* end ImageWriterGetRoom() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageWriterInitialize
+
+Description:
+Initializes the image writer.
+
+Requires:
+  -
+
+Promises:
+  - Writer is IMAGE_WRITER_IDLE
+*/
+void ImageWriterInitialize(void)
+{
+  ImageWriter_eStatus = IMAGE_WRITER_IDLE;
+
+} /* end ImageWriterInitialize() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageWriterUpdate
+
+Description:
+Background work for an image write.  Call every pass of the main loop.  Each call does at most one page erase and
+reads back at most IMAGE_WRITER_VERIFY_BYTES bytes.
+
+Requires:
+  -
+
+Promises:
+  - Words waiting for a gap are programmed as far as the time to the next column allows
+  - While writing, the page after the one holding the data taken is erased before it is needed, only where the
+    columns can spare IMAGE_PAGE_ERASE_US (and inside a radio quiet window when RF scheduling is on, unless the
+    write pointer has caught up)
+  - Flash that has been written is read back into the running flash CRC
+  - SYSTIME_SLOT_IMAGE_WRITER is armed for the next tick while writing or verifying
+  - At the end of verification, status becomes IMAGE_WRITER_COMPLETE if the flash CRC, the CRC of the received
+    data and the expected CRC all match, otherwise IMAGE_WRITER_ERROR
+*/
+void ImageWriterUpdate(void)
+{
+  u32 u32Taken;
+
+  if( (ImageWriter_eStatus != IMAGE_WRITER_WRITING) && (ImageWriter_eStatus != IMAGE_WRITER_VERIFYING) )
+  {
+    SysTimeSlotDisarm(SYSTIME_SLOT_IMAGE_WRITER);
+    return;
+  }
+
+  /* Pending words, erase-ahead and verification move one step per pass */
+  SysTimeSlotArm(SYSTIME_SLOT_IMAGE_WRITER, 1);
+  ImageWriterFlushPending();
+
+  /* Erase ahead: once the data taken enters the last erased page, erase the next one */
+  u32Taken = ImageWriter_u32WriteAddress + ((u32)ImageWriter_u8PendingWords << 2);
+  if( (ImageWriter_eStatus == IMAGE_WRITER_WRITING) &&
+      (ImageWriter_u32ErasedTo < ImageWriter_u32FlashEnd) &&
+      ((ImageWriter_u32ErasedTo - u32Taken) < IMAGE_PAGE_SIZE) &&
+      (ImageWriterGapUs() >= IMAGE_PAGE_ERASE_US) &&
+      ( !(G_u32AntFlags & _ANT_FLAGS_RF_SCHEDULING) || (ImageWriterGetRoom() == 0) ||
+        (AntRadioQuietUs() >= IMAGE_PAGE_ERASE_US) ) )
+  {
+    nrf_nvmc_page_erase(ImageWriter_u32ErasedTo);
+    ImageWriter_u32ErasedTo += IMAGE_PAGE_SIZE;
+    return;
+  }
+
+  ImageWriterVerifyStep();
+
+  if( (ImageWriter_eStatus == IMAGE_WRITER_VERIFYING) &&
+      (ImageWriter_u32VerifyAddress == ImageWriter_u32ImageEnd) )
+  {
+    if( (ImageWriter_u16FlashCrc == ImageWriter_u16StreamCrc) &&
+        (ImageWriter_u16StreamCrc == ImageWriter_u16ExpectedCrc) )
+    {
+      ImageWriter_eStatus = IMAGE_WRITER_COMPLETE;
+    }
+    else
+    {
+      ImageWriter_eStatus = IMAGE_WRITER_ERROR;
+    }
+  }
+
+} /* end ImageWriterUpdate() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageWriterFlushPending
+
+Description:
+Programs the words waiting in ImageWriter_au32Pending, in bursts that finish before the next column alarm.  Pages
+are never erased here: ImageWriterWrite() only takes data that fits in erased flash.
+
+Requires:
+  - The pending words lie below ImageWriter_u32ErasedTo (ImageWriterGetRoom() saw to it)
+
+Promises:
+  - Bursts of up to IMAGE_WRITER_CHUNK_WORDS are programmed, one CONFIG enable and disable each, while the gap to
+    the next column holds at least one word; the write pointer advances
+  - Words that do not fit stay pending for the next call; it never waits
+*/
+void ImageWriterFlushPending(void)
+{
+  u32 u32Gap;
+  u8 u8Count;
+
+  while(ImageWriter_u8PendingWords != 0)
+  {
+    u8Count = ImageWriter_u8PendingWords;
+    if(u8Count > IMAGE_WRITER_CHUNK_WORDS)
+    {
+      u8Count = IMAGE_WRITER_CHUNK_WORDS;
+    }
+
+    /* The CPU stops for the burst: no longer than the time to the next column */
+    u32Gap = ImageWriterGapUs();
+    if(u32Gap < ((u32)u8Count * IMAGE_WORD_WRITE_US))
+    {
+      u8Count = (u8)(u32Gap / IMAGE_WORD_WRITE_US);
+      if(u8Count == 0)
+      {
+        return;
+      }
+    }
+
+    nrf_nvmc_write_words(ImageWriter_u32WriteAddress, (const uint32_t*)ImageWriter_au32Pending, u8Count);
+    ImageWriter_u32WriteAddress += (u32)u8Count << 2;
+    ImageWriter_u8PendingWords -= u8Count;
+    memmove(ImageWriter_au32Pending, &ImageWriter_au32Pending[u8Count], (u32)ImageWriter_u8PendingWords << 2);
+  }
+
+} /* end ImageWriterFlushPending() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageWriterVerifyStep
+
+Description:
+Reads back the next piece of programmed flash into the flash CRC.
+
+Requires:
+  -
+
+Promises:
+  - Up to IMAGE_WRITER_VERIFY_BYTES bytes between the verify pointer and the write pointer (limited to the image
+    size so the 0xFF padding is excluded) are added to ImageWriter_u16FlashCrc
+*/
+void ImageWriterVerifyStep(void)
+{
+  u32 u32Limit = ImageWriter_u32WriteAddress;
+  u32 u32Count;
+
+  if(u32Limit > ImageWriter_u32ImageEnd)
+  {
+    u32Limit = ImageWriter_u32ImageEnd;
+  }
+
+  u32Count = u32Limit - ImageWriter_u32VerifyAddress;
+  if(u32Count > IMAGE_WRITER_VERIFY_BYTES)
+  {
+    u32Count = IMAGE_WRITER_VERIFY_BYTES;
+  }
+
+  if(u32Count != 0)
+  {
+    ImageWriter_u16FlashCrc = crc16_compute((const u8*)(uintptr_t)ImageWriter_u32VerifyAddress, u32Count,
+                                            &ImageWriter_u16FlashCrc);
+    ImageWriter_u32VerifyAddress += u32Count;
+  }
+
+} /* end ImageWriterVerifyStep() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: ImageWriterGapUs
+
+Description:
+Returns how long flash work can stop the CPU now without holding up a POV column.
+
+Requires:
+  -
+
+Promises:
+  - Returns SYSTIME_NO_DEADLINE if the columns are not running, otherwise the time to the next column alarm (long
+    in the dark part of a revolution or stroke)
+*/
+u32 ImageWriterGapUs(void)
+{
+  if( !(G_u32PovFlags & _POV_FLAGS_LOCKED) )
+  {
+    return(SYSTIME_NO_DEADLINE);
+  }
+
+  return( SysTimeAlarmSlackUs() );
+
+} /* end ImageWriterGapUs() */
+
+
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
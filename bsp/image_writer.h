@@ -0,0 +1,73 @@
+/**********************************************************************************************************************
+File: image_writer.h
+
+Description:
+Header file for image_writer.c source.
+**********************************************************************************************************************/
+
+#ifndef __IMAGE_WRITER_H
+#define __IMAGE_WRITER_H
+
+/**********************************************************************************************************************
+Type Definitions
+**********************************************************************************************************************/
+typedef enum {IMAGE_WRITER_IDLE = 0, IMAGE_WRITER_WRITING, IMAGE_WRITER_VERIFYING,
+              IMAGE_WRITER_COMPLETE, IMAGE_WRITER_ERROR} ImageWriterStatusType;
+
+
+/**********************************************************************************************************************
+Constants / Definitions
+**********************************************************************************************************************/
+/* Flash area for images: from IMAGE_FLASH_START up to the settings pages.  The linker file must keep code
+out of this area (see nRF51422_QFAA.icf). */
+#define IMAGE_FLASH_START           (u32)0x00030000
+#define IMAGE_FLASH_END             SETTINGS_PAGE0_ADDRESS
+#define IMAGE_PAGE_SIZE             (u32)1024                 /* nRF51 flash page size in bytes */
+
+#define IMAGE_WRITER_CHUNK_WORDS    (u8)16                    /* Most words in one NVMC write burst */
+#define IMAGE_WRITER_PENDING_WORDS  (u8)64                    /* Words held while no column gap fits a burst */
+#define IMAGE_WRITER_VERIFY_BYTES   (u16)256                  /* Bytes read back and checked per ImageWriterUpdate() */
+
+/* Worst case NVMC times from the nRF51 product specification, used to fit flash work around the radio and
+LED columns (the CPU stops while the NVMC is busy) */
+#define IMAGE_PAGE_ERASE_US         (u32)22300
+#define IMAGE_WORD_WRITE_US         (u32)47
+
+
+/**********************************************************************************************************************
+Function Declarations
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+bool ImageWriterStart(u32 u32Address_, u32 u32Size_);
+bool ImageWriterWrite(const u8* pu8Data_, u16 u16Length_);
+bool ImageWriterFinish(u16 u16ExpectedCrc_);
+void ImageWriterAbort(void);
+ImageWriterStatusType ImageWriterGetStatus(void);
+u32 ImageWriterGetBytesWritten(void);
+u32 ImageWriterGetRoom(void);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void ImageWriterInitialize(void);
+void ImageWriterUpdate(void);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void ImageWriterFlushPending(void);
+void ImageWriterVerifyStep(void);
+u32 ImageWriterGapUs(void);
+
+
+#endif /* __IMAGE_WRITER_H */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -79,6 +79,34 @@ void TIMER1_IRQHandler(void)
 }
 
 
+/*--------------------------------------------------------------------------------------------------------------------
+Interrupt handler: GPIOTE_IRQHandler
+
+Description:
+Shared by every driver with a GPIOTE event: each event goes to the driver that owns it, which clears it.
+
+Requires:
+  - GPIOTE_IRQn enabled at INTERRUPTS_GPIOTE_PRIORITY by the drivers that use it
+
+Promises:
+  - The PORT event (button edges) is passed to ButtonPortInterrupt()
+  - The ACCEL_TAP_GPIOTE_CHANNEL IN event (accelerometer INT2) is passed to AccelTapInterrupt()
+*/
+void GPIOTE_IRQHandler(void)
+{
+  if(NRF_GPIOTE->EVENTS_IN[ACCEL_TAP_GPIOTE_CHANNEL])
+  {
+    AccelTapInterrupt();
+  }
+
+  if(NRF_GPIOTE->EVENTS_PORT)
+  {
+    ButtonPortInterrupt();
+  }
+
+} /* end GPIOTE_IRQHandler() */
+
+
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
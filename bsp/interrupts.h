@@ -17,6 +17,8 @@ Type Definitions
 Constants / Definitions
 **********************************************************************************************************************/
 #define INTERRUPTS_INIT (u32)0x
+
+#define INTERRUPTS_GPIOTE_PRIORITY  (u8)3           /* Shared GPIOTE interrupt (application low) */
 /*
     31 [0] 
     30 [0] 
@@ -73,6 +75,7 @@ Function Declarations
 /* Protected functions                                                                                                */
 /*--------------------------------------------------------------------------------------------------------------------*/
 void InterruptsInitialize(void);
+void GPIOTE_IRQHandler(void);
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
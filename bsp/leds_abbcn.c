@@ -31,16 +31,30 @@ Toggle the specified LED.  LED response is immediate.
 e.g. LedToggle(BLUE);
 
 void LedPWM(LedNumberType eLED_, LedRateType ePwmRate_)
-Sets up an LED for PWM mode.  PWM mode requries the main loop to be running at 1ms period.
+Sets up an LED for PWM mode.  PWM mode requries the main loop to be running at 1ms period.  Each LED's period
+starts at its own phase (LED_PWM_PHASE) of a shared tick count, so turn on edges are spread across the period
+instead of all LEDs switching on together.  This covers LedPWM() only: the POV columns (pov.c) write the LED pins
+directly in bit planes, and their peak current is held by the per-plane governor there.
 e.g. LedPWM(BLUE, LED_PWM_5);
 
 void LedBlink(LedNumberType eLED_, LedRateType eBlinkRate_)
 Sets an LED to BLINK mode.  BLINK mode requries the main loop to be running at 1ms period.
 e.g. LedBlink(BLUE, LED_1HZ);
 
+void LedPlayAnimation(const LedAnimationType* psAnimation_)
+Plays a keyframe animation from a flash table.  Keyframes change in LedUpdate() from the 1ms tick, so nothing
+waits.  G_sLedBootAnimation and G_sLedIdleAnimation are built in.
+e.g. LedPlayAnimation(&G_sLedIdleAnimation);
+
+void LedStopAnimation(void)
+Stops the animation, leaving the LEDs as they are.
+
+bool LedIsAnimating(void)
+Returns true while an animation is playing.
+
 Protected:
 void LedInitialize(void)
-Test all LEDs and initialize to OFF state.
+Turns all LEDs off and starts the boot animation, which runs into the idle color cycle.
 
 DISCLAIMER: THIS CODE IS PROVIDED WITHOUT ANY WARRANTY OR GUARANTEES.  USERS MAY
 USE THIS CODE FOR DEVELOPMENT AND EXAMPLE PURPOSES ONLY.  ENGENUICS TECHNOLOGIES
@@ -57,6 +71,7 @@ All Global variable names shall start with "G_xxLed"
 ***********************************************************************************************************************/
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* New variables (all shall start with G_xxLed*/
+/* G_sLedBootAnimation and G_sLedIdleAnimation are defined after their keyframe tables below */
 
 
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -92,6 +107,55 @@ static LedConfigType Leds_asLedArray[TOTAL_LEDS] =
  {LED_NORMAL_MODE, LED_PWM_100, LED_PWM_100, LED_PWM_DUTY_HIGH, LED_ACTIVE_HIGH}, /* MGRN       */
  {LED_NORMAL_MODE, LED_PWM_100, LED_PWM_100, LED_PWM_DUTY_HIGH, LED_ACTIVE_HIGH}, /* MBLU       */
 };   
+
+/* PWM period start of each LED in ticks of Led_u8PwmTick, in LedNumberType order */
+static const u8 Led_au8PwmPhase[TOTAL_LEDS] =
+{
+  LED_PWM_PHASE(ARED), LED_PWM_PHASE(AGRN), LED_PWM_PHASE(ABLU), LED_PWM_PHASE(DRED),
+  LED_PWM_PHASE(DGRN), LED_PWM_PHASE(DBLU), LED_PWM_PHASE(YRED), LED_PWM_PHASE(YGRN),
+  LED_PWM_PHASE(YBLU), LED_PWM_PHASE(MRED), LED_PWM_PHASE(MGRN), LED_PWM_PHASE(MBLU)
+};
+static u8 Led_u8PwmTick;                               /* Position in the shared PWM period (0 to LED_PWM_PERIOD - 1) */
+
+/* Animation in progress */
+static const LedAnimationType* Led_psAnimation;        /* NULL when no animation is playing */
+static u8 Led_u8Frame;                                 /* Keyframe on display */
+static u32 Led_u32FrameStart;                          /* SysTimeGetMs() when the keyframe was due */
+
+/* Boot: each color wipes on group by group, holds, and wipes back off */
+#define LED_WIPE(color)                                                                                      \
+  {LED_GROUPS(color, 1), LED_ANIMATION_STEP_MS}, {LED_GROUPS(color, 2), LED_ANIMATION_STEP_MS},            \
+  {LED_GROUPS(color, 3), LED_ANIMATION_STEP_MS}, {LED_GROUPS(color, 4), LED_ANIMATION_HOLD_MS},            \
+  {LED_GROUPS(color, 3), LED_ANIMATION_STEP_MS}, {LED_GROUPS(color, 2), LED_ANIMATION_STEP_MS},            \
+  {LED_GROUPS(color, 1), LED_ANIMATION_STEP_MS}, {0, LED_ANIMATION_STEP_MS}
+
+static const LedKeyframeType Led_asBootFrames[] =
+{
+  LED_WIPE(LED_MASK_RED),
+  LED_WIPE(LED_MASK_RED | LED_MASK_GRN),
+  LED_WIPE(LED_MASK_GRN),
+  LED_WIPE(LED_MASK_GRN | LED_MASK_BLU),
+  LED_WIPE(LED_MASK_BLU),
+  LED_WIPE(LED_MASK_BLU | LED_MASK_RED),
+  LED_WIPE(LED_MASK_RED | LED_MASK_GRN | LED_MASK_BLU)
+};
+
+/* Idle: all groups step through the colors */
+static const LedKeyframeType Led_asIdleFrames[] =
+{
+  {LED_GROUPS(LED_MASK_RED, 4),                LED_ANIMATION_IDLE_MS},
+  {LED_GROUPS(LED_MASK_RED | LED_MASK_GRN, 4), LED_ANIMATION_IDLE_MS},
+  {LED_GROUPS(LED_MASK_GRN, 4),                LED_ANIMATION_IDLE_MS},
+  {LED_GROUPS(LED_MASK_GRN | LED_MASK_BLU, 4), LED_ANIMATION_IDLE_MS},
+  {LED_GROUPS(LED_MASK_BLU, 4),                LED_ANIMATION_IDLE_MS},
+  {LED_GROUPS(LED_MASK_BLU | LED_MASK_RED, 4), LED_ANIMATION_IDLE_MS}
+};
+
+/* Built in animations: boot runs into the idle cycle, which loops */
+const LedAnimationType G_sLedIdleAnimation = {Led_asIdleFrames, (u8)(sizeof(Led_asIdleFrames) / sizeof(LedKeyframeType)),
+                                              &G_sLedIdleAnimation};
+const LedAnimationType G_sLedBootAnimation = {Led_asBootFrames, (u8)(sizeof(Led_asBootFrames) / sizeof(LedKeyframeType)),
+                                              &G_sLedIdleAnimation};
  
 
 /***********************************************************************************************************************
@@ -205,13 +269,34 @@ Requires:
 
 Promises:
   - Requested LED is set to PWM mode at the duty cycle specified
+  - The LED joins its period part way through: on for the first ePwmRate_ ticks after its phase, off for the rest
 */
 void LedPWM(LedNumberType eLED_, LedRateType ePwmRate_)
 {
+  u8 u8Position;
+
+  /* Ticks since this LED's period started */
+  u8Position = Led_u8PwmTick + LED_PWM_PERIOD - Led_au8PwmPhase[eLED_];
+  if(u8Position >= LED_PWM_PERIOD)
+  {
+    u8Position -= LED_PWM_PERIOD;
+  }
+
+  if(u8Position < (u8)ePwmRate_)
+  {
+    LedOn(eLED_);
+    Leds_asLedArray[(u8)eLED_].u16Count = (u16)ePwmRate_ - u8Position;
+    Leds_asLedArray[(u8)eLED_].eCurrentDuty = LED_PWM_DUTY_HIGH;
+  }
+  else
+  {
+    LedOff(eLED_);
+    Leds_asLedArray[(u8)eLED_].u16Count = LED_PWM_PERIOD - u8Position;
+    Leds_asLedArray[(u8)eLED_].eCurrentDuty = LED_PWM_DUTY_LOW;
+  }
+
 	Leds_asLedArray[(u8)eLED_].eMode = LED_PWM_MODE;
 	Leds_asLedArray[(u8)eLED_].eRate = ePwmRate_;
-	Leds_asLedArray[(u8)eLED_].u16Count = (u16)ePwmRate_;
-  Leds_asLedArray[(u8)eLED_].eCurrentDuty = LED_PWM_DUTY_HIGH;
 
 } /* end LedPWM() */
 
@@ -239,391 +324,91 @@ void LedBlink(LedNumberType eLED_, LedRateType eBlinkRate_)
 } /* end LedBlink() */
 
 
-/*--------------------------------------------------------------------------------------------------------------------*/
-/* Protected functions */
-/*--------------------------------------------------------------------------------------------------------------------*/
-
 /*----------------------------------------------------------------------------------------------------------------------
-Function: LedInitialize
+Function: LedPlayAnimation
 
 Description:
-Initialization of LED system paramters and visual LED check.
+Starts a keyframe animation.
 
 Requires:
-  - G_u32SystemTime1ms ticking
-  - All LEDs already initialized to LED_NORMAL_MODE mode ON
+  - psAnimation_ points to an animation in flash with at least one keyframe
+  - LedUpdate() called every 1ms
 
 Promises:
-  - All LEDs in LED_NORMAL_MODE mode with OFF
+  - The first keyframe is shown now; the rest follow from LedUpdate()
+  - Any animation already playing is replaced
 */
-void LedInitialize(void)
+void LedPlayAnimation(const LedAnimationType* psAnimation_)
 {
-  u32 u32Timer;
-  LedNumberType aeLedSequence[] = {ARED};
-
-  /* Static Display of all colors */
-  LedOn(ARED);
-  LedOff(AGRN);
-  LedOn(ABLU);
-  
-  LedOn(DRED);
-  LedOff(DGRN);
-  LedOff(DBLU);
-
-  LedOff(YRED);
-  LedOn(YGRN);
-  LedOff(YBLU);
-
-  LedOff(MRED);
-  LedOff(MGRN);
-  LedOn(MBLU);
-  
-  while(1);
-  /* end of static display */
-
-  
-  while(1)
-#if 0
-  {
-    /* Sequentially light up a specific color of LEDs */
-    for(u8 k = 0; k < 3; k++)
-    {
-      for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-      {
-        LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * k)]);
-        for(u32 j = 0; j < 200000; j++);
-      }
-      
-      /* Pause for show */
-      for(u32 i = 0; i < 500000; i++);
-
-      /* Turn off the current LEDs */
-      for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-      {
-        LedOff(aeLedSequence[i + (8 * k)]);
-      }
-    }
-#endif
-
-#if 0 /* one-way sequence */
-  {
-    /* Red */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 0)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
-
-    /* Pause for show */
-    for(u32 i = 0; i < PAUSE_TIME; i++);
-
-    /* All off */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOff(aeLedSequence[i + (8 * 0)]);
-      LedOff(aeLedSequence[i + (8 * 1)]);
-      LedOff(aeLedSequence[i + (8 * 2)]);
-    }
-
-    /* Yellow */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 0)]);
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 1)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
-
-    /* Pause for show */
-    for(u32 i = 0; i < PAUSE_TIME; i++);
-
-    /* All off */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOff(aeLedSequence[i + (8 * 0)]);
-      LedOff(aeLedSequence[i + (8 * 1)]);
-      LedOff(aeLedSequence[i + (8 * 2)]);
-    }
-
-    /* Green */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 1)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
-
-    /* Pause for show */
-    for(u32 i = 0; i < PAUSE_TIME; i++);
-
-    /* All off */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOff(aeLedSequence[i + (8 * 0)]);
-      LedOff(aeLedSequence[i + (8 * 1)]);
-      LedOff(aeLedSequence[i + (8 * 2)]);
-    }
-
-    /* Cyan */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 1)]);
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 2)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
-
-    /* Pause for show */
-    for(u32 i = 0; i < PAUSE_TIME; i++);
-
-    /* All off */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOff(aeLedSequence[i + (8 * 0)]);
-      LedOff(aeLedSequence[i + (8 * 1)]);
-      LedOff(aeLedSequence[i + (8 * 2)]);
-    }
-
-    /* Blue */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 2)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
-
-    /* Pause for show */
-    for(u32 i = 0; i < PAUSE_TIME; i++);
-
-    /* All off */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOff(aeLedSequence[i + (8 * 0)]);
-      LedOff(aeLedSequence[i + (8 * 1)]);
-      LedOff(aeLedSequence[i + (8 * 2)]);
-    }
-
-    
-    /* Purple */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 0)]);
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 2)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
-
-    /* Pause for show */
-    for(u32 i = 0; i < PAUSE_TIME; i++);
-
-    /* All off */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOff(aeLedSequence[i + (8 * 0)]);
-      LedOff(aeLedSequence[i + (8 * 1)]);
-      LedOff(aeLedSequence[i + (8 * 2)]);
-    }
-
-    /* White */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 0)]);
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 1)]);
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 2)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
-
-    /* Pause for show */
-    for(u32 i = 0; i < PAUSE_TIME; i++);
+  Led_psAnimation = psAnimation_;
+  Led_u8Frame = 0;
+  Led_u32FrameStart = SysTimeGetMs();
+  LedShowKeyframe(psAnimation_->psFrames[0].u16OnMask);
 
-    /* All off */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOff(aeLedSequence[i + (8 * 0)]);
-      LedOff(aeLedSequence[i + (8 * 1)]);
-      LedOff(aeLedSequence[i + (8 * 2)]);
-    }
-
-  }
-#endif
-  
-  
-  {
-    /* Red */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 0)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
-
-    for(u32 j = 0; j < STEP_TIME; j++);
+} /* end LedPlayAnimation() */
 
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOff(aeLedSequence[7 - i + (NUM_LEDS_PER_COLOR * 0)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
 
-    /* Yellow */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 0)]);
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 1)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
-
-    for(u32 j = 0; j < STEP_TIME; j++);
-
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOff(aeLedSequence[7 - i + (NUM_LEDS_PER_COLOR * 0)]);
-      LedOff(aeLedSequence[7 - i + (NUM_LEDS_PER_COLOR * 1)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
-
-    /* Green */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 1)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
-
-    for(u32 j = 0; j < STEP_TIME; j++);
-
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOff(aeLedSequence[7 - i + (NUM_LEDS_PER_COLOR * 1)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
-
-    /* Cyan */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 1)]);
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 2)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
-
-    for(u32 j = 0; j < STEP_TIME; j++);
-
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOff(aeLedSequence[7 - i + (NUM_LEDS_PER_COLOR * 1)]);
-      LedOff(aeLedSequence[7 - i + (NUM_LEDS_PER_COLOR * 2)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
+/*----------------------------------------------------------------------------------------------------------------------
+Function: LedStopAnimation
 
-    /* Blue */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 2)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
+Description:
+Stops the animation.
 
-    for(u32 j = 0; j < STEP_TIME; j++);
+Requires:
+  -
 
-   for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOff(aeLedSequence[7 - i + (NUM_LEDS_PER_COLOR * 2)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
+Promises:
+  - No more keyframes are shown; the LEDs keep their current state
+*/
+void LedStopAnimation(void)
+{
+  Led_psAnimation = NULL;
 
-    /* Purple */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 0)]);
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 2)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
+} /* end LedStopAnimation() */
 
-    for(u32 j = 0; j < STEP_TIME; j++);
 
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOff(aeLedSequence[7 - i + (NUM_LEDS_PER_COLOR * 0)]);
-      LedOff(aeLedSequence[7 - i + (NUM_LEDS_PER_COLOR * 2)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
+/*----------------------------------------------------------------------------------------------------------------------
+Function: LedIsAnimating
 
-    /* While */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 0)]);
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 1)]);
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 2)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
+Description:
+Reports whether an animation is playing.
 
-    for(u32 j = 0; j < STEP_TIME; j++);
+Requires:
+  -
 
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOff(aeLedSequence[7 - i + (NUM_LEDS_PER_COLOR * 0)]);
-      LedOff(aeLedSequence[7 - i + (NUM_LEDS_PER_COLOR * 1)]);
-      LedOff(aeLedSequence[7 - i + (NUM_LEDS_PER_COLOR * 2)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-    }    
+Promises:
+  - Returns true while an animation is playing
+*/
+bool LedIsAnimating(void)
+{
+  return(Led_psAnimation != NULL);
 
+} /* end LedIsAnimating() */
 
 
-  }
-#if 0
-  {
-    /* Red */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOn(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 0)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-      LedOff(aeLedSequence[i + (NUM_LEDS_PER_COLOR * 0)]);
-    }    
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions */
+/*--------------------------------------------------------------------------------------------------------------------*/
 
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOn(aeLedSequence[(7 - i) + (NUM_LEDS_PER_COLOR * 0)]);
-      for(u32 j = 0; j < STEP_TIME; j++);
-      LedOff(aeLedSequence[(7 - i) + (NUM_LEDS_PER_COLOR * 0)]);
-    }    
+/*----------------------------------------------------------------------------------------------------------------------
+Function: LedInitialize
 
-  }
-#endif
-  
-  /* Finish with all white */
-    for(u8 i = 0; i < NUM_LEDS_PER_COLOR; i++)
-    {
-      LedOn(aeLedSequence[i]);
-      LedOn(aeLedSequence[i + NUM_LEDS_PER_COLOR]);
-      LedOn(aeLedSequence[i + (2 * NUM_LEDS_PER_COLOR)]);
-      for(u32 j = 0; j < 100000; j++);
-    }
+Description:
+Initialization of LED system paramters and start of the boot animation (the visual LED check).
 
-    /* Pause for show */
-  for(u32 i = 0; i < 2000000; i++);
+Requires:
+  - The 1ms system time (SysTimeGetMs()) is ticking
+  - LedUpdate() called every 1ms from the main loop
 
-#if 0
-  /* Turn all LEDs on full, then fade them out over a few seconds */
-  for(u8 i = 20; i > 0; i--)
-  {
-    
-    /* Spend 40ms in each level of intensity */
-    for(u16 j = 40; j > 0; j--)
-    {
-      u32Timer = G_u32SystemTime1ms;
-      while( !IsTimeUp(&u32Timer, 1) );
-      LedUpdate();
-    }
-    /* Pause for a bit on the first iteration to show the LEDs on for little while */
-    if(i == 20)
-    {
-      while( !IsTimeUp(&u32Timer, 1500) );
-    }
-    
-    /* Set the LED intensity for the next iteration */
-    for(u8 j = 0; j < TOTAL_LEDS; j++)
-    {
-      Leds_asLedArray[j].eRate = (LedRateType)(i - 1);
-    }
-  }
+Promises:
+  - All LEDs in LED_NORMAL_MODE mode with OFF
+  - G_sLedBootAnimation playing; it runs into G_sLedIdleAnimation
+*/
+void LedInitialize(void)
+{
+  LedShowKeyframe(0);
+  LedPlayAnimation(&G_sLedBootAnimation);
 
-  /* Final update to set last state, hold for a short period */
-  LedUpdate();
-  while( !IsTimeUp(&u32Timer, 200) );
-#endif
-  
 } /* end LedInitialize() */
 
 
@@ -641,16 +426,37 @@ Requires:
  - G_u32SystemTime1ms is counting
 
 Promises:
+   - The animation, if any, moves on to its next keyframe when the current one is over
+   - Led_u8PwmTick moves on one tick
    - All LEDs updated based on their counters
+   - SYSTIME_SLOT_LEDS is armed for the next tick while any LED is PWMing or blinking (the counters count passes),
+     otherwise for the end of the current keyframe, or disarmed if nothing is timed
 */
 void LedUpdate(void)
 {
+  bool bCounting = false;
+  u32 u32FrameMs;
+
+  if(Led_psAnimation != NULL)
+  {
+    LedAnimationStep();
+  }
+
+  /* Shared PWM period: LedPWM() lines each LED's counters up with it at its own phase */
+  Led_u8PwmTick++;
+  if(Led_u8PwmTick >= LED_PWM_PERIOD)
+  {
+    Led_u8PwmTick = 0;
+  }
+
 	/* Loop through each LED */
   for(u8 i = 0; i < TOTAL_LEDS; i++)
   {
     /* Check if LED is PWMing */
     if(Leds_asLedArray[(LedNumberType)i].eMode == LED_PWM_MODE)
     {
+      bCounting = true;
+
       /* Handle special case of 0% duty cycle */
       if( Leds_asLedArray[i].eRate == LED_PWM_0 )
       {
@@ -693,6 +499,8 @@ void LedUpdate(void)
     /* LED is in LED_BLINK_MODE mode */
     else if(Leds_asLedArray[(LedNumberType)i].eMode == LED_BLINK_MODE)
     {
+      bCounting = true;
+
       /* Decrement counter; toggle and reload if counter reaches 0 */
       if( --Leds_asLedArray[(LedNumberType)i].u16Count == 0)
       {
@@ -701,9 +509,100 @@ void LedUpdate(void)
       }
     }
   } /* end for */
+
+  if(bCounting)
+  {
+    SysTimeSlotArm(SYSTIME_SLOT_LEDS, 1);
+  }
+  else if(Led_psAnimation != NULL)
+  {
+    u32FrameMs = SysTimeElapsed(Led_u32FrameStart);
+    if(u32FrameMs < Led_psAnimation->psFrames[Led_u8Frame].u16DurationMs)
+    {
+      SysTimeSlotArm(SYSTIME_SLOT_LEDS, Led_psAnimation->psFrames[Led_u8Frame].u16DurationMs - u32FrameMs);
+    }
+    else
+    {
+      SysTimeSlotArm(SYSTIME_SLOT_LEDS, 0);
+    }
+  }
+  else
+  {
+    SysTimeSlotDisarm(SYSTIME_SLOT_LEDS);
+  }
+
 } /* end LedUpdate() */
 
 
+/*----------------------------------------------------------------------------------------------------------------------
+Function: LedAnimationStep
+
+Description:
+Moves the animation on when the current keyframe has run its time.
+
+Requires:
+ - Led_psAnimation is not NULL
+
+Promises:
+ - The next keyframe (or the first keyframe of psNext) is shown when due; keyframe times are measured from when
+   each was due, so lateness does not build up
+ - The animation stops after its last keyframe if psNext is NULL
+*/
+void LedAnimationStep(void)
+{
+  u16 u16Duration = Led_psAnimation->psFrames[Led_u8Frame].u16DurationMs;
+
+  if( SysTimeElapsed(Led_u32FrameStart) < u16Duration )
+  {
+    return;
+  }
+
+  Led_u32FrameStart += u16Duration;
+  Led_u8Frame++;
+  if(Led_u8Frame >= Led_psAnimation->u8Frames)
+  {
+    Led_u8Frame = 0;
+    Led_psAnimation = Led_psAnimation->psNext;
+    if(Led_psAnimation == NULL)
+    {
+      return;
+    }
+  }
+
+  LedShowKeyframe(Led_psAnimation->psFrames[Led_u8Frame].u16OnMask);
+
+} /* end LedAnimationStep() */
+
+
+/*----------------------------------------------------------------------------------------------------------------------
+Function: LedShowKeyframe
+
+Description:
+Sets every LED from a keyframe mask.
+
+Requires:
+ - u16OnMask_ bit n is LedNumberType n
+
+Promises:
+ - LEDs with their bit set are on, the rest off, all in LED_NORMAL_MODE
+*/
+void LedShowKeyframe(u16 u16OnMask_)
+{
+  for(u8 i = 0; i < TOTAL_LEDS; i++)
+  {
+    if(u16OnMask_ & ((u16)1 << i))
+    {
+      LedOn( (LedNumberType)i );
+    }
+    else
+    {
+      LedOff( (LedNumberType)i );
+    }
+  }
+
+} /* end LedShowKeyframe() */
+
+
 /*--------------------------------------------------------------------------------------------------------------------*/
 /* End of File */
 /*--------------------------------------------------------------------------------------------------------------------*/
@@ -28,6 +28,10 @@ typedef enum {LED_PWM_DUTY_LOW = 0, LED_PWM_DUTY_HIGH = 1} LedPWMDutyType;
 
 #define LED_PWM_PERIOD    (u8)20
 
+/* PWM phase of each LED: periods start spread evenly across LED_PWM_PERIOD so the LEDs do not all turn on at the
+same tick.  Used by LedPWM() only; the POV column planes are not phased. */
+#define LED_PWM_PHASE(led)  (u8)( ((led) * LED_PWM_PERIOD) / TOTAL_LEDS )
+
 /* Standard blinky values.  If other values are needed, add them at the end of the enum */
 typedef enum {LED_0_5HZ = 1000, LED_1HZ = 500, LED_2HZ = 250, LED_4HZ = 125, LED_8HZ = 63,
               LED_PWM_0 = 0, LED_PWM_5 = 1, LED_PWM_10 = 2, LED_PWM_15 = 3, LED_PWM_20 = 4, 
@@ -46,15 +50,37 @@ typedef struct
   LedActiveType eActiveState;
 }LedConfigType;
 
+/* Animation keyframe: LEDs on (bit n = LedNumberType n, the rest off) for a time */
+typedef struct
+{
+  u16 u16OnMask;
+  u16 u16DurationMs;
+} LedKeyframeType;
+
+/* A run of keyframes.  psNext plays when the last keyframe ends (NULL stops; pointing at itself loops). */
+typedef struct LedAnimation
+{
+  const LedKeyframeType* psFrames;
+  u8 u8Frames;
+  const struct LedAnimation* psNext;
+} LedAnimationType;
+
 
 /******************************************************************************
 * Constants
 ******************************************************************************/
-#define TOTAL_LEDS            (u8)24        /* Total number of LEDs in the system */
-#define NUM_LEDS_PER_COLOR    (u8)8         /* Number of LEDs in the system */
+#define TOTAL_LEDS            (u8)12        /* Total number of LEDs in the system */
+#define NUM_LEDS_PER_COLOR    (u8)4         /* Number of LEDs of each color (groups A, D, Y, M) */
+
+/* Keyframe masks: a color (bit 0 red, 1 green, 2 blue) on the first n groups */
+#define LED_MASK_RED          (u16)0x0001
+#define LED_MASK_GRN          (u16)0x0002
+#define LED_MASK_BLU          (u16)0x0004
+#define LED_GROUPS(color, n)  (u16)((color) * (((u16)1 << (3 * (n))) - 1) / 7)
 
-#define STEP_TIME             (u32)200000
-#define PAUSE_TIME            (u32)500000
+#define LED_ANIMATION_STEP_MS (u16)60       /* Boot wipe: time per group */
+#define LED_ANIMATION_HOLD_MS (u16)500      /* Boot wipe: pause with all groups on */
+#define LED_ANIMATION_IDLE_MS (u16)750      /* Idle cycle: time per color */
 
 /******************************************************************************
 * Function Declarations
@@ -65,12 +91,17 @@ void LedOff(LedNumberType eLED_);
 void LedToggle(LedNumberType eLED_);
 void LedPWM(LedNumberType eLED_, LedRateType ePwmRate_);
 void LedBlink(LedNumberType eLED_, LedRateType ePwmRate_);
+void LedPlayAnimation(const LedAnimationType* psAnimation_);
+void LedStopAnimation(void);
+bool LedIsAnimating(void);
 
 /* Protected Functions */
 void LedInitialize(void);
 
 /* Private Functions */
 void LedUpdate(void);
+void LedAnimationStep(void);
+void LedShowKeyframe(u16 u16OnMask_);
 
 
 /******************************************************************************
@@ -0,0 +1,637 @@
+/**********************************************************************************************************************
+File: settings.c
+
+Description:
+Persistent key-value settings store in flash (selected POV image, brightness, calibration, etc.).
+
+The store is a log of records in one of two flash pages.  Saving a value appends a new record after the last one,
+so a page is only erased when it fills up.  At that point the latest record for each key is copied to the other
+page (compaction) and the full page is erased.  This spreads erase cycles over both pages and means most saves
+cost a few word writes and no erase at all.
+
+A RAM index of the newest record for each key is built at boot, so reads never search the log.
+
+Power loss safety:
+- Each record carries a CRC16 over its key, length and data.  A record cut short by a power loss fails its CRC
+  and is ignored, so the previous value for that key is used.
+- A compacted page only gets its magic word after all records are copied.  If power is lost during compaction
+  the old page is still the only valid page at the next boot.  If both pages are valid, the one with the higher
+  generation count wins and the other is erased.
+
+Deferred writes: the CPU stops while the NVMC works, for SETTINGS_PAGE_ERASE_US on an erase.  SettingsWrite() puts
+the value in a RAM slot per key and writes it straight away only if there is time: always while the POV columns
+are stopped, otherwise only if the next column alarm is far enough away (SysTimeAlarmSlackUs()), as
+image_writer.c does for its erases.  With RF scheduling on it also waits for a radio quiet window.  Anything left
+over is written by SettingsUpdate() from the main loop, a record, a compaction copy or the old page's erase at a
+time, each in its own gap.  Reads see queued values.  A value still queued when the power goes is lost.
+**********************************************************************************************************************/
+
+#include "configuration.h"
+
+/***********************************************************************************************************************
+Global variable definitions with scope across entire project.
+All Global variable names shall start with "G_"
+***********************************************************************************************************************/
+/* New variables */
+volatile u32 G_u32SettingsFlags;                       /* Global state flags */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Existing variables (defined in other files -- should all contain the "extern" keyword) */
+extern volatile u32 G_u32SystemFlags;                  /* From main.c */
+extern volatile u32 G_u32AntFlags;                     /* From ant.c */
+extern u32 G_u32PovFlags;                              /* From pov.c */
+
+extern volatile u32 G_u32SystemTime1ms;                /* From board-specific source file */
+extern volatile u32 G_u32SystemTime1s;                 /* From board-specific source file */
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "Settings_" and be declared as static.
+***********************************************************************************************************************/
+static u8 Settings_u8ActivePage;                       /* Page currently holding the log (0 or 1) */
+static u32 Settings_u32Generation;                     /* Generation count of the active page */
+static u16 Settings_u16WriteOffset;                    /* Word offset of the next free word in the active page */
+static u16 Settings_au16RecordOffset[SETTINGS_KEYS];   /* Word offset of the newest record for each key */
+static u32 Settings_u32EraseCount;                     /* Page erases since boot */
+static bool Settings_bErasePending;                    /* Inactive page still holds the log before compaction */
+
+/* Values waiting for a gap to be written; SETTINGS_NOT_PENDING size when a key has none */
+static u8 Settings_au8PendingSize[SETTINGS_KEYS];
+static u8 Settings_aau8Pending[SETTINGS_KEYS][SETTINGS_MAX_VALUE_SIZE];
+
+
+/**********************************************************************************************************************
+Function Definitions
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SettingsRead
+
+Description:
+Reads the stored value for a key.
+
+Requires:
+  - SettingsInitialize() has run
+  - pu8Destination_ points to at least u8MaxSize_ bytes
+
+Promises:
+  - If a value is stored or queued for eKey_, up to u8MaxSize_ bytes are copied to pu8Destination_ and its size is
+    returned
+  - Returns 0 if no value is stored
+*/
+u8 SettingsRead(SettingsKeyType eKey_, u8* pu8Destination_, u8 u8MaxSize_)
+{
+  u32* pu32Record;
+  u8 u8Size;
+
+  if(eKey_ >= SETTINGS_KEYS)
+  {
+    return(0);
+  }
+
+  /* A queued value is newer than the one in flash */
+  if(Settings_au8PendingSize[eKey_] != SETTINGS_NOT_PENDING)
+  {
+    u8Size = Settings_au8PendingSize[eKey_];
+    memcpy(pu8Destination_, Settings_aau8Pending[eKey_], (u8Size < u8MaxSize_) ? u8Size : u8MaxSize_);
+    return(u8Size);
+  }
+
+  if(Settings_au16RecordOffset[eKey_] == SETTINGS_NO_RECORD)
+  {
+    return(0);
+  }
+
+  pu32Record = SettingsPageBase(Settings_u8ActivePage) + Settings_au16RecordOffset[eKey_];
+  u8Size = (u8)(*pu32Record >> SETTINGS_RECORD_LENGTH_POS);
+
+  memcpy(pu8Destination_, (u8*)(pu32Record + 1), (u8Size < u8MaxSize_) ? u8Size : u8MaxSize_);
+
+  return(u8Size);
+
+} /* end SettingsRead() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SettingsWrite
+
+Description:
+Stores a value for a key.  Writing the value that is already stored does nothing, so callers can save freely.
+
+Requires:
+  - SettingsInitialize() has run
+  - Called from the main loop (may block for flash writes, but only while SettingsFlashAllowed() says there is time)
+
+Promises:
+  - Returns true if the value is stored, or queued for SettingsUpdate() to store when there is a gap; the previous
+    value is kept if power is lost during the write
+  - Returns false if eKey_ or u8Size_ is invalid
+*/
+bool SettingsWrite(SettingsKeyType eKey_, const u8* pu8Source_, u8 u8Size_)
+{
+  u8 au8Current[SETTINGS_MAX_VALUE_SIZE];
+
+  if( (eKey_ >= SETTINGS_KEYS) || (u8Size_ > SETTINGS_MAX_VALUE_SIZE) )
+  {
+    return(false);
+  }
+
+  /* Skip the write if nothing changed */
+  if( (SettingsRead(eKey_, au8Current, sizeof(au8Current)) == u8Size_) &&
+      ((Settings_au8PendingSize[eKey_] != SETTINGS_NOT_PENDING) ||
+       (Settings_au16RecordOffset[eKey_] != SETTINGS_NO_RECORD)) &&
+      (memcmp(au8Current, pu8Source_, u8Size_) == 0) )
+  {
+    return(true);
+  }
+
+  memcpy(Settings_aau8Pending[eKey_], pu8Source_, u8Size_);
+  Settings_au8PendingSize[eKey_] = u8Size_;
+  SettingsFlush();
+
+  return(true);
+
+} /* end SettingsWrite() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SettingsGetEraseCount
+
+Description:
+Returns the number of page erases since boot to help judge flash wear.
+
+Requires:
+  -
+
+Promises:
+  - Returns Settings_u32EraseCount
+*/
+u32 SettingsGetEraseCount(void)
+{
+  return(Settings_u32EraseCount);
+
+} /* end SettingsGetEraseCount() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SettingsInitialize
+
+Description:
+Selects the valid settings page, cleans up after any interrupted compaction and builds the RAM index.
+
+Requires:
+  - Flash from SETTINGS_PAGE0_ADDRESS for two pages is reserved for settings
+
+Promises:
+  - One page holds a valid page header and is the active page
+  - The other page is erased
+  - Settings_au16RecordOffset holds the newest valid record for each key
+  - _SETTINGS_FLAGS_FORMATTED is set if no valid page was found (all settings are lost)
+*/
+void SettingsInitialize(void)
+{
+  u32* pu32Page0 = SettingsPageBase(0);
+  u32* pu32Page1 = SettingsPageBase(1);
+  bool bPage0Valid = (pu32Page0[SETTINGS_MAGIC_OFFSET] == SETTINGS_PAGE_MAGIC);
+  bool bPage1Valid = (pu32Page1[SETTINGS_MAGIC_OFFSET] == SETTINGS_PAGE_MAGIC);
+  u32* pu32Other;
+
+  G_u32SettingsFlags = 0;
+  Settings_u32EraseCount = 0;
+  Settings_bErasePending = false;
+  memset(Settings_au8PendingSize, SETTINGS_NOT_PENDING, sizeof(Settings_au8PendingSize));
+
+  if(bPage0Valid && bPage1Valid)
+  {
+    /* Compaction finished but the old page was not erased: the newer generation wins */
+    Settings_u8ActivePage = ((s32)(pu32Page1[SETTINGS_GENERATION_OFFSET] -
+                                   pu32Page0[SETTINGS_GENERATION_OFFSET]) > 0) ? 1 : 0;
+  }
+  else if(bPage0Valid || bPage1Valid)
+  {
+    Settings_u8ActivePage = bPage1Valid ? 1 : 0;
+  }
+  else
+  {
+    /* Nothing usable: start a fresh log in page 0 */
+    Settings_u8ActivePage = 0;
+    SettingsErasePage(0);
+    nrf_nvmc_write_word((u32)(uintptr_t)&pu32Page0[SETTINGS_GENERATION_OFFSET], 1);
+    nrf_nvmc_write_word((u32)(uintptr_t)&pu32Page0[SETTINGS_MAGIC_OFFSET], SETTINGS_PAGE_MAGIC);
+    G_u32SettingsFlags |= _SETTINGS_FLAGS_FORMATTED;
+  }
+
+  Settings_u32Generation = SettingsPageBase(Settings_u8ActivePage)[SETTINGS_GENERATION_OFFSET];
+
+  /* Erase the inactive page if it holds anything (old page or an interrupted compaction) */
+  pu32Other = SettingsPageBase(Settings_u8ActivePage ^ 1);
+  for(u16 i = 0; i < SETTINGS_PAGE_WORDS; i++)
+  {
+    if(pu32Other[i] != SETTINGS_ERASED_WORD)
+    {
+      SettingsErasePage(Settings_u8ActivePage ^ 1);
+      break;
+    }
+  }
+
+  SettingsScanPage();
+
+} /* end SettingsInitialize() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SettingsUpdate
+
+Description:
+Writes queued values, and finishes a compaction, when the POV columns and radio leave a gap.
+
+Requires:
+  - SettingsInitialize() has run
+  - Main loop context
+
+Promises:
+  - As much of the queued flash work is done as fits the gaps (see SettingsFlush())
+*/
+void SettingsUpdate(void)
+{
+  SettingsFlush();
+
+} /* end SettingsUpdate() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SettingsPageBase
+
+Description:
+Returns a pointer to the start of a settings page.
+
+Requires:
+  - u8Page_ is 0 or 1
+
+Promises:
+  - Returns the page address as a word pointer
+*/
+u32* SettingsPageBase(u8 u8Page_)
+{
+  return( (u32*)(uintptr_t)(SETTINGS_PAGE0_ADDRESS + (u8Page_ * SETTINGS_PAGE_SIZE)) );
+
+} /* end SettingsPageBase() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SettingsRecordHeader
+
+Description:
+Builds the header word for a record.
+
+Requires:
+  - u8Size_ <= SETTINGS_MAX_VALUE_SIZE
+
+Promises:
+  - Returns the header word with key, length and CRC16 of key, length and data
+*/
+u32 SettingsRecordHeader(u8 u8Key_, const u8* pu8Data_, u8 u8Size_)
+{
+  u8 au8KeyLength[2];
+  u16 u16Crc;
+
+  au8KeyLength[0] = u8Key_;
+  au8KeyLength[1] = u8Size_;
+  u16Crc = crc16_compute(au8KeyLength, sizeof(au8KeyLength), NULL);
+  u16Crc = crc16_compute(pu8Data_, u8Size_, &u16Crc);
+
+  return( ((u32)u8Key_ << SETTINGS_RECORD_KEY_POS) | ((u32)u8Size_ << SETTINGS_RECORD_LENGTH_POS) | u16Crc );
+
+} /* end SettingsRecordHeader() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SettingsRecordWords
+
+Description:
+Returns the flash space taken by a record, in words.
+
+Requires:
+  - u32Header_ is a record header word
+
+Promises:
+  - Returns 1 (header) plus the data length rounded up to whole words
+*/
+u16 SettingsRecordWords(u32 u32Header_)
+{
+  return( 1 + (((u8)(u32Header_ >> SETTINGS_RECORD_LENGTH_POS) + 3) >> 2) );
+
+} /* end SettingsRecordWords() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SettingsRecordValid
+
+Description:
+Checks a record's key, length and CRC.
+
+Requires:
+  - pu32Record_ points to a record header in flash with its length field already range-checked
+
+Promises:
+  - Returns true if the record was completely written
+*/
+bool SettingsRecordValid(const u32* pu32Record_)
+{
+  u32 u32Header = *pu32Record_;
+  u8 u8Key  = (u8)(u32Header >> SETTINGS_RECORD_KEY_POS);
+  u8 u8Size = (u8)(u32Header >> SETTINGS_RECORD_LENGTH_POS);
+
+  if(u8Key >= SETTINGS_KEYS)
+  {
+    return(false);
+  }
+
+  return( SettingsRecordHeader(u8Key, (const u8*)(pu32Record_ + 1), u8Size) == u32Header );
+
+} /* end SettingsRecordValid() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SettingsScanPage
+
+Description:
+Walks the log in the active page to find the newest record of each key and the first free word.
+
+Requires:
+  - Settings_u8ActivePage holds a valid page header
+
+Promises:
+  - Settings_au16RecordOffset and Settings_u16WriteOffset are updated
+  - _SETTINGS_FLAGS_TORN_RECORD is set if an incomplete record was skipped
+*/
+void SettingsScanPage(void)
+{
+  u32* pu32Page = SettingsPageBase(Settings_u8ActivePage);
+  u16 u16Offset = SETTINGS_HEADER_WORDS;
+  u16 u16Words;
+  u32 u32Header;
+
+  for(u8 i = 0; i < SETTINGS_KEYS; i++)
+  {
+    Settings_au16RecordOffset[i] = SETTINGS_NO_RECORD;
+  }
+
+  while(u16Offset < SETTINGS_PAGE_WORDS)
+  {
+    u32Header = pu32Page[u16Offset];
+    if(u32Header == SETTINGS_ERASED_WORD)
+    {
+      break;
+    }
+
+    /* A corrupt length means the rest of the page cannot be trusted: treat the page as full so the next
+    write compacts it */
+    u16Words = SettingsRecordWords(u32Header);
+    if( ((u8)(u32Header >> SETTINGS_RECORD_LENGTH_POS) > SETTINGS_MAX_VALUE_SIZE) ||
+        ((u16Offset + u16Words) > SETTINGS_PAGE_WORDS) )
+    {
+      G_u32SettingsFlags |= _SETTINGS_FLAGS_TORN_RECORD;
+      u16Offset = SETTINGS_PAGE_WORDS;
+      break;
+    }
+
+    if( SettingsRecordValid(&pu32Page[u16Offset]) )
+    {
+      Settings_au16RecordOffset[u32Header >> SETTINGS_RECORD_KEY_POS] = u16Offset;
+    }
+    else
+    {
+      G_u32SettingsFlags |= _SETTINGS_FLAGS_TORN_RECORD;
+    }
+
+    u16Offset += u16Words;
+  }
+
+  Settings_u16WriteOffset = u16Offset;
+
+} /* end SettingsScanPage() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SettingsAppend
+
+Description:
+Writes one record to flash.  The header goes first so a power loss during the data write leaves a record that
+fails its CRC instead of blank space that would be overwritten by the next record.
+
+Requires:
+  - pu32Destination_ points to at least SettingsRecordWords() erased words
+
+Promises:
+  - Record is written
+*/
+void SettingsAppend(u32* pu32Destination_, u8 u8Key_, const u8* pu8Data_, u8 u8Size_)
+{
+  u32 au32Data[SETTINGS_MAX_VALUE_SIZE / 4];
+  u32 u32Header = SettingsRecordHeader(u8Key_, pu8Data_, u8Size_);
+
+  nrf_nvmc_write_word((u32)(uintptr_t)pu32Destination_, u32Header);
+
+  if(u8Size_ != 0)
+  {
+    /* Pad the last word with the erased value */
+    memset(au32Data, 0xFF, sizeof(au32Data));
+    memcpy(au32Data, pu8Data_, u8Size_);
+    nrf_nvmc_write_words((u32)(uintptr_t)(pu32Destination_ + 1), (const uint32_t*)au32Data,
+                         SettingsRecordWords(u32Header) - 1);
+  }
+
+} /* end SettingsAppend() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SettingsCompact
+
+Description:
+Copies the newest record of every key to the inactive page, then makes it the active page.
+
+Requires:
+  - The inactive page is erased (Settings_bErasePending is false)
+
+Promises:
+  - The active page holds one record per stored key followed by free space
+  - The previously active page still has to be erased: Settings_bErasePending is set
+*/
+void SettingsCompact(void)
+{
+  u8 u8NewPage = Settings_u8ActivePage ^ 1;
+  u32* pu32OldPage = SettingsPageBase(Settings_u8ActivePage);
+  u32* pu32NewPage = SettingsPageBase(u8NewPage);
+  u16 u16Offset = SETTINGS_HEADER_WORDS;
+  u16 u16Words;
+
+  for(u8 i = 0; i < SETTINGS_KEYS; i++)
+  {
+    if(Settings_au16RecordOffset[i] != SETTINGS_NO_RECORD)
+    {
+      u16Words = SettingsRecordWords(pu32OldPage[Settings_au16RecordOffset[i]]);
+      nrf_nvmc_write_words((u32)(uintptr_t)(pu32NewPage + u16Offset),
+                           (const uint32_t*)(pu32OldPage + Settings_au16RecordOffset[i]), u16Words);
+      Settings_au16RecordOffset[i] = u16Offset;
+      u16Offset += u16Words;
+    }
+  }
+
+  /* Generation first, magic last: the page only becomes valid once it is complete */
+  Settings_u32Generation++;
+  nrf_nvmc_write_word((u32)(uintptr_t)&pu32NewPage[SETTINGS_GENERATION_OFFSET], Settings_u32Generation);
+  nrf_nvmc_write_word((u32)(uintptr_t)&pu32NewPage[SETTINGS_MAGIC_OFFSET], SETTINGS_PAGE_MAGIC);
+
+  Settings_bErasePending = true;
+  Settings_u8ActivePage = u8NewPage;
+  Settings_u16WriteOffset = u16Offset;
+
+} /* end SettingsCompact() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SettingsErasePage
+
+Description:
+Erases one settings page and counts the erase.
+
+Requires:
+  - u8Page_ is 0 or 1
+
+Promises:
+  - Page is erased and Settings_u32EraseCount is incremented
+*/
+void SettingsErasePage(u8 u8Page_)
+{
+  nrf_nvmc_page_erase( (u32)(uintptr_t)SettingsPageBase(u8Page_) );
+  Settings_u32EraseCount++;
+
+} /* end SettingsErasePage() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SettingsFlashAllowed
+
+Description:
+Checks whether flash work that stops the CPU for u32DurationUs_ can start now.
+
+Requires:
+  -
+
+Promises:
+  - Returns true if the POV columns are stopped or the next column alarm is at least u32DurationUs_ away, and,
+    with RF scheduling on, the radio is quiet for at least as long
+*/
+bool SettingsFlashAllowed(u32 u32DurationUs_)
+{
+  if( (G_u32AntFlags & _ANT_FLAGS_RF_SCHEDULING) && (AntRadioQuietUs() < u32DurationUs_) )
+  {
+    return(false);
+  }
+
+  if( !(G_u32PovFlags & _POV_FLAGS_LOCKED) )
+  {
+    return(true);
+  }
+
+  return( SysTimeAlarmSlackUs() >= u32DurationUs_ );
+
+} /* end SettingsFlashAllowed() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SettingsFlush
+
+Description:
+Does the queued flash work, each step only if SettingsFlashAllowed() gives it time: the erase left by a compaction,
+then the queued records, compacting first when one does not fit (which needs the earlier erase done).
+
+Requires:
+  - Main loop context
+
+Promises:
+  - Stops at the first record that has to wait; SettingsUpdate() carries on from there
+  - Each record written leaves the queue and goes into the RAM index
+*/
+void SettingsFlush(void)
+{
+  u32* pu32Page;
+  u16 u16Words;
+  u16 u16LiveWords;
+
+  if( Settings_bErasePending && SettingsFlashAllowed(SETTINGS_PAGE_ERASE_US) )
+  {
+    SettingsErasePage(Settings_u8ActivePage ^ 1);
+    Settings_bErasePending = false;
+  }
+
+  for(u8 u8Key = 0; u8Key < SETTINGS_KEYS; u8Key++)
+  {
+    if(Settings_au8PendingSize[u8Key] == SETTINGS_NOT_PENDING)
+    {
+      continue;
+    }
+
+    /* Compact into the other page if the record does not fit; its old page is erased in a later gap */
+    u16Words = 1 + ((Settings_au8PendingSize[u8Key] + 3) >> 2);
+    if( (Settings_u16WriteOffset + u16Words) > SETTINGS_PAGE_WORDS )
+    {
+      u16LiveWords = SETTINGS_HEADER_WORDS;
+      pu32Page = SettingsPageBase(Settings_u8ActivePage);
+      for(u8 i = 0; i < SETTINGS_KEYS; i++)
+      {
+        if(Settings_au16RecordOffset[i] != SETTINGS_NO_RECORD)
+        {
+          u16LiveWords += SettingsRecordWords(pu32Page[Settings_au16RecordOffset[i]]);
+        }
+      }
+
+      if( Settings_bErasePending || !SettingsFlashAllowed(u16LiveWords * SETTINGS_WORD_WRITE_US) )
+      {
+        return;
+      }
+      SettingsCompact();
+
+      if( SettingsFlashAllowed(SETTINGS_PAGE_ERASE_US) )
+      {
+        SettingsErasePage(Settings_u8ActivePage ^ 1);
+        Settings_bErasePending = false;
+      }
+    }
+
+    if( !SettingsFlashAllowed(u16Words * SETTINGS_WORD_WRITE_US) )
+    {
+      return;
+    }
+
+    pu32Page = SettingsPageBase(Settings_u8ActivePage);
+    SettingsAppend(pu32Page + Settings_u16WriteOffset, u8Key, Settings_aau8Pending[u8Key],
+                   Settings_au8PendingSize[u8Key]);
+    Settings_au16RecordOffset[u8Key] = Settings_u16WriteOffset;
+    Settings_u16WriteOffset += u16Words;
+    Settings_au8PendingSize[u8Key] = SETTINGS_NOT_PENDING;
+  }
+
+} /* end SettingsFlush() */
+
+
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -0,0 +1,96 @@
+/**********************************************************************************************************************
+File: settings.h
+
+Description:
+Header file for settings.c source.
+**********************************************************************************************************************/
+
+#ifndef __SETTINGS_H
+#define __SETTINGS_H
+
+/**********************************************************************************************************************
+Type Definitions
+**********************************************************************************************************************/
+/* Settings keys.  Add new keys at the end, before SETTINGS_KEYS, so stored records keep their meaning. */
+typedef enum {SETTINGS_KEY_POV_IMAGE = 0, SETTINGS_KEY_BRIGHTNESS, SETTINGS_KEY_ACCEL_CALIBRATION,
+              SETTINGS_KEY_REMOTE_PAIRS, SETTINGS_KEY_IMAGE_KEY, SETTINGS_KEY_REMOTE_ENABLED,
+              SETTINGS_KEY_ANT_POWER_MODE, SETTINGS_KEY_COMMAND_NONCE, SETTINGS_KEYS} SettingsKeyType;
+
+
+/**********************************************************************************************************************
+Constants / Definitions
+**********************************************************************************************************************/
+/* Flash layout: two pages at the top of flash are used as a ping-pong log.  The linker file must keep
+code out of this area (see nRF51422_QFAA.icf). */
+#define SETTINGS_PAGE_SIZE          (u32)1024                 /* nRF51 flash page size in bytes */
+#define SETTINGS_PAGE0_ADDRESS      (u32)0x0003F800
+#define SETTINGS_PAGE1_ADDRESS      (u32)(SETTINGS_PAGE0_ADDRESS + SETTINGS_PAGE_SIZE)
+#define SETTINGS_PAGE_WORDS         (u16)(SETTINGS_PAGE_SIZE / 4)
+
+/* Page header: magic word then generation counter.  The magic word is written last during compaction, so a page
+with a valid magic word is always complete. */
+#define SETTINGS_PAGE_MAGIC         (u32)0x53455454           /* "SETT" */
+#define SETTINGS_HEADER_WORDS       (u16)2
+#define SETTINGS_MAGIC_OFFSET       (u16)0
+#define SETTINGS_GENERATION_OFFSET  (u16)1
+
+/* Record header word: [31:24] key, [23:16] data length in bytes, [15:0] CRC16 of key, length and data.
+Data follows the header padded to a whole number of words. */
+#define SETTINGS_ERASED_WORD        (u32)0xFFFFFFFF
+#define SETTINGS_RECORD_KEY_POS     (u8)24
+#define SETTINGS_RECORD_LENGTH_POS  (u8)16
+#define SETTINGS_RECORD_CRC_MASK    (u32)0x0000FFFF
+
+#define SETTINGS_MAX_VALUE_SIZE     (u8)32                    /* Largest value that can be stored */
+#define SETTINGS_NO_RECORD          (u16)0                    /* Index value for a key with no record */
+#define SETTINGS_NOT_PENDING        (u8)0xFF                  /* Pending size for a key with nothing queued */
+
+/* CPU halt times of the NVMC (nRF51 PS): flash work is only started when this much quiet time is left */
+#define SETTINGS_PAGE_ERASE_US      (u32)22300
+#define SETTINGS_WORD_WRITE_US      (u32)47
+
+/* G_u32SettingsFlags */
+#define _SETTINGS_FLAGS_FORMATTED   (u32)0x00000001           /* Set if no valid page was found at boot */
+#define _SETTINGS_FLAGS_TORN_RECORD (u32)0x00000002           /* Set if a partially written record was found at boot */
+
+
+/**********************************************************************************************************************
+Function Declarations
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+u8 SettingsRead(SettingsKeyType eKey_, u8* pu8Destination_, u8 u8MaxSize_);
+bool SettingsWrite(SettingsKeyType eKey_, const u8* pu8Source_, u8 u8Size_);
+u32 SettingsGetEraseCount(void);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void SettingsInitialize(void);
+void SettingsUpdate(void);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+u32* SettingsPageBase(u8 u8Page_);
+u32 SettingsRecordHeader(u8 u8Key_, const u8* pu8Data_, u8 u8Size_);
+u16 SettingsRecordWords(u32 u32Header_);
+bool SettingsRecordValid(const u32* pu32Record_);
+void SettingsScanPage(void);
+void SettingsAppend(u32* pu32Destination_, u8 u8Key_, const u8* pu8Data_, u8 u8Size_);
+void SettingsCompact(void);
+void SettingsErasePage(u8 u8Page_);
+bool SettingsFlashAllowed(u32 u32DurationUs_);
+void SettingsFlush(void);
+
+
+#endif /* __SETTINGS_H */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
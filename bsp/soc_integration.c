@@ -47,24 +47,18 @@ Function Definitions
 Interrupt handler: SD_EVT_IRQHandler
 
 Description:
-Processes soft device events.
+Soft device event interrupt.  Copies the waiting events into the ANT event queue; they are handled by AntUpdate()
+in the main loop.
 
 Requires:
   -
 
 Promises:
-  - 
+  - Soft device event queue is empty
 */
 void SD_EVT_IRQHandler(void)
 {
-   u32 u32Event;
-
-  /* Read out all current SOC events */
-  while (sd_ant_event_get(&u32Event) != NRF_ERROR_NOT_FOUND)
-  {
-    /* Flag if there are any ANT events */
-    G_u32SystemFlags |= _SYSTEM_ANT_EVENT; 
-  }
+  AntCaptureEvents();
 }
 
 /**
@@ -73,7 +67,11 @@ void SD_EVT_IRQHandler(void)
 void softdevice_assert_callback(uint32_t ulPC, uint16_t usLineNum, const uint8_t *pucFileName)
 {
    UNUSED_PARAMETER(ulPC);
-   assert_nrf_callback(usLineNum, pucFileName);
+   UNUSED_PARAMETER(usLineNum);
+   UNUSED_PARAMETER(pucFileName);
+
+   /* The stack cannot continue after an assert: start over rather than leave the wand dead */
+   NVIC_SystemReset();
 }
 
 
@@ -16,6 +16,12 @@ Type Definitions
 /**********************************************************************************************************************
 Constants / Definitions
 **********************************************************************************************************************/
+/* nrf_soc.h in SDK 4.2.2 has these under #if 0; without them SD_EVT_IRQHandler is not on the SWI2 vector */
+#ifndef SD_EVT_IRQn
+#define SD_EVT_IRQn                   (SWI2_IRQn)
+#define SD_EVT_IRQHandler             SWI2_IRQHandler
+#endif
+
 #define SOCINT_INIT (u32)0x
 /*
     31 [0] 
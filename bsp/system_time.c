@@ -0,0 +1,563 @@
+/**********************************************************************************************************************
+File: system_time.c
+
+Description:
+Monotonic system time services built on the 1ms system tick.
+
+All time comparisons use unsigned subtraction so they are correct across the 2^32 ms rollover of
+G_u32SystemTime1ms without any branching.  A 64-bit extended count is maintained without disabling
+interrupts: the epoch counter is advanced every time the MSB of the 1ms counter changes, so a reader
+can always tell if it caught the epoch counter one step behind the 1ms counter and correct for it.
+
+Deadline slots can be armed by any module so the sleep logic can find out how long the system may
+sleep before something needs attention.
+
+A separate 1 us time base runs on TIMER2 for work that needs finer timing than the 1ms tick (LED columns, radio
+time stamps).  The 16-bit timer is extended to 32 bits by counting wraps in TIMER2_IRQHandler, so SysTimeGetUs()
+wraps every ~71 minutes and must be compared with wrap-safe subtraction like the 1ms time.  One alarm can be
+set on it; the callback runs in the TIMER2 interrupt at SYSTIME_US_PRIORITY.
+**********************************************************************************************************************/
+
+#include "configuration.h"
+
+/***********************************************************************************************************************
+Global variable definitions with scope across entire project.
+All Global variable names shall start with "G_"
+***********************************************************************************************************************/
+/* New variables */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Existing variables (defined in other files -- should all contain the "extern" keyword) */
+extern volatile u32 G_u32SystemFlags;                  /* From main.c */
+
+extern volatile u32 G_u32SystemTime1ms;                /* From board-specific source file */
+extern volatile u32 G_u32SystemTime1s;                 /* From board-specific source file */
+
+
+/***********************************************************************************************************************
+Global variable definitions with scope limited to this local application.
+Variable names shall start with "SysTime_" and be declared as static.
+***********************************************************************************************************************/
+static volatile u32 SysTime_u32HalfEpochs;             /* Count of MSB transitions of G_u32SystemTime1ms */
+static u16 SysTime_u16MsToSecond;                      /* Countdown to the next 1s tick */
+
+static u32 SysTime_u32ArmedSlots;                      /* Bit n set if SysTimeSlotType n is armed */
+static SysTimeDeadlineType SysTime_au32SlotDeadlines[SYSTIME_SLOTS]; /* Deadline for each slot */
+
+static volatile u16 SysTime_u16UsHigh;                 /* Upper 16 bits of the microsecond time (TIMER2 wraps) */
+static volatile u32 SysTime_u32AlarmTime;              /* Microsecond time of the pending alarm */
+static volatile fnSysTimeAlarmType SysTime_pfnAlarm;   /* Pending alarm callback, NULL if none */
+
+
+/**********************************************************************************************************************
+Function Definitions
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SysTimeGetMs
+
+Description:
+Returns the current 1ms system time.  All modules should use this instead of reading G_u32SystemTime1ms.
+
+Requires:
+  -
+
+Promises:
+  - Returns G_u32SystemTime1ms
+*/
+u32 SysTimeGetMs(void)
+{
+  return(G_u32SystemTime1ms);
+
+} /* end SysTimeGetMs() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SysTimeGetMs64
+
+Description:
+Returns the 1ms system time extended to 64 bits so it never rolls over.  Safe to call from any interrupt
+priority: the epoch counter is read first and corrected if it has not yet caught up with the 1ms counter.
+
+Requires:
+  - SysTimeTick() is the only writer of G_u32SystemTime1ms
+
+Promises:
+  - Returns the number of ms since SysTimeInitialize() as a 64-bit value
+*/
+u64 SysTimeGetMs64(void)
+{
+  u32 u32HalfEpochs;
+  u32 u32Low;
+
+  /* Order matters: epochs first, then the low word */
+  u32HalfEpochs = SysTime_u32HalfEpochs;
+  u32Low = G_u32SystemTime1ms;
+
+  /* If the MSB of the low word does not match the parity of the epoch count, the tick landed
+  between the two reads and the epoch count is one step behind */
+  u32HalfEpochs += ((u32Low >> 31) ^ u32HalfEpochs) & 1;
+
+  return( ((u64)(u32HalfEpochs >> 1) << 32) | u32Low );
+
+} /* end SysTimeGetMs64() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SysTimeElapsed
+
+Description:
+Returns the time elapsed since u32StartTime_.  Unsigned subtraction gives the correct answer across rollover.
+
+Requires:
+  - u32StartTime_ is a value previously read from SysTimeGetMs() no more than 2^32 - 1 ms ago
+
+Promises:
+  - Returns the number of ms since u32StartTime_
+*/
+u32 SysTimeElapsed(u32 u32StartTime_)
+{
+  return(G_u32SystemTime1ms - u32StartTime_);
+
+} /* end SysTimeElapsed() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SysTimeDeadlineSet
+
+Description:
+Creates a deadline u32Period_ ms from now.
+
+Requires:
+  - u32Period_ <= SYSTIME_MAX_PERIOD
+
+Promises:
+  - Returns the deadline
+*/
+SysTimeDeadlineType SysTimeDeadlineSet(u32 u32Period_)
+{
+  return(G_u32SystemTime1ms + u32Period_);
+
+} /* end SysTimeDeadlineSet() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SysTimeDeadlineExpired
+
+Description:
+Checks if a deadline has passed.  The sign bit of (now - deadline) gives the answer without branching.
+
+Requires:
+  - u32Deadline_ was created with SysTimeDeadlineSet()
+
+Promises:
+  - Returns true if the deadline has been reached or passed
+*/
+bool SysTimeDeadlineExpired(SysTimeDeadlineType u32Deadline_)
+{
+  return( (bool)( ((G_u32SystemTime1ms - u32Deadline_) >> 31) ^ 1 ) );
+
+} /* end SysTimeDeadlineExpired() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SysTimeDeadlineRemaining
+
+Description:
+Returns the number of ms until a deadline.
+
+Requires:
+  - u32Deadline_ was created with SysTimeDeadlineSet()
+
+Promises:
+  - Returns the ms left until u32Deadline_, or 0 if it has expired
+*/
+u32 SysTimeDeadlineRemaining(SysTimeDeadlineType u32Deadline_)
+{
+  u32 u32Remaining = u32Deadline_ - G_u32SystemTime1ms;
+
+  /* Mask to 0 if the difference is negative (sign bit set) */
+  return( u32Remaining & ((u32Remaining >> 31) - 1) );
+
+} /* end SysTimeDeadlineRemaining() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SysTimeSlotArm
+
+Description:
+Arms a deadline slot so it is included in SysTimeNextDeadline().  Re-arming an armed slot moves its deadline.
+
+Requires:
+  - eSlot_ is a valid slot
+  - u32Period_ <= SYSTIME_MAX_PERIOD
+
+Promises:
+  - Slot deadline is u32Period_ ms from now and the slot is armed
+*/
+void SysTimeSlotArm(SysTimeSlotType eSlot_, u32 u32Period_)
+{
+  SysTime_au32SlotDeadlines[eSlot_] = SysTimeDeadlineSet(u32Period_);
+  SysTime_u32ArmedSlots |= (1u << eSlot_);
+
+} /* end SysTimeSlotArm() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SysTimeSlotDisarm
+
+Description:
+Removes a deadline slot from SysTimeNextDeadline().
+
+Requires:
+  - eSlot_ is a valid slot
+
+Promises:
+  - Slot is disarmed
+*/
+void SysTimeSlotDisarm(SysTimeSlotType eSlot_)
+{
+  SysTime_u32ArmedSlots &= ~(1u << eSlot_);
+
+} /* end SysTimeSlotDisarm() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SysTimeNextDeadline
+
+Description:
+Finds the nearest armed deadline so the sleep logic knows how long it can stay asleep.
+
+Requires:
+  -
+
+Promises:
+  - Returns the ms until the nearest armed deadline (0 if one has already expired)
+  - Returns SYSTIME_NO_DEADLINE if no slots are armed
+*/
+u32 SysTimeNextDeadline(void)
+{
+  u32 u32Nearest = SYSTIME_NO_DEADLINE;
+  u32 u32Remaining;
+  u32 u32Slots = SysTime_u32ArmedSlots;
+
+  for(u8 i = 0; u32Slots != 0; i++, u32Slots >>= 1)
+  {
+    if(u32Slots & 0x01)
+    {
+      u32Remaining = SysTimeDeadlineRemaining(SysTime_au32SlotDeadlines[i]);
+      if(u32Remaining < u32Nearest)
+      {
+        u32Nearest = u32Remaining;
+      }
+    }
+  }
+
+  return(u32Nearest);
+
+} /* end SysTimeNextDeadline() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SysTimeGetUs
+
+Description:
+Returns the microsecond time.  Safe to call from any context.
+
+Requires:
+  - SysTimeInitialize() has started TIMER2
+
+Promises:
+  - Returns the 32-bit microsecond count (wraps every 2^32 us)
+*/
+u32 SysTimeGetUs(void)
+{
+  u16 u16High;
+  u16 u16Low;
+
+  do
+  {
+    u16High = SysTime_u16UsHigh;
+    SYSTIME_US_TIMER->TASKS_CAPTURE[SYSTIME_US_CC_CAPTURE] = 1;
+    u16Low = (u16)SYSTIME_US_TIMER->CC[SYSTIME_US_CC_CAPTURE];
+
+    /* A wrap that has not been counted yet: only seen when called from the TIMER2 interrupt itself, or in the
+    few cycles before it preempts (in which case the high word changes and the loop runs again) */
+    if(SYSTIME_US_TIMER->EVENTS_COMPARE[SYSTIME_US_CC_WRAP] && (u16Low < 0x8000))
+    {
+      u16High++;
+      if(SysTime_u16UsHigh == (u16)(u16High - 1))
+      {
+        break;
+      }
+    }
+  } while(u16High != SysTime_u16UsHigh);
+
+  return( ((u32)u16High << 16) | u16Low );
+
+} /* end SysTimeGetUs() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SysTimeAlarmSet
+
+Description:
+Sets the microsecond alarm.  Replaces any alarm already pending.
+
+Requires:
+  - u32AlarmTime_ is less than SYSTIME_MAX_PERIOD us away
+  - pfnAlarm_ is short enough to run in an interrupt
+
+Promises:
+  - pfnAlarm_(u32AlarmTime_) is called from TIMER2_IRQHandler when SysTimeGetUs() reaches u32AlarmTime_, or
+    SYSTIME_US_ALARM_MIN_LEAD us from now if that time has already passed
+*/
+void SysTimeAlarmSet(u32 u32AlarmTime_, fnSysTimeAlarmType pfnAlarm_)
+{
+  SysTime_pfnAlarm = NULL;
+  SysTime_u32AlarmTime = u32AlarmTime_;
+  SysTime_pfnAlarm = pfnAlarm_;
+
+  SysTimeAlarmArm();
+
+} /* end SysTimeAlarmSet() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SysTimeAlarmCancel
+
+Description:
+Cancels the pending microsecond alarm.
+
+Requires:
+  -
+
+Promises:
+  - No alarm callback runs until SysTimeAlarmSet() is called again
+*/
+void SysTimeAlarmCancel(void)
+{
+  SysTime_pfnAlarm = NULL;
+  SYSTIME_US_TIMER->INTENCLR = TIMER_INTENCLR_COMPARE0_Msk;
+
+} /* end SysTimeAlarmCancel() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SysTimeAlarmSlackUs
+
+Description:
+Returns how long until the microsecond alarm fires, so blocking work (e.g. flash programming) can be fitted in
+before it.
+
+Requires:
+  -
+
+Promises:
+  - Returns the microseconds until the pending alarm (0 if it is due), or SYSTIME_NO_DEADLINE if none is set
+*/
+u32 SysTimeAlarmSlackUs(void)
+{
+  s32 s32Slack;
+
+  if(SysTime_pfnAlarm == NULL)
+  {
+    return(SYSTIME_NO_DEADLINE);
+  }
+
+  s32Slack = (s32)(SysTime_u32AlarmTime - SysTimeGetUs());
+  if(s32Slack < 0)
+  {
+    return(0);
+  }
+
+  return( (u32)s32Slack );
+
+} /* end SysTimeAlarmSlackUs() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SysTimeInitialize
+
+Description:
+Zeroes the system time counters and disarms all deadline slots.
+
+Requires:
+  - System tick is not yet running
+
+Promises:
+  - G_u32SystemTime1ms, G_u32SystemTime1s and the 64-bit epoch are 0
+  - All deadline slots are disarmed
+*/
+void SysTimeInitialize(void)
+{
+  G_u32SystemTime1ms = 0;
+  G_u32SystemTime1s  = 0;
+
+  SysTime_u32HalfEpochs  = 0;
+  SysTime_u16MsToSecond  = SYSTIME_MS_PER_SECOND;
+  SysTime_u32ArmedSlots  = 0;
+
+  /* Microsecond time base: free running, interrupt on each wrap to extend it to 32 bits */
+  SysTime_u16UsHigh = 0;
+  SysTime_pfnAlarm  = NULL;
+
+  SYSTIME_US_TIMER->TASKS_STOP = 1;
+  SYSTIME_US_TIMER->MODE       = TIMER_MODE_MODE_Timer << TIMER_MODE_MODE_Pos;
+  SYSTIME_US_TIMER->BITMODE    = TIMER_BITMODE_BITMODE_16Bit << TIMER_BITMODE_BITMODE_Pos;
+  SYSTIME_US_TIMER->PRESCALER  = SYSTIME_US_PRESCALER;
+  SYSTIME_US_TIMER->CC[SYSTIME_US_CC_WRAP] = 0;
+  SYSTIME_US_TIMER->EVENTS_COMPARE[SYSTIME_US_CC_WRAP] = 0;
+  SYSTIME_US_TIMER->INTENSET   = TIMER_INTENSET_COMPARE3_Msk;
+  SYSTIME_US_TIMER->TASKS_CLEAR = 1;
+
+  NVIC_SetPriority(TIMER2_IRQn, SYSTIME_US_PRIORITY);
+  NVIC_ClearPendingIRQ(TIMER2_IRQn);
+  NVIC_EnableIRQ(TIMER2_IRQn);
+
+  SYSTIME_US_TIMER->TASKS_START = 1;
+
+} /* end SysTimeInitialize() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SysTimeTick
+
+Description:
+Advances system time by 1ms.  This is the only place the system time counters are written.
+
+Requires:
+  - Called exactly once per 1ms system tick
+
+Promises:
+  - G_u32SystemTime1ms is incremented and the epoch count follows its MSB
+  - G_u32SystemTime1s is incremented every 1000 calls
+*/
+void SysTimeTick(void)
+{
+  u32 u32Now = G_u32SystemTime1ms + 1;
+
+  /* Low word first, then the epoch count (SysTimeGetMs64 relies on this order) */
+  G_u32SystemTime1ms = u32Now;
+  SysTime_u32HalfEpochs += ((u32Now >> 31) ^ SysTime_u32HalfEpochs) & 1;
+
+  if(--SysTime_u16MsToSecond == 0)
+  {
+    SysTime_u16MsToSecond = SYSTIME_MS_PER_SECOND;
+    G_u32SystemTime1s++;
+  }
+
+} /* end SysTimeTick() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------
+Interrupt handler: TIMER2_IRQHandler
+
+Description:
+Counts wraps of the microsecond timer and runs the alarm callback.
+
+Requires:
+  - TIMER2 set up by SysTimeInitialize()
+
+Promises:
+  - SysTime_u16UsHigh is incremented on each wrap and a far alarm is re-armed once it is in range
+  - A due alarm is cleared and its callback is run (the callback may set the next alarm)
+*/
+void TIMER2_IRQHandler(void)
+{
+  fnSysTimeAlarmType pfnAlarm;
+
+  /* Count the wrap first so every time read below is correct */
+  if(SYSTIME_US_TIMER->EVENTS_COMPARE[SYSTIME_US_CC_WRAP])
+  {
+    SYSTIME_US_TIMER->EVENTS_COMPARE[SYSTIME_US_CC_WRAP] = 0;
+    SysTime_u16UsHigh++;
+
+    if(SysTime_pfnAlarm != NULL)
+    {
+      SysTimeAlarmArm();
+    }
+  }
+
+  if(SYSTIME_US_TIMER->EVENTS_COMPARE[SYSTIME_US_CC_ALARM])
+  {
+    SYSTIME_US_TIMER->EVENTS_COMPARE[SYSTIME_US_CC_ALARM] = 0;
+
+    /* The compare also matches once per wrap while an alarm is out of range, so check the full time */
+    pfnAlarm = SysTime_pfnAlarm;
+    if( (pfnAlarm != NULL) && ((s32)(SysTimeGetUs() - SysTime_u32AlarmTime) >= 0) )
+    {
+      SysTime_pfnAlarm = NULL;
+      SYSTIME_US_TIMER->INTENCLR = TIMER_INTENCLR_COMPARE0_Msk;
+      pfnAlarm(SysTime_u32AlarmTime);
+    }
+  }
+
+} /* end TIMER2_IRQHandler() */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------------------------------------------------
+Function: SysTimeAlarmArm
+
+Description:
+Loads the alarm compare if the alarm is within reach of the 16-bit timer.
+
+Requires:
+  - SysTime_u32AlarmTime holds the alarm time
+
+Promises:
+  - CC[SYSTIME_US_CC_ALARM] matches the alarm time (or SYSTIME_US_ALARM_MIN_LEAD us from now if it is due) and
+    its interrupt is enabled; an alarm out of range is left for the wrap interrupt to arm
+  - A compare value that was passed while it was being written (e.g. the soft device held the CPU) is moved
+    forward so the alarm is never lost for a whole wrap
+*/
+void SysTimeAlarmArm(void)
+{
+  u32 u32Now;
+  u32 u32Compare;
+  s32 s32Lead;
+
+  do
+  {
+    u32Now = SysTimeGetUs();
+    s32Lead = (s32)(SysTime_u32AlarmTime - u32Now);
+    if(s32Lead > SYSTIME_US_ALARM_RANGE)
+    {
+      SYSTIME_US_TIMER->INTENCLR = TIMER_INTENCLR_COMPARE0_Msk;
+      return;
+    }
+
+    if(s32Lead < SYSTIME_US_ALARM_MIN_LEAD)
+    {
+      s32Lead = SYSTIME_US_ALARM_MIN_LEAD;
+    }
+
+    u32Compare = u32Now + (u32)s32Lead;
+    SYSTIME_US_TIMER->EVENTS_COMPARE[SYSTIME_US_CC_ALARM] = 0;
+    SYSTIME_US_TIMER->CC[SYSTIME_US_CC_ALARM] = (u16)u32Compare;
+    SYSTIME_US_TIMER->INTENSET = TIMER_INTENSET_COMPARE0_Msk;
+
+  } while( ((s32)(SysTimeGetUs() - u32Compare) >= 0) &&
+           (SYSTIME_US_TIMER->EVENTS_COMPARE[SYSTIME_US_CC_ALARM] == 0) );
+
+} /* end SysTimeAlarmArm() */
+
+
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
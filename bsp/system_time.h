@@ -0,0 +1,90 @@
+/**********************************************************************************************************************
+File: system_time.h
+
+Description:
+Header file for system_time.c source.
+**********************************************************************************************************************/
+
+#ifndef __SYSTEM_TIME_H
+#define __SYSTEM_TIME_H
+
+/**********************************************************************************************************************
+Type Definitions
+**********************************************************************************************************************/
+/* A deadline is the absolute G_u32SystemTime1ms value at which it expires.  Comparisons are made with
+wrap-safe subtraction so a deadline may be at most SYSTIME_MAX_PERIOD ms in the future. */
+typedef u32 SysTimeDeadlineType;
+
+/* Deadline slots that can be armed so the sleep logic can ask for the nearest pending deadline.
+Add a slot for each module that needs to wake the system at a specific time. */
+typedef enum {SYSTIME_SLOT_POV = 0, SYSTIME_SLOT_BUTTONS, SYSTIME_SLOT_LEDS, SYSTIME_SLOT_ACCEL,
+              SYSTIME_SLOT_IMAGE_WRITER, SYSTIME_SLOT_ANT, SYSTIME_SLOTS} SysTimeSlotType;
+
+/* Microsecond alarm callback: runs in the TIMER2 interrupt and receives the time the alarm was set for */
+typedef void(*fnSysTimeAlarmType)(u32 u32AlarmTime_);
+
+
+/**********************************************************************************************************************
+Constants / Definitions
+**********************************************************************************************************************/
+#define SYSTIME_MS_PER_SECOND       (u16)1000               /* Number of 1ms ticks per 1s tick */
+#define SYSTIME_MAX_PERIOD          (u32)0x7FFFFFFF         /* Longest period that can be compared wrap-safe */
+#define SYSTIME_NO_DEADLINE         (u32)0xFFFFFFFF         /* Returned when no deadline slots are armed */
+
+/* Microsecond time base: TIMER2 runs free at 1 MHz in 16-bit mode and is extended to 32 bits by counting wraps
+in its interrupt.  CC[0] is the alarm, CC[1] captures the count for reads and CC[3] = 0 marks each wrap. */
+#define SYSTIME_US_TIMER            NRF_TIMER2
+#define SYSTIME_US_PRESCALER        (u32)4                  /* 16 MHz / 2^4 = 1 MHz */
+#define SYSTIME_US_PRIORITY         (u8)1                   /* Application high: LED column timing runs here */
+#define SYSTIME_US_CC_ALARM         (u8)0
+#define SYSTIME_US_CC_CAPTURE       (u8)1
+#define SYSTIME_US_CC_WRAP          (u8)3
+#define SYSTIME_US_ALARM_RANGE      (s32)0xFFFF             /* Furthest alarm the 16-bit compare can reach */
+#define SYSTIME_US_ALARM_MIN_LEAD   (s32)4                  /* Alarms due sooner fire this many us from now */
+
+
+/**********************************************************************************************************************
+Function Declarations
+**********************************************************************************************************************/
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Public functions                                                                                                   */
+/*--------------------------------------------------------------------------------------------------------------------*/
+u32 SysTimeGetMs(void);
+u64 SysTimeGetMs64(void);
+u32 SysTimeElapsed(u32 u32StartTime_);
+
+SysTimeDeadlineType SysTimeDeadlineSet(u32 u32Period_);
+bool SysTimeDeadlineExpired(SysTimeDeadlineType u32Deadline_);
+u32 SysTimeDeadlineRemaining(SysTimeDeadlineType u32Deadline_);
+
+void SysTimeSlotArm(SysTimeSlotType eSlot_, u32 u32Period_);
+void SysTimeSlotDisarm(SysTimeSlotType eSlot_);
+u32 SysTimeNextDeadline(void);
+
+u32 SysTimeGetUs(void);
+void SysTimeAlarmSet(u32 u32AlarmTime_, fnSysTimeAlarmType pfnAlarm_);
+void SysTimeAlarmCancel(void);
+u32 SysTimeAlarmSlackUs(void);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Protected functions                                                                                                */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void SysTimeInitialize(void);
+void SysTimeTick(void);
+void TIMER2_IRQHandler(void);
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* Private functions                                                                                                  */
+/*--------------------------------------------------------------------------------------------------------------------*/
+void SysTimeAlarmArm(void);
+
+
+#endif /* __SYSTEM_TIME_H */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
@@ -57,27 +57,8 @@ Promises:
 */
 bool IsTimeUp(u32 *pu32SavedTick_, u32 u32Period_)
 {
-  u32 u32TimeElapsed;
-  
-  /* Check to see if the timer in question has rolled */
-  if(G_u32SystemTime1ms >= *pu32SavedTick_)
-  {
-    u32TimeElapsed = G_u32SystemTime1ms - *pu32SavedTick_;
-  }
-  else
-  {
-    u32TimeElapsed = (0xFFFFFFFF - *pu32SavedTick_) + G_u32SystemTime1ms;
-  }
-
-  /* Now determine if time is up */
-  if(u32TimeElapsed < u32Period_)
-  {
-    return(false);
-  }
-  else
-  {
-    return(true);
-  }
+  /* Unsigned subtraction handles rollover so no special case is needed */
+  return( SysTimeElapsed(*pu32SavedTick_) >= u32Period_ );
 
 } /* end IsTimeUp() */
 
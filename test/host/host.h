@@ -0,0 +1,111 @@
+/**********************************************************************************************************************
+File: host.h
+
+Description:
+Stub header for the host tests.  A test includes this first and then the firmware source file(s) it tests, so each
+test is one translation unit built with the native gcc:
+
+  #include "host.h"
+  #include "system_time.c"
+
+The nRF51 peripherals used by the modules are redirected to RAM copies of their register blocks (Host_sTimer1
+etc.) that a test can read and poke.  NVIC, SCB and the sleep instructions are stubbed out; __WFE() calls
+HostWaitForEvent(), which each test that sleeps must define to move its simulated time on.
+
+CHECK() counts a failure and prints where it happened; HostResult() prints the totals and gives the exit code.
+**********************************************************************************************************************/
+
+#ifndef __HOST_H
+#define __HOST_H
+
+#include <stdio.h>
+#include "configuration.h"
+
+/* The firmware also uses NULL for the '\0' character, as the target compiler allows */
+#undef NULL
+#define NULL 0
+
+/**********************************************************************************************************************
+Peripherals in RAM
+**********************************************************************************************************************/
+NRF_TIMER_Type  Host_sTimer1;
+NRF_TIMER_Type  Host_sTimer2;
+NRF_ECB_Type    Host_sEcb;
+NRF_NVMC_Type   Host_sNvmc;
+NRF_GPIO_Type   Host_sGpio;
+NRF_GPIOTE_Type Host_sGpiote;
+NRF_CLOCK_Type  Host_sClock;
+NRF_POWER_Type  Host_sPower;
+NRF_RTC_Type    Host_sRtc1;
+NRF_FICR_Type   Host_sFicr;
+SCB_Type        Host_sScb;
+
+#undef NRF_TIMER1
+#undef NRF_TIMER2
+#undef NRF_ECB
+#undef NRF_NVMC
+#undef NRF_GPIO
+#undef NRF_GPIOTE
+#undef NRF_CLOCK
+#undef NRF_POWER
+#undef NRF_RTC1
+#undef NRF_FICR
+#undef SCB
+
+#define NRF_TIMER1  (&Host_sTimer1)
+#define NRF_TIMER2  (&Host_sTimer2)
+#define NRF_ECB     (&Host_sEcb)
+#define NRF_NVMC    (&Host_sNvmc)
+#define NRF_GPIO    (&Host_sGpio)
+#define NRF_GPIOTE  (&Host_sGpiote)
+#define NRF_CLOCK   (&Host_sClock)
+#define NRF_POWER   (&Host_sPower)
+#define NRF_RTC1    (&Host_sRtc1)
+#define NRF_FICR    (&Host_sFicr)
+#define SCB         (&Host_sScb)
+
+/* The CMSIS inlines write the real NVIC, so calls are replaced before the firmware sources see them */
+#define NVIC_EnableIRQ(IRQn_)             ((void)(IRQn_))
+#define NVIC_DisableIRQ(IRQn_)            ((void)(IRQn_))
+#define NVIC_SetPriority(IRQn_, u32Pri_)  ((void)(IRQn_), (void)(u32Pri_))
+#define NVIC_ClearPendingIRQ(IRQn_)       ((void)(IRQn_))
+#define NVIC_SetPendingIRQ(IRQn_)         ((void)(IRQn_))
+#define NVIC_SystemReset()                HostReset()
+#define __WFE()                           HostWaitForEvent()
+#define __SEV()
+#define __NOP()
+
+void HostWaitForEvent(void);
+void HostReset(void);
+
+
+/**********************************************************************************************************************
+Checks
+**********************************************************************************************************************/
+static u32 Host_u32Checks;
+static u32 Host_u32Failures;
+
+#define CHECK(bCondition_)                                                                      \
+  do                                                                                            \
+  {                                                                                             \
+    Host_u32Checks++;                                                                           \
+    if( !(bCondition_) )                                                                        \
+    {                                                                                           \
+      Host_u32Failures++;                                                                       \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #bCondition_);                    \
+    }                                                                                           \
+  } while(0)
+
+static int HostResult(const char* pcName_)
+{
+  printf("%s: %u checks, %u failed\n", pcName_, (unsigned)Host_u32Checks, (unsigned)Host_u32Failures);
+  return(Host_u32Failures != 0);
+}
+
+
+#endif /* __HOST_H */
+
+
+/*--------------------------------------------------------------------------------------------------------------------*/
+/* End of File                                                                                                        */
+/*--------------------------------------------------------------------------------------------------------------------*/
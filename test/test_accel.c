@@ -0,0 +1,394 @@
+/**********************************************************************************************************************
+File: test_accel.c
+
+Description:
+Host tests for the accelerometer driver's taps (accelerometer_lis2dh.c).  The I2C master is replaced by a model of
+the LIS2DH register file, and the sensor samples at the rate CTRL_REG1 sets.  Each sample goes through a model of
+the click engine on Z, which takes its threshold, timing and enables from the CLICK_* and TIME_* registers the
+driver wrote:
+
+  - a click is the acceleration going over CLICK_THS and back under within TIME_LIMIT samples
+  - after a click, TIME_LATENCY samples are ignored (ringing), then a second click that starts within TIME_WINDOW
+    samples makes a double click
+  - CLICK_SRC holds the last click until it is read, and INT2 rises if CTRL_REG6 routes clicks to it; the GPIOTE IN
+    event is passed to AccelTapInterrupt() as GPIOTE_IRQHandler would
+
+Gravity (1 g on Z, the wand held upright) only reaches the engine if CTRL_REG2 leaves the click high pass filter off.
+Taps are pulses on Z at times in ms, and the main loop runs AccelUpdate() and AccelGetTap() once per 1 ms tick.
+**********************************************************************************************************************/
+
+#include "host.h"
+#include "system_time.c"
+#include "accelerometer_lis2dh.c"
+
+#define TEST_GRAVITY            (s32)16384              /* 1 g, left justified at +/-2 g */
+#define TEST_THS_LSB            (s32)256                /* CLICK_THS: full scale / 128 */
+#define TEST_TAP                (s16)24000              /* 1.5 g */
+#define TEST_MAX_EVENTS         (u8)8
+
+/* Register bits the model reads (the driver writes whole register values) */
+#define TEST_CTRL_REG2_HPCLICK  (u8)0x04
+#define TEST_CTRL_REG3_I1_DRDY1 (u8)0x10
+#define TEST_CTRL_REG6_I2_CLICK (u8)0x80
+#define TEST_CLICK_CFG_ZS       (u8)0x10
+#define TEST_CLICK_CFG_ZD       (u8)0x20
+#define TEST_CLICK_SRC_Z        (u8)0x04
+
+/* A pulse on Z */
+typedef struct
+{
+  u32 u32StartMs;
+  u32 u32WidthMs;
+  s16 s16Z;
+} TestPulseType;
+
+/* A gesture AccelGetTap() returned */
+typedef struct
+{
+  u8 u8Taps;
+  u32 u32Ms;
+} TestTapType;
+
+volatile u32 G_u32SystemFlags;
+volatile u32 G_u32SystemTime1ms;
+volatile u32 G_u32SystemTime1s;
+
+static u8 Test_au8Registers[0x40];                     /* LIS2DH register file */
+static u32 Test_u32NowUs;
+static u32 Test_u32NextSampleUs;
+static s16 Test_s16Z;                                  /* Z acceleration now, without gravity */
+
+/* Click engine state, in samples */
+static u8 Test_u8ClickSamples;                         /* Samples over the threshold so far, 0 = not in a click */
+static u16 Test_u16SinceClick;                         /* Samples since the last single click ended */
+static bool Test_bClickArmed;                          /* A single click may still become a double */
+static u32 Test_u32Clicks;                             /* CLICK_SRC updates */
+
+static TestTapType Test_asTaps[TEST_MAX_EVENTS];
+static u8 Test_u8Taps;
+
+
+void PovMotionSample(s16 s16X_, u32 u32TimeUs_) { (void)s16X_; (void)u32TimeUs_; }
+void SystemWakeRequest(void) {}
+void nrf_delay_ms(uint32_t volatile u32Ms_) { (void)u32Ms_; }
+
+
+/* Sample period the output data rate in CTRL_REG1 sets */
+static u32 TestSamplePeriodUs(void)
+{
+  switch(Test_au8Registers[CTRL_REG1] >> 4)
+  {
+    case 2:  return(100000);
+    case 7:  return(2500);
+    default: return(0);
+  }
+}
+
+static void TestSetUs(u32 u32Us_)
+{
+  Test_u32NowUs = u32Us_;
+  SysTime_u16UsHigh = (u16)(u32Us_ >> 16);
+  NRF_TIMER2->CC[SYSTIME_US_CC_CAPTURE] = u32Us_ & 0xFFFF;
+}
+
+static void TestSetPin(u32 u32Pin_, bool bHigh_)
+{
+  if(bHigh_)
+  {
+    *(volatile u32*)&NRF_GPIO->IN |= u32Pin_;
+  }
+  else
+  {
+    *(volatile u32*)&NRF_GPIO->IN &= ~u32Pin_;
+  }
+}
+
+/* A click found: latch it in CLICK_SRC and pulse INT2 */
+static void TestClick(u8 u8Kind_)
+{
+  Test_au8Registers[CLICK_SRC] = _CLICK_SRC_IA | u8Kind_ | TEST_CLICK_SRC_Z;
+  Test_u32Clicks++;
+
+  if( (Test_au8Registers[CTRL_REG6] & TEST_CTRL_REG6_I2_CLICK) &&
+      (((NRF_GPIOTE->CONFIG[ACCEL_TAP_GPIOTE_CHANNEL] & GPIOTE_CONFIG_PSEL_Msk) >> GPIOTE_CONFIG_PSEL_Pos) ==
+       ACCEL_INT2_PIN_NUMBER) )
+  {
+    NRF_GPIOTE->EVENTS_IN[ACCEL_TAP_GPIOTE_CHANNEL] = 1;
+    if(NRF_GPIOTE->INTENSET & (GPIOTE_INTENSET_IN0_Msk << ACCEL_TAP_GPIOTE_CHANNEL))
+    {
+      AccelTapInterrupt();
+    }
+  }
+}
+
+/* One sample through the click engine and into the output registers */
+static void TestSensorSample(void)
+{
+  s32 s32Z = Test_s16Z;
+  u8 u8Cfg = Test_au8Registers[CLICK_CFG];
+  bool bOver;
+
+  if( !(Test_au8Registers[CTRL_REG2] & TEST_CTRL_REG2_HPCLICK) )
+  {
+    s32Z += TEST_GRAVITY;
+  }
+  bOver = (s32Z > (s32)(Test_au8Registers[CLICK_THS] & 0x7F) * TEST_THS_LSB) ||
+          (s32Z < -(s32)(Test_au8Registers[CLICK_THS] & 0x7F) * TEST_THS_LSB);
+
+  if(Test_u16SinceClick < 0xFFFF)
+  {
+    Test_u16SinceClick++;
+  }
+  if( Test_bClickArmed && (Test_u16SinceClick > Test_au8Registers[TIME_LATENCY] + Test_au8Registers[TIME_WINDOW]) )
+  {
+    Test_bClickArmed = false;
+  }
+
+  if(bOver)
+  {
+    /* Ringing in the latency after a click does not start one */
+    if( (Test_u8ClickSamples != 0) || !Test_bClickArmed || (Test_u16SinceClick > Test_au8Registers[TIME_LATENCY]) )
+    {
+      if(Test_u8ClickSamples < 0xFF)
+      {
+        Test_u8ClickSamples++;
+      }
+    }
+  }
+  else if(Test_u8ClickSamples != 0)
+  {
+    if(Test_u8ClickSamples <= Test_au8Registers[TIME_LIMIT])
+    {
+      if(Test_bClickArmed)
+      {
+        Test_bClickArmed = false;
+        if(u8Cfg & TEST_CLICK_CFG_ZD)
+        {
+          TestClick(_CLICK_SRC_DCLICK);
+        }
+      }
+      else
+      {
+        Test_bClickArmed = true;
+        Test_u16SinceClick = 0;
+        if(u8Cfg & TEST_CLICK_CFG_ZS)
+        {
+          TestClick(_CLICK_SRC_SCLICK);
+        }
+      }
+    }
+    Test_u8ClickSamples = 0;
+  }
+
+  /* Data ready on INT1 */
+  if(Test_au8Registers[STATUS_REG2] & _STATUS_REG2_ZYXDA)
+  {
+    Test_au8Registers[STATUS_REG2] |= _STATUS_REG2_ZYXOR;
+  }
+  Test_au8Registers[STATUS_REG2] |= _STATUS_REG2_ZYXDA;
+  Test_au8Registers[OUT_Z_L] = (u8)s32Z;
+  Test_au8Registers[OUT_Z_H] = (u8)(s32Z >> 8);
+  TestSetPin(P0_23_ACCEL_INT1, (Test_au8Registers[CTRL_REG3] & TEST_CTRL_REG3_I1_DRDY1) != 0);
+}
+
+bool I2cMasterWrite(u8 u8Address_, const u8* pu8Data_, u8 u8Length_)
+{
+  u8 u8Register = pu8Data_[0] & ~AUTO_INCREMENT;
+
+  CHECK(u8Address_ == LIS2DH_ADDRESS);
+  for(u8 i = 1; i < u8Length_; i++)
+  {
+    Test_au8Registers[u8Register & 0x3F] = pu8Data_[i];
+    if(pu8Data_[0] & AUTO_INCREMENT)
+    {
+      u8Register++;
+    }
+  }
+  return(true);
+}
+
+bool I2cMasterWriteRead(u8 u8Address_, u8 u8Register_, u8* pu8Data_, u8 u8Length_)
+{
+  u8 u8Register = u8Register_ & ~AUTO_INCREMENT;
+
+  CHECK(u8Address_ == LIS2DH_ADDRESS);
+  for(u8 i = 0; i < u8Length_; i++)
+  {
+    pu8Data_[i] = (u8Register == WHO_AM_I) ? I_AM : Test_au8Registers[u8Register & 0x3F];
+    if(u8Register == CLICK_SRC)
+    {
+      Test_au8Registers[CLICK_SRC] = 0;
+    }
+    if(u8Register == OUT_Z_H)
+    {
+      Test_au8Registers[STATUS_REG2] = 0;
+      TestSetPin(P0_23_ACCEL_INT1, false);
+    }
+    if(u8Register_ & AUTO_INCREMENT)
+    {
+      u8Register++;
+    }
+  }
+  return(true);
+}
+
+
+static void TestStart(void)
+{
+  memset(Test_au8Registers, 0, sizeof(Test_au8Registers));
+  memset(&Host_sGpiote, 0, sizeof(Host_sGpiote));
+  Test_u8ClickSamples = 0;
+  Test_u16SinceClick = 0xFFFF;
+  Test_bClickArmed = false;
+  Test_u32Clicks = 0;
+  Test_s16Z = 0;
+  Test_u8Taps = 0;
+
+  AccelInitialize();
+  Test_u32NextSampleUs = Test_u32NowUs + TestSamplePeriodUs();
+}
+
+/* Runs the sensor and the main loop for u32Ms_ ticks, with the pulses on Z, times from now */
+static void TestRun(u32 u32Ms_, const TestPulseType* psPulses_, u8 u8Pulses_)
+{
+  u32 u32StartUs = Test_u32NowUs;
+  u32 u32Us;
+  u8 u8Taps;
+
+  for(u32 u32Ms = 0; u32Ms < u32Ms_; u32Ms++)
+  {
+    /* The sensor samples during the tick */
+    while((s32)(u32StartUs + (u32Ms + 1) * 1000 - Test_u32NextSampleUs) > 0)
+    {
+      u32Us = Test_u32NextSampleUs - u32StartUs;
+      Test_s16Z = 0;
+      for(u8 i = 0; i < u8Pulses_; i++)
+      {
+        if( (u32Us >= psPulses_[i].u32StartMs * 1000) &&
+            (u32Us < (psPulses_[i].u32StartMs + psPulses_[i].u32WidthMs) * 1000) )
+        {
+          Test_s16Z = psPulses_[i].s16Z;
+        }
+      }
+      TestSensorSample();
+      Test_u32NextSampleUs += TestSamplePeriodUs();
+    }
+
+    TestSetUs(u32StartUs + (u32Ms + 1) * 1000);
+    SysTimeTick();
+    AccelUpdate();
+    if( AccelGetTap(&u8Taps) && (Test_u8Taps < TEST_MAX_EVENTS) )
+    {
+      Test_asTaps[Test_u8Taps].u8Taps = u8Taps;
+      Test_asTaps[Test_u8Taps].u32Ms = u32Ms + 1;
+      Test_u8Taps++;
+    }
+  }
+}
+
+
+/* The click engine is set up from the driver's registers: Z single and double, high pass, INT2 on a GPIOTE event */
+static void TestConfigure(void)
+{
+  TestStart();
+  CHECK(G_u32AccelFlags & _ACCEL_FLAGS_PRESENT);
+  CHECK(Test_au8Registers[CLICK_CFG] == CLICK_CFG_INIT);
+  CHECK(Test_au8Registers[CLICK_THS] == CLICK_THS_INIT);
+  CHECK(Test_au8Registers[TIME_LIMIT] == TIME_LIMIT_INIT);
+  CHECK(Test_au8Registers[TIME_LATENCY] == TIME_LATENCY_INIT);
+  CHECK(Test_au8Registers[TIME_WINDOW] == TIME_WINDOW_INIT);
+  CHECK(Test_au8Registers[CTRL_REG2] & TEST_CTRL_REG2_HPCLICK);
+  CHECK(Test_au8Registers[CTRL_REG6] & TEST_CTRL_REG6_I2_CLICK);
+  CHECK(TestSamplePeriodUs() == 2500);
+
+  /* Held still: gravity is filtered out, so nothing is a click */
+  TestRun(1000, NULL, 0);
+  CHECK(Test_u32Clicks == 0);
+  CHECK(Test_u8Taps == 0);
+}
+
+/* One tap is reported once no second can follow; two make one double, reported at once */
+static void TestTaps(void)
+{
+  const TestPulseType asSingle[] = {{100, 5, TEST_TAP}};
+  const TestPulseType asDouble[] = {{100, 5, TEST_TAP}, {220, 5, -TEST_TAP}};
+  const TestPulseType asApart[]  = {{100, 5, TEST_TAP}, {600, 5, TEST_TAP}};
+
+  TestStart();
+  TestRun(1000, asSingle, 1);
+  CHECK(Test_u32Clicks == 1);
+  CHECK(Test_u8Taps == 1);
+  CHECK(Test_asTaps[0].u8Taps == 1);
+  CHECK(Test_asTaps[0].u32Ms >= 105 + ACCEL_TAP_SINGLE_MS);
+  CHECK(Test_asTaps[0].u32Ms <= 105 + ACCEL_TAP_SINGLE_MS + 3);
+  printf("tap, single reported %u ms after the tap", (unsigned)(Test_asTaps[0].u32Ms - 100));
+
+  TestStart();
+  TestRun(1000, asDouble, 2);
+  CHECK(Test_u32Clicks == 2);
+  CHECK(Test_u8Taps == 1);
+  CHECK(Test_asTaps[0].u8Taps == 2);
+  CHECK(Test_asTaps[0].u32Ms <= 225 + 3);
+  printf(", double %u ms after the second\n", (unsigned)(Test_asTaps[0].u32Ms - 220));
+
+  /* Further apart than latency and window: two singles */
+  TestStart();
+  TestRun(1500, asApart, 2);
+  CHECK(Test_u8Taps == 2);
+  CHECK( (Test_asTaps[0].u8Taps == 1) && (Test_asTaps[1].u8Taps == 1) );
+}
+
+/* What the engine must not take for a tap: a push held past TIME_LIMIT, a knock under CLICK_THS, and ringing
+inside TIME_LATENCY, which leaves a single tap */
+static void TestRejects(void)
+{
+  const TestPulseType asPush[]  = {{100, 60, TEST_TAP}};
+  const TestPulseType asSoft[]  = {{100, 5, (s16)((CLICK_THS_INIT - 2) * TEST_THS_LSB)}};
+  const TestPulseType asRing[]  = {{100, 5, TEST_TAP}, {130, 5, -TEST_TAP}};
+
+  TestStart();
+  TestRun(1000, asPush, 1);
+  TestRun(1000, asSoft, 1);
+  CHECK(Test_u32Clicks == 0);
+  CHECK(Test_u8Taps == 0);
+
+  TestStart();
+  TestRun(1000, asRing, 2);
+  CHECK(Test_u8Taps == 1);
+  CHECK(Test_asTaps[0].u8Taps == 1);
+}
+
+/* The idle profile slows the sensor to 10 Hz and loads click timing counted in its samples */
+static void TestIdleProfile(void)
+{
+  const TestPulseType asSingle[] = {{150, 100, TEST_TAP}};
+
+  TestStart();
+  AccelSetProfile(ACCEL_PROFILE_IDLE);
+  Test_u32NextSampleUs = Test_u32NowUs + TestSamplePeriodUs();
+  CHECK(TestSamplePeriodUs() == 100000);
+  CHECK(Test_au8Registers[TIME_LIMIT] == ACCEL_IDLE_TIME_LIMIT);
+  CHECK(Test_au8Registers[TIME_LATENCY] == ACCEL_IDLE_TIME_LATENCY);
+  CHECK(Test_au8Registers[TIME_WINDOW] == ACCEL_IDLE_TIME_WINDOW);
+
+  TestRun(1500, asSingle, 1);
+  CHECK(Test_u8Taps == 1);
+  CHECK(Test_asTaps[0].u8Taps == 1);
+  CHECK(Test_asTaps[0].u32Ms >= 300 + ACCEL_IDLE_SINGLE_TAP_MS);
+
+  /* And back: the fast click timing returns with the rate */
+  AccelSetProfile(ACCEL_PROFILE_SWING);
+  CHECK(TestSamplePeriodUs() == 2500);
+  CHECK(Test_au8Registers[TIME_LIMIT] == TIME_LIMIT_INIT);
+}
+
+
+int main(void)
+{
+  TestConfigure();
+  TestTaps();
+  TestRejects();
+  TestIdleProfile();
+
+  return(HostResult("test_accel"));
+}
@@ -0,0 +1,325 @@
+/**********************************************************************************************************************
+File: test_aes_ctr.c
+
+Description:
+Host tests for the AES-128 counter mode stream (aes_ctr.c) against a software AES.  The ECB is emulated by
+TestEcbService(): every STARTECB task is run through the software AES on the module's ECB data structure and
+ECB_IRQHandler() is called with ENDECB (or ERRORECB when a failure is injected), as the peripheral would.  The
+reference keystream is the software AES of [nonce, zeros, big endian block number], checked first against the
+FIPS-197 example so both sides do not share a mistake.
+
+AesCtrXor() waits for the interrupt when the ring runs dry, which cannot happen on the host, so no piece of the
+stream here is longer than the ring holds.
+**********************************************************************************************************************/
+
+#include "host.h"
+#include "aes_ctr.c"
+
+#define TEST_STREAM_SIZE      (u32)4200               /* Past block 255, so the counter carries a byte */
+#define TEST_PIECE_MAX        (u16)((AES_CTR_RING_BLOCKS - 1) * AES_CTR_BLOCK_SIZE)
+
+volatile u32 G_u32SystemFlags;
+volatile u32 G_u32SystemTime1ms;
+volatile u32 G_u32SystemTime1s;
+
+static u8 Test_au8Sbox[256];
+static u32 Test_u32EcbFailures;                        /* ECB runs to abort with ERRORECB */
+static u32 Test_u32Seed = 1;
+
+static const u8 Test_au8Key[AES_CTR_KEY_SIZE] =
+{
+  0x2B, 0x7E, 0x15, 0x16, 0x28, 0xAE, 0xD2, 0xA6, 0xAB, 0xF7, 0x15, 0x88, 0x09, 0xCF, 0x4F, 0x3C
+};
+static const u8 Test_au8Nonce[AES_CTR_NONCE_SIZE] = {0xF0, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6};
+
+static u8 Test_au8Plain[TEST_STREAM_SIZE];
+static u8 Test_au8Cipher[TEST_STREAM_SIZE];            /* Reference encryption of Test_au8Plain */
+static u8 Test_au8Work[TEST_STREAM_SIZE + 4];          /* Room to misalign the data */
+
+
+/* Software AES-128 (FIPS-197), encryption only */
+static u8 TestGfMultiply(u8 u8A_, u8 u8B_)
+{
+  u8 u8Product = 0;
+
+  while(u8B_)
+  {
+    if(u8B_ & 1)
+    {
+      u8Product ^= u8A_;
+    }
+    u8A_ = (u8)((u8A_ << 1) ^ ((u8A_ & 0x80) ? 0x1B : 0));
+    u8B_ >>= 1;
+  }
+  return(u8Product);
+}
+
+static void TestBuildSbox(void)
+{
+  u8 u8Inverse;
+  u8 u8Value;
+
+  for(u16 x = 0; x < 256; x++)
+  {
+    u8Inverse = 0;
+    for(u16 y = 1; (x != 0) && (y < 256); y++)
+    {
+      if(TestGfMultiply((u8)x, (u8)y) == 1)
+      {
+        u8Inverse = (u8)y;
+        break;
+      }
+    }
+
+    u8Value = u8Inverse;
+    for(u8 i = 1; i < 5; i++)
+    {
+      u8Value ^= (u8)((u8Inverse << i) | (u8Inverse >> (8 - i)));
+    }
+    Test_au8Sbox[x] = (u8)(u8Value ^ 0x63);
+  }
+}
+
+static void TestAesEncrypt(const u8* pu8Key_, const u8* pu8In_, u8* pu8Out_)
+{
+  u8 au8RoundKey[176];
+  u8 au8State[16];
+  u8 au8Column[4];
+  u8 u8Rcon = 1;
+  u8 u8Temp;
+
+  memcpy(au8RoundKey, pu8Key_, 16);
+  for(u8 i = 16; i < 176; i += 4)
+  {
+    memcpy(au8Column, &au8RoundKey[i - 4], 4);
+    if((i % 16) == 0)
+    {
+      u8Temp = au8Column[0];
+      au8Column[0] = (u8)(Test_au8Sbox[au8Column[1]] ^ u8Rcon);
+      au8Column[1] = Test_au8Sbox[au8Column[2]];
+      au8Column[2] = Test_au8Sbox[au8Column[3]];
+      au8Column[3] = Test_au8Sbox[u8Temp];
+      u8Rcon = TestGfMultiply(u8Rcon, 2);
+    }
+    for(u8 j = 0; j < 4; j++)
+    {
+      au8RoundKey[i + j] = (u8)(au8RoundKey[i + j - 16] ^ au8Column[j]);
+    }
+  }
+
+  for(u8 i = 0; i < 16; i++)
+  {
+    au8State[i] = (u8)(pu8In_[i] ^ au8RoundKey[i]);
+  }
+
+  for(u8 u8Round = 1; u8Round <= 10; u8Round++)
+  {
+    /* SubBytes and ShiftRows: byte r of column c comes from column c + r */
+    memcpy(pu8Out_, au8State, 16);
+    for(u8 c = 0; c < 4; c++)
+    {
+      for(u8 r = 0; r < 4; r++)
+      {
+        au8State[4 * c + r] = Test_au8Sbox[pu8Out_[4 * ((c + r) % 4) + r]];
+      }
+    }
+
+    if(u8Round != 10)
+    {
+      for(u8 c = 0; c < 4; c++)
+      {
+        memcpy(au8Column, &au8State[4 * c], 4);
+        for(u8 r = 0; r < 4; r++)
+        {
+          au8State[4 * c + r] = (u8)(TestGfMultiply(au8Column[r], 2) ^ TestGfMultiply(au8Column[(r + 1) % 4], 3) ^
+                                     au8Column[(r + 2) % 4] ^ au8Column[(r + 3) % 4]);
+        }
+      }
+    }
+
+    for(u8 i = 0; i < 16; i++)
+    {
+      au8State[i] ^= au8RoundKey[16 * u8Round + i];
+    }
+  }
+
+  memcpy(pu8Out_, au8State, 16);
+}
+
+/* Reference counter mode: block n of the keystream is AES(key, [nonce, zeros, n big endian]) */
+static void TestReferenceCtr(const u8* pu8In_, u8* pu8Out_, u32 u32Length_)
+{
+  u8 au8Counter[AES_CTR_BLOCK_SIZE];
+  u8 au8Keystream[AES_CTR_BLOCK_SIZE];
+
+  for(u32 u32Block = 0; (u32Block * AES_CTR_BLOCK_SIZE) < u32Length_; u32Block++)
+  {
+    memset(au8Counter, 0, sizeof(au8Counter));
+    memcpy(au8Counter, Test_au8Nonce, AES_CTR_NONCE_SIZE);
+    au8Counter[12] = (u8)(u32Block >> 24);
+    au8Counter[13] = (u8)(u32Block >> 16);
+    au8Counter[14] = (u8)(u32Block >> 8);
+    au8Counter[15] = (u8)u32Block;
+    TestAesEncrypt(Test_au8Key, au8Counter, au8Keystream);
+
+    for(u8 i = 0; (i < AES_CTR_BLOCK_SIZE) && ((u32Block * AES_CTR_BLOCK_SIZE + i) < u32Length_); i++)
+    {
+      pu8Out_[u32Block * AES_CTR_BLOCK_SIZE + i] = (u8)(pu8In_[u32Block * AES_CTR_BLOCK_SIZE + i] ^ au8Keystream[i]);
+    }
+  }
+}
+
+
+/* Emulated ECB: runs every started block to its interrupt */
+static void TestEcbService(void)
+{
+  while(NRF_ECB->TASKS_STARTECB)
+  {
+    NRF_ECB->TASKS_STARTECB = 0;
+    if(Test_u32EcbFailures != 0)
+    {
+      Test_u32EcbFailures--;
+      NRF_ECB->EVENTS_ERRORECB = 1;
+    }
+    else
+    {
+      TestAesEncrypt(AesCtr_pu8Key, AesCtr_pu8Counter, (u8*)AesCtr_pu32Keystream);
+      NRF_ECB->EVENTS_ENDECB = 1;
+    }
+    ECB_IRQHandler();
+  }
+}
+
+static u32 TestRandom(u32 u32Range_)
+{
+  Test_u32Seed = Test_u32Seed * 1664525 + 1013904223;
+  return( (Test_u32Seed >> 8) % u32Range_ );
+}
+
+/* Decrypts the reference ciphertext from u32Offset_ to the end in random pieces at u8Misalign_ bytes off a word */
+static bool TestStream(u32 u32Offset_, u8 u8Misalign_)
+{
+  u8* pu8Data = &Test_au8Work[u8Misalign_];
+  u32 u32Position = u32Offset_;
+  u16 u16Length;
+
+  memcpy(pu8Data, Test_au8Cipher, TEST_STREAM_SIZE);
+  if( !AesCtrStart(Test_au8Nonce, u32Offset_) )
+  {
+    return(false);
+  }
+
+  while(u32Position < TEST_STREAM_SIZE)
+  {
+    TestEcbService();
+    u16Length = (u16)(1 + TestRandom(TEST_PIECE_MAX));
+    if(u16Length > (TEST_STREAM_SIZE - u32Position))
+    {
+      u16Length = (u16)(TEST_STREAM_SIZE - u32Position);
+    }
+    if( !AesCtrXor(&pu8Data[u32Position], u16Length) )
+    {
+      return(false);
+    }
+    u32Position += u16Length;
+  }
+  AesCtrStop();
+
+  return( memcmp(&pu8Data[u32Offset_], &Test_au8Plain[u32Offset_], TEST_STREAM_SIZE - u32Offset_) == 0 );
+}
+
+
+static void TestReference(void)
+{
+  static const u8 au8Key[16] =
+  {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F
+  };
+  static const u8 au8Plain[16] =
+  {
+    0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77, 0x88, 0x99, 0xAA, 0xBB, 0xCC, 0xDD, 0xEE, 0xFF
+  };
+  static const u8 au8Cipher[16] =
+  {
+    0x69, 0xC4, 0xE0, 0xD8, 0x6A, 0x7B, 0x04, 0x30, 0xD8, 0xCD, 0xB7, 0x80, 0x70, 0xB4, 0xC5, 0x5A
+  };
+  u8 au8Out[16];
+
+  TestBuildSbox();
+  CHECK(Test_au8Sbox[0x00] == 0x63);
+  CHECK(Test_au8Sbox[0x53] == 0xED);
+  TestAesEncrypt(au8Key, au8Plain, au8Out);
+  CHECK(memcmp(au8Out, au8Cipher, sizeof(au8Out)) == 0);
+
+  for(u32 i = 0; i < TEST_STREAM_SIZE; i++)
+  {
+    Test_au8Plain[i] = (u8)(i * 13 + (i >> 7));
+  }
+  TestReferenceCtr(Test_au8Plain, Test_au8Cipher, TEST_STREAM_SIZE);
+}
+
+static void TestNoKey(void)
+{
+  u8 au8Data[4] = {0};
+
+  AesCtrInitialize();
+  CHECK(!AesCtrStart(Test_au8Nonce, 0));
+  CHECK(!AesCtrXor(au8Data, sizeof(au8Data)));
+  CHECK(NRF_ECB->TASKS_STARTECB == 0);
+}
+
+/* Whole streams in random pieces, aligned and not */
+static void TestStreams(void)
+{
+  AesCtrStatsType sStats;
+
+  AesCtrSetKey(Test_au8Key);
+  for(u8 u8Misalign = 0; u8Misalign < 4; u8Misalign++)
+  {
+    for(u8 i = 0; i < 8; i++)
+    {
+      CHECK(TestStream(0, u8Misalign));
+    }
+  }
+
+  /* Every block was made once and the ring never ran dry */
+  AesCtrGetStats(&sStats);
+  CHECK(sStats.u32Stalls == 0);
+  CHECK(sStats.u32Errors == 0);
+  CHECK(sStats.u32Blocks >= 32 * ((TEST_STREAM_SIZE + AES_CTR_BLOCK_SIZE - 1) / AES_CTR_BLOCK_SIZE));
+  CHECK(!AesCtrXor(Test_au8Work, 1));
+}
+
+/* Resuming part way through, as a resend from the acknowledged offset does */
+static void TestResume(void)
+{
+  for(u32 u32Offset = 0; u32Offset < TEST_STREAM_SIZE; u32Offset += 97)
+  {
+    CHECK(TestStream(u32Offset, (u8)(u32Offset & 0x3)));
+  }
+  CHECK(TestStream(256 * AES_CTR_BLOCK_SIZE - 3, 2));
+}
+
+/* Radio aborts: the block is run again and the stream is unchanged */
+static void TestEcbErrors(void)
+{
+  AesCtrStatsType sStats;
+
+  Test_u32EcbFailures = 5;
+  CHECK(TestStream(0, 1));
+  AesCtrGetStats(&sStats);
+  CHECK(sStats.u32Errors == 5);
+  CHECK(Test_u32EcbFailures == 0);
+}
+
+
+int main(void)
+{
+  TestReference();
+  TestNoKey();
+  TestStreams();
+  TestResume();
+  TestEcbErrors();
+
+  return(HostResult("test_aes_ctr"));
+}
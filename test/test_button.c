@@ -0,0 +1,226 @@
+/**********************************************************************************************************************
+File: test_button.c
+
+Description:
+Host tests for the button driver (buttons_abbcn.c).  A trace of pin levels is played through the PORT interrupt
+one millisecond at a time, with ButtonUpdate() run after every tick as the main loop would, and the events that
+come out are checked.  Bounce is a burst of edges a few milliseconds apart.  The microsecond time the edges are
+stamped with is set here: it moves on 1000us with every tick, and can be placed between ticks.
+**********************************************************************************************************************/
+
+#include "host.h"
+#include "system_time.c"
+#include "buttons_abbcn.c"
+
+#define TEST_ALL_RELEASED     (u32)(P0_07_BUTTON0 | P0_06_BUTTON1 | P0_05_BUTTON2 | P0_04_BUTTON3)
+
+volatile u32 G_u32SystemFlags;
+volatile u32 G_u32SystemTime1ms;
+volatile u32 G_u32SystemTime1s;
+
+static u32 Test_u32WakeRequests;                       /* SystemWakeRequest() calls */
+
+
+void SystemWakeRequest(void) { Test_u32WakeRequests++; }
+
+
+/* IN is read only in the register block */
+static void TestSetPins(u32 u32Levels_)
+{
+  *(volatile u32*)&NRF_GPIO->IN = u32Levels_;
+}
+
+
+static void TestStart(void)
+{
+  TestSetPins(TEST_ALL_RELEASED);
+  ButtonInitialize();
+}
+
+/* Sets the time SysTimeGetUs() returns */
+static void TestSetUs(u32 u32Us_)
+{
+  SysTime_u16UsHigh = (u16)(u32Us_ >> 16);
+  NRF_TIMER2->CC[SYSTIME_US_CC_CAPTURE] = u32Us_ & 0xFFFF;
+}
+
+/* Run the main loop for u32Ms_ ticks */
+static void TestRun(u32 u32Ms_)
+{
+  for(u32 i = 0; i < u32Ms_; i++)
+  {
+    TestSetUs(SysTimeGetUs() + 1000);
+    SysTimeTick();
+    ButtonUpdate();
+  }
+}
+
+/* Edge on BUTTON0 through the interrupt at the current time */
+static void TestEdge(bool bPressed_)
+{
+  if(bPressed_)
+  {
+    TestSetPins(NRF_GPIO->IN & ~P0_07_BUTTON0);
+  }
+  else
+  {
+    TestSetPins(NRF_GPIO->IN | P0_07_BUTTON0);
+  }
+
+  NRF_GPIOTE->EVENTS_PORT = 1;
+  ButtonPortInterrupt();
+}
+
+/* Edge on BUTTON0, then u32Ms_ ticks at the new level */
+static void TestLevel(bool bPressed_, u32 u32Ms_)
+{
+  TestEdge(bPressed_);
+  TestRun(u32Ms_);
+}
+
+/* A contact bounce: three short pulses before the level settles */
+static void TestBounce(bool bPressed_, u32 u32SettleMs_)
+{
+  for(u8 i = 0; i < 3; i++)
+  {
+    TestLevel(bPressed_, 2);
+    TestLevel(!bPressed_, 1);
+  }
+  TestLevel(bPressed_, u32SettleMs_);
+}
+
+static bool TestEvent(ButtonEventKindType eEvent_, u8 u8Clicks_)
+{
+  ButtonEventType sEvent;
+
+  return( ButtonGetEvent(&sEvent) && (sEvent.eButton == BUTTON0) && (sEvent.eEvent == eEvent_) &&
+          (sEvent.u8Clicks == u8Clicks_) );
+}
+
+
+static void TestClick(void)
+{
+  ButtonEventType sEvent;
+
+  TestStart();
+  Test_u32WakeRequests = 0;
+  TestBounce(true, 100);
+  CHECK(IsButtonPressed(BUTTON0));
+  CHECK(Test_u32WakeRequests == 7);
+  TestBounce(false, BUTTON_MULTI_CLICK_MS - 1);
+  CHECK(!IsButtonPressed(BUTTON0));
+
+  /* The click is held back until the multi-click window has closed */
+  CHECK(!ButtonGetEvent(&sEvent));
+  TestRun(BUTTON_DEBOUNCE_MS + 10);
+  CHECK(TestEvent(BUTTON_EVENT_CLICK, 1));
+  CHECK(!ButtonGetEvent(&sEvent));
+
+  /* Idle buttons leave the deadline disarmed */
+  CHECK(SysTimeNextDeadline() == SYSTIME_NO_DEADLINE);
+}
+
+static void TestDoubleClick(void)
+{
+  ButtonEventType sEvent;
+
+  TestStart();
+  TestBounce(true, 80);
+  TestBounce(false, 150);
+  TestBounce(true, 80);
+  TestBounce(false, BUTTON_MULTI_CLICK_MS + BUTTON_DEBOUNCE_MS);
+  CHECK(TestEvent(BUTTON_EVENT_CLICK, 2));
+  CHECK(!ButtonGetEvent(&sEvent));
+
+  /* Presses further apart than the window are two clicks */
+  TestLevel(true, 80);
+  TestLevel(false, BUTTON_MULTI_CLICK_MS + BUTTON_DEBOUNCE_MS + 50);
+  TestLevel(true, 80);
+  TestLevel(false, BUTTON_MULTI_CLICK_MS + BUTTON_DEBOUNCE_MS);
+  CHECK(TestEvent(BUTTON_EVENT_CLICK, 1));
+  CHECK(TestEvent(BUTTON_EVENT_CLICK, 1));
+}
+
+static void TestLongPress(void)
+{
+  ButtonEventType sEvent;
+
+  TestStart();
+  TestBounce(true, BUTTON_LONG_PRESS_MS - 10);
+  CHECK(!ButtonGetEvent(&sEvent));
+
+  /* Reported while still held, and the release makes no click */
+  TestRun(BUTTON_DEBOUNCE_MS + 10);
+  CHECK(IsButtonPressed(BUTTON0));
+  CHECK(TestEvent(BUTTON_EVENT_LONG_PRESS, 0));
+  TestBounce(false, BUTTON_MULTI_CLICK_MS + BUTTON_DEBOUNCE_MS);
+  CHECK(!ButtonGetEvent(&sEvent));
+}
+
+/* Pulses shorter than the debounce time are not presses */
+static void TestGlitch(void)
+{
+  ButtonEventType sEvent;
+
+  TestStart();
+  for(u8 i = 0; i < 20; i++)
+  {
+    TestLevel(true, BUTTON_DEBOUNCE_MS - 5);
+    TestLevel(false, 3);
+    CHECK(!IsButtonPressed(BUTTON0));
+  }
+  TestRun(BUTTON_MULTI_CLICK_MS + BUTTON_DEBOUNCE_MS);
+  CHECK(!ButtonGetEvent(&sEvent));
+
+  /* A button held through reset gives nothing when it is let go */
+  TestSetPins(TEST_ALL_RELEASED & ~P0_07_BUTTON0);
+  ButtonInitialize();
+  CHECK(IsButtonPressed(BUTTON0));
+  TestRun(BUTTON_LONG_PRESS_MS + 10);
+  TestLevel(false, BUTTON_MULTI_CLICK_MS + BUTTON_DEBOUNCE_MS);
+  CHECK(!ButtonGetEvent(&sEvent));
+}
+
+/* Edges between ticks are timed from the edge itself, not from the tick before it: a press 900us into a tick is
+accepted when BUTTON_DEBOUNCE_MS has passed since the edge, one tick later than a 1ms stamp would allow */
+static void TestEdgeTime(void)
+{
+  ButtonEventType sEvent;
+
+  TestStart();
+  TestSetUs(SysTimeGetUs() + 900);
+  TestEdge(true);
+  CHECK(!NRF_GPIOTE->EVENTS_PORT);
+  CHECK(Button_asStatus[BUTTON0].u32EdgeTimeUs == SysTimeGetUs());
+
+  /* 900us + (BUTTON_DEBOUNCE_MS - 1)ms: 100us short of the debounce time */
+  TestRun(BUTTON_DEBOUNCE_MS - 1);
+  CHECK(!IsButtonPressed(BUTTON0));
+  CHECK(SysTimeNextDeadline() == 1);
+
+  TestRun(1);
+  CHECK(IsButtonPressed(BUTTON0));
+  CHECK(Button_asStatus[BUTTON0].u32PressTimeUs == Button_asStatus[BUTTON0].u32EdgeTimeUs);
+
+  /* The press is timed from the edge too */
+  TestSetUs(Button_asStatus[BUTTON0].u32EdgeTimeUs + BUTTON_LONG_PRESS_US - 1);
+  ButtonUpdate();
+  CHECK(!ButtonGetEvent(&sEvent));
+  TestSetUs(Button_asStatus[BUTTON0].u32EdgeTimeUs + BUTTON_LONG_PRESS_US);
+  ButtonUpdate();
+  CHECK(TestEvent(BUTTON_EVENT_LONG_PRESS, 0));
+  TestLevel(false, BUTTON_MULTI_CLICK_MS + BUTTON_DEBOUNCE_MS);
+  CHECK(!ButtonGetEvent(&sEvent));
+}
+
+
+int main(void)
+{
+  TestClick();
+  TestDoubleClick();
+  TestLongPress();
+  TestGlitch();
+  TestEdgeTime();
+
+  return(HostResult("test_button"));
+}
@@ -0,0 +1,213 @@
+/**********************************************************************************************************************
+File: test_command.c
+
+Description:
+Host tests for the command dispatcher (command.c): the real table through the hash index, and a benchmark of
+the index against the linear SearchString() scan it replaced on a 64 command table.  The table is hashed at start
+up rather than at compile time, since the C preprocessor cannot hash strings.
+**********************************************************************************************************************/
+
+#include <time.h>
+#include "host.h"
+#include "system_time.c"
+#include "utilities.c"
+#include "command.c"
+
+#define TEST_BENCH_COMMANDS   (u8)64
+#define TEST_BENCH_LOOPS      (u32)200000
+
+volatile u32 G_u32SystemFlags;
+volatile u32 G_u32SystemTime1ms;
+volatile u32 G_u32SystemTime1s;
+
+static u32 Test_u32Calls;                              /* Handler calls */
+static u32 Test_au32Args[4];                           /* Arguments of the last handler call */
+
+
+/* The modules behind the real command table */
+void LedOn(LedNumberType eLED_) { Test_u32Calls++; Test_au32Args[0] = eLED_; }
+void LedOff(LedNumberType eLED_) { Test_u32Calls++; Test_au32Args[0] = eLED_; }
+void LedToggle(LedNumberType eLED_) { Test_u32Calls++; Test_au32Args[0] = eLED_; }
+void LedPWM(LedNumberType eLED_, LedRateType eRate_) { Test_u32Calls++; Test_au32Args[0] = eLED_; Test_au32Args[1] = eRate_; }
+void LedBlink(LedNumberType eLED_, LedRateType eRate_) { Test_u32Calls++; Test_au32Args[0] = eLED_; Test_au32Args[1] = eRate_; }
+void PovSyncSetRole(PovSyncRoleType eRole_) { Test_u32Calls++; Test_au32Args[0] = eRole_; }
+bool AntSetRfScheduling(bool bEnable_) { Test_u32Calls++; Test_au32Args[0] = bEnable_; return(true); }
+void PovClearColumnStats(void) { }
+bool AntSetPowerMode(bool bEnable_) { Test_u32Calls++; Test_au32Args[0] = bEnable_; return(true); }
+void RemoteSetEnabled(bool bEnable_) { Test_u32Calls++; Test_au32Args[0] = bEnable_; }
+bool RemotePair(u16 u16DeviceNumber_) { Test_u32Calls++; Test_au32Args[0] = u16DeviceNumber_; return(true); }
+void RemoteUnpairAll(void) { Test_u32Calls++; Test_au32Args[0] = 0; }
+void PovSetMotionMode(PovMotionType eMode_) { Test_u32Calls++; Test_au32Args[0] = eMode_; }
+void PovSetImageWidth(u32 u32Width_) { Test_u32Calls++; Test_au32Args[0] = u32Width_; }
+void PovSetCurrentBudget(u32 u32BudgetMa_) { Test_u32Calls++; Test_au32Args[0] = u32BudgetMa_; }
+
+bool ImageUploadSetKey(const u8* pu8Key_)
+{
+  Test_u32Calls++;
+  for(u8 i = 0; i < 4; i++)
+  {
+    Test_au32Args[i] = ((u32)pu8Key_[4 * i] << 24) | ((u32)pu8Key_[4 * i + 1] << 16) |
+                       ((u32)pu8Key_[4 * i + 2] << 8) | pu8Key_[4 * i + 3];
+  }
+  return(true);
+}
+
+
+static bool TestRun(const char* pcLine_)
+{
+  u8 au8Line[64];
+
+  strncpy((char*)au8Line, pcLine_, sizeof(au8Line));
+  Test_u32Calls = 0;
+  return( CommandDispatch(au8Line) && (Test_u32Calls == 1) );
+}
+
+static void TestTable(void)
+{
+  CommandInitialize();
+
+  CHECK(TestRun("LEDON 3\r\n") && (Test_au32Args[0] == 3));
+  CHECK(TestRun("  LEDPWM 2 15") && (Test_au32Args[0] == 2) && (Test_au32Args[1] == 15));
+  CHECK(TestRun("SYNC:2") && (Test_au32Args[0] == 2));
+  CHECK(TestRun("PAIR 4660") && (Test_au32Args[0] == 4660));
+  CHECK(TestRun("PAIR 0") && (Test_au32Args[0] == 0));
+  CHECK(TestRun("BUDGET 350") && (Test_au32Args[0] == 350));
+  CHECK(TestRun("KEY 1 2 3 4294967295") && (Test_au32Args[0] == 1) && (Test_au32Args[3] == 0xFFFFFFFF));
+
+  /* A key word that is missing, too big or not a number, or anything after the key, leaves the key alone */
+  CHECK(!TestRun("KEY 1 2 3 4294967296"));
+  CHECK(!TestRun("KEY 1 2 3 99999999999"));
+  CHECK(!TestRun("KEY 1 2 3"));
+  CHECK(!TestRun("KEY 1 2 3x 4"));
+  CHECK(!TestRun("KEY 1 2 3 4 5"));
+  CHECK(TestRun("KEY 5 6 7 8 \r\n") && (Test_au32Args[0] == 5) && (Test_au32Args[3] == 8));
+
+  /* Every name in the table is found */
+  for(u8 i = 0; i < COMMAND_TABLE_SIZE; i++)
+  {
+    Test_u32Calls = 0;
+    CHECK(CommandDispatch((u8*)Command_asCommandTable[i].pu8Name));
+  }
+
+  /* Prefixes, extensions, case and garbage are not */
+  CHECK(!TestRun("LED 1"));
+  CHECK(!TestRun("LEDONX 1"));
+  CHECK(!TestRun("ledon 1"));
+  CHECK(!TestRun(""));
+  CHECK(!TestRun("ABCDEFGHIJKLMNOPQRSTUVWXYZ"));
+  CHECK(Test_u32Calls == 0);
+}
+
+
+/* Benchmark: 64 generated names, every one dispatched in turn */
+static u8 Test_au8BenchNames[TEST_BENCH_COMMANDS][12];
+static CommandEntryType Test_asBenchTable[TEST_BENCH_COMMANDS];
+static u8 Test_au8BenchLines[TEST_BENCH_COMMANDS][24];
+
+static void TestBenchHandler(u8* pu8Arguments_)
+{
+  (void)pu8Arguments_;
+  Test_u32Calls++;
+}
+
+/* The dispatcher before the index: try each command name against the line in table order */
+static bool TestLinearDispatch(u8* pu8Line_)
+{
+  for(u8 i = 0; i < TEST_BENCH_COMMANDS; i++)
+  {
+    if(SearchString(pu8Line_, (u8*)Test_asBenchTable[i].pu8Name))
+    {
+      Test_asBenchTable[i].pfnHandler(pu8Line_);
+      return(true);
+    }
+  }
+  return(false);
+}
+
+static double TestSeconds(void)
+{
+  struct timespec sTime;
+
+  clock_gettime(CLOCK_MONOTONIC, &sTime);
+  return( (double)sTime.tv_sec + (double)sTime.tv_nsec * 1e-9 );
+}
+
+static void TestBenchmark(void)
+{
+  static const char* apcWords[] = {"LED", "ANT", "POV", "SYNC", "ACCEL", "IMAGE", "REMOTE", "KEY"};
+  static const char* apcVerbs[] = {"ON", "OFF", "SET", "GET", "RATE", "MODE", "STAT", "CLEAR"};
+  double dStart;
+  double dHashNs;
+  double dLinearNs;
+  double dLastHashNs;
+  double dLastLinearNs;
+  u8 u8Count = 0;
+
+  for(u8 w = 0; w < 8; w++)
+  {
+    for(u8 v = 0; v < 8; v++)
+    {
+      snprintf((char*)Test_au8BenchNames[u8Count], sizeof(Test_au8BenchNames[0]), "%s%s", apcWords[w], apcVerbs[v]);
+      Test_asBenchTable[u8Count].pu8Name = Test_au8BenchNames[u8Count];
+      Test_asBenchTable[u8Count].pfnHandler = TestBenchHandler;
+      snprintf((char*)Test_au8BenchLines[u8Count], sizeof(Test_au8BenchLines[0]), "%s 12 34\r", Test_au8BenchNames[u8Count]);
+      u8Count++;
+    }
+  }
+
+  CommandBuildIndex(Test_asBenchTable, TEST_BENCH_COMMANDS);
+
+  /* Both find every command */
+  Test_u32Calls = 0;
+  for(u8 i = 0; i < TEST_BENCH_COMMANDS; i++)
+  {
+    CHECK(CommandDispatch(Test_au8BenchLines[i]));
+    CHECK(TestLinearDispatch(Test_au8BenchLines[i]));
+  }
+  CHECK(Test_u32Calls == 2 * TEST_BENCH_COMMANDS);
+
+  dStart = TestSeconds();
+  for(u32 n = 0; n < TEST_BENCH_LOOPS; n++)
+  {
+    (void)CommandDispatch(Test_au8BenchLines[n % TEST_BENCH_COMMANDS]);
+  }
+  dHashNs = (TestSeconds() - dStart) * 1e9 / TEST_BENCH_LOOPS;
+
+  dStart = TestSeconds();
+  for(u32 n = 0; n < TEST_BENCH_LOOPS; n++)
+  {
+    (void)TestLinearDispatch(Test_au8BenchLines[n % TEST_BENCH_COMMANDS]);
+  }
+  dLinearNs = (TestSeconds() - dStart) * 1e9 / TEST_BENCH_LOOPS;
+
+  /* The last command in the table is the worst case for the scan */
+  dStart = TestSeconds();
+  for(u32 n = 0; n < TEST_BENCH_LOOPS; n++)
+  {
+    (void)CommandDispatch(Test_au8BenchLines[TEST_BENCH_COMMANDS - 1]);
+  }
+  dLastHashNs = (TestSeconds() - dStart) * 1e9 / TEST_BENCH_LOOPS;
+
+  dStart = TestSeconds();
+  for(u32 n = 0; n < TEST_BENCH_LOOPS; n++)
+  {
+    (void)TestLinearDispatch(Test_au8BenchLines[TEST_BENCH_COMMANDS - 1]);
+  }
+  dLastLinearNs = (TestSeconds() - dStart) * 1e9 / TEST_BENCH_LOOPS;
+
+  printf("benchmark, %u commands: hash index %.0f ns (last %.0f ns), SearchString scan %.0f ns (last %.0f ns)\n",
+         (unsigned)TEST_BENCH_COMMANDS, dHashNs, dLastHashNs, dLinearNs, dLastLinearNs);
+
+  /* The index must not fall behind the scan it replaced, on average or at the end of the table */
+  CHECK(dHashNs < dLinearNs);
+  CHECK(dLastHashNs < dLastLinearNs);
+}
+
+
+int main(void)
+{
+  TestTable();
+  TestBenchmark();
+
+  return(HostResult("test_command"));
+}
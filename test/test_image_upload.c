@@ -0,0 +1,570 @@
+/**********************************************************************************************************************
+File: test_image_upload.c
+
+Description:
+Host tests for the ANT upload service (image_upload.c) with the ANT driver, image writer, settings and system time
+compiled in over an emulated NVMC.  The image area and the settings pages are mapped at their real addresses.  The
+AES-CTR stream is a stub with a keyed test keystream (aes_ctr.c has its own test against AES), so what is checked
+here is which keystream position each page uses.  CommandDispatch() is a stub that records the lines it is given.
+
+The soft device is a set of sd_ant_* stubs: messages from the host are queued for sd_ant_event_get() and read by
+AntCaptureEvents() as the SD_EVT interrupt would, and the status broadcast is taken from
+sd_ant_broadcast_message_tx().  On top of that a simulated link plays the host side of a burst upload in simulated
+time: advanced burst packets at TEST_PACKET_US, a status broadcast every channel period, at most the advertised
+window past the acknowledged offset, resends after a failed burst, page erases that stall the main loop, and
+longer stalls that overflow the event queue.  The upload throughput is printed for each loss rate.
+**********************************************************************************************************************/
+
+#include <sys/mman.h>
+#include "host.h"
+#include "crc16.c"
+#include "system_time.c"
+#include "settings.c"
+#include "image_writer.c"
+#include "image_upload.c"
+#include "ant.c"
+
+#define TEST_FLASH_MAP_BASE     IMAGE_FLASH_START
+#define TEST_FLASH_MAP_SIZE     (u32)0x10000            /* Image area and both settings pages */
+#define TEST_LINES              (u8)8                   /* Command lines recorded */
+#define TEST_RADIO_QUEUE        (u8)32                  /* Soft device events waiting for sd_ant_event_get() */
+
+/* Simulated link: a 24 byte advanced burst packet every TEST_PACKET_US is about the 60 kbps ceiling */
+#define TEST_PACKET_BYTES       (u8)24
+#define TEST_PACKET_US          (u32)3200
+#define TEST_PERIOD_US          ANT_PERIOD_TO_US(ANT_CHANNEL_PERIOD)
+#define TEST_BURST_PACKETS      (u32)40                 /* Host splits the window into bursts of this many packets */
+#define TEST_STALL_US           (u32)80000              /* Main loop stall long enough to overflow the event queue */
+#define TEST_LINK_IMAGE_SIZE    (u32)(24 * IMAGE_PAGE_SIZE + 123)
+#define TEST_LINK_TIMEOUT_US    (u32)60000000
+
+volatile u32 G_u32SystemFlags;
+volatile u32 G_u32SystemTime1ms;
+volatile u32 G_u32SystemTime1s;
+volatile u32 G_u32AesCtrFlags;
+u32 G_u32PovFlags;
+
+static ANT_MESSAGE Test_asRadio[TEST_RADIO_QUEUE];      /* Soft device event queue */
+static u8 Test_au8RadioEvent[TEST_RADIO_QUEUE];
+static u8 Test_u8RadioHead;
+static u8 Test_u8RadioTail;
+static u8 Test_au8Status[IMAGE_UPLOAD_PAGE_SIZE];       /* Status broadcast on air */
+
+static u32 Test_u32NowUs;                               /* Simulated time */
+static u32 Test_u32BusyUntilUs;                         /* Main loop blocked (page erase or stall) until then */
+static u32 Test_u32Random;                              /* Loss pattern */
+
+static u8 Test_au8Key[AES_CTR_KEY_SIZE];               /* Key loaded in the AES-CTR stub */
+static u8 Test_au8StreamNonce[AES_CTR_NONCE_SIZE];     /* Stream the stub is running */
+static u32 Test_u32StreamOffset;
+
+static u8 Test_aau8Lines[TEST_LINES][IMAGE_UPLOAD_COMMAND_SIZE];  /* Lines passed to CommandDispatch() */
+static u8 Test_u8Lines;
+
+
+/* Emulated NVMC */
+void nrf_nvmc_write_word(uint32_t address, uint32_t value)
+{
+  *(volatile u32*)(uintptr_t)address &= value;
+}
+
+void nrf_nvmc_write_words(uint32_t address, const uint32_t* src, uint32_t num_words)
+{
+  for(u32 i = 0; i < num_words; i++)
+  {
+    nrf_nvmc_write_word(address + 4 * i, src[i]);
+  }
+}
+
+/* The CPU stops while the NVMC erases */
+void nrf_nvmc_page_erase(uint32_t address)
+{
+  memset((void*)(uintptr_t)address, 0xFF, IMAGE_PAGE_SIZE);
+  Test_u32BusyUntilUs = Test_u32NowUs + IMAGE_PAGE_ERASE_US;
+}
+
+void PovColumnAlarm(u32 u32AlarmTime_) { }
+void SystemWakeRequest(void) { }
+void softdevice_assert_callback(uint32_t ulPC, uint16_t usLineNum, const uint8_t *pucFileName) { }
+
+
+/* Soft device stubs: configuration calls succeed, events come from Test_asRadio */
+uint32_t sd_softdevice_enable(nrf_clock_lfclksrc_t clock_source, softdevice_assertion_handler_t assertion_handler)
+{
+  return(NRF_SUCCESS);
+}
+
+uint32_t sd_nvic_SetPriority(IRQn_Type IRQn, nrf_app_irq_priority_t priority) { return(NRF_SUCCESS); }
+uint32_t sd_nvic_EnableIRQ(IRQn_Type IRQn) { return(NRF_SUCCESS); }
+uint32_t sd_ant_adv_burst_config_set(uint8_t *pucConfigData, uint8_t ucSize) { return(NRF_SUCCESS); }
+uint32_t sd_ant_channel_assign(uint8_t ucChannel, uint8_t ucChannelType, uint8_t ucNetwork, uint8_t ucExtAssign)
+{
+  return(NRF_SUCCESS);
+}
+uint32_t sd_ant_channel_id_set(uint8_t ucChannel, uint16_t usDeviceNumber, uint8_t ucDeviceType,
+                               uint8_t ucTransmitType)
+{
+  return(NRF_SUCCESS);
+}
+uint32_t sd_ant_channel_period_set(uint8_t ucChannel, uint16_t usPeriod) { return(NRF_SUCCESS); }
+uint32_t sd_ant_channel_radio_freq_set(uint8_t ucChannel, uint8_t ucFreq) { return(NRF_SUCCESS); }
+uint32_t sd_ant_channel_radio_tx_power_set(uint8_t ucChannel, uint8_t ucTxPower) { return(NRF_SUCCESS); }
+uint32_t sd_ant_channel_open(uint8_t ucChannel) { return(NRF_SUCCESS); }
+uint32_t sd_ant_channel_close(uint8_t ucChannel) { return(NRF_SUCCESS); }
+uint32_t sd_ant_channel_unassign(uint8_t ucChannel) { return(NRF_SUCCESS); }
+uint32_t sd_ant_event_filtering_set(uint16_t usFilter) { return(NRF_SUCCESS); }
+uint32_t sd_ant_rfactive_notification_config_set(uint8_t ucMode, uint16_t usTimeThreshold) { return(NRF_SUCCESS); }
+uint32_t sd_ant_id_list_add(uint8_t ucChannel, uint8_t *pucDevId, uint8_t ucListIndex) { return(NRF_SUCCESS); }
+uint32_t sd_ant_id_list_config(uint8_t ucChannel, uint8_t ucIDListSize, uint8_t ucIncExcFlag) { return(NRF_SUCCESS); }
+uint32_t sd_ant_lib_config_set(uint8_t ucANTLibConfig) { return(NRF_SUCCESS); }
+uint32_t sd_ant_lib_config_clear(uint8_t ucANTLibConfig) { return(NRF_SUCCESS); }
+uint32_t sd_ant_rx_scan_mode_start(uint8_t ucSyncChannelPacketsOnly) { return(NRF_SUCCESS); }
+
+uint32_t sd_ant_broadcast_message_tx(uint8_t ucChannel, uint8_t ucSize, uint8_t *aucMesg)
+{
+  memcpy(Test_au8Status, aucMesg, IMAGE_UPLOAD_PAGE_SIZE);
+  return(NRF_SUCCESS);
+}
+
+uint32_t sd_ant_event_get(uint8_t *pucChannel, uint8_t *pucEvent, uint8_t *aucANTMesg)
+{
+  if(Test_u8RadioTail == Test_u8RadioHead)
+  {
+    return(NRF_ERROR_NOT_FOUND);
+  }
+
+  *pucChannel = ANT_CHANNEL_UPLOAD;
+  *pucEvent = Test_au8RadioEvent[Test_u8RadioTail];
+  memcpy(aucANTMesg, Test_asRadio[Test_u8RadioTail].aucMessage, sizeof(ANT_MESSAGE));
+  Test_u8RadioTail = (u8)((Test_u8RadioTail + 1) % TEST_RADIO_QUEUE);
+  return(NRF_SUCCESS);
+}
+
+
+/* AES-CTR stub: a keystream byte depends on the key, the nonce and its position in the stream */
+static u8 TestKeystream(const u8* pu8Key_, const u8* pu8Nonce_, u32 u32Position_)
+{
+  return( (u8)(pu8Key_[u32Position_ % AES_CTR_KEY_SIZE] ^ (pu8Nonce_[u32Position_ % AES_CTR_NONCE_SIZE] * 29) ^
+               (u32Position_ * 151) ^ (u32Position_ >> 8)) );
+}
+
+void AesCtrSetKey(const u8* pu8Key_)
+{
+  memcpy(Test_au8Key, pu8Key_, AES_CTR_KEY_SIZE);
+  G_u32AesCtrFlags = _AES_CTR_FLAGS_KEY_SET;
+}
+
+bool AesCtrStart(const u8* pu8Nonce_, u32 u32Offset_)
+{
+  if( !(G_u32AesCtrFlags & _AES_CTR_FLAGS_KEY_SET) )
+  {
+    return(false);
+  }
+
+  memcpy(Test_au8StreamNonce, pu8Nonce_, AES_CTR_NONCE_SIZE);
+  Test_u32StreamOffset = u32Offset_;
+  G_u32AesCtrFlags |= _AES_CTR_FLAGS_RUNNING;
+  return(true);
+}
+
+void AesCtrStop(void)
+{
+  G_u32AesCtrFlags &= ~_AES_CTR_FLAGS_RUNNING;
+}
+
+bool AesCtrXor(u8* pu8Data_, u16 u16Length_)
+{
+  if( !(G_u32AesCtrFlags & _AES_CTR_FLAGS_RUNNING) )
+  {
+    return(false);
+  }
+
+  for(u16 i = 0; i < u16Length_; i++)
+  {
+    pu8Data_[i] ^= TestKeystream(Test_au8Key, Test_au8StreamNonce, Test_u32StreamOffset++);
+  }
+  return(true);
+}
+
+
+/* Command stub: records the line, and KEY loads a key made from its first argument character */
+bool CommandDispatch(u8* pu8Line_)
+{
+  u8 au8Key[AES_CTR_KEY_SIZE];
+
+  if(Test_u8Lines < TEST_LINES)
+  {
+    strcpy((char*)Test_aau8Lines[Test_u8Lines++], (const char*)pu8Line_);
+  }
+
+  if(strncmp((const char*)pu8Line_, "KEY ", 4) == 0)
+  {
+    memset(au8Key, pu8Line_[4], sizeof(au8Key));
+    (void)ImageUploadSetKey(au8Key);
+  }
+  return(true);
+}
+
+
+/* Queues a soft device event; u8Length_ payload bytes follow the channel byte */
+static void TestRadioEvent(u8 u8Event_, u8 u8MessageId_, u8 u8ChannelByte_, const u8* pu8Payload_, u8 u8Length_)
+{
+  ANT_MESSAGE* psMessage = &Test_asRadio[Test_u8RadioHead];
+
+  memset(psMessage, 0, sizeof(ANT_MESSAGE));
+  psMessage->ANT_MESSAGE_ucSize = MESG_CHANNEL_NUM_SIZE + u8Length_;
+  psMessage->ANT_MESSAGE_ucMesgID = u8MessageId_;
+  psMessage->ANT_MESSAGE_ucChannel = u8ChannelByte_;
+  memcpy(psMessage->ANT_MESSAGE_aucPayload, pu8Payload_, u8Length_);
+  Test_au8RadioEvent[Test_u8RadioHead] = u8Event_;
+  Test_u8RadioHead = (u8)((Test_u8RadioHead + 1) % TEST_RADIO_QUEUE);
+}
+
+/* One pass of the main loop, unless a page erase or a stall has it blocked */
+static void TestMainLoop(void)
+{
+  if((s32)(Test_u32NowUs - Test_u32BusyUntilUs) >= 0)
+  {
+    AntUpdate();
+    ImageWriterUpdate();
+  }
+}
+
+/* Moves the simulated time on: the microsecond timer follows it and the 1ms tick runs */
+static void TestAdvance(u32 u32Us_)
+{
+  u32 u32Ms = (Test_u32NowUs + u32Us_) / 1000 - Test_u32NowUs / 1000;
+
+  Test_u32NowUs += u32Us_;
+  SysTime_u16UsHigh = (u16)(Test_u32NowUs >> 16);
+  NRF_TIMER2->CC[SYSTIME_US_CC_CAPTURE] = Test_u32NowUs & 0xFFFF;
+  for( ; u32Ms != 0; u32Ms--)
+  {
+    SysTimeTick();
+  }
+}
+
+static u32 TestRandom(void)
+{
+  Test_u32Random = Test_u32Random * 1103515245 + 12345;
+  return(Test_u32Random >> 16);
+}
+
+/* Host side: one message on the upload channel, read by the SD_EVT interrupt */
+static void TestSendPage(const u8* pu8Page_)
+{
+  TestRadioEvent(EVENT_RX, MESG_ACKNOWLEDGED_DATA_ID, ANT_CHANNEL_UPLOAD, pu8Page_, IMAGE_UPLOAD_PAGE_SIZE);
+  AntCaptureEvents();
+  TestMainLoop();
+
+  /* The next message goes a channel period later, when anything blocking the main loop is over */
+  TestAdvance(TEST_PERIOD_US);
+  TestMainLoop();
+}
+
+static void TestSendSession(u32 u32Nonce_)
+{
+  u8 au8Page[IMAGE_UPLOAD_PAGE_SIZE] = {IMAGE_UPLOAD_PAGE_SESSION, 0, 0, 0};
+
+  au8Page[4] = (u8)(u32Nonce_ >> 24);
+  au8Page[5] = (u8)(u32Nonce_ >> 16);
+  au8Page[6] = (u8)(u32Nonce_ >> 8);
+  au8Page[7] = (u8)u32Nonce_;
+  TestSendPage(au8Page);
+}
+
+/* Sends pcText_ (a multiple of 6 characters) from sequence u8Sequence_, encrypted under the key in pu8Key_ with
+session nonce u32Nonce_, or plain if pu8Key_ is NULL */
+static void TestSendText(const char* pcText_, u8 u8Sequence_, const u8* pu8Key_, u32 u32Nonce_)
+{
+  u8 au8Nonce[AES_CTR_NONCE_SIZE] = {0, 0, 0, (u8)(u32Nonce_ >> 24), (u8)(u32Nonce_ >> 16), (u8)(u32Nonce_ >> 8),
+                                     (u8)u32Nonce_};
+  u8 au8Page[IMAGE_UPLOAD_PAGE_SIZE];
+  u8 u8Text = IMAGE_UPLOAD_PAGE_SIZE - IMAGE_UPLOAD_COMMAND_TEXT;
+
+  for(u32 u32Sent = 0; u32Sent < strlen(pcText_); u32Sent += u8Text, u8Sequence_++)
+  {
+    au8Page[0] = IMAGE_UPLOAD_PAGE_COMMAND;
+    au8Page[1] = u8Sequence_;
+    memcpy(&au8Page[IMAGE_UPLOAD_COMMAND_TEXT], &pcText_[u32Sent], u8Text);
+    for(u8 i = 0; (pu8Key_ != NULL) && (i < u8Text); i++)
+    {
+      au8Page[IMAGE_UPLOAD_COMMAND_TEXT + i] ^=
+        TestKeystream(pu8Key_, au8Nonce, (u32)u8Sequence_ * AES_CTR_BLOCK_SIZE + i);
+    }
+    TestSendPage(au8Page);
+  }
+}
+
+static bool TestLine(u8 u8Line_, const char* pcLine_)
+{
+  return( (u8Line_ < Test_u8Lines) && (strcmp((const char*)Test_aau8Lines[u8Line_], pcLine_) == 0) );
+}
+
+
+/* Plain commands until a key is set; after that only encrypted sessions with fresh nonces */
+static void TestCommandSecurity(void)
+{
+  u8 au8KeyA[AES_CTR_KEY_SIZE];
+  u8 au8KeyB[AES_CTR_KEY_SIZE];
+  u8 au8Begin[IMAGE_UPLOAD_PAGE_SIZE] = {IMAGE_UPLOAD_PAGE_BEGIN, 0x00, 0x10, 0x00, 0x34, 0x12, 0, 0};
+  u8 au8Nonce[IMAGE_UPLOAD_PAGE_SIZE] = {IMAGE_UPLOAD_PAGE_NONCE, 9, 8, 7, 6, 5, 4, 3};
+
+  memset(au8KeyA, 'A', sizeof(au8KeyA));
+  memset(au8KeyB, 'B', sizeof(au8KeyB));
+
+  /* No key: plain text, first KEY is taken */
+  Test_u8Lines = 0;
+  TestSendText("LEDON 1\r\0\0\0\0", 0, NULL, 0);
+  TestSendText("KEY A\r", 2, NULL, 0);
+  CHECK(TestLine(0, "LEDON 1") && TestLine(1, "KEY A"));
+  CHECK(memcmp(Test_au8Key, au8KeyA, AES_CTR_KEY_SIZE) == 0);
+
+  /* Key set: plain pages, and so a plain KEY, are ignored, and so are encrypted ones before a session */
+  TestSendText("KEY B\r", 3, NULL, 0);
+  TestSendText("LEDON2", 4, au8KeyA, 0);
+  CHECK(Test_u8Lines == 2);
+  CHECK(memcmp(Test_au8Key, au8KeyA, AES_CTR_KEY_SIZE) == 0);
+
+  /* A session: encrypted pages with rising sequence numbers; a repeat or an older page is dropped */
+  TestSendSession(100);
+  TestSendText("LEDOFF 3\r\0\0\0", 0, au8KeyA, 100);
+  TestSendText("LEDON ", 5, au8KeyA, 100);
+  TestSendText("LEDON ", 5, au8KeyA, 100);
+  TestSendText("LEDOFF", 1, au8KeyA, 100);
+  TestSendText("4\r\0\0\0\0", 9, au8KeyA, 100);
+  CHECK(TestLine(2, "LEDOFF 3") && TestLine(3, "LEDON 4") && (Test_u8Lines == 4));
+
+  /* The wrong key or nonce decrypts to noise, which never makes a command */
+  TestSendText("LEDON 5\r\0\0\0\0", 10, au8KeyB, 100);
+  TestSendText("LEDON 6\r\0\0\0\0", 20, au8KeyA, 99);
+  CHECK( (Test_u8Lines == 4) || !TestLine(4, "LEDON 5") );
+  CHECK( !TestLine(4, "LEDON 6") && !TestLine(5, "LEDON 6") );
+  Test_u8Lines = 4;
+
+  /* Replays: an old or equal nonce opens nothing, before or after a reset */
+  TestSendSession(100);
+  TestSendText("LEDON 7\r\0\0\0\0", 0, au8KeyA, 100);
+  ImageUploadInitialize();
+  TestSendSession(100);
+  TestSendSession(50);
+  TestSendText("LEDON 7\r\0\0\0\0", 0, au8KeyA, 100);
+  CHECK(Test_u8Lines == 4);
+
+  /* A KEY in a session changes the key and ends the session */
+  TestSendSession(101);
+  TestSendText("KEY B\r", 0, au8KeyA, 101);
+  CHECK(TestLine(4, "KEY B") && (memcmp(Test_au8Key, au8KeyB, AES_CTR_KEY_SIZE) == 0));
+  TestSendText("LEDON 8\r\0\0\0\0", 1, au8KeyB, 101);
+  CHECK(Test_u8Lines == 5);
+  TestSendSession(102);
+  TestSendText("LEDON 8\r\0\0\0\0", 0, au8KeyB, 102);
+  CHECK(TestLine(5, "LEDON 8"));
+
+  /* A command page during an encrypted upload puts the image keystream back */
+  TestSendPage(au8Begin);
+  TestSendPage(au8Nonce);
+  TestSendText("LEDON 9\r\0\0\0\0", 2, au8KeyB, 102);
+  CHECK(TestLine(6, "LEDON 9"));
+  CHECK(G_u32AesCtrFlags & _AES_CTR_FLAGS_RUNNING);
+  CHECK( (memcmp(Test_au8StreamNonce, &au8Nonce[1], AES_CTR_NONCE_SIZE) == 0) && (Test_u32StreamOffset == 0) );
+  TestSendPage((const u8[IMAGE_UPLOAD_PAGE_SIZE]){IMAGE_UPLOAD_PAGE_ABORT});
+}
+
+/* Host side of a burst upload over the simulated link.  u16FailPerMille_ of the packets still fail after the
+stack's retries (EVENT_TRANSFER_RX_FAILED), and u16StallPerMille_ find the main loop blocked for TEST_STALL_US so
+the event queue overflows and the board sees a gap in the burst.  The host only learns the acknowledged offset
+from the status broadcast on air, which was loaded at the previous EVENT_TX.  Returns the time until the status
+shows the image complete, or TEST_LINK_TIMEOUT_US; *pu32Sent_ counts the data bytes sent. */
+static u32 TestLinkUpload(const u8* pu8Image_, u32 u32Size_, u16 u16Crc_, u16 u16FailPerMille_,
+                          u16 u16StallPerMille_, u32* pu32Sent_)
+{
+  u8 au8Begin[IMAGE_UPLOAD_PAGE_SIZE] = {IMAGE_UPLOAD_PAGE_BEGIN, (u8)u32Size_, (u8)(u32Size_ >> 8),
+                                         (u8)(u32Size_ >> 16), (u8)u16Crc_, (u8)(u16Crc_ >> 8), 0, 0};
+  u8 au8Packet[TEST_PACKET_BYTES];
+  u32 u32Start = Test_u32NowUs;
+  u32 u32NextStatus = Test_u32NowUs + TEST_PERIOD_US;
+  u32 u32Acked = 0;
+  u32 u32LastAcked = 0;
+  u32 u32Window = 0;
+  u32 u32Next = 0;
+  u32 u32BurstPackets = 0;
+  bool bWaitStatus = true;
+  u8 u8Header;
+  u8 u8Data;
+  u8 u8ChannelByte;
+
+  *pu32Sent_ = 0;
+  TestSendPage(au8Begin);
+
+  while((Test_u32NowUs - u32Start) < TEST_LINK_TIMEOUT_US)
+  {
+    TestAdvance(TEST_PACKET_US);
+
+    /* The status goes out once a channel period, between bursts */
+    if( (u32BurstPackets == 0) && ((s32)(Test_u32NowUs - u32NextStatus) >= 0) )
+    {
+      u32NextStatus = Test_u32NowUs + TEST_PERIOD_US;
+      if(Test_au8Status[1] == IMAGE_WRITER_COMPLETE)
+      {
+        return(Test_u32NowUs - u32Start);
+      }
+
+      /* Resend from the acknowledged offset after a failure, or when nothing has been acknowledged for a period
+      and the host has nothing more it may send */
+      u32Acked = ImageUploadReadU24(&Test_au8Status[2]);
+      u32Window = Test_au8Status[5] * IMAGE_UPLOAD_WINDOW_UNIT;
+      if( bWaitStatus ||
+          ((u32Acked == u32LastAcked) && (((u32Next - u32Acked) >= u32Window) || (u32Next >= u32Size_))) )
+      {
+        u32Next = u32Acked;
+        bWaitStatus = false;
+      }
+      u32LastAcked = u32Acked;
+
+      TestRadioEvent(EVENT_TX, MESG_BROADCAST_DATA_ID, ANT_CHANNEL_UPLOAD, NULL, 0);
+      AntCaptureEvents();
+    }
+    else if( (u32BurstPackets != 0) ||
+             (!bWaitStatus && (u32Next < u32Size_) && ((u32Next - u32Acked) < u32Window)) )
+    {
+      /* Burst packet: the first one starts with the data page giving the stream offset */
+      memset(au8Packet, 0, sizeof(au8Packet));
+      u8Header = 0;
+      if(u32BurstPackets == 0)
+      {
+        au8Packet[0] = IMAGE_UPLOAD_PAGE_DATA;
+        au8Packet[1] = (u8)u32Next;
+        au8Packet[2] = (u8)(u32Next >> 8);
+        au8Packet[3] = (u8)(u32Next >> 16);
+        u8Header = IMAGE_UPLOAD_HEADER_SIZE;
+      }
+
+      u8Data = TEST_PACKET_BYTES - u8Header;
+      if(u8Data > (u32Size_ - u32Next))
+      {
+        u8Data = (u8)(u32Size_ - u32Next);
+      }
+      memcpy(&au8Packet[u8Header], &pu8Image_[u32Next], u8Data);
+      u32Next += u8Data;
+      *pu32Sent_ += u8Data;
+
+      u8ChannelByte = ANT_CHANNEL_UPLOAD;
+      if(u32BurstPackets != 0)
+      {
+        u8ChannelByte |= (u8)((((u32BurstPackets - 1) % 3) + 1) << ANT_BURST_SEQUENCE_POS);
+      }
+      u32BurstPackets++;
+      if( (u32BurstPackets == TEST_BURST_PACKETS) || (u32Next >= u32Size_) || ((u32Next - u32Acked) >= u32Window) )
+      {
+        u8ChannelByte |= ANT_BURST_LAST_PACKET;
+        u32BurstPackets = 0;
+      }
+
+      if((TestRandom() % 1000) < u16FailPerMille_)
+      {
+        TestRadioEvent(EVENT_TRANSFER_RX_FAILED, MESG_BURST_DATA_ID, ANT_CHANNEL_UPLOAD, NULL, 0);
+        u32BurstPackets = 0;
+        bWaitStatus = true;
+      }
+      else
+      {
+        if((TestRandom() % 1000) < u16StallPerMille_)
+        {
+          Test_u32BusyUntilUs = Test_u32NowUs + TEST_STALL_US;
+        }
+        TestRadioEvent(EVENT_RX, MESG_ADV_BURST_DATA_ID, u8ChannelByte, au8Packet, TEST_PACKET_BYTES);
+      }
+      AntCaptureEvents();
+    }
+
+    TestMainLoop();
+  }
+
+  return(TEST_LINK_TIMEOUT_US);
+}
+
+/* Whole uploads over the simulated link, clean and lossy: the image always arrives intact, losses show up as
+failed bursts and resent bytes, and the throughput stays close to the packet rate */
+static void TestBurstLink(void)
+{
+  static const u16 au16FailPerMille[] = {0, 20, 0, 30};
+  static const u16 au16StallPerMille[] = {0, 0, 3, 3};
+  static u8 au8Image[TEST_LINK_IMAGE_SIZE];
+  AntEventStatsType sStats;
+  u32 u32Dropped = 0;
+  u8 u8Failed = 0;
+  u32 u32Us;
+  u32 u32Sent;
+  u32 u32Rate;
+  u16 u16Crc = 0xFFFF;
+
+  Test_u32Random = 1;
+  for(u32 i = 0; i < TEST_LINK_IMAGE_SIZE; i++)
+  {
+    au8Image[i] = (u8)TestRandom();
+  }
+  u16Crc = crc16_compute(au8Image, TEST_LINK_IMAGE_SIZE, &u16Crc);
+
+  for(u8 i = 0; i < sizeof(au16FailPerMille) / sizeof(au16FailPerMille[0]); i++)
+  {
+    memset((void*)(uintptr_t)IMAGE_FLASH_START, 0x00, TEST_LINK_IMAGE_SIZE);
+    u32Us = TestLinkUpload(au8Image, TEST_LINK_IMAGE_SIZE, u16Crc, au16FailPerMille[i], au16StallPerMille[i],
+                           &u32Sent);
+    CHECK(u32Us < TEST_LINK_TIMEOUT_US);
+    CHECK(memcmp((const void*)(uintptr_t)IMAGE_FLASH_START, au8Image, TEST_LINK_IMAGE_SIZE) == 0);
+
+    AntGetEventStats(&sStats);
+    u32Rate = (u32)((u64)TEST_LINK_IMAGE_SIZE * 1000000 / u32Us);
+    printf("benchmark, %u byte upload, %u/1000 packets failed, %u/1000 stalls: %u B/s, %u bytes resent, "
+           "%u failed bursts, %u events dropped\n", (unsigned)TEST_LINK_IMAGE_SIZE, au16FailPerMille[i],
+           au16StallPerMille[i], (unsigned)u32Rate, (unsigned)(u32Sent - TEST_LINK_IMAGE_SIZE),
+           (u8)(Test_au8Status[6] - u8Failed), (unsigned)(sStats.u32Dropped - u32Dropped));
+
+    /* Losses cost resends and nothing else */
+    if( (au16FailPerMille[i] == 0) && (au16StallPerMille[i] == 0) )
+    {
+      CHECK(u32Sent == TEST_LINK_IMAGE_SIZE);
+      CHECK(sStats.u32Dropped == u32Dropped);
+      CHECK(Test_au8Status[6] == u8Failed);
+      CHECK(u32Rate > (TEST_PACKET_BYTES * 1000000 / TEST_PACKET_US) * 3 / 4);
+    }
+    else
+    {
+      CHECK(u32Sent > TEST_LINK_IMAGE_SIZE);
+      CHECK(Test_au8Status[6] != u8Failed);
+      CHECK(u32Rate > (TEST_PACKET_BYTES * 1000000 / TEST_PACKET_US) / 6);
+    }
+    if(au16StallPerMille[i] != 0)
+    {
+      CHECK(sStats.u32Dropped > u32Dropped);
+    }
+    u32Dropped = sStats.u32Dropped;
+    u8Failed = Test_au8Status[6];
+  }
+}
+
+
+int main(void)
+{
+  void* pvFlash = mmap((void*)(uintptr_t)TEST_FLASH_MAP_BASE, TEST_FLASH_MAP_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+  if(pvFlash != (void*)(uintptr_t)TEST_FLASH_MAP_BASE)
+  {
+    printf("test_image_upload: cannot map the image area at 0x%05X\n", (unsigned)TEST_FLASH_MAP_BASE);
+    return(1);
+  }
+  memset(pvFlash, 0xFF, TEST_FLASH_MAP_SIZE);
+
+  SysTimeInitialize();
+  SettingsInitialize();
+  AntInitialize();
+  ImageWriterInitialize();
+  ImageUploadInitialize();
+
+  TestCommandSecurity();
+  TestBurstLink();
+
+  return(HostResult("test_image_upload"));
+}
@@ -0,0 +1,381 @@
+/**********************************************************************************************************************
+File: test_image_writer.c
+
+Description:
+Host tests for the image writer (image_writer.c) over an emulated NVMC, mapped at the image area like
+test_settings.c.  The POV columns are simulated by _POV_FLAGS_LOCKED and a pending microsecond alarm: the time to
+it is what the writer sees as the gap before the next column.  The emulated NVMC stops the clock for as long as the
+real one would stop the CPU, so a burst uses up the gap it was fitted into.  The benchmark runs a main loop over a
+spinning revolution, where the alarm is always the next column or, in the dark part, the next revolution.
+**********************************************************************************************************************/
+
+#include <sys/mman.h>
+#include <time.h>
+#include "host.h"
+#include "crc16.c"
+#include "system_time.c"
+#include "image_writer.c"
+
+#define TEST_FLASH_MAP_BASE     IMAGE_FLASH_START
+#define TEST_FLASH_MAP_SIZE     (u32)0x10000
+#define TEST_IMAGE_SIZE         (u32)(3 * IMAGE_PAGE_SIZE + 100)
+#define TEST_COLUMN_US          (u32)200                /* Alarm slack in the middle of the columns */
+#define TEST_DARK_US            (u32)30000              /* Alarm slack in the dark part of a revolution */
+#define TEST_NO_WORD_US         (u32)30                 /* Alarm slack too short for one word */
+
+/* Benchmark: a 48 kB image, and a revolution of 64 columns that leaves room for a page erase in the dark part */
+#define TEST_BENCH_SIZE         (u32)(48 * IMAGE_PAGE_SIZE)
+#define TEST_REVOLUTION_US      (u32)40000
+#define TEST_BENCH_COLUMN_US    (u32)250
+#define TEST_BENCH_COLUMNS_US   (u32)(64 * TEST_BENCH_COLUMN_US)
+
+volatile u32 G_u32SystemFlags;
+volatile u32 G_u32SystemTime1ms;
+volatile u32 G_u32SystemTime1s;
+volatile u32 G_u32AntFlags;
+u32 G_u32PovFlags;
+
+static u32 Test_u32Erases;                             /* Page erases made */
+static u32 Test_u32Bursts;                             /* nrf_nvmc_write_words() calls */
+static u32 Test_u32Words;                              /* Words programmed */
+static u32 Test_u32LateBursts;                         /* Bursts longer than the gap to the next column */
+static u32 Test_u32NowUs;                              /* Simulated time */
+static bool Test_bRevolution;                          /* The alarm follows TestRevolutionAlarm() */
+static u8 Test_au8Image[TEST_BENCH_SIZE];
+
+
+static void TestSetUs(u32 u32Us_)
+{
+  Test_u32NowUs = u32Us_;
+  SysTime_u16UsHigh = (u16)(u32Us_ >> 16);
+  NRF_TIMER2->CC[SYSTIME_US_CC_CAPTURE] = u32Us_ & 0xFFFF;
+}
+
+/* Next column boundary, or the start of the next revolution in the dark part */
+static void TestRevolutionAlarm(void)
+{
+  u32 u32Position = Test_u32NowUs % TEST_REVOLUTION_US;
+
+  if(u32Position < TEST_BENCH_COLUMNS_US)
+  {
+    SysTime_u32AlarmTime = Test_u32NowUs + TEST_BENCH_COLUMN_US - (u32Position % TEST_BENCH_COLUMN_US);
+  }
+  else
+  {
+    SysTime_u32AlarmTime = Test_u32NowUs + TEST_REVOLUTION_US - u32Position;
+  }
+}
+
+/* The CPU is stopped for the NVMC time */
+static void TestNvmcBusy(u32 u32Us_)
+{
+  TestSetUs(Test_u32NowUs + u32Us_);
+  if(Test_bRevolution)
+  {
+    TestRevolutionAlarm();
+  }
+}
+
+/* Emulated NVMC */
+void nrf_nvmc_write_words(uint32_t address, const uint32_t* src, uint32_t num_words)
+{
+  if( (G_u32PovFlags & _POV_FLAGS_LOCKED) && (num_words * IMAGE_WORD_WRITE_US > SysTimeAlarmSlackUs()) )
+  {
+    Test_u32LateBursts++;
+  }
+
+  for(u32 i = 0; i < num_words; i++)
+  {
+    *(volatile u32*)(uintptr_t)(address + 4 * i) &= src[i];
+  }
+  Test_u32Bursts++;
+  Test_u32Words += num_words;
+  TestNvmcBusy(num_words * IMAGE_WORD_WRITE_US);
+}
+
+void nrf_nvmc_page_erase(uint32_t address)
+{
+  Test_u32Erases++;
+  memset((void*)(uintptr_t)address, 0xFF, IMAGE_PAGE_SIZE);
+  TestNvmcBusy(IMAGE_PAGE_ERASE_US);
+}
+
+u32 AntRadioQuietUs(void) { return(0); }
+void PovColumnAlarm(u32 u32AlarmTime_) { }
+
+
+/* Columns running with the next one u32SlackUs_ away, or stopped for 0 */
+static void TestColumns(u32 u32SlackUs_)
+{
+  TestSetUs(0);
+  Test_bRevolution = false;
+  if(u32SlackUs_ == 0)
+  {
+    G_u32PovFlags = 0;
+    SysTime_pfnAlarm = NULL;
+    return;
+  }
+
+  G_u32PovFlags = _POV_FLAGS_LOCKED;
+  SysTime_u32AlarmTime = u32SlackUs_;
+  SysTime_pfnAlarm = PovColumnAlarm;
+}
+
+/* Writes from u32Offset_ in 24 byte packets as far as the writer has room; returns the new offset */
+static u32 TestWritePackets(u32 u32Offset_)
+{
+  u32 u32Length;
+
+  while(u32Offset_ < TEST_IMAGE_SIZE)
+  {
+    u32Length = TEST_IMAGE_SIZE - u32Offset_;
+    if(u32Length > 24)
+    {
+      u32Length = 24;
+    }
+    if(u32Length > ImageWriterGetRoom())
+    {
+      u32Length = ImageWriterGetRoom();
+    }
+    if(u32Length == 0)
+    {
+      break;
+    }
+
+    CHECK(ImageWriterWrite(&Test_au8Image[u32Offset_], (u16)u32Length));
+    u32Offset_ += u32Length;
+  }
+
+  return(u32Offset_);
+}
+
+static void TestStart(void)
+{
+  for(u32 i = 0; i < TEST_IMAGE_SIZE; i++)
+  {
+    Test_au8Image[i] = (u8)(i * 7 + (i >> 8));
+  }
+  memset((void*)(uintptr_t)IMAGE_FLASH_START, 0x00, 4 * IMAGE_PAGE_SIZE);
+
+  ImageWriterInitialize();
+  Test_u32Erases = 0;
+  Test_u32Words = 0;
+  Test_u32LateBursts = 0;
+  CHECK(ImageWriterStart(IMAGE_FLASH_START, TEST_IMAGE_SIZE));
+}
+
+static void TestFinish(void)
+{
+  u16 u16Crc = 0xFFFF;
+
+  u16Crc = crc16_compute(Test_au8Image, TEST_IMAGE_SIZE, &u16Crc);
+  CHECK(ImageWriterFinish(u16Crc));
+  for(u8 i = 0; (i < 100) && (ImageWriterGetStatus() == IMAGE_WRITER_VERIFYING); i++)
+  {
+    ImageWriterUpdate();
+  }
+  CHECK(ImageWriterGetStatus() == IMAGE_WRITER_COMPLETE);
+  CHECK(memcmp((const void*)(uintptr_t)IMAGE_FLASH_START, Test_au8Image, TEST_IMAGE_SIZE) == 0);
+  CHECK(Test_u32Erases == 4);
+}
+
+
+/* Columns stopped: erases run from ImageWriterUpdate() as the write pointer needs them */
+static void TestIdle(void)
+{
+  u32 u32Offset = 0;
+  u8 u8Byte = 0;
+
+  TestColumns(0);
+  TestStart();
+  CHECK(ImageWriterGetRoom() == 0);
+  CHECK(!ImageWriterWrite(&u8Byte, 1));
+  CHECK(ImageWriterGetStatus() == IMAGE_WRITER_WRITING);
+
+  while(u32Offset < TEST_IMAGE_SIZE)
+  {
+    ImageWriterUpdate();
+    u32Offset = TestWritePackets(u32Offset);
+  }
+  TestFinish();
+}
+
+/* Columns running: no erase while a column is close, and the upload waits for the dark part */
+static void TestLocked(void)
+{
+  u32 u32Offset = 0;
+  u32 u32Erases;
+
+  TestColumns(TEST_COLUMN_US);
+  TestStart();
+  for(u8 i = 0; i < 10; i++)
+  {
+    ImageWriterUpdate();
+  }
+  CHECK(Test_u32Erases == 0);
+  CHECK(ImageWriterGetRoom() == 0);
+
+  while(u32Offset < TEST_IMAGE_SIZE)
+  {
+    TestColumns(TEST_DARK_US);
+    ImageWriterUpdate();
+    u32Offset = TestWritePackets(u32Offset);
+
+    /* Back among the columns: the writer stops when the erased flash runs out */
+    TestColumns(TEST_COLUMN_US);
+    u32Erases = Test_u32Erases;
+    for(u8 i = 0; i < 10; i++)
+    {
+      ImageWriterUpdate();
+    }
+    u32Offset = TestWritePackets(u32Offset);
+    CHECK(Test_u32Erases == u32Erases);
+    CHECK( (u32Offset == TEST_IMAGE_SIZE) || (ImageWriterGetRoom() == 0) );
+  }
+
+  TestColumns(TEST_DARK_US);
+  TestFinish();
+  CHECK(Test_u32LateBursts == 0);
+}
+
+/* No gap for even one word: writes are taken into the pending words and return at once, the sender is held off
+when they are full, and ImageWriterUpdate() programs them once a gap comes */
+static void TestNoGap(void)
+{
+  u32 u32Offset;
+
+  TestColumns(TEST_DARK_US);
+  TestStart();
+  ImageWriterUpdate();
+  CHECK(Test_u32Erases == 1);
+
+  TestColumns(TEST_NO_WORD_US);
+  u32Offset = TestWritePackets(0);
+  CHECK(u32Offset == 4 * IMAGE_WRITER_PENDING_WORDS);
+  CHECK(ImageWriterGetRoom() == 0);
+  CHECK(ImageWriterGetBytesWritten() == 0);
+  for(u8 i = 0; i < 10; i++)
+  {
+    ImageWriterUpdate();
+  }
+  CHECK(Test_u32Words == 0);
+  CHECK(Test_u32NowUs == 0);
+
+  /* A column gap takes what fits in it, and no more */
+  TestColumns(TEST_COLUMN_US);
+  ImageWriterUpdate();
+  CHECK(Test_u32Words == TEST_COLUMN_US / IMAGE_WORD_WRITE_US);
+  CHECK(ImageWriterGetRoom() == 4 * Test_u32Words);
+
+  while(u32Offset < TEST_IMAGE_SIZE)
+  {
+    TestColumns(TEST_DARK_US);
+    ImageWriterUpdate();
+    u32Offset = TestWritePackets(u32Offset);
+  }
+  TestFinish();
+  CHECK(Test_u32LateBursts == 0);
+}
+
+/* Bytes per second through the writer over the emulated NVMC, in 24 byte packets as fast as it takes them with a
+pass of the main loop each ms: columns stopped, and spinning with a burst only where it fits before a column */
+static void TestBenchmark(void)
+{
+  double dStart;
+  double dCpuUs;
+  u32 u32Offset;
+  u32 u32Length;
+  u32 u32Passes;
+  u16 u16Crc;
+  struct timespec sTime;
+
+  for(u8 u8Spinning = 0; u8Spinning < 2; u8Spinning++)
+  {
+    for(u32 i = 0; i < TEST_BENCH_SIZE; i++)
+    {
+      Test_au8Image[i] = (u8)(i * 13 + (i >> 9));
+    }
+    TestColumns(0);
+    if(u8Spinning)
+    {
+      G_u32PovFlags = _POV_FLAGS_LOCKED;
+      SysTime_pfnAlarm = PovColumnAlarm;
+      Test_bRevolution = true;
+      TestRevolutionAlarm();
+    }
+
+    ImageWriterInitialize();
+    Test_u32Erases = 0;
+    Test_u32Bursts = 0;
+    Test_u32Words = 0;
+    Test_u32LateBursts = 0;
+    CHECK(ImageWriterStart(IMAGE_FLASH_START, TEST_BENCH_SIZE));
+
+    clock_gettime(CLOCK_MONOTONIC, &sTime);
+    dStart = sTime.tv_sec * 1e6 + sTime.tv_nsec / 1e3;
+    u32Offset = 0;
+    u32Passes = 0;
+    while( (ImageWriterGetStatus() == IMAGE_WRITER_WRITING) || (ImageWriterGetStatus() == IMAGE_WRITER_VERIFYING) )
+    {
+      /* Next pass of the main loop on the next ms, unless the NVMC held it past that */
+      TestSetUs((Test_u32NowUs / 1000 + 1) * 1000);
+      if(Test_bRevolution)
+      {
+        TestRevolutionAlarm();
+      }
+      u32Passes++;
+
+      ImageWriterUpdate();
+      u32Length = 24;
+      while( (u32Offset < TEST_BENCH_SIZE) && (ImageWriterGetRoom() >= u32Length) )
+      {
+        if(u32Length > TEST_BENCH_SIZE - u32Offset)
+        {
+          u32Length = TEST_BENCH_SIZE - u32Offset;
+        }
+        CHECK(ImageWriterWrite(&Test_au8Image[u32Offset], (u16)u32Length));
+        u32Offset += u32Length;
+      }
+      if( (u32Offset == TEST_BENCH_SIZE) && (ImageWriterGetStatus() == IMAGE_WRITER_WRITING) )
+      {
+        u16Crc = 0xFFFF;
+        u16Crc = crc16_compute(Test_au8Image, TEST_BENCH_SIZE, &u16Crc);
+        CHECK(ImageWriterFinish(u16Crc));
+      }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &sTime);
+    dCpuUs = sTime.tv_sec * 1e6 + sTime.tv_nsec / 1e3 - dStart;
+
+    printf("benchmark, %u byte image over the emulated NVMC, columns %s: %.0f B/s, %u passes, "
+           "%.1f words per burst, %u bursts past a column, host CPU %.1f MB/s\n",
+           (unsigned)TEST_BENCH_SIZE, u8Spinning ? "spinning" : "stopped",
+           TEST_BENCH_SIZE * 1e6 / Test_u32NowUs, (unsigned)u32Passes, (double)Test_u32Words / Test_u32Bursts,
+           (unsigned)Test_u32LateBursts, TEST_BENCH_SIZE / dCpuUs);
+
+    CHECK(ImageWriterGetStatus() == IMAGE_WRITER_COMPLETE);
+    CHECK(memcmp((const void*)(uintptr_t)IMAGE_FLASH_START, Test_au8Image, TEST_BENCH_SIZE) == 0);
+    CHECK(Test_u32Erases == TEST_BENCH_SIZE / IMAGE_PAGE_SIZE);
+    CHECK(Test_u32LateBursts == 0);
+  }
+  TestColumns(0);
+}
+
+
+int main(void)
+{
+  void* pvFlash = mmap((void*)(uintptr_t)TEST_FLASH_MAP_BASE, TEST_FLASH_MAP_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+  if(pvFlash != (void*)(uintptr_t)TEST_FLASH_MAP_BASE)
+  {
+    printf("test_image_writer: cannot map the image area at 0x%05X\n", (unsigned)TEST_FLASH_MAP_BASE);
+    return(1);
+  }
+
+  TestIdle();
+  TestLocked();
+  TestNoGap();
+  TestBenchmark();
+
+  return(HostResult("test_image_writer"));
+}
@@ -0,0 +1,367 @@
+/**********************************************************************************************************************
+File: test_leds.c
+
+Description:
+Host tests for the LED driver (leds_abbcn.c): the keyframe animation player.  The 1ms tick is faked with
+SysTimeTick(), and the main loop is LedUpdate() run after it, every tick or only when the LED deadline slot says
+so, as SystemSleep() would.  The register block in RAM does not apply OUTSET and OUTCLR writes to OUT, so GPIO
+accesses go through TestGpio(), which folds the last write into OUT before handing the block out.  The keyframe
+shown at any time is worked out here from the animation tables and compared with the LEDs.  The LedPWM() test
+counts the LEDs on together in every tick.
+**********************************************************************************************************************/
+
+#include <string.h>
+#include "host.h"
+
+static NRF_GPIO_Type* TestGpio(void);
+#undef NRF_GPIO
+#define NRF_GPIO  (TestGpio())
+
+#include "system_time.c"
+#include "leds_abbcn.c"
+
+#define TEST_BOOT_MS            (u32)6440               /* 7 wipes of 6 steps, a hold and an off step */
+#define TEST_RUN_MS             (u32)20000
+#define TEST_MAX_LATE_MS        (u32)40                 /* Below the shortest keyframe */
+
+volatile u32 G_u32SystemFlags;
+volatile u32 G_u32SystemTime1ms;
+volatile u32 G_u32SystemTime1s;
+
+static u32 Test_u32StartMs;                            /* SysTimeGetMs() when the animation started */
+
+/* A two keyframe animation that stops */
+static const LedKeyframeType Test_asOnceFrames[] =
+{
+  {(u16)((1 << ARED) | (1 << MBLU)), 10},
+  {(u16)(1 << DGRN),                 25}
+};
+static const LedAnimationType Test_sOnce = {Test_asOnceFrames, 2, NULL};
+
+
+static NRF_GPIO_Type* TestGpio(void)
+{
+  Host_sGpio.OUT = (Host_sGpio.OUT | Host_sGpio.OUTSET) & ~Host_sGpio.OUTCLR;
+  Host_sGpio.OUTSET = 0;
+  Host_sGpio.OUTCLR = 0;
+  *(volatile u32*)&Host_sGpio.IN = Host_sGpio.OUT;
+  return(&Host_sGpio);
+}
+
+/* LEDs on, bit n = LedNumberType n */
+static u16 TestLeds(void)
+{
+  u32 u32Out = TestGpio()->OUT;
+  u16 u16Mask = 0;
+
+  for(u8 i = 0; i < TOTAL_LEDS; i++)
+  {
+    if(u32Out & Led_au32BitPositions[i])
+    {
+      u16Mask |= (u16)(1 << i);
+    }
+  }
+  return(u16Mask);
+}
+
+/* Keyframe due u32Ms_ after psAnimation_ started, and when it was due; NULL once the animation has stopped */
+static const LedKeyframeType* TestKeyframeAt(const LedAnimationType* psAnimation_, u32 u32Ms_, u32* pu32DueMs_)
+{
+  u32 u32Due = 0;
+  u8 u8Frame = 0;
+
+  while(u32Due + psAnimation_->psFrames[u8Frame].u16DurationMs <= u32Ms_)
+  {
+    u32Due += psAnimation_->psFrames[u8Frame].u16DurationMs;
+    if(++u8Frame >= psAnimation_->u8Frames)
+    {
+      u8Frame = 0;
+      psAnimation_ = psAnimation_->psNext;
+      if(psAnimation_ == NULL)
+      {
+        return(NULL);
+      }
+    }
+  }
+
+  *pu32DueMs_ = u32Due;
+  return(&psAnimation_->psFrames[u8Frame]);
+}
+
+static void TestStart(void)
+{
+  LedShowKeyframe(0xFFFF);
+  Test_u32StartMs = SysTimeGetMs();
+}
+
+
+/* LedInitialize() returns with the clock stopped, and nothing moves until the tick does */
+static void TestNonBlocking(void)
+{
+  TestStart();
+  LedInitialize();
+  CHECK(SysTimeGetMs() == Test_u32StartMs);
+  CHECK(LedIsAnimating());
+  CHECK(TestLeds() == G_sLedBootAnimation.psFrames[0].u16OnMask);
+
+  for(u16 i = 0; i < 1000; i++)
+  {
+    LedUpdate();
+  }
+  CHECK(Led_u8Frame == 0);
+  CHECK(SysTimeNextDeadline() == G_sLedBootAnimation.psFrames[0].u16DurationMs);
+  CHECK(TestLeds() == G_sLedBootAnimation.psFrames[0].u16OnMask);
+}
+
+/* Run every tick: each keyframe comes on in the tick it is due, boot runs into the idle cycle, which loops */
+static void TestKeyframeTiming(void)
+{
+  const LedKeyframeType* psFrame;
+  u32 u32Due;
+  u32 u32Wrong = 0;
+  u32 u32Changes = 0;
+  u16 u16Last;
+
+  TestStart();
+  LedInitialize();
+  u16Last = TestLeds();
+  for(u32 u32Ms = 1; u32Ms <= TEST_RUN_MS; u32Ms++)
+  {
+    SysTimeTick();
+    LedUpdate();
+
+    psFrame = TestKeyframeAt(&G_sLedBootAnimation, u32Ms, &u32Due);
+    if(TestLeds() != psFrame->u16OnMask)
+    {
+      u32Wrong++;
+    }
+    if(TestLeds() != u16Last)
+    {
+      u32Changes++;
+      u16Last = TestLeds();
+      if(u32Due != u32Ms)
+      {
+        u32Wrong++;
+      }
+    }
+  }
+
+  CHECK(u32Wrong == 0);
+  CHECK(u32Changes == 56 + (TEST_RUN_MS - TEST_BOOT_MS) / LED_ANIMATION_IDLE_MS);
+  CHECK(TestKeyframeAt(&G_sLedBootAnimation, TEST_BOOT_MS - 1, &u32Due) == &Led_asBootFrames[55]);
+  CHECK(TestKeyframeAt(&G_sLedBootAnimation, TEST_BOOT_MS, &u32Due) == &Led_asIdleFrames[0]);
+  CHECK(Led_psAnimation == &G_sLedIdleAnimation);
+  CHECK(Led_u32FrameStart - Test_u32StartMs == TEST_BOOT_MS + (TEST_RUN_MS - TEST_BOOT_MS) /
+        LED_ANIMATION_IDLE_MS * LED_ANIMATION_IDLE_MS);
+}
+
+/* Main loop asleep until the LED deadline: one pass per keyframe, each on time */
+static void TestSleep(void)
+{
+  const LedKeyframeType* psFrame;
+  u32 u32Due;
+  u32 u32Sleep;
+  u32 u32Passes = 0;
+  u32 u32Wrong = 0;
+
+  TestStart();
+  LedInitialize();
+  LedUpdate();
+  while(true)
+  {
+    u32Sleep = SysTimeNextDeadline();
+    CHECK(u32Sleep != SYSTIME_NO_DEADLINE);
+    if(u32Sleep == 0)
+    {
+      u32Sleep = 1;
+    }
+    if(SysTimeGetMs() - Test_u32StartMs + u32Sleep > TEST_RUN_MS)
+    {
+      break;
+    }
+    while(u32Sleep-- != 0)
+    {
+      SysTimeTick();
+    }
+
+    LedUpdate();
+    u32Passes++;
+    psFrame = TestKeyframeAt(&G_sLedBootAnimation, SysTimeGetMs() - Test_u32StartMs, &u32Due);
+    if( (TestLeds() != psFrame->u16OnMask) || (u32Due != SysTimeGetMs() - Test_u32StartMs) )
+    {
+      u32Wrong++;
+    }
+  }
+
+  CHECK(u32Wrong == 0);
+  CHECK(u32Passes == 56 + (TEST_RUN_MS - TEST_BOOT_MS) / LED_ANIMATION_IDLE_MS);
+}
+
+/* A busy main loop makes a keyframe late, but the next is still due on time: lateness does not build up */
+static void TestLate(void)
+{
+  const LedKeyframeType* psFrame;
+  const LedKeyframeType* psLast = NULL;
+  u32 u32Random = 7;
+  u32 u32Due;
+  u32 u32Late;
+  u32 u32MaxLate = 0;
+  u32 u32Wrong = 0;
+
+  TestStart();
+  LedInitialize();
+  while(SysTimeGetMs() - Test_u32StartMs < TEST_RUN_MS)
+  {
+    u32Random = u32Random * 1103515245 + 12345;
+    for(u32 i = (u32Random >> 16) % (TEST_MAX_LATE_MS + 1); i != 0; i--)
+    {
+      SysTimeTick();
+    }
+    SysTimeTick();
+    LedUpdate();
+
+    psFrame = TestKeyframeAt(&G_sLedBootAnimation, SysTimeGetMs() - Test_u32StartMs, &u32Due);
+    if( (TestLeds() != psFrame->u16OnMask) || (Led_u32FrameStart - Test_u32StartMs != u32Due) )
+    {
+      u32Wrong++;
+    }
+    if(psFrame != psLast)
+    {
+      psLast = psFrame;
+      u32Late = SysTimeGetMs() - Test_u32StartMs - u32Due;
+      if(u32Late > u32MaxLate)
+      {
+        u32MaxLate = u32Late;
+      }
+    }
+  }
+
+  CHECK(u32Wrong == 0);
+  CHECK(u32MaxLate <= TEST_MAX_LATE_MS);
+}
+
+/* An animation with no psNext stops on its last keyframe; stopping one leaves the LEDs and the deadline idle */
+static void TestStop(void)
+{
+  TestStart();
+  LedPlayAnimation(&Test_sOnce);
+  CHECK(TestLeds() == Test_asOnceFrames[0].u16OnMask);
+  for(u8 i = 0; i < 34; i++)
+  {
+    SysTimeTick();
+    LedUpdate();
+  }
+  CHECK(LedIsAnimating());
+  CHECK(TestLeds() == Test_asOnceFrames[1].u16OnMask);
+  SysTimeTick();
+  LedUpdate();
+  CHECK(!LedIsAnimating());
+  CHECK(TestLeds() == Test_asOnceFrames[1].u16OnMask);
+  CHECK(SysTimeNextDeadline() == SYSTIME_NO_DEADLINE);
+
+  LedPlayAnimation(&G_sLedIdleAnimation);
+  SysTimeTick();
+  LedUpdate();
+  LedStopAnimation();
+  for(u16 i = 0; i < 2 * LED_ANIMATION_IDLE_MS; i++)
+  {
+    SysTimeTick();
+    LedUpdate();
+  }
+  CHECK(TestLeds() == G_sLedIdleAnimation.psFrames[0].u16OnMask);
+  CHECK(SysTimeNextDeadline() == SYSTIME_NO_DEADLINE);
+}
+
+/* LedPWM() at every duty, all LEDs at once: each LED is on for its duty, and as the periods start at spread phases
+no more LEDs are on together in any tick than the duty's share of them (rounded up), where unphased they would all
+be.  The counts for one period at 25% and the peak at each duty are printed. */
+static void TestPwmStagger(void)
+{
+  u16 au16OnTicks[TOTAL_LEDS];
+  u8 au8Count[LED_PWM_PERIOD];
+  u8 au8Max[LED_PWM_PERIOD];
+  u8 u8On;
+  u8 u8Max;
+  u8 u8Bound;
+  u32 u32WrongDuty = 0;
+
+  LedStopAnimation();
+  for(u8 u8Rate = LED_PWM_5; u8Rate < LED_PWM_100; u8Rate++)
+  {
+    for(u8 i = 0; i < TOTAL_LEDS; i++)
+    {
+      LedPWM((LedNumberType)i, (LedRateType)u8Rate);
+    }
+    memset(au16OnTicks, 0, sizeof(au16OnTicks));
+    u8Max = 0;
+
+    for(u16 u16Tick = 0; u16Tick < 10 * LED_PWM_PERIOD; u16Tick++)
+    {
+      SysTimeTick();
+      LedUpdate();
+      CHECK(SysTimeNextDeadline() == 1);
+
+      u8On = 0;
+      for(u8 i = 0; i < TOTAL_LEDS; i++)
+      {
+        if(TestLeds() & (1 << i))
+        {
+          au16OnTicks[i]++;
+          u8On++;
+        }
+      }
+      au8Count[u16Tick % LED_PWM_PERIOD] = u8On;
+      if(u8On > u8Max)
+      {
+        u8Max = u8On;
+      }
+    }
+
+    for(u8 i = 0; i < TOTAL_LEDS; i++)
+    {
+      if(au16OnTicks[i] != 10 * u8Rate)
+      {
+        u32WrongDuty++;
+      }
+    }
+    if(u8Rate == LED_PWM_25)
+    {
+      printf("pwm, on together per tick over one period at 25%%:");
+      for(u8 i = 0; i < LED_PWM_PERIOD; i++)
+      {
+        printf(" %u", au8Count[i]);
+      }
+      printf("\n");
+    }
+    au8Max[u8Rate] = u8Max;
+
+    u8Bound = (u8)((TOTAL_LEDS * u8Rate + LED_PWM_PERIOD - 1) / LED_PWM_PERIOD);
+    CHECK(u8Max <= u8Bound);
+  }
+
+  printf("pwm, most on together of %u at 5..95%%:", (unsigned)TOTAL_LEDS);
+  for(u8 u8Rate = LED_PWM_5; u8Rate < LED_PWM_100; u8Rate++)
+  {
+    printf(" %u", au8Max[u8Rate]);
+  }
+  printf("\n");
+
+  CHECK(u32WrongDuty == 0);
+  for(u8 i = 0; i < TOTAL_LEDS; i++)
+  {
+    LedOff((LedNumberType)i);
+  }
+}
+
+
+int main(void)
+{
+  TestNonBlocking();
+  TestKeyframeTiming();
+  TestSleep();
+  TestLate();
+  TestStop();
+  TestPwmStagger();
+
+  return(HostResult("test_leds"));
+}
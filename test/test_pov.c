@@ -0,0 +1,533 @@
+/**********************************************************************************************************************
+File: test_pov.c
+
+Description:
+Host tests for the POV display (pov.c) with the image decoder (pov_image.c) and the system time (system_time.c)
+compiled in.  The modules pov.c calls for buttons, LEDs, the accelerometer, the radio and power are stubs.  Images
+are raw containers built here in RAM; the image flash area is mapped erased, so it never holds a valid image.
+
+The column interrupt runs in simulated time: TestAlarms() moves the microsecond time from one pending alarm to the
+next and calls it as TIMER2_IRQHandler would, and what each column put on the LEDs is handed to a recorder.
+**********************************************************************************************************************/
+
+#include <sys/mman.h>
+#include <time.h>
+#include <math.h>
+#include "host.h"
+#include "system_time.c"
+#include "pov_image.c"
+#include "pov.c"
+
+#define TEST_FLASH_MAP_BASE     IMAGE_FLASH_START
+#define TEST_FLASH_MAP_SIZE     (u32)(IMAGE_FLASH_END - IMAGE_FLASH_START)
+#define TEST_IMAGE_SIZE         (u16)(POV_IMAGE_HEADER_SIZE + POV_COLUMNS * POV_CHANNELS)
+#define TEST_REVOLUTIONS        (u32)(1 << POV_DITHER_BITS)  /* Revolutions for the dither to go all the way round */
+#define TEST_SPIN_US            (u32)40000              /* 25 revolutions per second */
+#define TEST_SWAP_REVOLUTIONS   (u32)400
+#define TEST_BENCH_FRAMES       (u32)20000
+
+/* Swing trace: X = -amplitude * sin(2 pi t / cycle) + offset + noise, sampled at the accelerometer's 400 Hz */
+#define TEST_SWING_CYCLE_US     (u32)500000             /* 2 Hz: 250 ms strokes */
+#define TEST_SWING_AMPLITUDE    (double)12000           /* 0.73 g */
+#define TEST_SWING_SAMPLE_US    (u32)2500
+#define TEST_SWING_SETTLE_US    (u32)3000000            /* Lock and settle before measuring */
+#define TEST_SWING_RUN_US       (u32)20000000
+
+volatile u32 G_u32SystemFlags;
+volatile u32 G_u32SystemTime1ms;
+volatile u32 G_u32SystemTime1s;
+const LedAnimationType G_sLedIdleAnimation;
+
+static u8 Test_au8Image[TEST_IMAGE_SIZE];              /* Raw container */
+static u32 Test_u32NowUs;                              /* Simulated time */
+static void (*Test_pfnColumn)(u16 u16Column_, u32 u32Leds_);  /* Recorder for each column shown */
+
+/* Swap test: frames rendered, and what each revolution showed */
+static u32 Test_au32FrameGeneration[2];                /* Render count when each frame was last rendered */
+static u8 Test_au8FrameLevel[2];                       /* Image level each frame was rendered from */
+static u32 Test_u32Generation;                         /* Frames rendered */
+static u32 Test_u32RevolutionGeneration;               /* Frame the revolution on display started with */
+static u32 Test_u32LastColumnGeneration;               /* Newest frame rendered when the last column was shown */
+static u32 Test_u32Revolutions;
+static u32 Test_u32MixedRevolutions;                   /* Revolutions showing more than one frame or level */
+static u32 Test_u32StaleRevolutions;                   /* Revolutions not showing the newest frame they should */
+static u16 Test_u16NextColumn;
+
+/* Swing test: where each image column was drawn, as wand position in 1/amplitude */
+static double Test_adColumnMin[POV_COLUMNS];
+static double Test_adColumnMax[POV_COLUMNS];
+static double Test_adColumnSum[POV_COLUMNS];
+static u32 Test_u32SwingColumns;
+static u32 Test_u32SwingStartUs;
+static bool Test_bSwingMeasure;
+
+
+/* Stubs for the modules around the display */
+ImageWriterStatusType ImageWriterGetStatus(void) { return(IMAGE_WRITER_IDLE); }
+void ImageWriterUpdate(void) { }
+void AntUpdate(void) { }
+void AccelSetProfile(AccelProfileType eProfile_) { }
+u32 AccelGetStillMs(void) { return(0); }
+bool AccelGetTap(u8* pu8Taps_) { return(false); }
+bool AccelSleep(void) { return(true); }
+void LedPlayAnimation(const LedAnimationType* psAnimation_) { }
+void LedStopAnimation(void) { }
+bool ButtonGetEvent(ButtonEventType* psEvent_) { return(false); }
+bool IsButtonPressed(u32 u32Button_) { return(false); }
+void RemoteStartPairing(void) { }
+void RemoteSetEnabled(bool bEnabled_) { }
+bool RemoteIsEnabled(void) { return(false); }
+void SystemOff(void) { }
+
+
+/* Fills the raw image with one level for every channel of every column */
+static void TestImageFill(u8 u8Level_)
+{
+  Test_au8Image[0] = POV_IMAGE_MAGIC0;
+  Test_au8Image[1] = POV_IMAGE_MAGIC1;
+  Test_au8Image[2] = POV_IMAGE_FORMAT_RAW;
+  Test_au8Image[3] = (u8)POV_COLUMNS;
+  Test_au8Image[4] = (u8)((POV_COLUMNS * POV_CHANNELS) & 0xFF);
+  Test_au8Image[5] = (u8)((POV_COLUMNS * POV_CHANNELS) >> 8);
+  Test_au8Image[6] = 0;
+  Test_au8Image[7] = 0;
+  memset(&Test_au8Image[POV_IMAGE_HEADER_SIZE], u8Level_, POV_COLUMNS * POV_CHANNELS);
+}
+
+/* Sets the time SysTimeGetUs() returns */
+static void TestSetUs(u32 u32Us_)
+{
+  Test_u32NowUs = u32Us_;
+  SysTime_u16UsHigh = (u16)(u32Us_ >> 16);
+  NRF_TIMER2->CC[SYSTIME_US_CC_CAPTURE] = u32Us_ & 0xFFFF;
+}
+
+/* Runs the column interrupt at each alarm up to u32EndUs_, then moves the time on to u32EndUs_.  Each column shown
+(its first plane) goes to Test_pfnColumn as the image column and the LEDs it lit. */
+static void TestAlarms(u32 u32EndUs_)
+{
+  fnSysTimeAlarmType pfnAlarm;
+  u32 u32AlarmUs;
+  u16 u16Column;
+  u8 u8Plane;
+
+  while( (SysTime_pfnAlarm != NULL) && ((s32)(u32EndUs_ - SysTime_u32AlarmTime) >= 0) )
+  {
+    pfnAlarm = SysTime_pfnAlarm;
+    u32AlarmUs = SysTime_u32AlarmTime;
+    u16Column = Pov_sActive.bReverse ? (POV_COLUMNS - 1 - Pov_u16Column) : Pov_u16Column;
+    u8Plane = Pov_u8Plane;
+
+    TestSetUs(u32AlarmUs);
+    SysTime_pfnAlarm = NULL;
+    pfnAlarm(u32AlarmUs);
+    if( (pfnAlarm == PovColumnAlarm) && (u8Plane == 0) && (u16Column < POV_COLUMNS) && (Test_pfnColumn != NULL) )
+    {
+      Test_pfnColumn(u16Column, NRF_GPIO->OUTSET);
+    }
+  }
+
+  TestSetUs(u32EndUs_);
+}
+
+/* Slots a channel is lit for in a column of the frame on display */
+static u32 TestShownSlots(u16 u16Column_, u8 u8Channel_)
+{
+  u32 u32Slots = 0;
+
+  for(u8 u8Plane = 0; u8Plane < POV_PWM_BITS; u8Plane++)
+  {
+    if(Pov_au32Planes[Pov_u8Front][u16Column_][u8Plane] & Pov_au32ChannelPins[u8Channel_])
+    {
+      u32Slots += 1u << (POV_PWM_BITS - 1 - u8Plane);
+    }
+  }
+
+  return(u32Slots);
+}
+
+
+/* The default budget never dims: full white draws every LED at once and still fits */
+static void TestGovernorDefault(void)
+{
+  PovCurrentStatsType sStats;
+
+  TestImageFill(255);
+  CHECK(PovSetImage(Test_au8Image, sizeof(Test_au8Image)));
+  PovGetCurrentStats(&sStats);
+  CHECK(sStats.u32BudgetMa == POV_CURRENT_BUDGET_MA);
+  CHECK(sStats.u16ScaleQ8 == POV_CURRENT_SCALE_FULL);
+  CHECK(sStats.u32DemandMa <= POV_CURRENT_BUDGET_MA);
+  CHECK(memcmp(Pov_au8ScaledLut, Pov_au8DutyLut, sizeof(Pov_au8ScaledLut)) == 0);
+}
+
+/* A lower budget dims the image as a whole: every plane of every revolution fits, and every channel still shows
+its scaled duty on average, so the dither stays consistent and no pixel is dropped */
+static void TestGovernorBudget(void)
+{
+  static const u8 au8Levels[] = {255, 200, 128, 60};
+  static const u32 au32Budgets[] = {200, 120, 60, 20};
+  PovCurrentStatsType sStats;
+  u32 au32Slots[POV_CHANNELS];
+  u32 au32Error[POV_CHANNELS];
+  u32 u32Duty;
+
+  for(u8 i = 0; i < sizeof(au8Levels); i++)
+  {
+    TestImageFill(au8Levels[i]);
+    CHECK(PovSetImage(Test_au8Image, sizeof(Test_au8Image)));
+
+    for(u8 j = 0; j < sizeof(au32Budgets) / sizeof(au32Budgets[0]); j++)
+    {
+      PovSetCurrentBudget(au32Budgets[j]);
+      PovGetCurrentStats(&sStats);
+      CHECK(PovPlanePeakMa(sStats.u16ScaleQ8) <= au32Budgets[j]);
+      CHECK( (sStats.u16ScaleQ8 == POV_CURRENT_SCALE_FULL) || (sStats.u32DemandMa > au32Budgets[j]) );
+
+      for(u8 u8Channel = 0; u8Channel < POV_CHANNELS; u8Channel++)
+      {
+        au32Slots[u8Channel] = 0;
+        au32Error[u8Channel] = Pov_au8DitherError[u8Channel % POV_COLORS][0][u8Channel / POV_COLORS];
+      }
+
+      for(u32 u32Rev = 0; u32Rev < TEST_REVOLUTIONS; u32Rev++)
+      {
+        PovRenderFrame();
+        PovGetCurrentStats(&sStats);
+        CHECK(sStats.u32PeakMa <= au32Budgets[j]);
+        for(u8 u8Channel = 0; u8Channel < POV_CHANNELS; u8Channel++)
+        {
+          au32Slots[u8Channel] += TestShownSlots(0, u8Channel);
+        }
+      }
+
+      /* Shown + error left = revolutions * duty, for every channel at the same scale */
+      for(u8 u8Channel = 0; u8Channel < POV_CHANNELS; u8Channel++)
+      {
+        u32Duty = (Pov_au8DutyLut[u8Channel % POV_COLORS][au8Levels[i]] * sStats.u16ScaleQ8) >> 8;
+        CHECK( (au32Slots[u8Channel] << POV_DITHER_BITS) +
+               Pov_au8DitherError[u8Channel % POV_COLORS][0][u8Channel / POV_COLORS] ==
+               TEST_REVOLUTIONS * u32Duty + au32Error[u8Channel] );
+      }
+    }
+  }
+
+  PovSetCurrentBudget(POV_CURRENT_BUDGET_MA);
+  PovGetCurrentStats(&sStats);
+  CHECK(sStats.u16ScaleQ8 == POV_CURRENT_SCALE_FULL);
+}
+
+/* Every 8-bit level of every color, as a whole frame of that level: over n revolutions the slots a channel shows
+add up to n times its duty to within the dither error carried over, so the average is within
+POV_DITHER_MASK / n duty steps of the duty and converges to it.  Every column and channel is checked. */
+static void TestDitherAverage(void)
+{
+  static u32 au32Slots[POV_COLUMNS][POV_CHANNELS];
+  u32 u32Shown;
+  u32 u32Target;
+  u32 u32Error;
+  u32 u32MaxFirst = 0;
+  u32 u32MaxLast = 0;
+  u32 u32Bad = 0;
+
+  for(u16 u16Level = 0; u16Level < POV_LEVELS; u16Level++)
+  {
+    TestImageFill((u8)u16Level);
+    CHECK(PovSetImage(Test_au8Image, sizeof(Test_au8Image)));
+    memset(au32Slots, 0, sizeof(au32Slots));
+
+    for(u32 u32Rev = 1; u32Rev <= TEST_REVOLUTIONS; u32Rev++)
+    {
+      PovRenderFrame();
+      for(u16 u16Column = 0; u16Column < POV_COLUMNS; u16Column++)
+      {
+        for(u8 u8Channel = 0; u8Channel < POV_CHANNELS; u8Channel++)
+        {
+          au32Slots[u16Column][u8Channel] += TestShownSlots(u16Column, u8Channel);
+          u32Shown = au32Slots[u16Column][u8Channel] << POV_DITHER_BITS;
+          u32Target = u32Rev * Pov_au8DutyLut[u8Channel % POV_COLORS][u16Level];
+          u32Error = (u32Shown > u32Target) ? (u32Shown - u32Target) : (u32Target - u32Shown);
+          if(u32Error > POV_DITHER_MASK)
+          {
+            u32Bad++;
+          }
+
+          /* Average error in 1/256 duty step */
+          u32Error = (u32Error << 8) / u32Rev;
+          if( (u32Rev == 1) && (u32Error > u32MaxFirst) )
+          {
+            u32MaxFirst = u32Error;
+          }
+          if( (u32Rev == TEST_REVOLUTIONS) && (u32Error > u32MaxLast) )
+          {
+            u32MaxLast = u32Error;
+          }
+        }
+      }
+    }
+  }
+
+  printf("dither, average duty error over 1 revolution %.2f steps, over %u revolutions %.3f steps\n",
+         u32MaxFirst / 256.0, (unsigned)TEST_REVOLUTIONS, u32MaxLast / 256.0);
+  CHECK(u32Bad == 0);
+  CHECK(u32MaxLast < 256);
+}
+
+static double TestSeconds(void)
+{
+  struct timespec sTime;
+
+  clock_gettime(CLOCK_MONOTONIC, &sTime);
+  return( (double)sTime.tv_sec + (double)sTime.tv_nsec * 1e-9 );
+}
+
+/* Render cost on the host for the built in test image: a whole frame, and one column as PovUpdate() renders them
+behind the interrupt.  Only the ratio carries over to the target. */
+static void TestRenderBenchmark(void)
+{
+  double dStart;
+  double dFrameUs;
+  double dColumnNs;
+
+  CHECK(PovSetImage(Pov_au8TestImage, sizeof(Pov_au8TestImage)));
+
+  dStart = TestSeconds();
+  for(u32 n = 0; n < TEST_BENCH_FRAMES; n++)
+  {
+    PovRenderFrame();
+  }
+  dFrameUs = (TestSeconds() - dStart) * 1e6 / TEST_BENCH_FRAMES;
+
+  dStart = TestSeconds();
+  for(u32 n = 0; n < TEST_BENCH_FRAMES * POV_COLUMNS; n++)
+  {
+    PovRenderColumn(Pov_u8Front, (u16)(n % POV_COLUMNS), NULL);
+  }
+  dColumnNs = (TestSeconds() - dStart) * 1e9 / (TEST_BENCH_FRAMES * POV_COLUMNS);
+
+  printf("benchmark, %u columns x %u channels: PovRenderFrame %.2f us, PovRenderColumn %.0f ns\n",
+         (unsigned)POV_COLUMNS, (unsigned)POV_CHANNELS, dFrameUs, dColumnNs);
+  CHECK(dFrameUs > 0.0);
+}
+
+
+/* Wand position at a time: the X acceleration is -w^2 times it, so it crosses zero with X, in the middle of each
+stroke */
+static double TestSwingPosition(u32 u32TimeUs_)
+{
+  return( sin(2.0 * M_PI * (double)(u32TimeUs_ - Test_u32SwingStartUs) / TEST_SWING_CYCLE_US) );
+}
+
+/* A column is lit from its alarm to the next one, so it stands where the wand is half way through */
+static void TestSwingColumn(u16 u16Column_, u32 u32Leds_)
+{
+  double dPosition = TestSwingPosition(Test_u32NowUs + ((Pov_sActive.u32StepQ8 * Pov_sActive.u8ColumnStride) >> 9));
+
+  if(!Test_bSwingMeasure)
+  {
+    return;
+  }
+
+  if( (Test_adColumnMin[u16Column_] > dPosition) || (Test_adColumnSum[u16Column_] == 0.0) )
+  {
+    Test_adColumnMin[u16Column_] = dPosition;
+  }
+  if( (Test_adColumnMax[u16Column_] < dPosition) || (Test_adColumnSum[u16Column_] == 0.0) )
+  {
+    Test_adColumnMax[u16Column_] = dPosition;
+  }
+  Test_adColumnSum[u16Column_] += dPosition + 2.0;
+  Test_u32SwingColumns++;
+}
+
+/* Swings the wand with X sinusoidal, plus an offset (gravity on a tilted swing makes alternate strokes differ) and
+sample noise, and measures how still the image stands: for each column, the spread of the positions it is drawn at
+over every stroke, both ways, in columns (the mean distance between neighbours).  Returns the largest spread. */
+static double TestSwingTrace(s16 s16Offset_, u16 u16Noise_)
+{
+  PovColumnStatsType sStats;
+  u32 u32Random = 3;
+  u32 u32EndUs;
+  double dX;
+  double dColumn;
+  double dSpread = 0.0;
+
+  memset(Test_adColumnSum, 0, sizeof(Test_adColumnSum));
+  Test_u32SwingColumns = 0;
+  Test_bSwingMeasure = false;
+  Test_u32SwingStartUs = Test_u32NowUs;
+  Test_pfnColumn = TestSwingColumn;
+  PovSetMotionMode(POV_MOTION_SWING);
+  PovClearColumnStats();
+
+  u32EndUs = Test_u32NowUs + TEST_SWING_RUN_US;
+  for(u32 u32SampleUs = Test_u32NowUs; (s32)(u32EndUs - u32SampleUs) > 0; u32SampleUs += TEST_SWING_SAMPLE_US)
+  {
+    TestAlarms(u32SampleUs);
+    if( !Test_bSwingMeasure && ((u32SampleUs - Test_u32SwingStartUs) >= TEST_SWING_SETTLE_US) )
+    {
+      Test_bSwingMeasure = true;
+      PovClearColumnStats();
+    }
+
+    u32Random = u32Random * 1103515245 + 12345;
+    dX = -TEST_SWING_AMPLITUDE * TestSwingPosition(u32SampleUs) + s16Offset_;
+    if(u16Noise_ != 0)
+    {
+      dX += (double)((s32)((u32Random >> 8) % (2 * u16Noise_ + 1)) - (s32)u16Noise_);
+    }
+    PovMotionSample((s16)lrint(dX), u32SampleUs);
+  }
+
+  /* Column pitch: the image runs from column 0 to the last column on average */
+  dColumn = ((Test_adColumnSum[POV_COLUMNS - 1] - Test_adColumnSum[0]) / (Test_u32SwingColumns / POV_COLUMNS)) /
+            (POV_COLUMNS - 1);
+  for(u16 u16Column = 0; u16Column < POV_COLUMNS; u16Column++)
+  {
+    if( (Test_adColumnMax[u16Column] - Test_adColumnMin[u16Column]) / dColumn > dSpread )
+    {
+      dSpread = (Test_adColumnMax[u16Column] - Test_adColumnMin[u16Column]) / dColumn;
+    }
+  }
+
+  PovGetColumnStats(&sStats);
+  printf("benchmark, swing %u ms cycle, offset %d, noise %u: %u strokes, column spread max %.2f columns, "
+         "center error max %u us\n", (unsigned)(TEST_SWING_CYCLE_US / 1000), s16Offset_, u16Noise_,
+         (unsigned)sStats.u32Strokes, dSpread, (unsigned)sStats.u32MaxCenterErrorUs);
+
+  CHECK(G_u32PovFlags & _POV_FLAGS_LOCKED);
+  CHECK(sStats.u32Strokes >= 2 * (TEST_SWING_RUN_US - TEST_SWING_SETTLE_US) / TEST_SWING_CYCLE_US - 1);
+  CHECK(Test_u32SwingColumns >= (sStats.u32Strokes - 1) * POV_COLUMNS);
+  CHECK(dColumn > 0.0);
+
+  Test_pfnColumn = NULL;
+  PovSetMotionMode(POV_MOTION_SPIN);
+  return(dSpread);
+}
+
+/* Swinging: every column lands in the same place stroke after stroke, both ways.  The offset makes alternate
+strokes differ in length but not the image position.  Noise of +/-200 on X rising ~375 a sample near zero moves each
+crossing by up to ~1.3 ms, and a center is predicted from two of them, so the image can wander by a few columns. */
+static void TestSwing(void)
+{
+  CHECK(TestSwingTrace(0, 0) < 0.25);
+  CHECK(TestSwingTrace(1600, 0) < 0.25);
+  CHECK(TestSwingTrace(0, 200) < 4.0);
+}
+
+
+/* Renders a frame of one level everywhere and notes which frame it went to.  Full and zero levels light every LED
+or none in every plane, whatever the dither error, so a column's LEDs tell which image it came from. */
+static void TestSwapRequest(u8 u8Level_)
+{
+  TestImageFill(u8Level_);
+  PovRenderFrame();
+  Test_u32Generation++;
+  Test_au32FrameGeneration[Pov_u8Front ^ 1] = Test_u32Generation;
+  Test_au8FrameLevel[Pov_u8Front ^ 1] = u8Level_;
+}
+
+static void TestSwapColumn(u16 u16Column_, u32 u32Leds_)
+{
+  u32 u32Generation = Test_au32FrameGeneration[Pov_u8Front];
+  u32 u32Expected = (Test_au8FrameLevel[Pov_u8Front] != 0) ? POV_LED_MASK : 0;
+
+  if(u16Column_ == 0)
+  {
+    /* A new revolution shows a frame rendered before the last one ended: no older than the newest frame at its
+    last column, no newer than the newest now */
+    if( (Test_u32Revolutions != 0) &&
+        ((u32Generation < Test_u32LastColumnGeneration) || (u32Generation < Test_u32RevolutionGeneration)) )
+    {
+      Test_u32StaleRevolutions++;
+    }
+    Test_u32RevolutionGeneration = u32Generation;
+    Test_u16NextColumn = 0;
+    Test_u32Revolutions++;
+  }
+
+  if( (u16Column_ != Test_u16NextColumn) || (u32Generation != Test_u32RevolutionGeneration) ||
+      (u32Leds_ != u32Expected) )
+  {
+    Test_u32MixedRevolutions++;
+  }
+  Test_u16NextColumn = u16Column_ + 1;
+
+  if(u16Column_ == POV_COLUMNS - 1)
+  {
+    Test_u32LastColumnGeneration = Test_u32Generation;
+  }
+}
+
+/* Swap requests at random times, from several a revolution to none for a while, against the column interrupt:
+every revolution shows all its columns from one frame, and a frame rendered before a revolution ends is shown
+from the next one on (unless a newer one replaced it first) */
+static void TestSwap(void)
+{
+  u32 u32Random = 7;
+  u32 u32StartUs = Test_u32NowUs;
+  u32 u32NextMarkUs = u32StartUs;
+  u32 u32NextSwapUs = u32StartUs + TEST_SPIN_US * (POV_LOCK_MARKS + 1);
+  u8 u8Level = 0;
+
+  TestImageFill(0);
+  CHECK(PovSetImage(Test_au8Image, sizeof(Test_au8Image)));
+  Test_u32Generation = 0;
+  Test_au32FrameGeneration[Pov_u8Front] = 0;
+  Test_au8FrameLevel[Pov_u8Front] = 0;
+  Test_pfnColumn = TestSwapColumn;
+
+  while(Test_u32Revolutions < TEST_SWAP_REVOLUTIONS)
+  {
+    if((s32)(u32NextSwapUs - u32NextMarkUs) < 0)
+    {
+      TestAlarms(u32NextSwapUs);
+      u8Level ^= 0xFF;
+      TestSwapRequest(u8Level);
+      u32Random = u32Random * 1103515245 + 12345;
+      u32NextSwapUs += (u32Random >> 8) % (TEST_SPIN_US * 3 / 2);
+    }
+    else
+    {
+      TestAlarms(u32NextMarkUs);
+      PovRevolutionMark(u32NextMarkUs);
+      u32NextMarkUs += TEST_SPIN_US;
+    }
+  }
+
+  printf("swap, %u revolutions, %u frames rendered: %u mixed, %u late\n", (unsigned)Test_u32Revolutions,
+         (unsigned)Test_u32Generation, (unsigned)Test_u32MixedRevolutions, (unsigned)Test_u32StaleRevolutions);
+  CHECK(G_u32PovFlags & _POV_FLAGS_LOCKED);
+  CHECK(Test_u32Generation > TEST_SWAP_REVOLUTIONS);
+  CHECK(Test_u32MixedRevolutions == 0);
+  CHECK(Test_u32StaleRevolutions == 0);
+
+  Test_pfnColumn = NULL;
+  PovStop();
+}
+
+
+int main(void)
+{
+  void* pvFlash = mmap((void*)(uintptr_t)TEST_FLASH_MAP_BASE, TEST_FLASH_MAP_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+  if(pvFlash != (void*)(uintptr_t)TEST_FLASH_MAP_BASE)
+  {
+    printf("test_pov: cannot map the image area at 0x%05X\n", (unsigned)TEST_FLASH_MAP_BASE);
+    return(1);
+  }
+  memset(pvFlash, 0xFF, TEST_FLASH_MAP_SIZE);
+
+  SysTimeInitialize();
+  PovInitialize();
+
+  TestGovernorDefault();
+  TestGovernorBudget();
+  TestDitherAverage();
+  TestRenderBenchmark();
+  TestSwap();
+  TestSwing();
+
+  return(HostResult("test_pov"));
+}
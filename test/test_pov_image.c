@@ -0,0 +1,274 @@
+/**********************************************************************************************************************
+File: test_pov_image.c
+
+Description:
+Host tests for the POV image container (pov_image.c).  Images are encoded here in every format, following the
+layout described in pov_image.h, and decoded with PovImageOpen() / PovImageNextColumn(); every column must come
+back as it went in, through more than one revolution so the wrap to column 0 is covered.
+**********************************************************************************************************************/
+
+#include "host.h"
+#include "pov_image.c"
+
+#define TEST_IMAGE_MAX        (u16)(POV_IMAGE_HEADER_SIZE + POV_COLUMNS * (3 + POV_CHANNELS))
+
+volatile u32 G_u32SystemFlags;
+volatile u32 G_u32SystemTime1ms;
+volatile u32 G_u32SystemTime1s;
+
+static u8 Test_aau8Columns[POV_COLUMNS][POV_CHANNELS];   /* Image being encoded */
+static u8 Test_au8Image[TEST_IMAGE_MAX];                 /* Encoded container */
+
+
+static u16 TestHeader(u8 u8Format_, u16 u16DataSize_)
+{
+  Test_au8Image[0] = POV_IMAGE_MAGIC0;
+  Test_au8Image[1] = POV_IMAGE_MAGIC1;
+  Test_au8Image[2] = u8Format_;
+  Test_au8Image[3] = (u8)POV_COLUMNS;
+  Test_au8Image[4] = (u8)(u16DataSize_ & 0xFF);
+  Test_au8Image[5] = (u8)(u16DataSize_ >> 8);
+  Test_au8Image[6] = 0;
+  Test_au8Image[7] = 0;
+
+  return( (u16)(POV_IMAGE_HEADER_SIZE + u16DataSize_) );
+}
+
+static u16 TestEncodeRaw(void)
+{
+  memcpy(&Test_au8Image[POV_IMAGE_HEADER_SIZE], Test_aau8Columns, sizeof(Test_aau8Columns));
+  return( TestHeader(POV_IMAGE_FORMAT_RAW, sizeof(Test_aau8Columns)) );
+}
+
+/* Repeats for equal columns, a DELTA when it is shorter than a LITERAL */
+static u16 TestEncodeRleDelta(void)
+{
+  u8 au8Previous[POV_CHANNELS] = {0};
+  u8* pu8Out = &Test_au8Image[POV_IMAGE_HEADER_SIZE];
+  u16 u16Mask;
+  u8 u8Changed;
+  u16 c = 0;
+  u8 u8Run;
+
+  while(c < POV_COLUMNS)
+  {
+    if(memcmp(Test_aau8Columns[c], au8Previous, POV_CHANNELS) == 0)
+    {
+      for(u8Run = 1; ((c + u8Run) < POV_COLUMNS) && (u8Run <= POV_IMAGE_CODE_REPEAT_MAX) &&
+                     (memcmp(Test_aau8Columns[c + u8Run], au8Previous, POV_CHANNELS) == 0); u8Run++)
+      {
+      }
+      *pu8Out++ = (u8)(POV_IMAGE_CODE_REPEAT + u8Run - 1);
+      c += u8Run;
+      continue;
+    }
+
+    u16Mask = 0;
+    u8Changed = 0;
+    for(u8 i = 0; i < POV_CHANNELS; i++)
+    {
+      if(Test_aau8Columns[c][i] != au8Previous[i])
+      {
+        u16Mask |= (u16)(1 << i);
+        u8Changed++;
+      }
+    }
+
+    if( (2 + u8Changed) < (1 + POV_CHANNELS) )
+    {
+      *pu8Out++ = (u8)(POV_IMAGE_CODE_DELTA | (u16Mask >> 8));
+      *pu8Out++ = (u8)(u16Mask & 0xFF);
+      for(u8 i = 0; i < POV_CHANNELS; i++)
+      {
+        if(u16Mask & (1 << i))
+        {
+          *pu8Out++ = Test_aau8Columns[c][i];
+        }
+      }
+    }
+    else
+    {
+      *pu8Out++ = POV_IMAGE_CODE_LITERAL;
+      memcpy(pu8Out, Test_aau8Columns[c], POV_CHANNELS);
+      pu8Out += POV_CHANNELS;
+    }
+
+    memcpy(au8Previous, Test_aau8Columns[c], POV_CHANNELS);
+    c++;
+  }
+
+  return( TestHeader(POV_IMAGE_FORMAT_RLE_DELTA, (u16)(pu8Out - &Test_au8Image[POV_IMAGE_HEADER_SIZE])) );
+}
+
+/* Builds the palette from the image itself; the image must use no more than 2^u8Bits_ colors */
+static u16 TestEncodePalette(u8 u8Bits_)
+{
+  u8* pu8Palette = &Test_au8Image[POV_IMAGE_HEADER_SIZE];
+  u8* pu8Indices = pu8Palette + POV_IMAGE_PALETTE_SIZE(u8Bits_);
+  u8 u8Colors = 0;
+  u16 u16Bit = 0;
+  u8 u8Index;
+
+  memset(pu8Palette, 0, POV_IMAGE_PALETTE_SIZE(u8Bits_) + POV_IMAGE_INDEX_SIZE(u8Bits_));
+  for(u16 c = 0; c < POV_COLUMNS; c++)
+  {
+    for(u8 p = 0; p < POV_PIXELS; p++, u16Bit += u8Bits_)
+    {
+      for(u8Index = 0; u8Index < u8Colors; u8Index++)
+      {
+        if(memcmp(&pu8Palette[u8Index * POV_COLORS], &Test_aau8Columns[c][p * POV_COLORS], POV_COLORS) == 0)
+        {
+          break;
+        }
+      }
+      if(u8Index == u8Colors)
+      {
+        CHECK(u8Colors < (1 << u8Bits_));
+        memcpy(&pu8Palette[u8Index * POV_COLORS], &Test_aau8Columns[c][p * POV_COLORS], POV_COLORS);
+        u8Colors++;
+      }
+      pu8Indices[u16Bit >> 3] |= (u8)(u8Index << (u16Bit & 0x7));
+    }
+  }
+
+  return( TestHeader((u8)(POV_IMAGE_FORMAT_PALETTE1 + ((u8Bits_ == 1) ? 0 : ((u8Bits_ == 2) ? 1 : 2))),
+                     POV_IMAGE_PALETTE_SIZE(u8Bits_) + POV_IMAGE_INDEX_SIZE(u8Bits_)) );
+}
+
+/* Two revolutions of columns must match the source */
+static void TestDecode(u16 u16Size_)
+{
+  PovImageDecoderType sDecoder;
+  const u8* pu8Levels;
+  bool bSame = true;
+
+  CHECK(PovImageOpen(&sDecoder, Test_au8Image, u16Size_));
+  for(u16 r = 0; r < 2; r++)
+  {
+    for(u16 c = 0; c < POV_COLUMNS; c++)
+    {
+      pu8Levels = PovImageNextColumn(&sDecoder);
+      bSame = bSame && (memcmp(pu8Levels, Test_aau8Columns[c], POV_CHANNELS) == 0);
+    }
+  }
+  CHECK(bSame);
+  CHECK(!sDecoder.bError);
+}
+
+
+/* Vertical bars, a gradient and runs of equal columns: exercises every RLE_DELTA code */
+static void TestFillBars(void)
+{
+  for(u16 c = 0; c < POV_COLUMNS; c++)
+  {
+    for(u8 i = 0; i < POV_CHANNELS; i++)
+    {
+      Test_aau8Columns[c][i] = (c < 4) ? 0 : (u8)((c / 8) * 30 + ((i % POV_COLORS) == 0 ? c : 0));
+    }
+  }
+  Test_aau8Columns[40][5] = 0xFF;
+  Test_aau8Columns[41][0] = 0x01;
+}
+
+static void TestFillPseudoRandom(u32 u32Seed_)
+{
+  for(u16 c = 0; c < POV_COLUMNS; c++)
+  {
+    for(u8 i = 0; i < POV_CHANNELS; i++)
+    {
+      u32Seed_ = u32Seed_ * 1664525 + 1013904223;
+      Test_aau8Columns[c][i] = (u8)(u32Seed_ >> 24);
+    }
+  }
+}
+
+/* Every pixel one of u8Colors_ colors */
+static void TestFillColors(u8 u8Colors_)
+{
+  u8 u8Color;
+
+  for(u16 c = 0; c < POV_COLUMNS; c++)
+  {
+    for(u8 p = 0; p < POV_PIXELS; p++)
+    {
+      u8Color = (u8)((c * 3 + p * 5 + (c >> 3)) % u8Colors_);
+      Test_aau8Columns[c][p * POV_COLORS + 0] = (u8)(u8Color * 17);
+      Test_aau8Columns[c][p * POV_COLORS + 1] = (u8)(255 - u8Color * 13);
+      Test_aau8Columns[c][p * POV_COLORS + 2] = (u8)(u8Color * u8Color);
+    }
+  }
+}
+
+
+static void TestRoundTrip(void)
+{
+  TestFillBars();
+  TestDecode(TestEncodeRaw());
+  TestDecode(TestEncodeRleDelta());
+
+  for(u32 s = 1; s < 20; s++)
+  {
+    TestFillPseudoRandom(s);
+    TestDecode(TestEncodeRaw());
+    TestDecode(TestEncodeRleDelta());
+  }
+
+  TestFillColors(2);
+  TestDecode(TestEncodePalette(1));
+  TestFillColors(4);
+  TestDecode(TestEncodePalette(2));
+  TestFillColors(16);
+  TestDecode(TestEncodePalette(4));
+  TestDecode(TestEncodeRleDelta());
+}
+
+static void TestBadImages(void)
+{
+  PovImageDecoderType sDecoder;
+  const u8* pu8Levels;
+  u16 u16Size;
+  u8 au8Dark[POV_CHANNELS] = {0};
+
+  TestFillPseudoRandom(99);
+  u16Size = TestEncodeRleDelta();
+
+  /* Size limit, magic, column count and format are all checked */
+  CHECK(!PovImageOpen(&sDecoder, Test_au8Image, u16Size - 1));
+  Test_au8Image[1] = 'X';
+  CHECK(!PovImageOpen(&sDecoder, Test_au8Image, u16Size));
+  Test_au8Image[1] = POV_IMAGE_MAGIC1;
+  Test_au8Image[3] = POV_COLUMNS - 1;
+  CHECK(!PovImageOpen(&sDecoder, Test_au8Image, u16Size));
+  Test_au8Image[3] = POV_COLUMNS;
+  Test_au8Image[2] = 0x7F;
+  CHECK(!PovImageOpen(&sDecoder, Test_au8Image, u16Size));
+  CHECK(!PovImageOpen(&sDecoder, Test_au8Image, 4));
+
+  /* Erased flash is not an image */
+  memset(Test_au8Image, 0xFF, sizeof(Test_au8Image));
+  CHECK(!PovImageOpen(&sDecoder, Test_au8Image, sizeof(Test_au8Image)));
+
+  /* Data cut short: the columns past the end are dark, and the next revolution starts clean */
+  TestFillPseudoRandom(7);
+  u16Size = TestEncodeRleDelta();
+  TestHeader(POV_IMAGE_FORMAT_RLE_DELTA, (u16)((u16Size - POV_IMAGE_HEADER_SIZE) / 2));
+  CHECK(PovImageOpen(&sDecoder, Test_au8Image, u16Size));
+  for(u16 c = 0; c < POV_COLUMNS; c++)
+  {
+    pu8Levels = PovImageNextColumn(&sDecoder);
+  }
+  CHECK(sDecoder.bError);
+  CHECK(memcmp(pu8Levels, au8Dark, POV_CHANNELS) == 0);
+  pu8Levels = PovImageNextColumn(&sDecoder);
+  CHECK(!sDecoder.bError);
+  CHECK(memcmp(pu8Levels, Test_aau8Columns[0], POV_CHANNELS) == 0);
+}
+
+
+int main(void)
+{
+  TestRoundTrip();
+  TestBadImages();
+
+  return(HostResult("test_pov_image"));
+}
@@ -0,0 +1,435 @@
+/**********************************************************************************************************************
+File: test_pov_sync.c
+
+Description:
+Host simulation of wand phase sync (pov_sync.c) across several wands.  pov_sync.c keeps its state in statics, so
+each simulated wand holds a copy that is swapped in while that wand runs.  The display is a model instead of
+pov.c: each wand spins at its own period from its own start angle, the rotation estimate that PovGetPhase()
+extrapolates from has its revolution mark off by up to a configurable jitter, and the image is drawn at the true
+angle less the phase offset sync sets.  The ANT channel is a model too: the master's page goes out every sync
+channel period and each slave gets it after its own event latency, while the master's EVENT_TX is stamped after
+the master's.  The sync outcome is measured from the true angles, as someone watching the wands would see it:
+time to lock and the residual phase error between each slave's image and the master's.
+**********************************************************************************************************************/
+
+#include "host.h"
+#include "system_time.c"
+#include "pov_sync.c"
+
+#define TEST_WANDS              (u8)4                   /* Wand 0 is the master */
+#define TEST_PERIOD_US          ANT_PERIOD_TO_US(POV_SYNC_CHANNEL_PERIOD)
+#define TEST_ROTATION_US        (u32)40000              /* 25 revolutions per second */
+#define TEST_SETTLE_PAGES       (u32)80                 /* Pages run before the residual error is measured */
+#define TEST_MEASURE_PAGES      (u32)400                /* Pages the residual error is measured over */
+
+typedef struct
+{
+  u32 u32RotationUs;                          /* True revolution time */
+  u32 u32StartUs;                             /* True time of angle 0 */
+  u32 u32MarkJitterUs;                        /* Rotation estimate mark error: up to +/- this */
+  u32 u32EventLatencyUs;                      /* Radio event to interrupt time stamp (TX for the master) */
+  u16 u16LossPerMille;                        /* Slave: pages missed */
+  s16 s16Offset;                              /* PovSetPhaseOffset() */
+  bool bChannelOpen;
+
+  /* pov_sync.c statics while another wand runs */
+  PovSyncRoleType eRole;
+  PovSyncRoleType eChannelRole;
+  u32 u32OpenTime;
+  u8 u8Sequence;
+  u8 au8Page[ANT_STANDARD_DATA_PAYLOAD_SIZE];
+  PovSyncStatusType sStatus;
+  u32 u32FirstPageTime;
+  bool bSeedResidual;
+} TestWandType;
+
+volatile u32 G_u32SystemFlags;
+volatile u32 G_u32SystemTime1ms;
+volatile u32 G_u32SystemTime1s;
+
+static TestWandType Test_asWands[TEST_WANDS];
+static TestWandType* Test_psWand = &Test_asWands[0];  /* Wand whose state is in pov_sync.c */
+static u8 Test_au8Air[ANT_STANDARD_DATA_PAYLOAD_SIZE]; /* Page the master has loaded for the next period */
+static bool Test_bAirLoaded;
+static u32 Test_u32NowUs;
+static u32 Test_u32Random;
+
+
+/* The display model */
+bool PovGetRotation(u32* pu32PeriodUs_, u32* pu32MarkUs_)
+{
+  *pu32PeriodUs_ = Test_psWand->u32RotationUs;
+  *pu32MarkUs_ = Test_psWand->u32StartUs;
+  return(true);
+}
+
+static u32 TestRandom(void)
+{
+  Test_u32Random = Test_u32Random * 1103515245 + 12345;
+  return(Test_u32Random >> 16);
+}
+
+/* Angle in 1/65536 revolution at a time, from a mark u32Mark_ */
+static u16 TestAngle(u32 u32TimeUs_, u32 u32MarkUs_, u32 u32RotationUs_)
+{
+  s32 s32Elapsed = (s32)(u32TimeUs_ - u32MarkUs_) % (s32)u32RotationUs_;
+
+  if(s32Elapsed < 0)
+  {
+    s32Elapsed += (s32)u32RotationUs_;
+  }
+  return( (u16)(((u64)s32Elapsed << 16) / u32RotationUs_) );
+}
+
+u16 PovGetPhase(u32 u32TimeUs_)
+{
+  u32 u32Mark = Test_psWand->u32StartUs;
+
+  if(Test_psWand->u32MarkJitterUs != 0)
+  {
+    u32Mark += (TestRandom() % (2 * Test_psWand->u32MarkJitterUs + 1)) - Test_psWand->u32MarkJitterUs;
+  }
+  return( (u16)(TestAngle(u32TimeUs_, u32Mark, Test_psWand->u32RotationUs) - (u16)Test_psWand->s16Offset) );
+}
+
+void PovSetPhaseOffset(s16 s16Offset_) { Test_psWand->s16Offset = s16Offset_; }
+s16 PovGetPhaseOffset(void) { return(Test_psWand->s16Offset); }
+
+/* Image angle a wand really shows */
+static u16 TestShownPhase(u8 u8Wand_, u32 u32TimeUs_)
+{
+  TestWandType* psWand = &Test_asWands[u8Wand_];
+
+  return( (u16)(TestAngle(u32TimeUs_, psWand->u32StartUs, psWand->u32RotationUs) - (u16)psWand->s16Offset) );
+}
+
+
+/* The ANT channel model */
+bool AntRegisterChannelHandler(u8 u8Channel_, fnAntChannelHandlerType pfnHandler_) { return(true); }
+void AntRequireTxEvents(u8 u8Channel_, bool bRequired_) { }
+bool AntIsChannelOpen(u8 u8Channel_) { return(Test_psWand->bChannelOpen); }
+
+bool AntOpenChannel(const AntChannelConfigType* psConfig_)
+{
+  Test_psWand->bChannelOpen = true;
+  return(true);
+}
+
+bool AntCloseChannel(u8 u8Channel_)
+{
+  Test_psWand->bChannelOpen = false;
+  return(true);
+}
+
+bool AntBroadcast(u8 u8Channel_, u8* pu8Data_)
+{
+  memcpy(Test_au8Air, pu8Data_, sizeof(Test_au8Air));
+  Test_bAirLoaded = true;
+  return(true);
+}
+
+
+/* Swaps the pov_sync.c state of another wand in */
+static void TestSelect(u8 u8Wand_)
+{
+  Test_psWand->eRole = PovSync_eRole;
+  Test_psWand->eChannelRole = PovSync_eChannelRole;
+  Test_psWand->u32OpenTime = PovSync_u32OpenTime;
+  Test_psWand->u8Sequence = PovSync_u8Sequence;
+  memcpy(Test_psWand->au8Page, PovSync_au8Page, sizeof(PovSync_au8Page));
+  Test_psWand->sStatus = PovSync_sStatus;
+  Test_psWand->u32FirstPageTime = PovSync_u32FirstPageTime;
+  Test_psWand->bSeedResidual = PovSync_bSeedResidual;
+
+  Test_psWand = &Test_asWands[u8Wand_];
+  PovSync_eRole = Test_psWand->eRole;
+  PovSync_eChannelRole = Test_psWand->eChannelRole;
+  PovSync_u32OpenTime = Test_psWand->u32OpenTime;
+  PovSync_u8Sequence = Test_psWand->u8Sequence;
+  memcpy(PovSync_au8Page, Test_psWand->au8Page, sizeof(PovSync_au8Page));
+  PovSync_sStatus = Test_psWand->sStatus;
+  PovSync_u32FirstPageTime = Test_psWand->u32FirstPageTime;
+  PovSync_bSeedResidual = Test_psWand->bSeedResidual;
+}
+
+/* Moves the shared time on (the ms time drives the reopen timer and the time to lock) */
+static void TestAdvance(u32 u32Us_)
+{
+  u32 u32Ms = (Test_u32NowUs + u32Us_) / 1000 - Test_u32NowUs / 1000;
+
+  Test_u32NowUs += u32Us_;
+  for( ; u32Ms != 0; u32Ms--)
+  {
+    SysTimeTick();
+  }
+}
+
+/* One event for the current wand's sync channel handler */
+static void TestEvent(u8 u8Event_, const u8* pu8Page_, u32 u32TimeUs_)
+{
+  AntEventType sEvent;
+
+  memset(&sEvent, 0, sizeof(sEvent));
+  sEvent.u8Channel = ANT_CHANNEL_SYNC;
+  sEvent.u8Event = u8Event_;
+  sEvent.u8MessageId = MESG_BROADCAST_DATA_ID;
+  sEvent.u32TimeUs = u32TimeUs_;
+  if(pu8Page_ != NULL)
+  {
+    memcpy(sEvent.au8Payload, pu8Page_, ANT_STANDARD_DATA_PAYLOAD_SIZE);
+    sEvent.u8Length = ANT_STANDARD_DATA_PAYLOAD_SIZE;
+  }
+  PovSyncAntHandler(&sEvent, 1);
+}
+
+/* Sets up the wands with roles, opens their channels and clears the air */
+static void TestStart(void)
+{
+  for(u8 i = 0; i < TEST_WANDS; i++)
+  {
+    TestSelect(i);
+    PovSyncInitialize();
+    PovSync_eRole = POV_SYNC_OFF;
+    PovSyncSetRole((i == 0) ? POV_SYNC_MASTER : POV_SYNC_SLAVE);
+  }
+
+  Test_bAirLoaded = false;
+  TestAdvance(POV_SYNC_REOPEN_MS * 1000);
+  for(u8 i = 0; i < TEST_WANDS; i++)
+  {
+    TestSelect(i);
+    PovSyncUpdate();
+  }
+}
+
+/* One sync channel period: the page on air reaches the slaves, then the master's EVENT_TX loads the next */
+static void TestPage(void)
+{
+  u8 au8Page[ANT_STANDARD_DATA_PAYLOAD_SIZE];
+
+  TestAdvance(TEST_PERIOD_US);
+  memcpy(au8Page, Test_au8Air, sizeof(au8Page));
+
+  for(u8 i = 1; Test_bAirLoaded && (i < TEST_WANDS); i++)
+  {
+    TestSelect(i);
+    if((TestRandom() % 1000) >= Test_asWands[i].u16LossPerMille)
+    {
+      TestEvent(EVENT_RX, au8Page, Test_u32NowUs + Test_asWands[i].u32EventLatencyUs);
+    }
+  }
+
+  TestSelect(0);
+  TestEvent(EVENT_TX, NULL, Test_u32NowUs + Test_asWands[0].u32EventLatencyUs);
+}
+
+/* Runs until every slave is synced or the page limit; returns the pages run */
+static u32 TestRunToLock(u32 u32MaxPages_)
+{
+  u32 u32Pages;
+  bool bAllSynced = false;
+
+  for(u32Pages = 0; (u32Pages < u32MaxPages_) && !bAllSynced; u32Pages++)
+  {
+    TestPage();
+    bAllSynced = true;
+    for(u8 i = 1; i < TEST_WANDS; i++)
+    {
+      TestSelect(i);
+      bAllSynced = bAllSynced && PovSync_sStatus.bSynced;
+    }
+  }
+
+  return(u32Pages);
+}
+
+/* Mean and largest phase error of a slave's image against the master's over u32Pages_ pages, measured half way
+between pages */
+static void TestResidual(u32 u32Pages_, s32* ps32Mean_, u32* pu32Max_, u8 u8Slave_)
+{
+  s32 s32Sum = 0;
+  s16 s16Error;
+
+  *pu32Max_ = 0;
+  for(u32 i = 0; i < u32Pages_; i++)
+  {
+    TestPage();
+    s16Error = (s16)(TestShownPhase(0, Test_u32NowUs + TEST_PERIOD_US / 2) -
+                     TestShownPhase(u8Slave_, Test_u32NowUs + TEST_PERIOD_US / 2));
+    s32Sum += s16Error;
+    if((u32)abs(s16Error) > *pu32Max_)
+    {
+      *pu32Max_ = (u32)abs(s16Error);
+    }
+  }
+  *ps32Mean_ = s32Sum / (s32)u32Pages_;
+}
+
+
+/* Three slaves, each started far out of phase, with mark jitter and lost pages, lock to the master.  The filter
+keeps the image error under the mark jitter of the two wands put together, and it averages out to nothing */
+static void TestConvergence(void)
+{
+  static const u32 au32StartUs[TEST_WANDS] = {0, 13000, 27500, 39000};
+  static const u32 au32JitterUs[TEST_WANDS] = {100, 0, 150, 300};
+  static const u16 au16LossPerMille[TEST_WANDS] = {0, 0, 100, 300};
+  u32 au32LockMs[TEST_WANDS];
+  u32 au32Max[TEST_WANDS];
+  s32 as32Mean[TEST_WANDS];
+  u32 u32Pages;
+  u32 u32Jitter;
+
+  memset(Test_asWands, 0, sizeof(Test_asWands));
+  Test_u32Random = 1;
+  for(u8 i = 0; i < TEST_WANDS; i++)
+  {
+    Test_asWands[i].u32RotationUs = TEST_ROTATION_US;
+    Test_asWands[i].u32StartUs = au32StartUs[i];
+    Test_asWands[i].u32MarkJitterUs = au32JitterUs[i];
+    Test_asWands[i].u16LossPerMille = au16LossPerMille[i];
+  }
+  TestStart();
+
+  u32Pages = TestRunToLock(400);
+  CHECK(u32Pages < 400);
+  for(u8 i = 1; i < TEST_WANDS; i++)
+  {
+    TestSelect(i);
+    CHECK(PovSync_sStatus.bSynced);
+    au32LockMs[i] = PovSync_sStatus.u32TimeToLockMs;
+    CHECK(au32LockMs[i] < 10000);
+  }
+
+  TestResidual(TEST_SETTLE_PAGES, &as32Mean[0], &au32Max[0], 1);
+  for(u8 i = 1; i < TEST_WANDS; i++)
+  {
+    TestResidual(TEST_MEASURE_PAGES, &as32Mean[i], &au32Max[i], i);
+    u32Jitter = (u32)((((u64)au32JitterUs[0] + au32JitterUs[i]) << 16) / TEST_ROTATION_US);
+    CHECK(au32Max[i] < u32Jitter);
+    CHECK(abs(as32Mean[i]) < (s32)POV_SYNC_LOCK_ERROR / 8);
+  }
+
+  printf("sync, %u slaves: lock %u/%u/%u ms, residual error mean %d/%d/%d max %u/%u/%u (1/65536 rev)\n",
+         TEST_WANDS - 1, (unsigned)au32LockMs[1], (unsigned)au32LockMs[2], (unsigned)au32LockMs[3],
+         (int)as32Mean[1], (int)as32Mean[2], (int)as32Mean[3],
+         (unsigned)au32Max[1], (unsigned)au32Max[2], (unsigned)au32Max[3]);
+}
+
+/* A latency difference POV_SYNC_LATENCY_US does not cover shows up one for one as a constant phase error, and a
+slave spinning at a slightly different period lags by the drift over a page divided by the filter gain */
+static void TestLatency(void)
+{
+  static const u32 au32LatencyUs[TEST_WANDS] = {50, 50, 250, 50};
+  s32 s32Mean;
+  s32 s32Expected;
+  u32 u32Max;
+
+  memset(Test_asWands, 0, sizeof(Test_asWands));
+  Test_u32Random = 2;
+  for(u8 i = 0; i < TEST_WANDS; i++)
+  {
+    Test_asWands[i].u32RotationUs = TEST_ROTATION_US;
+    Test_asWands[i].u32StartUs = 5000 * i;
+    Test_asWands[i].u32EventLatencyUs = au32LatencyUs[i];
+  }
+  Test_asWands[3].u32RotationUs = TEST_ROTATION_US + 4;
+  TestStart();
+  (void)TestRunToLock(400);
+
+  /* Matched latency: no error */
+  TestResidual(TEST_SETTLE_PAGES, &s32Mean, &u32Max, 1);
+  TestResidual(TEST_MEASURE_PAGES, &s32Mean, &u32Max, 1);
+  CHECK(u32Max <= 2);
+
+  /* 200us late stamps: the slave compares against a later angle of its own and runs 200us behind */
+  s32Expected = (s32)(((u64)200 << 16) / TEST_ROTATION_US);
+  TestResidual(TEST_MEASURE_PAGES, &s32Mean, &u32Max, 2);
+  CHECK(abs(s32Mean - s32Expected) <= 2);
+  printf("sync, 200 us latency mismatch: residual error %d (expected %d)", (int)s32Mean, (int)s32Expected);
+
+  /* 4us per revolution slower: 3.125 revolutions a page drift 12.5us, and the filter keeps 4 pages of it */
+  s32Expected = (s32)((((u64)4 * TEST_PERIOD_US / TEST_ROTATION_US) << (16 + POV_SYNC_GAIN_SHIFT)) /
+                      TEST_ROTATION_US);
+  TestResidual(TEST_MEASURE_PAGES, &s32Mean, &u32Max, 3);
+  CHECK(abs(abs(s32Mean) - s32Expected) <= s32Expected / 4 + 2);
+  printf(", 0.01%% period mismatch: %d (expected %d)\n", (int)s32Mean, (int)s32Expected);
+}
+
+/* The offset filter itself: a large first error is taken in one step and the residual filter starts again after
+it, small errors are taken a quarter at a time with the same rounding either side of zero, and once synced a large
+error is filtered like a small one */
+static void TestOffsetFilter(void)
+{
+  static const s16 as16Errors[] = {1, 2, 3, 5, 6, 7, 100, 1000};
+  u8 au8Page[ANT_STANDARD_DATA_PAYLOAD_SIZE] = {POV_SYNC_PAGE, 0, 0, 0, 0, 0, 0, POV_SYNC_PAGE_LOCKED};
+  u32 u32Time = 1000000;
+  u16 u16Master;
+  s16 s16Step;
+
+  memset(Test_asWands, 0, sizeof(Test_asWands));
+  Test_asWands[1].u32RotationUs = TEST_ROTATION_US;
+  TestSelect(1);
+  PovSyncInitialize();
+  PovSync_eRole = POV_SYNC_OFF;
+  PovSyncSetRole(POV_SYNC_SLAVE);
+  PovSync_eChannelRole = POV_SYNC_SLAVE;
+
+  /* An unlocked master is ignored */
+  au8Page[7] = 0;
+  au8Page[2] = 0x34;
+  au8Page[3] = 0x12;
+  PovSyncSlaveReceive(au8Page, u32Time);
+  CHECK( (PovGetPhaseOffset() == 0) && (PovSync_sStatus.u32Messages == 0) );
+  au8Page[7] = POV_SYNC_PAGE_LOCKED;
+
+  /* Acquisition: 0x3000 out is corrected at once */
+  u16Master = (u16)(PovGetPhase(u32Time) + 0x3000);
+  au8Page[2] = (u8)u16Master;
+  au8Page[3] = (u8)(u16Master >> 8);
+  PovSyncSlaveReceive(au8Page, u32Time);
+  CHECK(PovGetPhaseOffset() == -0x3000);
+  CHECK(PovGetPhase(u32Time) == u16Master);
+  CHECK(!PovSync_sStatus.bSynced);
+
+  /* The error just corrected does not hold the lock back: the next page in phase locks */
+  PovSyncSlaveReceive(au8Page, u32Time);
+  CHECK(PovSync_sStatus.bSynced);
+  CHECK(PovSync_sStatus.u16Residual == 0);
+
+  /* Small errors: a rounded quarter, the same magnitude for +e and -e */
+  for(u8 i = 0; i < sizeof(as16Errors) / sizeof(as16Errors[0]); i++)
+  {
+    s16Step = (s16)((as16Errors[i] + 2) >> 2);
+    for(s8 s8Sign = 1; s8Sign >= -1; s8Sign -= 2)
+    {
+      PovSetPhaseOffset(0);
+      u16Master = (u16)(PovGetPhase(u32Time) + s8Sign * as16Errors[i]);
+      au8Page[2] = (u8)u16Master;
+      au8Page[3] = (u8)(u16Master >> 8);
+      PovSyncSlaveReceive(au8Page, u32Time);
+      CHECK(PovSync_sStatus.s16LastError == s8Sign * as16Errors[i]);
+      CHECK(PovGetPhaseOffset() == -s8Sign * s16Step);
+    }
+  }
+
+  /* Once synced, a large error (a bad mark) only moves the offset a quarter of the way */
+  CHECK(PovSync_sStatus.bSynced);
+  PovSetPhaseOffset(0);
+  u16Master = (u16)(PovGetPhase(u32Time) + 0x2000);
+  au8Page[2] = (u8)u16Master;
+  au8Page[3] = (u8)(u16Master >> 8);
+  PovSyncSlaveReceive(au8Page, u32Time);
+  CHECK(PovGetPhaseOffset() == -0x800);
+}
+
+
+int main(void)
+{
+  SysTimeInitialize();
+
+  TestConvergence();
+  TestLatency();
+  TestOffsetFilter();
+
+  return(HostResult("test_pov_sync"));
+}
@@ -0,0 +1,478 @@
+/**********************************************************************************************************************
+File: test_remote.c
+
+Description:
+Host simulation of the show remote receiver (remote.c) with the ANT driver (ant.c) and the system time compiled in.
+The soft device is a set of sd_ant_* stubs as in test_image_upload.c, with a simulated radio on top: each remote
+broadcasts its current command page once per TEST_REMOTE_PERIOD_US, and while the wand is scanning the page is
+queued for sd_ant_event_get() with the extended device ID, unless the scan ID list leaves the remote out or the
+page is lost.  The SD_EVT interrupt (AntCaptureEvents()) runs when a page arrives; the main loop runs every
+TEST_STEP_US unless a frame render has it busy.  Settings are a RAM stub, and the display calls record what was
+applied and when, so the time from a button press on a remote to the command taking effect is measured.
+**********************************************************************************************************************/
+
+#include "host.h"
+#include "system_time.c"
+#include "ant.c"
+#include "remote.c"
+
+#define TEST_REMOTES            (u8)3
+#define TEST_REMOTE_PERIOD_US   ANT_PERIOD_TO_US(8192)  /* Remotes broadcast at 4 Hz */
+#define TEST_STEP_US            (u32)100                /* Main loop pass */
+#define TEST_BUSY_US            (u32)2000               /* A frame render blocks the main loop this long... */
+#define TEST_BUSY_PERCENT       (u32)20                 /* ...starting in this many 1ms ticks */
+#define TEST_RADIO_QUEUE        (u8)16                  /* Soft device events waiting for sd_ant_event_get() */
+#define TEST_PRESSES            (u32)60                 /* Commands sent per latency run */
+#define TEST_SETTINGS_SIZE      (u8)16
+
+typedef struct
+{
+  u16 u16DeviceNumber;
+  u32 u32PeriodUs;                            /* Broadcast period (remote crystals differ a little) */
+  u32 u32NextTxUs;                            /* Time of the next broadcast */
+  bool bSilent;                               /* Switched off */
+  u8 au8Page[REMOTE_PAGE_SIZE];               /* Page sent every period */
+} TestRemoteType;
+
+volatile u32 G_u32SystemFlags;
+volatile u32 G_u32SystemTime1ms;
+volatile u32 G_u32SystemTime1s;
+
+static TestRemoteType Test_asRemotes[TEST_REMOTES];
+static u16 Test_u16LossPerMille;                        /* Pages lost on air */
+
+static ANT_MESSAGE Test_asRadio[TEST_RADIO_QUEUE];      /* Soft device event queue */
+static u8 Test_au8RadioChannel[TEST_RADIO_QUEUE];
+static u8 Test_au8RadioEvent[TEST_RADIO_QUEUE];
+static u8 Test_u8RadioHead;
+static u8 Test_u8RadioTail;
+static bool Test_bScanning;                             /* Soft device in scan mode */
+static u32 Test_u32ScanStarts;
+static u16 Test_au16IdList[ANT_ID_LIST_SIZE];           /* Scan ID list loaded in the soft device */
+static u8 Test_u8IdListSize;
+
+static u32 Test_u32NowUs;                               /* Simulated time */
+static u32 Test_u32BusyUntilUs;                         /* Main loop blocked until then */
+static u32 Test_u32Random;
+
+static u8 Test_aau8Settings[SETTINGS_KEYS][TEST_SETTINGS_SIZE];  /* Settings stub */
+static u8 Test_au8SettingsSize[SETTINGS_KEYS];
+
+static u32 Test_u32Applied;                             /* Display calls made by RemoteApply() */
+static u32 Test_u32AppliedUs;
+static u8 Test_u8AppliedCommand;
+static u32 Test_u32AppliedArgument;
+
+
+void SystemWakeRequest(void) { }
+void softdevice_assert_callback(uint32_t ulPC, uint16_t usLineNum, const uint8_t *pucFileName) { }
+void ImageUploadAntHandler(AntEventType* psEvents_, u8 u8Count_) { }
+
+
+/* Settings stub */
+u8 SettingsRead(SettingsKeyType eKey_, u8* pu8Destination_, u8 u8MaxSize_)
+{
+  u8 u8Size = Test_au8SettingsSize[eKey_];
+
+  if(u8Size > u8MaxSize_)
+  {
+    u8Size = u8MaxSize_;
+  }
+  memcpy(pu8Destination_, Test_aau8Settings[eKey_], u8Size);
+  return(u8Size);
+}
+
+bool SettingsWrite(SettingsKeyType eKey_, const u8* pu8Source_, u8 u8Size_)
+{
+  if(u8Size_ > TEST_SETTINGS_SIZE)
+  {
+    return(false);
+  }
+  memcpy(Test_aau8Settings[eKey_], pu8Source_, u8Size_);
+  Test_au8SettingsSize[eKey_] = u8Size_;
+  return(true);
+}
+
+
+/* Display stubs: record what the remote did */
+static void TestApplied(u8 u8Command_, u32 u32Argument_)
+{
+  Test_u32Applied++;
+  Test_u32AppliedUs = Test_u32NowUs;
+  Test_u8AppliedCommand = u8Command_;
+  Test_u32AppliedArgument = u32Argument_;
+}
+
+void PovSetBlank(bool bBlank_) { TestApplied(REMOTE_CMD_BLANK, (u32)bBlank_); }
+void PovSetPhaseOffset(s16 s16Offset_) { TestApplied(REMOTE_CMD_PHASE, (u16)s16Offset_); }
+void PovSyncSetRole(PovSyncRoleType eRole_) { TestApplied(REMOTE_CMD_SYNC, (u32)eRole_); }
+
+
+/* Soft device stubs: configuration calls succeed, the scan state and ID list are kept for the simulated radio */
+uint32_t sd_softdevice_enable(nrf_clock_lfclksrc_t clock_source, softdevice_assertion_handler_t assertion_handler)
+{
+  return(NRF_SUCCESS);
+}
+
+uint32_t sd_nvic_SetPriority(IRQn_Type IRQn, nrf_app_irq_priority_t priority) { return(NRF_SUCCESS); }
+uint32_t sd_nvic_EnableIRQ(IRQn_Type IRQn) { return(NRF_SUCCESS); }
+uint32_t sd_ant_adv_burst_config_set(uint8_t *pucConfigData, uint8_t ucSize) { return(NRF_SUCCESS); }
+uint32_t sd_ant_channel_assign(uint8_t ucChannel, uint8_t ucChannelType, uint8_t ucNetwork, uint8_t ucExtAssign)
+{
+  return(NRF_SUCCESS);
+}
+uint32_t sd_ant_channel_id_set(uint8_t ucChannel, uint16_t usDeviceNumber, uint8_t ucDeviceType,
+                               uint8_t ucTransmitType)
+{
+  return(NRF_SUCCESS);
+}
+uint32_t sd_ant_channel_period_set(uint8_t ucChannel, uint16_t usPeriod) { return(NRF_SUCCESS); }
+uint32_t sd_ant_channel_radio_freq_set(uint8_t ucChannel, uint8_t ucFreq) { return(NRF_SUCCESS); }
+uint32_t sd_ant_channel_radio_tx_power_set(uint8_t ucChannel, uint8_t ucTxPower) { return(NRF_SUCCESS); }
+uint32_t sd_ant_channel_open(uint8_t ucChannel) { return(NRF_SUCCESS); }
+uint32_t sd_ant_channel_unassign(uint8_t ucChannel) { return(NRF_SUCCESS); }
+uint32_t sd_ant_event_filtering_set(uint16_t usFilter) { return(NRF_SUCCESS); }
+uint32_t sd_ant_rfactive_notification_config_set(uint8_t ucMode, uint16_t usTimeThreshold) { return(NRF_SUCCESS); }
+uint32_t sd_ant_lib_config_set(uint8_t ucANTLibConfig) { return(NRF_SUCCESS); }
+uint32_t sd_ant_lib_config_clear(uint8_t ucANTLibConfig) { return(NRF_SUCCESS); }
+uint32_t sd_ant_broadcast_message_tx(uint8_t ucChannel, uint8_t ucSize, uint8_t *aucMesg) { return(NRF_SUCCESS); }
+
+uint32_t sd_ant_id_list_add(uint8_t ucChannel, uint8_t *pucDevId, uint8_t ucListIndex)
+{
+  Test_au16IdList[ucListIndex] = (u16)pucDevId[0] | ((u16)pucDevId[1] << 8);
+  return(NRF_SUCCESS);
+}
+
+uint32_t sd_ant_id_list_config(uint8_t ucChannel, uint8_t ucIDListSize, uint8_t ucIncExcFlag)
+{
+  Test_u8IdListSize = ucIDListSize;
+  return(NRF_SUCCESS);
+}
+
+uint32_t sd_ant_rx_scan_mode_start(uint8_t ucSyncChannelPacketsOnly)
+{
+  Test_bScanning = true;
+  Test_u32ScanStarts++;
+  return(NRF_SUCCESS);
+}
+
+uint32_t sd_ant_event_get(uint8_t *pucChannel, uint8_t *pucEvent, uint8_t *aucANTMesg)
+{
+  if(Test_u8RadioTail == Test_u8RadioHead)
+  {
+    return(NRF_ERROR_NOT_FOUND);
+  }
+
+  *pucChannel = Test_au8RadioChannel[Test_u8RadioTail];
+  *pucEvent = Test_au8RadioEvent[Test_u8RadioTail];
+  memcpy(aucANTMesg, Test_asRadio[Test_u8RadioTail].aucMessage, sizeof(ANT_MESSAGE));
+  Test_u8RadioTail = (u8)((Test_u8RadioTail + 1) % TEST_RADIO_QUEUE);
+  return(NRF_SUCCESS);
+}
+
+
+/* Queues a soft device event; u8Length_ payload bytes follow the channel byte */
+static void TestRadioEvent(u8 u8Channel_, u8 u8Event_, u8 u8MessageId_, const u8* pu8Payload_, u8 u8Length_)
+{
+  ANT_MESSAGE* psMessage = &Test_asRadio[Test_u8RadioHead];
+
+  memset(psMessage, 0, sizeof(ANT_MESSAGE));
+  psMessage->ANT_MESSAGE_ucSize = MESG_CHANNEL_NUM_SIZE + u8Length_;
+  psMessage->ANT_MESSAGE_ucMesgID = u8MessageId_;
+  psMessage->ANT_MESSAGE_ucChannel = u8Channel_;
+  memcpy(psMessage->ANT_MESSAGE_aucPayload, pu8Payload_, u8Length_);
+  Test_au8RadioChannel[Test_u8RadioHead] = u8Channel_;
+  Test_au8RadioEvent[Test_u8RadioHead] = u8Event_;
+  Test_u8RadioHead = (u8)((Test_u8RadioHead + 1) % TEST_RADIO_QUEUE);
+}
+
+/* The stack reports the channel closed (and stops scanning) shortly after the request */
+uint32_t sd_ant_channel_close(uint8_t ucChannel)
+{
+  Test_bScanning = false;
+  TestRadioEvent(ucChannel, EVENT_CHANNEL_CLOSED, MESG_RESPONSE_EVENT_ID, NULL, 0);
+  return(NRF_SUCCESS);
+}
+
+
+static u32 TestRandom(void)
+{
+  Test_u32Random = Test_u32Random * 1103515245 + 12345;
+  return(Test_u32Random >> 16);
+}
+
+/* Moves the simulated time on: the microsecond timer follows it and the 1ms tick runs */
+static void TestAdvance(u32 u32Us_)
+{
+  u32 u32Ms = (Test_u32NowUs + u32Us_) / 1000 - Test_u32NowUs / 1000;
+
+  Test_u32NowUs += u32Us_;
+  SysTime_u16UsHigh = (u16)(Test_u32NowUs >> 16);
+  NRF_TIMER2->CC[SYSTIME_US_CC_CAPTURE] = Test_u32NowUs & 0xFFFF;
+  for( ; u32Ms != 0; u32Ms--)
+  {
+    SysTimeTick();
+  }
+}
+
+/* A remote's broadcast: heard if scanning, the ID list lets it through and it is not lost.  The extended data is
+the flag byte then the channel ID: device number (LSB first), device type, transmission type. */
+static void TestAir(TestRemoteType* psRemote_)
+{
+  u8 au8Payload[REMOTE_EXT_ID_INDEX + 4];
+  bool bListed = (Test_u8IdListSize == 0);
+
+  for(u8 i = 0; i < Test_u8IdListSize; i++)
+  {
+    bListed |= (Test_au16IdList[i] == psRemote_->u16DeviceNumber);
+  }
+
+  if( psRemote_->bSilent || !Test_bScanning || !bListed || ((TestRandom() % 1000) < Test_u16LossPerMille) )
+  {
+    return;
+  }
+
+  memcpy(au8Payload, psRemote_->au8Page, REMOTE_PAGE_SIZE);
+  au8Payload[REMOTE_EXT_FLAG_INDEX]  = ANT_EXT_MESG_BITFIELD_DEVICE_ID;
+  au8Payload[REMOTE_EXT_ID_INDEX]    = (u8)psRemote_->u16DeviceNumber;
+  au8Payload[REMOTE_EXT_ID_INDEX + 1] = (u8)(psRemote_->u16DeviceNumber >> 8);
+  au8Payload[REMOTE_EXT_ID_INDEX + 2] = REMOTE_DEVICE_TYPE;
+  au8Payload[REMOTE_EXT_ID_INDEX + 3] = REMOTE_TRANSMISSION_TYPE;
+  TestRadioEvent(ANT_CHANNEL_SCAN, EVENT_RX, MESG_BROADCAST_DATA_ID, au8Payload, sizeof(au8Payload));
+}
+
+/* Runs the simulation for u32Us_: remote broadcasts, the event interrupt, and the main loop unless it is busy */
+static void TestRun(u32 u32Us_)
+{
+  u32 u32End = Test_u32NowUs + u32Us_;
+
+  while((s32)(Test_u32NowUs - u32End) < 0)
+  {
+    TestAdvance(TEST_STEP_US);
+
+    for(u8 i = 0; i < TEST_REMOTES; i++)
+    {
+      if((s32)(Test_u32NowUs - Test_asRemotes[i].u32NextTxUs) >= 0)
+      {
+        Test_asRemotes[i].u32NextTxUs += Test_asRemotes[i].u32PeriodUs;
+        TestAir(&Test_asRemotes[i]);
+      }
+    }
+
+    if(Test_u8RadioTail != Test_u8RadioHead)
+    {
+      AntCaptureEvents();
+    }
+
+    /* A pass of the main loop, which may then start rendering a frame */
+    if((s32)(Test_u32NowUs - Test_u32BusyUntilUs) >= 0)
+    {
+      AntUpdate();
+      RemoteUpdate();
+      if( ((Test_u32NowUs % 1000) < TEST_STEP_US) && ((TestRandom() % 100) < TEST_BUSY_PERCENT) )
+      {
+        Test_u32BusyUntilUs = Test_u32NowUs + TEST_BUSY_US;
+      }
+    }
+  }
+}
+
+/* A button press on a remote: the page gets a new sequence number and goes out from the next broadcast on */
+static void TestPress(TestRemoteType* psRemote_, u8 u8Command_, u32 u32Argument_)
+{
+  psRemote_->au8Page[0] = REMOTE_PAGE;
+  psRemote_->au8Page[1]++;
+  psRemote_->au8Page[2] = u8Command_;
+  psRemote_->au8Page[3] = (u8)u32Argument_;
+  psRemote_->au8Page[4] = (u8)(u32Argument_ >> 8);
+  psRemote_->au8Page[5] = (u8)(u32Argument_ >> 16);
+  psRemote_->au8Page[6] = (u8)(u32Argument_ >> 24);
+}
+
+/* Presses a command and runs until it is applied, or for u32TimeoutUs_.  Returns the press to apply time, or
+u32TimeoutUs_ if the command did not take effect (or something else did). */
+static u32 TestCommand(TestRemoteType* psRemote_, u8 u8Command_, u32 u32Argument_, u32 u32TimeoutUs_)
+{
+  u32 u32Applied = Test_u32Applied;
+  u32 u32PressUs = Test_u32NowUs;
+
+  TestPress(psRemote_, u8Command_, u32Argument_);
+  while( (Test_u32Applied == u32Applied) && ((Test_u32NowUs - u32PressUs) < u32TimeoutUs_) )
+  {
+    TestRun(TEST_STEP_US);
+  }
+
+  if( (Test_u32Applied != u32Applied + 1) || (Test_u8AppliedCommand != u8Command_) ||
+      (Test_u32AppliedArgument != u32Argument_) )
+  {
+    return(u32TimeoutUs_);
+  }
+  return(Test_u32AppliedUs - u32PressUs);
+}
+
+static void TestStartRemotes(void)
+{
+  for(u8 i = 0; i < TEST_REMOTES; i++)
+  {
+    Test_asRemotes[i].u16DeviceNumber = (u16)(0x1200 + 0x111 * i);
+    Test_asRemotes[i].u32PeriodUs = TEST_REMOTE_PERIOD_US - 40 * i;
+    Test_asRemotes[i].u32NextTxUs = Test_u32NowUs + (TEST_REMOTE_PERIOD_US / TEST_REMOTES) * i + 1;
+    Test_asRemotes[i].bSilent = false;
+    memset(Test_asRemotes[i].au8Page, 0, REMOTE_PAGE_SIZE);
+    Test_asRemotes[i].au8Page[0] = REMOTE_PAGE;
+  }
+}
+
+
+/* Turning remote mode on closes the upload channel and starts the scan; turning it off gives the channel back */
+static void TestScanMode(void)
+{
+  CHECK(AntIsChannelOpen(ANT_CHANNEL_UPLOAD));
+  CHECK(!RemoteIsEnabled());
+
+  RemoteSetEnabled(true);
+  TestRun(10000);
+  CHECK(Test_bScanning && (Test_u32ScanStarts == 1));
+  CHECK(G_u32AntFlags & _ANT_FLAGS_SCAN_MODE);
+  CHECK(!(G_u32AntFlags & _ANT_FLAGS_CHANNEL_OPEN));
+  CHECK(Test_u8IdListSize == 0);
+  CHECK(Test_au8SettingsSize[SETTINGS_KEY_REMOTE_ENABLED] == 1);
+
+  RemoteSetEnabled(false);
+  TestRun(10000);
+  CHECK(!Test_bScanning && !(G_u32AntFlags & _ANT_FLAGS_SCAN_MODE));
+  CHECK(G_u32AntFlags & _ANT_FLAGS_CHANNEL_OPEN);
+
+  RemoteSetEnabled(true);
+  TestRun(10000);
+  CHECK(Test_bScanning && (Test_u32ScanStarts == 2));
+}
+
+/* End to end: press to command taking effect.  With nothing lost every command takes effect within one remote
+period of the press plus a busy main loop, and the repeats of the page are not applied again.  With losses the
+repeats carry the command a period or two later.  Remotes take turns, pressing at random points in their period. */
+static void TestLatency(u16 u16LossPerMille_)
+{
+  static const u8 au8Commands[] = {REMOTE_CMD_BLANK, REMOTE_CMD_PHASE, REMOTE_CMD_BLANK, REMOTE_CMD_SYNC};
+  RemoteStatsType sBefore;
+  RemoteStatsType sStats;
+  TestRemoteType* psRemote;
+  u32 u32Argument;
+  u32 u32Latency;
+  u32 u32Total = 0;
+  u32 u32Max = 0;
+  u32 u32Late = 0;
+
+  /* Pages already on air are heard first */
+  Test_u16LossPerMille = u16LossPerMille_;
+  TestRun(TEST_REMOTE_PERIOD_US);
+  RemoteGetStats(&sBefore);
+
+  for(u32 i = 0; i < TEST_PRESSES; i++)
+  {
+    TestRun(TEST_STEP_US * (TestRandom() % (TEST_REMOTE_PERIOD_US / TEST_STEP_US)));
+
+    psRemote = &Test_asRemotes[i % TEST_REMOTES];
+    switch(au8Commands[i % sizeof(au8Commands)])
+    {
+      case REMOTE_CMD_PHASE: u32Argument = (u16)(s16)(37 * i - 700); break;
+      case REMOTE_CMD_SYNC:  u32Argument = (i / sizeof(au8Commands)) % (POV_SYNC_SLAVE + 1); break;
+      default:               u32Argument = (i / sizeof(au8Commands)) & 1; break;
+    }
+
+    u32Latency = TestCommand(psRemote, au8Commands[i % sizeof(au8Commands)], u32Argument,
+                             10 * TEST_REMOTE_PERIOD_US);
+    CHECK(u32Latency < 10 * TEST_REMOTE_PERIOD_US);
+    u32Total += u32Latency;
+    if(u32Latency > u32Max)
+    {
+      u32Max = u32Latency;
+    }
+    if(u32Latency > TEST_REMOTE_PERIOD_US)
+    {
+      u32Late++;
+    }
+
+    /* Let the repeats go by */
+    TestRun(2 * TEST_REMOTE_PERIOD_US);
+  }
+
+  RemoteGetStats(&sStats);
+  printf("benchmark, remote command, %u/1000 pages lost: press to apply mean %u us, max %u us, %u/%u later than "
+         "one period; interrupt to apply max %u us\n", u16LossPerMille_, (unsigned)(u32Total / TEST_PRESSES),
+         (unsigned)u32Max, (unsigned)u32Late, (unsigned)TEST_PRESSES, (unsigned)sStats.u32MaxLatencyUs);
+
+  CHECK(sStats.u32Commands - sBefore.u32Commands == TEST_PRESSES);
+  CHECK(sStats.u32Duplicates - sBefore.u32Duplicates >= TEST_PRESSES);
+  CHECK(sStats.u32MaxLatencyUs <= TEST_BUSY_US + TEST_STEP_US);
+  if(u16LossPerMille_ == 0)
+  {
+    CHECK(u32Max <= TEST_REMOTE_PERIOD_US + TEST_BUSY_US + TEST_STEP_US);
+  }
+}
+
+/* Pairing takes the first remote heard and the scan then hears only that one, until pairing is undone */
+static void TestPairing(void)
+{
+  u32 u32Starts = Test_u32ScanStarts;
+
+  Test_u16LossPerMille = 0;
+  Test_asRemotes[0].bSilent = true;
+  Test_asRemotes[2].bSilent = true;
+  RemoteStartPairing();
+  TestRun(REMOTE_RETRY_MS * 1000 + TEST_REMOTE_PERIOD_US);
+  CHECK(Test_u32ScanStarts == u32Starts + 2);
+  CHECK( (Remote_u8PairCount == 1) && (Remote_au16Pairs[0] == Test_asRemotes[1].u16DeviceNumber) );
+  CHECK( (Test_u8IdListSize == 1) && (Test_au16IdList[0] == Test_asRemotes[1].u16DeviceNumber) );
+  CHECK(Test_au8SettingsSize[SETTINGS_KEY_REMOTE_PAIRS] == sizeof(u16));
+
+  /* Only the paired remote is heard */
+  Test_asRemotes[0].bSilent = false;
+  Test_asRemotes[2].bSilent = false;
+  CHECK(TestCommand(&Test_asRemotes[0], REMOTE_CMD_BLANK, 1, 4 * TEST_REMOTE_PERIOD_US) ==
+        4 * TEST_REMOTE_PERIOD_US);
+  CHECK(TestCommand(&Test_asRemotes[1], REMOTE_CMD_BLANK, 0, 4 * TEST_REMOTE_PERIOD_US) <=
+        TEST_REMOTE_PERIOD_US + TEST_BUSY_US + TEST_STEP_US);
+
+  /* Pairing with nothing heard gives up and keeps the list */
+  Test_asRemotes[0].bSilent = true;
+  Test_asRemotes[1].bSilent = true;
+  Test_asRemotes[2].bSilent = true;
+  RemoteStartPairing();
+  TestRun(REMOTE_PAIRING_MS * 1000 + REMOTE_RETRY_MS * 1000);
+  CHECK(!Remote_bPairing && (Remote_u8PairCount == 1) && (Test_u8IdListSize == 1));
+  Test_asRemotes[0].bSilent = false;
+  Test_asRemotes[1].bSilent = false;
+  Test_asRemotes[2].bSilent = false;
+
+  /* The pairs come back after a reset */
+  Remote_u8PairCount = 0;
+  RemoteInitialize();
+  CHECK( (Remote_u8PairCount == 1) && (Remote_au16Pairs[0] == Test_asRemotes[1].u16DeviceNumber) );
+  CHECK(RemoteIsEnabled());
+
+  /* Unpaired, any remote is heard again */
+  RemoteUnpairAll();
+  TestRun(REMOTE_RETRY_MS * 1000);
+  CHECK(Test_bScanning && (Test_u8IdListSize == 0));
+  CHECK(TestCommand(&Test_asRemotes[2], REMOTE_CMD_BLANK, 1, 4 * TEST_REMOTE_PERIOD_US) <=
+        TEST_REMOTE_PERIOD_US + TEST_BUSY_US + TEST_STEP_US);
+}
+
+
+int main(void)
+{
+  SysTimeInitialize();
+  AntInitialize();
+  RemoteInitialize();
+  Test_u32Random = 1;
+  TestStartRemotes();
+
+  TestScanMode();
+  TestLatency(0);
+  TestLatency(100);
+  TestLatency(300);
+  TestPairing();
+
+  return(HostResult("test_remote"));
+}
@@ -0,0 +1,281 @@
+/**********************************************************************************************************************
+File: test_settings.c
+
+Description:
+Host tests for the flash settings store (settings.c) over an emulated NVMC.  The two settings pages are mapped at
+their real address, so the module's u32 addresses work unchanged.  Like the nRF51 flash, a word write can only
+clear bits and an erase sets a page to 0xFF.  A power loss is simulated by a write budget: once it runs out, later
+writes are lost.  Spinning columns are simulated by pointing the SysTime alarm a given slack ahead.
+**********************************************************************************************************************/
+
+#include <sys/mman.h>
+#include "host.h"
+#include "crc16.c"
+#include "system_time.c"
+#include "settings.c"
+
+#define TEST_FLASH_MAP_BASE     (u32)(SETTINGS_PAGE0_ADDRESS & ~0xFFFu)
+#define TEST_FLASH_MAP_SIZE     (u32)0x1000
+#define TEST_NO_POWER_LOSS      (u32)0xFFFFFFFF
+#define TEST_COLUMN_US          (u32)200                  /* Slack between two columns: records only */
+#define TEST_DARK_US            (u32)30000                /* Slack in the dark part of a swing: room for an erase */
+
+volatile u32 G_u32SystemFlags;
+volatile u32 G_u32SystemTime1ms;
+volatile u32 G_u32SystemTime1s;
+volatile u32 G_u32AntFlags;
+u32 G_u32PovFlags;
+
+static u32 Test_u32WritesLeft = TEST_NO_POWER_LOSS;    /* Word writes before the power goes */
+static u32 Test_u32Writes;                             /* Word writes made */
+static u32 Test_u32QuietUs;                            /* AntRadioQuietUs() result */
+
+
+/* Emulated NVMC */
+void nrf_nvmc_write_word(uint32_t address, uint32_t value)
+{
+  if(Test_u32WritesLeft == 0)
+  {
+    return;
+  }
+  if(Test_u32WritesLeft != TEST_NO_POWER_LOSS)
+  {
+    Test_u32WritesLeft--;
+  }
+
+  Test_u32Writes++;
+  *(volatile u32*)(uintptr_t)address &= value;
+}
+
+void nrf_nvmc_write_words(uint32_t address, const uint32_t* src, uint32_t num_words)
+{
+  for(u32 i = 0; i < num_words; i++)
+  {
+    nrf_nvmc_write_word(address + 4 * i, src[i]);
+  }
+}
+
+void nrf_nvmc_page_erase(uint32_t address)
+{
+  if(Test_u32WritesLeft == 0)
+  {
+    return;
+  }
+  memset((void*)(uintptr_t)address, 0xFF, SETTINGS_PAGE_SIZE);
+}
+
+u32 AntRadioQuietUs(void) { return(Test_u32QuietUs); }
+void PovColumnAlarm(u32 u32AlarmTime_) { }
+
+
+/* Columns running with the next one u32SlackUs_ away, or stopped for 0 */
+static void TestColumns(u32 u32SlackUs_)
+{
+  NRF_TIMER2->CC[SYSTIME_US_CC_CAPTURE] = 0;
+  if(u32SlackUs_ == 0)
+  {
+    G_u32PovFlags = 0;
+    SysTime_pfnAlarm = NULL;
+    return;
+  }
+
+  G_u32PovFlags = _POV_FLAGS_LOCKED;
+  SysTime_u32AlarmTime = u32SlackUs_;
+  SysTime_pfnAlarm = PovColumnAlarm;
+}
+
+
+static void TestWriteU32(SettingsKeyType eKey_, u32 u32Value_)
+{
+  CHECK(SettingsWrite(eKey_, (const u8*)&u32Value_, sizeof(u32Value_)));
+}
+
+static u32 TestReadU32(SettingsKeyType eKey_)
+{
+  u32 u32Value = 0;
+
+  CHECK(SettingsRead(eKey_, (u8*)&u32Value, sizeof(u32Value)) == sizeof(u32Value));
+  return(u32Value);
+}
+
+
+static void TestFormat(void)
+{
+  u8 au8Value[4];
+
+  /* Power on with junk in both pages */
+  memset((void*)(uintptr_t)SETTINGS_PAGE0_ADDRESS, 0x5A, 2 * SETTINGS_PAGE_SIZE);
+  SettingsInitialize();
+  CHECK(G_u32SettingsFlags & _SETTINGS_FLAGS_FORMATTED);
+  CHECK(SettingsRead(SETTINGS_KEY_BRIGHTNESS, au8Value, sizeof(au8Value)) == 0);
+  CHECK(SettingsPageBase(1)[0] == SETTINGS_ERASED_WORD);
+
+  SettingsInitialize();
+  CHECK( !(G_u32SettingsFlags & _SETTINGS_FLAGS_FORMATTED) );
+}
+
+static void TestReadWrite(void)
+{
+  u8 au8Long[SETTINGS_MAX_VALUE_SIZE + 1];
+  u8 au8Odd[3] = {1, 2, 3};
+  u8 au8Back[8];
+
+  TestWriteU32(SETTINGS_KEY_BRIGHTNESS, 0x11223344);
+  TestWriteU32(SETTINGS_KEY_POV_IMAGE, 7);
+  CHECK(SettingsWrite(SETTINGS_KEY_ACCEL_CALIBRATION, au8Odd, sizeof(au8Odd)));
+  TestWriteU32(SETTINGS_KEY_BRIGHTNESS, 0x55667788);
+
+  /* Across a reboot the newest record wins */
+  SettingsInitialize();
+  CHECK(TestReadU32(SETTINGS_KEY_BRIGHTNESS) == 0x55667788);
+  CHECK(TestReadU32(SETTINGS_KEY_POV_IMAGE) == 7);
+  CHECK(SettingsRead(SETTINGS_KEY_ACCEL_CALIBRATION, au8Back, sizeof(au8Back)) == 3);
+  CHECK(memcmp(au8Back, au8Odd, 3) == 0);
+
+  /* The same value again costs no flash writes */
+  Test_u32Writes = 0;
+  TestWriteU32(SETTINGS_KEY_BRIGHTNESS, 0x55667788);
+  CHECK(Test_u32Writes == 0);
+
+  /* Bad keys and sizes */
+  CHECK(!SettingsWrite(SETTINGS_KEYS, au8Odd, 1));
+  CHECK(!SettingsWrite(SETTINGS_KEY_BRIGHTNESS, au8Long, sizeof(au8Long)));
+  CHECK(SettingsRead(SETTINGS_KEYS, au8Back, sizeof(au8Back)) == 0);
+}
+
+/* Enough writes to fill both pages a few times over */
+static void TestCompaction(void)
+{
+  u32 u32Generation = Settings_u32Generation;
+
+  for(u32 i = 0; i < 1000; i++)
+  {
+    TestWriteU32(SETTINGS_KEY_BRIGHTNESS, i);
+  }
+  CHECK(SettingsGetEraseCount() >= 6);
+  CHECK(Settings_u32Generation == u32Generation + SettingsGetEraseCount());
+
+  SettingsInitialize();
+  CHECK(TestReadU32(SETTINGS_KEY_BRIGHTNESS) == 999);
+  CHECK(TestReadU32(SETTINGS_KEY_POV_IMAGE) == 7);
+  CHECK(G_u32SettingsFlags == 0);
+}
+
+/* Power lost after the header of a record: the old value stays */
+static void TestTornRecord(void)
+{
+  Test_u32WritesLeft = 1;
+  TestWriteU32(SETTINGS_KEY_POV_IMAGE, 8);
+  Test_u32WritesLeft = TEST_NO_POWER_LOSS;
+
+  SettingsInitialize();
+  CHECK(G_u32SettingsFlags & _SETTINGS_FLAGS_TORN_RECORD);
+  CHECK(TestReadU32(SETTINGS_KEY_POV_IMAGE) == 7);
+
+  /* The log carries on past it */
+  TestWriteU32(SETTINGS_KEY_POV_IMAGE, 9);
+  SettingsInitialize();
+  CHECK(TestReadU32(SETTINGS_KEY_POV_IMAGE) == 9);
+}
+
+/* Power lost at every step of a compaction: every key keeps its old or new value */
+static void TestTornCompaction(void)
+{
+  u32 u32Last = 0;
+  u32 u32Value;
+
+  for(u32 u32Budget = 0; u32Budget < 12; u32Budget++)
+  {
+    /* Fill the page to one record short of a compaction (it is still full after a compaction that was cut off) */
+    while( (Settings_u16WriteOffset + 2) <= SETTINGS_PAGE_WORDS )
+    {
+      u32Last++;
+      TestWriteU32(SETTINGS_KEY_BRIGHTNESS, 5000 + u32Last);
+    }
+
+    Test_u32WritesLeft = u32Budget;
+    TestWriteU32(SETTINGS_KEY_BRIGHTNESS, 1);
+    Test_u32WritesLeft = TEST_NO_POWER_LOSS;
+
+    SettingsInitialize();
+    u32Value = TestReadU32(SETTINGS_KEY_BRIGHTNESS);
+    CHECK( (u32Value == 1) || (u32Value == 5000 + u32Last) );
+    CHECK(TestReadU32(SETTINGS_KEY_POV_IMAGE) == 9);
+    CHECK(SettingsPageBase(Settings_u8ActivePage ^ 1)[0] == SETTINGS_ERASED_WORD);
+  }
+}
+
+/* While the columns spin, a full page waits for slack: the copy goes between columns, the erase in a dark gap */
+static void TestDeferred(void)
+{
+  u32 u32Erases;
+  u32 u32Writes;
+
+  while( (Settings_u16WriteOffset + 2) <= SETTINGS_PAGE_WORDS )
+  {
+    TestWriteU32(SETTINGS_KEY_BRIGHTNESS, Settings_u16WriteOffset);
+  }
+  u32Erases = SettingsGetEraseCount();
+
+  /* No room between columns for even a record: the value is only queued, but reads see it */
+  TestColumns(SETTINGS_WORD_WRITE_US);
+  u32Writes = Test_u32Writes;
+  TestWriteU32(SETTINGS_KEY_BRIGHTNESS, 70);
+  CHECK(TestReadU32(SETTINGS_KEY_BRIGHTNESS) == 70);
+  TestWriteU32(SETTINGS_KEY_BRIGHTNESS, 70);
+  SettingsUpdate();
+  CHECK(Test_u32Writes == u32Writes);
+
+  /* A longer gap: compaction and the record, but not the erase */
+  TestColumns(SETTINGS_PAGE_ERASE_US - 1);
+  SettingsUpdate();
+  CHECK(Settings_au8PendingSize[SETTINGS_KEY_BRIGHTNESS] == SETTINGS_NOT_PENDING);
+  CHECK(Settings_bErasePending);
+  CHECK(SettingsGetEraseCount() == u32Erases);
+
+  /* Records keep going into the new page while the erase waits */
+  TestColumns(TEST_COLUMN_US);
+  TestWriteU32(SETTINGS_KEY_POV_IMAGE, 10);
+  CHECK(Settings_au8PendingSize[SETTINGS_KEY_POV_IMAGE] == SETTINGS_NOT_PENDING);
+
+  /* With RF scheduling on, a dark gap is not enough without a radio quiet window */
+  G_u32AntFlags = _ANT_FLAGS_RF_SCHEDULING;
+  Test_u32QuietUs = SETTINGS_PAGE_ERASE_US - 1;
+  TestColumns(TEST_DARK_US);
+  SettingsUpdate();
+  CHECK(Settings_bErasePending);
+
+  Test_u32QuietUs = SETTINGS_PAGE_ERASE_US;
+  SettingsUpdate();
+  CHECK(!Settings_bErasePending);
+  CHECK(SettingsGetEraseCount() == u32Erases + 1);
+  G_u32AntFlags = 0;
+  TestColumns(0);
+
+  SettingsInitialize();
+  CHECK(TestReadU32(SETTINGS_KEY_BRIGHTNESS) == 70);
+  CHECK(TestReadU32(SETTINGS_KEY_POV_IMAGE) == 10);
+  CHECK(SettingsPageBase(Settings_u8ActivePage ^ 1)[0] == SETTINGS_ERASED_WORD);
+}
+
+
+int main(void)
+{
+  void* pvFlash = mmap((void*)(uintptr_t)TEST_FLASH_MAP_BASE, TEST_FLASH_MAP_SIZE, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+
+  if(pvFlash != (void*)(uintptr_t)TEST_FLASH_MAP_BASE)
+  {
+    printf("test_settings: cannot map the settings pages at 0x%05X\n", (unsigned)TEST_FLASH_MAP_BASE);
+    return(1);
+  }
+
+  TestFormat();
+  TestReadWrite();
+  TestCompaction();
+  TestTornRecord();
+  TestTornCompaction();
+  TestDeferred();
+
+  return(HostResult("test_settings"));
+}
@@ -0,0 +1,316 @@
+/**********************************************************************************************************************
+File: test_system_time.c
+
+Description:
+Host tests for the 1ms system time (system_time.c) and the tick counting and sleep in the board support file.
+TIMER1 is simulated by HostWaitForEvent(): each event moves the time on TEST_WFE_STEP_US and raises the compare
+event when CC[0] is passed.  CC[1] always holds the time, so a capture reads it.  A benchmark times the elapsed and
+deadline checks against the branching IsTimeUp() they replaced.
+**********************************************************************************************************************/
+
+#include <time.h>
+#include "host.h"
+#include "system_time.c"
+#include "abbcn-ehdw-01.c"
+
+#define TEST_WFE_STEP_US      (u32)100
+#define TEST_BENCH_TIMES      (u16)256
+#define TEST_BENCH_LOOPS      (u32)20000
+
+volatile u32 G_u32SystemFlags;
+
+static u32 Test_u32NowUs;                              /* Simulated TIMER1 time, not wrapped */
+static u32 Test_u32WakeAtUs;                           /* SystemWakeRequest() at this time, 0 = never */
+static u32 Test_u32Events;                             /* HostWaitForEvent() calls */
+
+
+/* Soft device calls made by the board support file */
+uint32_t sd_softdevice_is_enabled(uint8_t* p_softdevice_enabled) { *p_softdevice_enabled = 0; return(NRF_SUCCESS); }
+uint32_t sd_clock_hfclk_release(void) { return(NRF_SUCCESS); }
+uint32_t sd_power_system_off(void) { return(NRF_SUCCESS); }
+void HostReset(void) { }
+
+
+static void TestSetTime(u32 u32Us_)
+{
+  Test_u32NowUs = u32Us_;
+  NRF_TIMER1->CC[TIMER_CC_CAPTURE] = (u16)u32Us_;
+}
+
+void HostWaitForEvent(void)
+{
+  u16 u16Before = (u16)Test_u32NowUs;
+
+  Test_u32Events++;
+  TestSetTime(Test_u32NowUs + TEST_WFE_STEP_US);
+
+  if( (u16)(NRF_TIMER1->CC[TIMER_CC_SLEEP] - u16Before - 1) < TEST_WFE_STEP_US )
+  {
+    NRF_TIMER1->EVENTS_COMPARE[TIMER_CC_SLEEP] = 1;
+  }
+
+  if( (Test_u32WakeAtUs != 0) && (Test_u32NowUs >= Test_u32WakeAtUs) )
+  {
+    Test_u32WakeAtUs = 0;
+    SystemWakeRequest();
+  }
+}
+
+static void TestStart(void)
+{
+  TestSetTime(0);
+  Test_u32WakeAtUs = 0;
+  SysTickSetup();
+}
+
+
+/* The 64-bit time and deadlines carry on across the 2^32 ms rollover */
+static void TestWrap(void)
+{
+  SysTimeDeadlineType u32Deadline;
+
+  TestStart();
+  G_u32SystemTime1ms = 0xFFFFFFF0;
+  SysTime_u32HalfEpochs = 1;
+  CHECK(SysTimeGetMs64() == 0x00000000FFFFFFF0ull);
+
+  u32Deadline = SysTimeDeadlineSet(0x20);
+  for(u8 i = 0; i < 0x1F; i++)
+  {
+    SysTimeTick();
+  }
+  CHECK(G_u32SystemTime1ms == 0x0000000F);
+  CHECK(SysTimeGetMs64() == 0x000000010000000Full);
+  CHECK(!SysTimeDeadlineExpired(u32Deadline));
+  CHECK(SysTimeDeadlineRemaining(u32Deadline) == 1);
+  CHECK(SysTimeElapsed(0xFFFFFFF0) == 0x1F);
+
+  SysTimeTick();
+  CHECK(SysTimeDeadlineExpired(u32Deadline));
+  CHECK(SysTimeDeadlineRemaining(u32Deadline) == 0);
+
+  /* Second rollover: the epoch count goes on to 2 */
+  G_u32SystemTime1ms = 0xFFFFFFFF;
+  SysTime_u32HalfEpochs = 3;
+  SysTimeTick();
+  CHECK(SysTimeGetMs64() == 0x0000000200000000ull);
+}
+
+static void TestSeconds(void)
+{
+  TestStart();
+  for(u16 i = 0; i < 2999; i++)
+  {
+    SysTimeTick();
+  }
+  CHECK(G_u32SystemTime1s == 2);
+  SysTimeTick();
+  CHECK(G_u32SystemTime1s == 3);
+}
+
+static void TestSlots(void)
+{
+  TestStart();
+  CHECK(SysTimeNextDeadline() == SYSTIME_NO_DEADLINE);
+
+  SysTimeSlotArm(SYSTIME_SLOT_LEDS, 40);
+  SysTimeSlotArm(SYSTIME_SLOT_ANT, 7);
+  CHECK(SysTimeNextDeadline() == 7);
+
+  SysTimeSlotDisarm(SYSTIME_SLOT_ANT);
+  CHECK(SysTimeNextDeadline() == 40);
+
+  for(u8 i = 0; i < 45; i++)
+  {
+    SysTimeTick();
+  }
+  CHECK(SysTimeNextDeadline() == 0);
+  SysTimeSlotDisarm(SYSTIME_SLOT_LEDS);
+}
+
+/* Ticks are counted from the timer, so a long pass loses no time, including across the 16-bit timer wrap */
+static void TestCountTicks(void)
+{
+  u32 u32Ticks = 0;
+
+  TestStart();
+  TestSetTime(5300);
+  CHECK(SystemCountTicks() == 5);
+  CHECK(G_u32SystemTime1ms == 5);
+  CHECK(SystemCountTicks() == 0);
+
+  /* 700us passes for a bit over two timer wraps */
+  for(u16 i = 0; i < 200; i++)
+  {
+    TestSetTime(Test_u32NowUs + 700);
+    u32Ticks += SystemCountTicks();
+  }
+  CHECK(Test_u32NowUs == 145300);
+  CHECK(u32Ticks == 140);
+  CHECK(G_u32SystemTime1ms == 145);
+
+  /* A 20ms flash erase in one pass */
+  TestSetTime(Test_u32NowUs + 20000);
+  CHECK(SystemCountTicks() == 20);
+  CHECK(G_u32SystemTime1ms == 165);
+}
+
+static void TestSleep(void)
+{
+  /* Nothing armed: the longest sleep */
+  TestStart();
+  TestSetTime(200);
+  SystemSleep();
+  CHECK(G_u32SystemTime1ms == SYSTEM_SLEEP_MAX_MS);
+  CHECK(Test_u32NowUs >= SYSTEM_SLEEP_MAX_MS * 1000);
+  CHECK(Test_u32NowUs < SYSTEM_SLEEP_MAX_MS * 1000 + TEST_WFE_STEP_US);
+  CHECK( !(G_u32SystemFlags & _SYSTEM_SLEEPING) );
+
+  /* The nearest slot limits it */
+  SysTimeSlotArm(SYSTIME_SLOT_BUTTONS, 3);
+  SysTimeSlotArm(SYSTIME_SLOT_POV, 30);
+  TestSetTime(Test_u32NowUs + 150);
+  SystemSleep();
+  CHECK(G_u32SystemTime1ms == SYSTEM_SLEEP_MAX_MS + 3);
+
+  /* An expired slot still waits for the next tick */
+  SystemSleep();
+  CHECK(G_u32SystemTime1ms == SYSTEM_SLEEP_MAX_MS + 4);
+  SysTimeSlotDisarm(SYSTIME_SLOT_BUTTONS);
+  SysTimeSlotDisarm(SYSTIME_SLOT_POV);
+
+  /* A pass that overran returns at once with the time caught up */
+  Test_u32Events = 0;
+  TestSetTime(Test_u32NowUs + 2500);
+  SystemSleep();
+  CHECK(Test_u32Events == 0);
+  CHECK(G_u32SystemTime1ms == SYSTEM_SLEEP_MAX_MS + 6);
+
+  /* A wake request ends the sleep at once */
+  TestStart();
+  Test_u32WakeAtUs = 2300;
+  SystemSleep();
+  CHECK(G_u32SystemTime1ms == 2);
+  CHECK(Test_u32NowUs < 2300 + TEST_WFE_STEP_US);
+
+  /* A request before the first tick still waits for it */
+  TestStart();
+  Test_u32WakeAtUs = 400;
+  SystemSleep();
+  CHECK(G_u32SystemTime1ms == 1);
+}
+
+
+/* Benchmark: the IsTimeUp() before this module, branching on the rollover and one ms short across it */
+static bool TestOldIsTimeUp(u32* pu32SavedTick_, u32 u32Period_)
+{
+  u32 u32TimeElapsed;
+
+  if(G_u32SystemTime1ms >= *pu32SavedTick_)
+  {
+    u32TimeElapsed = G_u32SystemTime1ms - *pu32SavedTick_;
+  }
+  else
+  {
+    u32TimeElapsed = (0xFFFFFFFF - *pu32SavedTick_) + G_u32SystemTime1ms;
+  }
+
+  if(u32TimeElapsed < u32Period_)
+  {
+    return(false);
+  }
+  else
+  {
+    return(true);
+  }
+}
+
+static double TestNowSeconds(void)
+{
+  struct timespec sTime;
+
+  clock_gettime(CLOCK_MONOTONIC, &sTime);
+  return( (double)sTime.tv_sec + (double)sTime.tv_nsec * 1e-9 );
+}
+
+static void TestBenchmark(void)
+{
+  static u32 au32Saved[TEST_BENCH_TIMES];
+  static SysTimeDeadlineType au32Deadline[TEST_BENCH_TIMES];
+  u32 u32Seed = 1;
+  u32 u32Up = 0;
+  u32 u32OldUp = 0;
+  double dStart;
+  double dElapsedNs;
+  double dDeadlineNs;
+  double dOldNs;
+
+  /* Saved times either side of now, half of them across the rollover */
+  G_u32SystemTime1ms = 0x00000100;
+  for(u16 i = 0; i < TEST_BENCH_TIMES; i++)
+  {
+    u32Seed = u32Seed * 1664525 + 1013904223;
+    au32Saved[i] = G_u32SystemTime1ms - (u32Seed >> 23);
+    au32Deadline[i] = au32Saved[i] + 300;
+  }
+
+  /* Same answers, except where the old one was a ms short across the rollover */
+  for(u16 i = 0; i < TEST_BENCH_TIMES; i++)
+  {
+    u32Up += SysTimeElapsed(au32Saved[i]) >= 300;
+    u32OldUp += TestOldIsTimeUp(&au32Saved[i], 300);
+    CHECK(SysTimeDeadlineExpired(au32Deadline[i]) == (SysTimeElapsed(au32Saved[i]) >= 300));
+  }
+  CHECK(u32Up >= u32OldUp);
+
+  dStart = TestNowSeconds();
+  for(u32 n = 0; n < TEST_BENCH_LOOPS; n++)
+  {
+    G_u32SystemTime1ms = 0x00000100 + (n & 0x3FF);
+    for(u16 i = 0; i < TEST_BENCH_TIMES; i++)
+    {
+      u32Up += SysTimeElapsed(au32Saved[i]) >= 300;
+    }
+  }
+  dElapsedNs = (TestNowSeconds() - dStart) * 1e9 / ((double)TEST_BENCH_LOOPS * TEST_BENCH_TIMES);
+
+  dStart = TestNowSeconds();
+  for(u32 n = 0; n < TEST_BENCH_LOOPS; n++)
+  {
+    G_u32SystemTime1ms = 0x00000100 + (n & 0x3FF);
+    for(u16 i = 0; i < TEST_BENCH_TIMES; i++)
+    {
+      u32Up += SysTimeDeadlineExpired(au32Deadline[i]);
+    }
+  }
+  dDeadlineNs = (TestNowSeconds() - dStart) * 1e9 / ((double)TEST_BENCH_LOOPS * TEST_BENCH_TIMES);
+
+  dStart = TestNowSeconds();
+  for(u32 n = 0; n < TEST_BENCH_LOOPS; n++)
+  {
+    G_u32SystemTime1ms = 0x00000100 + (n & 0x3FF);
+    for(u16 i = 0; i < TEST_BENCH_TIMES; i++)
+    {
+      u32OldUp += TestOldIsTimeUp(&au32Saved[i], 300);
+    }
+  }
+  dOldNs = (TestNowSeconds() - dStart) * 1e9 / ((double)TEST_BENCH_LOOPS * TEST_BENCH_TIMES);
+
+  /* The loops' results are used, so the compiler keeps them */
+  CHECK( (u32Up != 0) && (u32OldUp != 0) );
+  printf("benchmark, %u checks: SysTimeElapsed %.2f ns, SysTimeDeadlineExpired %.2f ns, old IsTimeUp %.2f ns\n",
+         (unsigned)(TEST_BENCH_LOOPS * TEST_BENCH_TIMES), dElapsedNs, dDeadlineNs, dOldNs);
+}
+
+
+int main(void)
+{
+  TestWrap();
+  TestSeconds();
+  TestSlots();
+  TestCountTicks();
+  TestSleep();
+  TestBenchmark();
+
+  return(HostResult("test_system_time"));
+}